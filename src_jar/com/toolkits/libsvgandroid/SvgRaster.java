@@ -42,28 +42,37 @@ public class SvgRaster {
 	public native static void svgAndroidDestroy(long id);
 
 	public native static int svgAndroidParseBuffer(long id, String bfr);
+	// base for relative image hrefs, set it before parsing
+	public native static int svgAndroidSetBaseUri(long id, String base);
 
 	public native static int svgAndroidParseChunkBegin(long id);
 	public native static int svgAndroidParseChunk(long id, String bfr);
 	public native static int svgAndroidParseChunkEnd(long id);
 
 	public native static int svgAndroidSetAntialiasing(long id, boolean doIt);
+	// resolution of in, cm, mm, pt and pc lengths, 100 unless set,
+	// e.g. DisplayMetrics.densityDpi
+	public native static int svgAndroidSetDpi(long id, double dpi);
 
+	// a document is rendered by one thread at a time, different
+	// documents can be rendered in parallel
 	public native static int svgAndroidRender(long id, Canvas target);
 	public native static int svgAndroidRenderToArea(long id, Canvas target, int x, int y, int w, int h);
+	// software rendering into an ARGB_8888 bitmap, no canvas involved
+	public native static int svgAndroidRenderToBitmap(long id, Bitmap target);
 
-	public native static void svgAndroidSetBoundingBox(
-		boolean is_in_clip,
-		int left, int top, int right, int bottom);
+	// release bitmaps kept between renders, call from onTrimMemory()
+	public native static void svgAndroidTrimMemory(long id);
+	// bytes of bitmap memory currently kept between renders
+	public native static long svgAndroidGetCacheMemory(long id);
 
 	public static void debugMatrix(Matrix m) {
 		Log.v("Kamoflage", m.toString());
 	}
 
-	public static void setTypeface(
-		Paint p, String family, int weight_n_slant, float textSize, int talign) {
+	// typefaces are cached natively, see _svg_android_select_font()
+	public static Typeface createTypeface(String family, int weight_n_slant) {
 		int style = android.graphics.Typeface.NORMAL;
-		Paint.Align al = Paint.Align.LEFT;
 
 		switch(weight_n_slant) {
 		case 0: // italic, bold
@@ -81,6 +90,13 @@ public class SvgRaster {
 			break;
 		}
 
+		return Typeface.create(family, style);
+	}
+
+	public static void setTypeface(
+		Paint p, Typeface tf, float textSize, int talign) {
+		Paint.Align al = Paint.Align.LEFT;
+
 		switch(talign) {
 		default:
 		case 0:
@@ -94,8 +110,6 @@ public class SvgRaster {
 			break;
 		}
 
-		Typeface tf = Typeface.create(family, style);
-
 		p.setTypeface(tf);
 		p.setTextSize(textSize);
 		p.setTextAlign(al);
@@ -158,37 +172,37 @@ public class SvgRaster {
 		return ret;
 	}
 
-	public static float[] getBounds(Path p) {
-		float[] rv = {(float)0.0, (float)0.0, (float)0.0, (float)0.0};
+	// rv[] = {left, top, right, bottom}, the array is owned by the caller
+	// so that nothing is allocated while rendering
+	public static void getBounds(Path p, float[] rv) {
+		Scratch s = scratch.get();
 
-		RectF r = new RectF();
-		p.computeBounds(r, false);
-		rv[0] = r.left;
-		rv[1] = r.top;
-		rv[2] = r.right;
-		rv[3] = r.bottom;
-
-		return rv;
+		p.computeBounds(s.bounds_rect, false);
+		rv[0] = s.bounds_rect.left;
+		rv[1] = s.bounds_rect.top;
+		rv[2] = s.bounds_rect.right;
+		rv[3] = s.bounds_rect.bottom;
 	}
 
 	public static Matrix matrixCreate(float xx, float yx, float xy, float yy, float x0, float y0) {
 		android.graphics.Matrix x = new android.graphics.Matrix();
-		float[] val = {
-			(float)xx,  (float)xy,  (float)x0,
-			(float)yx,  (float)yy,  (float)y0,
-			(float)0.0, (float)0.0, (float)1.0
-		};
-		x.setValues(val);
+		matrixInit(x, xx, yx, xy, yy, x0, y0);
 		return x;
 	}
 
 	public static void matrixInit(Matrix x, float xx, float yx, float xy, float yy, float x0, float y0) {
-		float[] val = {
-			(float)xx,  (float)xy,  (float)x0,
-			(float)yx,  (float)yy,  (float)y0,
-			(float)0.0, (float)0.0, (float)1.0
-		};
-		x.setValues(val);
+		Scratch s = scratch.get();
+
+		s.matrix_values[Matrix.MSCALE_X] = xx;
+		s.matrix_values[Matrix.MSKEW_X] = xy;
+		s.matrix_values[Matrix.MTRANS_X] = x0;
+		s.matrix_values[Matrix.MSKEW_Y] = yx;
+		s.matrix_values[Matrix.MSCALE_Y] = yy;
+		s.matrix_values[Matrix.MTRANS_Y] = y0;
+		s.matrix_values[Matrix.MPERSP_0] = 0.0f;
+		s.matrix_values[Matrix.MPERSP_1] = 0.0f;
+		s.matrix_values[Matrix.MPERSP_2] = 1.0f;
+		x.setValues(s.matrix_values);
 	}
 
 	public static void setPaintStyle(Paint p, boolean isStroke) {
@@ -225,6 +239,42 @@ public class SvgRaster {
 		}
 	}
 
+	// ops[] = {0 = moveTo, 1 = lineTo, 2 = cubicTo, 3 = quadTo, 4 = close}
+	// args[] holds the coordinates for all ops, in order
+	public static void replayPath(Path p, boolean even_odd, byte[] ops, int op_count, float[] args) {
+		int k, a = 0;
+
+		// the fill rule is inherited natively, the path object is not
+		setFillRule(p, even_odd);
+
+		for(k = 0; k < op_count; k++) {
+			switch(ops[k]) {
+			case 0:
+				p.moveTo(args[a], args[a + 1]);
+				a += 2;
+				break;
+			case 1:
+				p.lineTo(args[a], args[a + 1]);
+				a += 2;
+				break;
+			case 2:
+				p.cubicTo(args[a], args[a + 1],
+					  args[a + 2], args[a + 3],
+					  args[a + 4], args[a + 5]);
+				a += 6;
+				break;
+			case 3:
+				p.quadTo(args[a], args[a + 1],
+					 args[a + 2], args[a + 3]);
+				a += 4;
+				break;
+			case 4:
+				p.close();
+				break;
+			}
+		}
+	}
+
 	public static void setFillRule(Path p, boolean even_odd) {
 		if(even_odd)
 			p.setFillType(Path.FillType.EVEN_ODD);
@@ -232,71 +282,128 @@ public class SvgRaster {
 			p.setFillType(Path.FillType.WINDING);
 	}
 
-	// using this makes SvgRaster non-thread safe... boohoo.. :(
-	// but it will also make us use the GC much less..
-	private static RectF static_rect = new RectF(0.0f, 0.0f, 1.0f, 1.0f);
-	private static RectF static_rect2 = new RectF(0, 0, 1, 1);
-	private static Rect static_rect2i = new Rect(0, 0, 1, 1);
-	private static Matrix static_matrix = new Matrix();
+	// Scratch objects reused by the helpers below, so that we use the GC
+	// much less. There is one set per thread, documents rendered on
+	// different threads don't share anything here.
+	private static class Scratch {
+		RectF static_rect = new RectF(0.0f, 0.0f, 1.0f, 1.0f);
+		RectF static_rect2 = new RectF(0, 0, 1, 1);
+		Rect static_rect2i = new Rect(0, 0, 1, 1);
+		Matrix static_matrix = new Matrix();
+		RectF bounds_rect = new RectF();
+		float[] matrix_values = new float[9];
+
+		Matrix layer_matrix = new Matrix();
+		float[] layer_values = new float[9];
+		Paint layer_paint = new Paint(Paint.FILTER_BITMAP_FLAG);
+
+		Canvas current_screen_canvas = null;
+		float current_screen_canvas_offset_x, current_screen_canvas_offset_y;
+	}
 
-	private static Canvas current_screen_canvas = null;
-	private static float current_screen_canvas_offset_x, current_screen_canvas_offset_y;
+	private static final ThreadLocal<Scratch> scratch = new ThreadLocal<Scratch>() {
+		@Override protected Scratch initialValue() {
+			return new Scratch();
+		}
+	};
 
+	// applies to renders on the calling thread
 	public static void setCurrentScreenCanvas(Canvas cv, float off_x, float off_y) {
-		current_screen_canvas = cv;
-		current_screen_canvas_offset_x = off_x;
-		current_screen_canvas_offset_y = off_y;
+		Scratch s = scratch.get();
+
+		s.current_screen_canvas = cv;
+		s.current_screen_canvas_offset_x = off_x;
+		s.current_screen_canvas_offset_y = off_y;
 //		Log.v("Kamoflage", "   off_y: " + off_y);
 	}
 
-	private static void clipAndSetBoundingBox(Canvas c, RectF r) {
+	// rv[] = {is_in_clip, left, top, right, bottom}
+	private static void clipAndSetBoundingBox(Scratch s, Canvas c, RectF r, float[] rv) {
 		// is_in_clip defaults to true, so that if there is an EMPTY clip
 		// we will still have a valid bounding box..
 		boolean is_in_clip = true;
 
-		c.getMatrix(static_matrix);
-		/* ignore result */ static_matrix.mapRect(r);
+		c.getMatrix(s.static_matrix);
+		/* ignore result */ s.static_matrix.mapRect(r);
 
-		if(c.getClipBounds(static_rect2i)) {
-			static_rect2.left = (float)static_rect2i.left;
-			static_rect2.top = (float)static_rect2i.top;
-			static_rect2.right = (float)static_rect2i.right;
-			static_rect2.bottom = (float)static_rect2i.bottom;
-			/* ignore result */ static_matrix.mapRect(static_rect2);
+		if(c.getClipBounds(s.static_rect2i)) {
+			s.static_rect2.left = (float)s.static_rect2i.left;
+			s.static_rect2.top = (float)s.static_rect2i.top;
+			s.static_rect2.right = (float)s.static_rect2i.right;
+			s.static_rect2.bottom = (float)s.static_rect2i.bottom;
+			/* ignore result */ s.static_matrix.mapRect(s.static_rect2);
 /*
 			Log.v("Kamoflage", "                r(" + r.left + ", " + r.top + ", " + r.right + ", " + r.bottom + ")");
-			Log.v("Kamoflage", "           stat_r(" + static_rect2.left + ", " + static_rect2.top + ", " + static_rect2.right + ", " + static_rect2.bottom + ")");*/
+			Log.v("Kamoflage", "           stat_r(" + s.static_rect2.left + ", " + s.static_rect2.top + ", " + s.static_rect2.right + ", " + s.static_rect2.bottom + ")");*/
 			is_in_clip = r.intersect(
-				(float)static_rect2.left,
-				(float)static_rect2.top,
-				(float)static_rect2.right,
-				(float)static_rect2.bottom
+				(float)s.static_rect2.left,
+				(float)s.static_rect2.top,
+				(float)s.static_rect2.right,
+				(float)s.static_rect2.bottom
 				);
 			//Log.v("Kamoflage", "       -- is_in_clip? " + is_in_clip);
 		}
-		if(c == current_screen_canvas) {
-			svgAndroidSetBoundingBox(is_in_clip,
-						 (int)r.left - (int)current_screen_canvas_offset_x,
-						 (int)r.top - (int)current_screen_canvas_offset_y,
-						 (int)r.right - (int)current_screen_canvas_offset_x,
-						 (int)r.bottom - (int)current_screen_canvas_offset_y);
+		rv[0] = is_in_clip ? 1.0f : 0.0f;
+		if(c == s.current_screen_canvas) {
+			rv[1] = (int)r.left - (int)s.current_screen_canvas_offset_x;
+			rv[2] = (int)r.top - (int)s.current_screen_canvas_offset_y;
+			rv[3] = (int)r.right - (int)s.current_screen_canvas_offset_x;
+			rv[4] = (int)r.bottom - (int)s.current_screen_canvas_offset_y;
 		} else {
-			svgAndroidSetBoundingBox(is_in_clip,
-						 (int)r.left,
-						 (int)r.top,
-						 (int)r.right,
-						 (int)r.bottom);
+			rv[1] = (int)r.left;
+			rv[2] = (int)r.top;
+			rv[3] = (int)r.right;
+			rv[4] = (int)r.bottom;
 		}
 	}
 
-	public static void getBoundingBox(Path p, Canvas c) {
-		p.computeBounds(static_rect, true);
+	// fills rv[] with the canvas matrix (xx, yx, xy, yy, x0, y0) followed
+	// by the device clip bounds (left, top, right, bottom) so that the
+	// native side can compute bounding boxes on its own. An empty clip is
+	// returned as left == right.
+	public static void getCanvasState(Canvas c, float[] rv) {
+		Scratch s = scratch.get();
+		float[] val = s.matrix_values;
+		float off_x = 0.0f, off_y = 0.0f;
+
+		if(c == s.current_screen_canvas) {
+			off_x = s.current_screen_canvas_offset_x;
+			off_y = s.current_screen_canvas_offset_y;
+		}
+
+		c.getMatrix(s.static_matrix);
+		s.static_matrix.getValues(val);
+		rv[0] = val[Matrix.MSCALE_X];
+		rv[1] = val[Matrix.MSKEW_Y];
+		rv[2] = val[Matrix.MSKEW_X];
+		rv[3] = val[Matrix.MSCALE_Y];
+		rv[4] = val[Matrix.MTRANS_X] - off_x;
+		rv[5] = val[Matrix.MTRANS_Y] - off_y;
+
+		if(c.getClipBounds(s.static_rect2i)) {
+			s.static_rect2.set(s.static_rect2i);
+			/* ignore result */ s.static_matrix.mapRect(s.static_rect2);
+			rv[6] = s.static_rect2.left - off_x;
+			rv[7] = s.static_rect2.top - off_y;
+			rv[8] = s.static_rect2.right - off_x;
+			rv[9] = s.static_rect2.bottom - off_y;
+		} else {
+			rv[6] = rv[7] = rv[8] = rv[9] = 0.0f;
+		}
+	}
+
+	// the device space bounding box of p, see clipAndSetBoundingBox()
+	public static void getBoundingBox(Path p, Canvas c, float[] rv) {
+		Scratch s = scratch.get();
+
+		p.computeBounds(s.static_rect, true);
 
 //		Log.v("Kamoflage", "***** getBoundingBox for path.");
-		clipAndSetBoundingBox(c, static_rect);
+		clipAndSetBoundingBox(s, c, s.static_rect, rv);
 	}
 
 	public static void drawEllipse(Canvas c, Paint p, float cx, float cy, float rx, float ry) {
+		Scratch s = scratch.get();
 		float l, t, r, b;
 
 		l = cx - rx;
@@ -304,20 +411,17 @@ public class SvgRaster {
 		r = cx + rx;
 		b = cy + ry;
 
-		static_rect.set(l, t, r, b);
-		c.drawOval(static_rect, p);
-
-		clipAndSetBoundingBox(c, static_rect);
+		s.static_rect.set(l, t, r, b);
+		c.drawOval(s.static_rect, p);
 	}
 
 	public static void drawRect(Canvas c, Paint p,
 				    float x, float y, float w, float h,
 				    float rx, float ry) {
-		static_rect.set(x, y, x + w, y + h);
-		c.drawRoundRect(static_rect, rx, ry, p);
+		Scratch s = scratch.get();
 
-//		Log.v("Kamoflage", "***** getBoundingBox for rect.");
-		clipAndSetBoundingBox(c, static_rect);
+		s.static_rect.set(x, y, x + w, y + h);
+		c.drawRoundRect(s.static_rect, rx, ry, p);
 	}
 
 	public static Bitmap data2bitmap(int w, int h, int[] data) {
@@ -328,4 +432,45 @@ public class SvgRaster {
 		return Bitmap.createBitmap(w, h, Bitmap.Config.ARGB_8888);
 	}
 
+	private static void setLayerMatrix(Scratch s, float xx, float yx, float xy, float yy, float x0, float y0) {
+		s.layer_values[Matrix.MSCALE_X] = xx;
+		s.layer_values[Matrix.MSKEW_X] = xy;
+		s.layer_values[Matrix.MTRANS_X] = x0;
+		s.layer_values[Matrix.MSKEW_Y] = yx;
+		s.layer_values[Matrix.MSCALE_Y] = yy;
+		s.layer_values[Matrix.MTRANS_Y] = y0;
+		s.layer_values[Matrix.MPERSP_0] = 0.0f;
+		s.layer_values[Matrix.MPERSP_1] = 0.0f;
+		s.layer_values[Matrix.MPERSP_2] = 1.0f;
+		s.layer_matrix.setValues(s.layer_values);
+	}
+
+	// group opacity layers are pooled, so both the bitmap and the
+	// canvas are reused here. The matrix maps user space of the group
+	// to the layer pixels.
+	public static void beginLayer(Canvas c, Bitmap b, float xx, float yx, float xy, float yy, float x0, float y0) {
+		Scratch s = scratch.get();
+
+		b.eraseColor(0);
+		c.restoreToCount(1);
+		setLayerMatrix(s, xx, yx, xy, yy, x0, y0);
+		c.setMatrix(s.layer_matrix);
+	}
+
+	// composite the first w x h pixels of a layer, the matrix maps
+	// layer pixels to the user space of c
+	public static void drawLayer(Canvas c, Bitmap b, int w, int h,
+				     float xx, float yx, float xy, float yy, float x0, float y0,
+				     int alpha) {
+		Scratch s = scratch.get();
+
+		setLayerMatrix(s, xx, yx, xy, yy, x0, y0);
+		c.save();
+		c.concat(s.layer_matrix);
+		c.clipRect(0, 0, w, h);
+		s.layer_paint.setAlpha(alpha);
+		c.drawBitmap(b, 0.0f, 0.0f, s.layer_paint);
+		c.restore();
+	}
+
 }
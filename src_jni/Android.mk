@@ -70,11 +70,19 @@ LOCAL_MODULE    := svgandroid
 LOCAL_CFLAGS += -DLIBSVG_EXPAT -DCONFIG_DIR=\"/\" \
 -I../prereqs/include/ \
 -Ijni/libsvg/ \
+-Ijni/libsvg-soft/ \
 -DHAVE_CONFIG_H -Wall
 LOCAL_CPPFLAGS += -DASIO_STANDALONE -std=c++11
 
 # debugging
 #LOCAL_CFLAGS += -DDEBUG_LIBSVG_ANDROID
+# count calls into java per render, see svg-android-internal.h
+#LOCAL_CFLAGS += -DSVG_ANDROID_JNI_STATS
+# keep flattened polylines in 16.16 fixed point (see svg.h). Only the
+# soft engine draws with those, libsvg-android uses them for stroke
+# bounds alone - its paths, transforms and bounding boxes stay in double,
+# so this does not take floating point out of the android engine
+#LOCAL_CFLAGS += -DLIBSVG_FIXED_POINT
 
 LOCAL_STATIC_LIBRARIES := libjpeg libz libpng libexpat
 
@@ -98,6 +106,8 @@ LIBSVG_SOURCES = \
 	libsvg/svg_pattern.c \
 	libsvg/svg_image.c \
 	libsvg/svg_path.c \
+	libsvg/svg_polyline.c \
+	libsvg/svg_stroke.c \
 	libsvg/svg_str.c \
 	libsvg/svg_style.c \
 	libsvg/svg_text.c \
@@ -113,13 +123,27 @@ LIBSVG_ANDROID_SOURCES = \
 	libsvg-android/svg_android_render.c \
 	libsvg-android/svg_android_render_helper.c \
 	libsvg-android/svg_android_state.c \
+	libsvg-android/svg_android_path.c \
+	libsvg-android/svg_android_layer.c \
+	libsvg-android/svg_android_image.c \
+	libsvg-android/svg_android_text.c \
 	libsvg-android/svg-android.h \
 	libsvg-android/svg-android-internal.h \
 	libsvg-android/svg_android_filter.c
 
+# software engine, renders without a canvas
+LIBSVG_SOFT_SOURCES = \
+	libsvg-soft/svg_soft.c \
+	libsvg-soft/svg_soft_render.c \
+	libsvg-soft/svg_soft_ctm.c \
+	libsvg-soft/svg_soft_raster.c \
+	libsvg-soft/svg_soft_paint.c \
+	libsvg-soft/svg-soft.h \
+	libsvg-soft/svg-soft-internal.h
+
 
 # package it
-LOCAL_LDLIBS := -llog
-LOCAL_SRC_FILES := $(LIBSVG_SOURCES) $(LIBSVG_ANDROID_SOURCES)
+LOCAL_LDLIBS := -llog -ljnigraphics
+LOCAL_SRC_FILES := $(LIBSVG_SOURCES) $(LIBSVG_ANDROID_SOURCES) $(LIBSVG_SOFT_SOURCES)
 
 include $(BUILD_SHARED_LIBRARY)
@@ -28,10 +28,12 @@
 #define SVG_ANDROID_INTERNAL_H
 
 #include "svg-android.h"
+#include "svg-soft.h"
 
 #include <jni.h>
 
 #include <stdarg.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -52,19 +54,205 @@ typedef enum svg_android_render_type {
 	SVG_ANDROID_RENDER_TYPE_STROKE
 } svg_android_render_type_t;
 
+/* native mirror of the android canvas matrix, same layout as the
+ * arguments to the transform() callback */
+typedef struct svg_android_ctm {
+	double xx, yx;
+	double xy, yy;
+	double x0, y0;
+} svg_android_ctm_t;
+
+/* op codes for the native path buffer, must match SvgRaster.replayPath() */
+typedef enum svg_android_path_op {
+	SVG_ANDROID_PATH_OP_MOVE_TO = 0,
+	SVG_ANDROID_PATH_OP_LINE_TO = 1,
+	SVG_ANDROID_PATH_OP_CURVE_TO = 2,
+	SVG_ANDROID_PATH_OP_QUAD_TO = 3,
+	SVG_ANDROID_PATH_OP_CLOSE_PATH = 4
+} svg_android_path_op_t;
+
+typedef struct svg_android_path_buffer {
+	jbyte *ops;
+	int num_ops, ops_size;
+
+	jfloat *args;
+	int num_args, args_size;
+
+	// user space extents of the buffered segments, control points included
+	int has_extents;
+	double x1, y1, x2, y2;
+
+	// java side copies, kept as global refs and reused between paths
+	jbyteArray ops_array;
+	int ops_array_size;
+	jfloatArray args_array;
+	int args_array_size;
+} svg_android_path_buffer_t;
+
+/* A path element's geometry kept as an android.graphics.Path global ref.
+ * libsvg stores the entry pointer in svg_path_t.cache and drops it when
+ * the geometry changes, we drop it ourselves when the budget is used up
+ * and clear the owner's pointer so that libsvg emits the segments again.
+ */
+#define SVG_ANDROID_PATH_CACHE_MAX_ENTRIES 256
+
+/* allowed error of the stroke bounds, in device pixels */
+#define SVG_ANDROID_STROKE_TOLERANCE 0.25
+
+typedef struct svg_android_path_cache_entry {
+	jobject path;
+	void **owner;
+
+	svg_fill_rule_t fill_rule;
+
+	// user space extents, so that hits need no bounding box from java
+	int has_extents;
+	double x1, y1, x2, y2;
+
+	// extents of the stroke, valid as long as the style stays the same
+	int has_stroke_extents;
+	svg_stroke_style_t stroke_style;
+	double stroke_extents[4];
+
+	// most recently used first
+	struct svg_android_path_cache_entry *prev, *next;
+} svg_android_path_cache_entry_t;
+
+/* offscreen layer for a translucent group, see svg_android_layer.c */
+typedef struct svg_android_layer {
+	jobject bitmap;
+	jobject canvas;
+	int width, height; // bucketed bitmap size
+	int in_use;
+	int pooled;
+	unsigned int last_used;
+} svg_android_layer_t;
+
+#define SVG_ANDROID_LAYER_POOL_SIZE 8
+
+/* A gradient shader together with everything it was built from. Only
+ * the local matrix depends on the element being painted, so a shader
+ * can be reused for as long as the resolved definition stays the same.
+ */
+typedef struct svg_android_gradient_cache_entry {
+	svg_gradient_t *gradient;
+	svg_gradient_type_t type;
+	svg_gradient_spread_t spread;
+	double geometry[5]; // x1, y1, x2, y2 or fx, fy, r in pixels
+
+	int num_stops;
+	jfloat *offsets;
+	jint *colors;
+
+	jobject shader;
+	unsigned int last_used;
+} svg_android_gradient_cache_entry_t;
+
+#define SVG_ANDROID_GRADIENT_CACHE_SIZE 32
+
+/* A pattern tile rendered at device resolution and its BitmapShader.
+ * The tile is scaled back to pattern space by the shader local matrix.
+ */
+typedef struct svg_android_pattern_cache_entry {
+	svg_element_t *pattern_element;
+	unsigned int generation; // svg_content_generation() at render time
+	svg_pattern_units_t units;
+	svg_pattern_units_t content_units;
+	double width, height; // tile size in pattern space
+	int tile_width, tile_height; // bitmap size in device pixels
+
+	jobject bitmap;
+	jobject shader;
+	size_t bytes;
+	unsigned int last_used;
+} svg_android_pattern_cache_entry_t;
+
+#define SVG_ANDROID_PATTERN_CACHE_SIZE 16
+#define SVG_ANDROID_PATTERN_CACHE_BYTES (8 * 1024 * 1024)
+#define SVG_ANDROID_PATTERN_MAX_TILE 2048
+
+typedef struct svg_android_image_cache_entry {
+	unsigned char *data; // svg_image_t.data the bitmap was made from
+	jobject bitmap;
+	size_t bytes;
+	unsigned int last_used;
+
+	struct svg_android_image_cache_entry *next;
+} svg_android_image_cache_entry_t;
+
+#define SVG_ANDROID_IMAGE_CACHE_BYTES (32 * 1024 * 1024)
+
+/* Typeface.create() result for an interned family and a style */
+typedef struct svg_android_typeface_cache_entry {
+	const char *family;
+	int weight_n_slant;
+	jobject typeface;
+	unsigned int last_used;
+} svg_android_typeface_cache_entry_t;
+
+#define SVG_ANDROID_TYPEFACE_CACHE_SIZE 16
+
+/* DashPathEffect for a dash array (padded to an even length) and offset */
+typedef struct svg_android_dash_cache_entry {
+	jfloat *dash;
+	int num_dashes;
+	jfloat offset;
+	jobject effect;
+	unsigned int last_used;
+} svg_android_dash_cache_entry_t;
+
+#define SVG_ANDROID_DASH_CACHE_SIZE 16
+
+/* Glyph outlines of a text run, see svg_android_text.c. Unlike element
+ * paths these are keyed on what they are made of, so changing the text
+ * or the font simply misses and the old outline ages out.
+ */
+#define SVG_ANDROID_TEXT_CACHE_BUCKETS 256
+#define SVG_ANDROID_TEXT_CACHE_MAX_ENTRIES 512
+
+typedef struct svg_android_text_cache_entry {
+	unsigned int hash;
+	char *utf8;
+	const char *font_family; // interned
+	unsigned int font_weight;
+	svg_font_style_t font_style;
+	double font_size;
+	svg_text_anchor_t text_anchor;
+	double x, y;
+
+	jobject path;
+	svg_fill_rule_t fill_rule;
+
+	int has_extents;
+	double x1, y1, x2, y2;
+
+	struct svg_android_text_cache_entry *bucket_next;
+
+	// most recently used first
+	struct svg_android_text_cache_entry *prev, *next;
+} svg_android_text_cache_entry_t;
+
 typedef struct svg_android_state {
 	svg_android_t *instance;
 
-	// we need to store the last path point, since we cant get it from an android path...
-	// this we need for the arc_to implementation...
-	double last_x, last_y;
-
 	jobject filter_source_bitmap;
 	jobject offscreen_bitmap;
 	jobject background_bitmap;
 
 	svg_bounding_box_t bounding_box;
 
+	// current canvas matrix and device clip, tracked natively so that
+	// bounding boxes can be computed without asking java
+	svg_android_ctm_t ctm;
+	int has_clip;
+	double clip_x1, clip_y1, clip_x2, clip_y2;
+
+	// group opacity layer owned by this state, composited in pop_state
+	svg_android_layer_t *layer;
+	int layer_width, layer_height;
+	double layer_opacity;
+	svg_android_ctm_t layer_ctm; // maps layer pixels to user space of the parent canvas
+
 	jobject saved_filter_canvas; // temporary canvas
 	jobject saved_canvas; // temporary canvas
 
@@ -78,6 +266,7 @@ typedef struct svg_android_state {
 	/* save state data for "copy_android_state" function */
 	svg_fill_rule_t fill_rule;
 	svg_length_t width_len;
+	svg_length_cache_t width_cache; // width_len resolved, see _svg_android_stroke_width()
 	svg_stroke_line_cap_t line_cap;
 	svg_stroke_line_join_t line_join;
 	double miter_limit;
@@ -87,7 +276,7 @@ typedef struct svg_android_state {
 	double fill_opacity;
 	double stroke_opacity;
 
-	char *font_family;
+	const char *font_family; // interned, see _svg_android_intern_font_family()
 	double font_size;
 	svg_font_style_t font_style;
 	unsigned int font_weight;
@@ -96,6 +285,7 @@ typedef struct svg_android_state {
 	double *dash;
 	int num_dashes;
 	double dash_offset;
+	int dash_dirty;
 
 	double opacity;
 
@@ -109,27 +299,21 @@ typedef struct svg_android_state {
 	struct svg_android_state *next;
 } svg_android_state_t;
 
-struct svg_android {
-	svg_t *svg;
-
-	svg_android_state_t *state;
-
-	unsigned int viewport_width;
-	unsigned int viewport_height;
-
-	jboolean do_antialias; // set to !0 for "true", 0 for "false"
-
-	unsigned int fit_to_area; // set to !0 for "true", 0 for "false"
-	unsigned int fit_to_x, fit_to_y, fit_to_w, fit_to_h;
-	double fit_to_scale;
-	jobject fit_to_MATRIX;
-
-//	cairo_t cr;
-	JNIEnv *env;
-
-	jobject canvas; // android canvas reference
-	jobject filter; // filter management object
+/* one per begin_element, a light element did not push a state of its
+ * own and borrows the current one, the fields below are put back into
+ * that state by end_element */
+typedef struct svg_android_element_frame {
+	int light;
+	svg_bounding_box_t bounding_box;
+	jobject path;
+	jobject matrix;
+} svg_android_element_frame_t;
 
+/* Every class and method the engine calls into, looked up once by
+ * JNI_OnLoad (see svg_android.c) and only read after that. Method and
+ * class ids are valid on any thread, so there is nothing per instance
+ * or per JNIEnv here. */
+typedef struct svg_android_jni {
 	jclass filter_clazz; // com/toolkits/libsvgandroid/Filter
 	jclass canvas_clazz; // android Canvas class
 	jclass raster_clazz; // android SvgRaster class
@@ -167,6 +351,7 @@ struct svg_android {
 
 	/* android razter method references */
 	jmethodID raster_setTypeface;
+	jmethodID raster_createTypeface;
 	jmethodID raster_getBounds;
 	jmethodID raster_matrixCreate;
 	jmethodID raster_matrixInit;
@@ -184,6 +369,10 @@ struct svg_android {
 	jmethodID raster_drawEllipse;
 	jmethodID raster_drawRect;
 	jmethodID raster_debugMatrix;
+	jmethodID raster_replayPath;
+	jmethodID raster_getCanvasState;
+	jmethodID raster_beginLayer;
+	jmethodID raster_drawLayer;
 
 	/* android bitmap method references */
 	jmethodID bitmap_erase_color;
@@ -204,10 +393,10 @@ struct svg_android {
 	jmethodID path_clone_constructor;
 	jmethodID path_transform;
 	jmethodID path_moveTo;
- 	jmethodID path_lineTo;
- 	jmethodID path_cubicTo;
- 	jmethodID path_quadTo;
- 	jmethodID path_close;
+	jmethodID path_lineTo;
+	jmethodID path_cubicTo;
+	jmethodID path_quadTo;
+	jmethodID path_close;
 	jmethodID path_reset;
 
 	/* android paint method references */
@@ -224,140 +413,265 @@ struct svg_android {
 
 	/* DashPathEffect method/constructors refs */
 	jmethodID dashPathEffect_constructor;
+} svg_android_jni_t;
+
+extern svg_android_jni_t svg_android_jni;
+
+/* Build with -DSVG_ANDROID_JNI_STATS to have every ANDROID_* call below
+ * counted per method id and logged after each render, which tells what
+ * a document costs in JNI transitions and Java allocations (constructor
+ * calls) without a profiler attached. Compiles to nothing otherwise. */
+#ifdef SVG_ANDROID_JNI_STATS
+#define SVG_ANDROID_JNI_SLOTS (sizeof(svg_android_jni_t) / sizeof(jmethodID))
+#define SVG_ANDROID_JNI_COUNT(a,m) \
+	((a)->jni_calls[offsetof(svg_android_jni_t, m) / sizeof(jmethodID)]++)
+#else
+#define SVG_ANDROID_JNI_COUNT(a,m) ((void)0)
+#endif
+
+struct svg_android {
+	svg_t *svg;
+
+	svg_android_state_t *state;
+
+	// recycled states, see svg_android_state.c
+	svg_android_state_t **state_store;
+	size_t state_store_level, state_store_depth;
+
+	// path segments waiting to be replayed into state->path
+	svg_android_path_buffer_t path_buffer;
+
+	// cached path geometry, see svg_android_path.c
+	svg_android_path_cache_entry_t *path_cache_head, *path_cache_tail;
+	int path_cache_entries;
+
+	// stroke outlines, only used to find the bounds of a stroke
+	svg_polyline_t stroke_path;
+	svg_stroker_t stroker;
+
+	// begin_element/end_element nesting
+	svg_android_element_frame_t *element_frames;
+	int num_element_frames, element_frames_size;
+
+	// stands in for the element matrix of light elements
+	jobject identity_matrix;
+
+	// group opacity layers, kept between renders
+	svg_android_layer_t layer_pool[SVG_ANDROID_LAYER_POOL_SIZE];
+	unsigned int layer_clock;
+
+	// gradient shaders, kept between renders
+	svg_android_gradient_cache_entry_t gradient_cache[SVG_ANDROID_GRADIENT_CACHE_SIZE];
+	unsigned int gradient_clock;
+
+	// rasterized pattern tiles, kept between renders
+	svg_android_pattern_cache_entry_t pattern_cache[SVG_ANDROID_PATTERN_CACHE_SIZE];
+	unsigned int pattern_clock;
+	size_t pattern_cache_bytes;
+
+	// decoded images as android bitmaps, see svg_android_image.c
+	svg_android_image_cache_entry_t *image_cache_head;
+	size_t image_cache_bytes;
+	unsigned int image_clock;
+
+	// font families used by states, they live as long as the instance so
+	// that equal families can be compared by pointer
+	char **font_families;
+	int num_font_families, font_families_size;
+
+	svg_android_typeface_cache_entry_t typeface_cache[SVG_ANDROID_TYPEFACE_CACHE_SIZE];
+	unsigned int typeface_clock;
+
+	svg_android_dash_cache_entry_t dash_cache[SVG_ANDROID_DASH_CACHE_SIZE];
+	unsigned int dash_clock;
+
+	// text outlines, see svg_android_text.c
+	svg_android_text_cache_entry_t *text_cache[SVG_ANDROID_TEXT_CACHE_BUCKETS];
+	svg_android_text_cache_entry_t *text_cache_head, *text_cache_tail;
+	int text_cache_entries;
+
+	jobject scratch_matrix; // see _svg_android_scratch_matrix()
+	jfloatArray scratch_floats; // see _svg_android_scratch_floats()
+
+	// user space extents of the path being painted, for bounding box units
+	int path_has_extents;
+	double path_x1, path_y1, path_x2, path_y2;
+
+	// root offscreen, only used by documents with filters
+	jobject root_bitmap;
+	int root_bitmap_width, root_bitmap_height;
+
+	// created by the first svgAndroidRenderToBitmap()
+	svg_soft_t *soft;
+
+	unsigned int viewport_width;
+	unsigned int viewport_height;
+
+	jboolean do_antialias; // set to !0 for "true", 0 for "false"
+
+	unsigned int fit_to_area; // set to !0 for "true", 0 for "false"
+	unsigned int fit_to_x, fit_to_y, fit_to_w, fit_to_h;
+	double fit_to_scale;
+	jobject fit_to_MATRIX;
+
+//	cairo_t cr;
+	JNIEnv *env;
+
+	jobject canvas; // android canvas reference
+	jobject filter; // filter management object
+
+#ifdef SVG_ANDROID_JNI_STATS
+	unsigned int jni_calls[SVG_ANDROID_JNI_SLOTS]; // since the render began
+#endif
 };
 
 #define ANDROID_CANVAS_CREATE(a,B) \
-	(*(a->env))->NewObject(a->env, a->canvas_clazz,a->canvas_constructor,B)
+	(SVG_ANDROID_JNI_COUNT(a, canvas_constructor), (*(a->env))->NewObject(a->env, svg_android_jni.canvas_clazz,svg_android_jni.canvas_constructor,B))
 #define ANDROID_SAVE(a) \
-	(*(a->env))->CallIntMethod(a->env, a->canvas, a->canvas_save)
+	(SVG_ANDROID_JNI_COUNT(a, canvas_save), (*(a->env))->CallIntMethod(a->env, a->canvas, svg_android_jni.canvas_save))
 #define ANDROID_RESTORE(a) \
-	(*(a->env))->CallVoidMethod(a->env, a->canvas, a->canvas_restore)
+	(SVG_ANDROID_JNI_COUNT(a, canvas_restore), (*(a->env))->CallVoidMethod(a->env, a->canvas, svg_android_jni.canvas_restore))
 #define ANDROID_CANVAS_CLIP_RECT(a,l,t,r,b)				\
-	(*(a->env))->CallBooleanMethod(a->env, a->canvas, a->canvas_clip_rect, l, t, r, b)
+	(SVG_ANDROID_JNI_COUNT(a, canvas_clip_rect), (*(a->env))->CallBooleanMethod(a->env, a->canvas, svg_android_jni.canvas_clip_rect, l, t, r, b))
 #define ANDROID_CANVAS_CONCAT_MATRIX(a,m) \
-	(*(a->env))->CallVoidMethod(a->env, a->canvas, a->canvas_concat, m)
+	(SVG_ANDROID_JNI_COUNT(a, canvas_concat), (*(a->env))->CallVoidMethod(a->env, a->canvas, svg_android_jni.canvas_concat, m))
 #define ANDROID_DRAW_BITMAP(a,b,m) \
-	(*(a->env))->CallVoidMethod(a->env, a->canvas, a->canvas_draw_bitmap, b, m, NULL)
+	(SVG_ANDROID_JNI_COUNT(a, canvas_draw_bitmap), (*(a->env))->CallVoidMethod(a->env, a->canvas, svg_android_jni.canvas_draw_bitmap, b, m, NULL))
 #define ANDROID_DRAW_BITMAP2(a,b,x,y)					\
-	(*(a->env))->CallVoidMethod(a->env, a->canvas, a->canvas_draw_bitmap2, b, x, y, NULL)
+	(SVG_ANDROID_JNI_COUNT(a, canvas_draw_bitmap2), (*(a->env))->CallVoidMethod(a->env, a->canvas, svg_android_jni.canvas_draw_bitmap2, b, x, y, NULL))
 #define ANDROID_DRAW_PATH(a,p,P) \
-	(*(a->env))->CallVoidMethod(a->env, a->canvas, a->canvas_draw_path, p, P)
+	(SVG_ANDROID_JNI_COUNT(a, canvas_draw_path), (*(a->env))->CallVoidMethod(a->env, a->canvas, svg_android_jni.canvas_draw_path, p, P))
 #define ANDROID_DRAW_TEXT(e,T,X,Y) \
-	(*(e->env))->CallVoidMethod(e->env, e->canvas, e->canvas_draw_text, (*(e->env))->NewStringUTF(e->env, T), X, Y, e->state->paint)
+	(SVG_ANDROID_JNI_COUNT(e, canvas_draw_text), (*(e->env))->CallVoidMethod(e->env, e->canvas, svg_android_jni.canvas_draw_text, (*(e->env))->NewStringUTF(e->env, T), X, Y, e->state->paint))
 #define ANDROID_DRAW_RGB(a,R,G,B)					\
-	(*(a->env))->CallVoidMethod(a->env, a->canvas, a->canvas_drawRGB, R, G, B)
+	(SVG_ANDROID_JNI_COUNT(a, canvas_drawRGB), (*(a->env))->CallVoidMethod(a->env, a->canvas, svg_android_jni.canvas_drawRGB, R, G, B))
 #define ANDROID_GET_WIDTH(a)					\
-	(*(a->env))->CallIntMethod(a->env, a->canvas, a->canvas_getWidth)
+	(SVG_ANDROID_JNI_COUNT(a, canvas_getWidth), (*(a->env))->CallIntMethod(a->env, a->canvas, svg_android_jni.canvas_getWidth))
 #define ANDROID_GET_HEIGHT(a)					\
-	(*(a->env))->CallIntMethod(a->env, a->canvas, a->canvas_getHeight)
-
-#define ANDROID_SET_TYPEFACE(e,F,W,S,A)				\
-	(*(e->env))->CallStaticVoidMethod(e->env, e->raster_clazz, e->raster_setTypeface, e->state->paint, (*(e->env))->NewStringUTF(e->env, F), W, S, A)
-#define ANDROID_PATH_GET_BOUNDS(e,P) \
-	(*(e->env))->CallStaticObjectMethod(e->env, e->raster_clazz, e->raster_getBounds, P)
+	(SVG_ANDROID_JNI_COUNT(a, canvas_getHeight), (*(a->env))->CallIntMethod(a->env, a->canvas, svg_android_jni.canvas_getHeight))
+
+#define ANDROID_SET_TYPEFACE(e,T,S,A)				\
+	(SVG_ANDROID_JNI_COUNT(e, raster_setTypeface), (*(e->env))->CallStaticVoidMethod(e->env, svg_android_jni.raster_clazz, svg_android_jni.raster_setTypeface, e->state->paint, T, S, A))
+#define ANDROID_CREATE_TYPEFACE(e,F,W)				\
+	(SVG_ANDROID_JNI_COUNT(e, raster_createTypeface), (*(e->env))->CallStaticObjectMethod(e->env, svg_android_jni.raster_clazz, svg_android_jni.raster_createTypeface, F, W))
+#define ANDROID_PATH_GET_BOUNDS(e,P,F) \
+	(SVG_ANDROID_JNI_COUNT(e, raster_getBounds), (*(e->env))->CallStaticVoidMethod(e->env, svg_android_jni.raster_clazz, svg_android_jni.raster_getBounds, P, F))
 #define ANDROID_MATRIX_CREATE(e,A,B,C,D,E,F) \
-	(*(e->env))->CallStaticObjectMethod(e->env, e->raster_clazz, e->raster_matrixCreate, A, B, C, D, E, F)
+	(SVG_ANDROID_JNI_COUNT(e, raster_matrixCreate), (*(e->env))->CallStaticObjectMethod(e->env, svg_android_jni.raster_clazz, svg_android_jni.raster_matrixCreate, A, B, C, D, E, F))
 #define ANDROID_MATRIX_INIT(e,m,A,B,C,D,E,F)				\
-	(*(e->env))->CallStaticVoidMethod(e->env, e->raster_clazz, e->raster_matrixInit, m, A, B, C, D, E, F)
+	(SVG_ANDROID_JNI_COUNT(e, raster_matrixInit), (*(e->env))->CallStaticVoidMethod(e->env, svg_android_jni.raster_clazz, svg_android_jni.raster_matrixInit, m, A, B, C, D, E, F))
 #define ANDROID_CREATE_BITMAP(a,w,h) \
-	(*(a->env))->CallStaticObjectMethod(a->env, a->raster_clazz, a->raster_createBitmap, w, h)
+	(SVG_ANDROID_JNI_COUNT(a, raster_createBitmap), (*(a->env))->CallStaticObjectMethod(a->env, svg_android_jni.raster_clazz, svg_android_jni.raster_createBitmap, w, h))
 #define ANDROID_DATA_2_BITMAP(a,d,w,h)					\
-	(*(a->env))->CallStaticObjectMethod(a->env, a->raster_clazz, a->raster_data2bitmap, w, h, d)
+	(SVG_ANDROID_JNI_COUNT(a, raster_data2bitmap), (*(a->env))->CallStaticObjectMethod(a->env, svg_android_jni.raster_clazz, svg_android_jni.raster_data2bitmap, w, h, d))
 
  // e == jbool true ? EVEN_ODD : WINDING
 #define ANDROID_SET_FILL_TYPE(a,p,e) \
-	(*(a->env))->CallStaticVoidMethod(a->env, a->raster_clazz, a->raster_setFillRule, p, e)
+	(SVG_ANDROID_JNI_COUNT(a, raster_setFillRule), (*(a->env))->CallStaticVoidMethod(a->env, svg_android_jni.raster_clazz, svg_android_jni.raster_setFillRule, p, e))
 
  // s = {TRUE = STROKE, FALSE = FILL}
 #define ANDROID_SET_PAINT_STYLE(a,p,s) \
-	(*(a->env))->CallStaticVoidMethod(a->env, a->raster_clazz, a->raster_setPaintStyle,p,s)
+	(SVG_ANDROID_JNI_COUNT(a, raster_setPaintStyle), (*(a->env))->CallStaticVoidMethod(a->env, svg_android_jni.raster_clazz, svg_android_jni.raster_setPaintStyle,p,s))
 
  // c[3] = {0 = BUTT, 1 = ROUND, 2/* = SQUARE}
 #define ANDROID_SET_STROKE_CAP(a,p,c) \
-	(*(a->env))->CallStaticVoidMethod(a->env, a->raster_clazz, a->raster_setStrokeCap,p,c)
+	(SVG_ANDROID_JNI_COUNT(a, raster_setStrokeCap), (*(a->env))->CallStaticVoidMethod(a->env, svg_android_jni.raster_clazz, svg_android_jni.raster_setStrokeCap,p,c))
 
  // c[3] = {0 = MITER, 1 = ROUND, 2/* = BEVEL}
 #define ANDROID_SET_STROKE_JOIN(a,p,c) \
-	(*(a->env))->CallStaticVoidMethod(a->env, a->raster_clazz, a->raster_setStrokeJoin,p,c)
+	(SVG_ANDROID_JNI_COUNT(a, raster_setStrokeJoin), (*(a->env))->CallStaticVoidMethod(a->env, svg_android_jni.raster_clazz, svg_android_jni.raster_setStrokeJoin,p,c))
 #define ANDROID_CREATE_BITMAP_SHADER(a,B) \
-	(*(a->env))->CallStaticObjectMethod(a->env, a->raster_clazz, a->raster_createBitmapShader,B)
+	(SVG_ANDROID_JNI_COUNT(a, raster_createBitmapShader), (*(a->env))->CallStaticObjectMethod(a->env, svg_android_jni.raster_clazz, svg_android_jni.raster_createBitmapShader,B))
 #define ANDROID_CREATE_LINEAR_GRADIENT(a,L,T,R,B,C,O,S) \
-	(*(a->env))->CallStaticObjectMethod(a->env, a->raster_clazz, a->raster_createLinearGradient,L,T,R,B,C,O,S)
+	(SVG_ANDROID_JNI_COUNT(a, raster_createLinearGradient), (*(a->env))->CallStaticObjectMethod(a->env, svg_android_jni.raster_clazz, svg_android_jni.raster_createLinearGradient,L,T,R,B,C,O,S))
 #define ANDROID_CREATE_RADIAL_GRADIENT(a,X,Y,R,C,O,S) \
-	(*(a->env))->CallStaticObjectMethod(a->env, a->raster_clazz, a->raster_createRadialGradient,X,Y,R,C,O,S)
+	(SVG_ANDROID_JNI_COUNT(a, raster_createRadialGradient), (*(a->env))->CallStaticObjectMethod(a->env, svg_android_jni.raster_clazz, svg_android_jni.raster_createRadialGradient,X,Y,R,C,O,S))
 #define ANDROID_MATRIX_INVERT(a,m) \
-	(*(a->env))->CallStaticObjectMethod(a->env, a->raster_clazz, a->raster_matrixInvert, m)
-#define ANDROID_GET_PATH_BOUNDING_BOX(a,P)				\
-	(*(a->env))->CallStaticVoidMethod(a->env, a->raster_clazz, a->raster_getBoundingBox, P, a->canvas)
+	(SVG_ANDROID_JNI_COUNT(a, raster_matrixInvert), (*(a->env))->CallStaticObjectMethod(a->env, svg_android_jni.raster_clazz, svg_android_jni.raster_matrixInvert, m))
+#define ANDROID_GET_PATH_BOUNDING_BOX(a,P,F)				\
+	(SVG_ANDROID_JNI_COUNT(a, raster_getBoundingBox), (*(a->env))->CallStaticVoidMethod(a->env, svg_android_jni.raster_clazz, svg_android_jni.raster_getBoundingBox, P, a->canvas, F))
 #define ANDROID_DRAW_ELLIPSE(a,A,B,C,D)				\
-	(*(a->env))->CallStaticVoidMethod(a->env, a->raster_clazz, a->raster_drawEllipse, a->canvas, a->state->paint, A, B, C, D)
+	(SVG_ANDROID_JNI_COUNT(a, raster_drawEllipse), (*(a->env))->CallStaticVoidMethod(a->env, svg_android_jni.raster_clazz, svg_android_jni.raster_drawEllipse, a->canvas, a->state->paint, A, B, C, D))
 #define ANDROID_DRAW_RECT(a,X,Y,W,H,RX,RY)				\
-	(*(a->env))->CallStaticVoidMethod(a->env, a->raster_clazz, a->raster_drawRect, a->canvas, a->state->paint, X, Y, W, H, RX, RY)
+	(SVG_ANDROID_JNI_COUNT(a, raster_drawRect), (*(a->env))->CallStaticVoidMethod(a->env, svg_android_jni.raster_clazz, svg_android_jni.raster_drawRect, a->canvas, a->state->paint, X, Y, W, H, RX, RY))
+#define ANDROID_PATH_REPLAY(a,P,E,O,N,A)				\
+	(SVG_ANDROID_JNI_COUNT(a, raster_replayPath), (*(a->env))->CallStaticVoidMethod(a->env, svg_android_jni.raster_clazz, svg_android_jni.raster_replayPath, P, E, O, N, A))
+#define ANDROID_GET_CANVAS_STATE(a,F)					\
+	(SVG_ANDROID_JNI_COUNT(a, raster_getCanvasState), (*(a->env))->CallStaticVoidMethod(a->env, svg_android_jni.raster_clazz, svg_android_jni.raster_getCanvasState, a->canvas, F))
+#define ANDROID_BEGIN_LAYER(a,C,B,M)					\
+	(SVG_ANDROID_JNI_COUNT(a, raster_beginLayer), (*(a->env))->CallStaticVoidMethod(a->env, svg_android_jni.raster_clazz, svg_android_jni.raster_beginLayer, C, B, \
+					  (jfloat)(M)->xx, (jfloat)(M)->yx, (jfloat)(M)->xy, (jfloat)(M)->yy, \
+					  (jfloat)(M)->x0, (jfloat)(M)->y0))
+#define ANDROID_DRAW_LAYER(a,B,W,H,M,A)					\
+	(SVG_ANDROID_JNI_COUNT(a, raster_drawLayer), (*(a->env))->CallStaticVoidMethod(a->env, svg_android_jni.raster_clazz, svg_android_jni.raster_drawLayer, a->canvas, B, W, H, \
+					  (jfloat)(M)->xx, (jfloat)(M)->yx, (jfloat)(M)->xy, (jfloat)(M)->yy, \
+					  (jfloat)(M)->x0, (jfloat)(M)->y0, A))
 #define ANDROID_DEBUG_MATRIX(a,A)				\
-	(*(a->env))->CallStaticVoidMethod(a->env, a->raster_clazz, a->raster_debugMatrix, A)
+	(SVG_ANDROID_JNI_COUNT(a, raster_debugMatrix), (*(a->env))->CallStaticVoidMethod(a->env, svg_android_jni.raster_clazz, svg_android_jni.raster_debugMatrix, A))
 
 #define ANDROID_FILL_BITMAP(a,b,c) \
-	(*(a->env))->CallVoidMethod(a->env, b, a->bitmap_erase_color, c)
+	(SVG_ANDROID_JNI_COUNT(a, bitmap_erase_color), (*(a->env))->CallVoidMethod(a->env, b, svg_android_jni.bitmap_erase_color, c))
 
 #define ANDROID_IDENTITY_MATRIX(a) \
-	(*(a->env))->NewObject(a->env, a->matrix_clazz,a->matrix_constructor)
+	(SVG_ANDROID_JNI_COUNT(a, matrix_constructor), (*(a->env))->NewObject(a->env, svg_android_jni.matrix_clazz,svg_android_jni.matrix_constructor))
 #define ANDROID_MATRIX_TRANSLATE(a,m,x,y)				\
-	(*(a->env))->CallBooleanMethod(a->env, m,a->matrix_postTranslate,x,y)
+	(SVG_ANDROID_JNI_COUNT(a, matrix_postTranslate), (*(a->env))->CallBooleanMethod(a->env, m,svg_android_jni.matrix_postTranslate,x,y))
 #define ANDROID_MATRIX_SCALE(a,m,x,y)			\
-	(*(a->env))->CallBooleanMethod(a->env, m,a->matrix_postScale,x,y)
+	(SVG_ANDROID_JNI_COUNT(a, matrix_postScale), (*(a->env))->CallBooleanMethod(a->env, m,svg_android_jni.matrix_postScale,x,y))
 #define ANDROID_MATRIX_MULTIPLY(a,m,M)			\
-	(*(a->env))->CallBooleanMethod(a->env, m,a->matrix_postConcat,M)
+	(SVG_ANDROID_JNI_COUNT(a, matrix_postConcat), (*(a->env))->CallBooleanMethod(a->env, m,svg_android_jni.matrix_postConcat,M))
 #define ANDROID_MATRIX_RESET(a,m)			\
-	(*(a->env))->CallVoidMethod(a->env, m,a->matrix_reset)
+	(SVG_ANDROID_JNI_COUNT(a, matrix_reset), (*(a->env))->CallVoidMethod(a->env, m,svg_android_jni.matrix_reset))
 #define ANDROID_MATRIX_SET(a,m,M)			\
-	(*(a->env))->CallVoidMethod(a->env, m,a->matrix_set,M)
+	(SVG_ANDROID_JNI_COUNT(a, matrix_set), (*(a->env))->CallVoidMethod(a->env, m,svg_android_jni.matrix_set,M))
 
 #define ANDROID_SHADER_SET_MATRIX(a,s,m) \
-	(*(a->env))->CallVoidMethod(a->env, s, a->shader_setLocalMatrix, m)
+	(SVG_ANDROID_JNI_COUNT(a, shader_setLocalMatrix), (*(a->env))->CallVoidMethod(a->env, s, svg_android_jni.shader_setLocalMatrix, m))
 
 #define ANDROID_PATH_CREATE(a) \
-	(*(a->env))->NewObject(a->env, a->path_clazz, a->path_constructor)
+	(SVG_ANDROID_JNI_COUNT(a, path_constructor), (*(a->env))->NewObject(a->env, svg_android_jni.path_clazz, svg_android_jni.path_constructor))
 #define ANDROID_PATH_CLONE(a, b)						\
-	(*(a->env))->NewObject(a->env, a->path_clazz, a->path_clone_constructor, b)
+	(SVG_ANDROID_JNI_COUNT(a, path_clone_constructor), (*(a->env))->NewObject(a->env, svg_android_jni.path_clazz, svg_android_jni.path_clone_constructor, b))
 #define ANDROID_PATH_TRANSFORM(a,m)					\
-	(*(a->env))->CallVoidMethod(a->env, a->state->path, a->path_transform, m)
+	(SVG_ANDROID_JNI_COUNT(a, path_transform), (*(a->env))->CallVoidMethod(a->env, a->state->path, svg_android_jni.path_transform, m))
 #define ANDROID_PATH_MOVE_TO(a,x,y) \
-	(*(a->env))->CallVoidMethod(a->env, a->state->path, a->path_moveTo, x, y)
+	(SVG_ANDROID_JNI_COUNT(a, path_moveTo), (*(a->env))->CallVoidMethod(a->env, a->state->path, svg_android_jni.path_moveTo, x, y))
 #define ANDROID_PATH_LINE_TO(a,x,y) \
-	(*(a->env))->CallVoidMethod(a->env, a->state->path, a->path_lineTo, x, y)
+	(SVG_ANDROID_JNI_COUNT(a, path_lineTo), (*(a->env))->CallVoidMethod(a->env, a->state->path, svg_android_jni.path_lineTo, x, y))
 #define ANDROID_PATH_CURVE_TO(a,x1,y1,x2,y2,x3,y3) \
-	(*(a->env))->CallVoidMethod(a->env, a->state->path, a->path_cubicTo, x1, y1, x2, y2, x3, y3)
+	(SVG_ANDROID_JNI_COUNT(a, path_cubicTo), (*(a->env))->CallVoidMethod(a->env, a->state->path, svg_android_jni.path_cubicTo, x1, y1, x2, y2, x3, y3))
 #define ANDROID_PATH_QUADRATIC_CURVE_TO(a,x1,y1,x2,y2)	\
-	(*(a->env))->CallVoidMethod(a->env, a->state->path, a->path_quadTo, x1, y1, x2, y2)
+	(SVG_ANDROID_JNI_COUNT(a, path_quadTo), (*(a->env))->CallVoidMethod(a->env, a->state->path, svg_android_jni.path_quadTo, x1, y1, x2, y2))
 #define ANDROID_PATH_CLOSE(a) \
-	(*(a->env))->CallVoidMethod(a->env, a->state->path, a->path_close)
+	(SVG_ANDROID_JNI_COUNT(a, path_close), (*(a->env))->CallVoidMethod(a->env, a->state->path, svg_android_jni.path_close))
 #define ANDROID_PATH_CLEAR(a,b)					\
-	(*(a->env))->CallVoidMethod(a->env, b, a->path_reset)
+	(SVG_ANDROID_JNI_COUNT(a, path_reset), (*(a->env))->CallVoidMethod(a->env, b, svg_android_jni.path_reset))
 
 #define ANDROID_PAINT_CREATE(a)	\
-	(*(a->env))->NewObject(a->env, a->paint_clazz, a->paint_constructor)
+	(SVG_ANDROID_JNI_COUNT(a, paint_constructor), (*(a->env))->NewObject(a->env, svg_android_jni.paint_clazz, svg_android_jni.paint_constructor))
 #define ANDROID_PAINT_SET_EFFECT(a,b) \
-	(*(a->env))->CallObjectMethod(a->env, a->state->paint, a->paint_setPathEffect, b)
+	(SVG_ANDROID_JNI_COUNT(a, paint_setPathEffect), (*(a->env))->CallObjectMethod(a->env, a->state->paint, svg_android_jni.paint_setPathEffect, b))
 #define ANDROID_PAINT_SET_COLOR(a,A,R,G,B) \
-	(*(a->env))->CallVoidMethod(a->env, a->state->paint, a->paint_setARGB, A, R, G, B)
+	(SVG_ANDROID_JNI_COUNT(a, paint_setARGB), (*(a->env))->CallVoidMethod(a->env, a->state->paint, svg_android_jni.paint_setARGB, A, R, G, B))
+ // setShader() hands back its argument as a new local reference, drop it
 #define ANDROID_PAINT_SET_SHADER(a,S) \
-	(void)(*(a->env))->CallObjectMethod(a->env, a->state->paint, a->paint_setShader, S)
+	(SVG_ANDROID_JNI_COUNT(a, paint_setShader), (*(a->env))->DeleteLocalRef(a->env, (*(a->env))->CallObjectMethod(a->env, a->state->paint, svg_android_jni.paint_setShader, S)))
 #define ANDROID_PAINT_SET_MITER_LIMIT(a,b)	\
-	(*(a->env))->CallVoidMethod(a->env, a->state->paint, a->paint_setStrokeMiter, b)
+	(SVG_ANDROID_JNI_COUNT(a, paint_setStrokeMiter), (*(a->env))->CallVoidMethod(a->env, a->state->paint, svg_android_jni.paint_setStrokeMiter, b))
 #define ANDROID_PAINT_SET_STROKE_WIDTH(a,b)	\
-	(*(a->env))->CallVoidMethod(a->env, a->state->paint, a->paint_setStrokeWidth, b)
+	(SVG_ANDROID_JNI_COUNT(a, paint_setStrokeWidth), (*(a->env))->CallVoidMethod(a->env, a->state->paint, svg_android_jni.paint_setStrokeWidth, b))
 #define ANDROID_PAINT_SET(a,p,P)					\
-	(*(a->env))->CallVoidMethod(a->env, p, a->paint_set, P)
+	(SVG_ANDROID_JNI_COUNT(a, paint_set), (*(a->env))->CallVoidMethod(a->env, p, svg_android_jni.paint_set, P))
 #define ANDROID_PAINT_RESET(a,p)	\
-	(*(a->env))->CallVoidMethod(a->env, p, a->paint_reset)
+	(SVG_ANDROID_JNI_COUNT(a, paint_reset), (*(a->env))->CallVoidMethod(a->env, p, svg_android_jni.paint_reset))
 
-#define ANDROID_TEXT_PATH(e,T,X,Y)					\
-	(*(e->env))->CallVoidMethod(e->env, e->state->paint, e->paint_getTextPath, (*(e->env))->NewStringUTF(e->env, T), 0, strlen_UTF8(T), X, Y, e->state->path)
+#define ANDROID_TEXT_PATH(e,S,N,X,Y,P)					\
+	(SVG_ANDROID_JNI_COUNT(e, paint_getTextPath), (*(e->env))->CallVoidMethod(e->env, e->state->paint, svg_android_jni.paint_getTextPath, S, 0, N, X, Y, P))
 #define ANDROID_SET_ANTIALIAS(e,P,B)					\
-	(*(e->env))->CallVoidMethod(e->env, P, e->paint_setAntialias, B)
+	(SVG_ANDROID_JNI_COUNT(e, paint_setAntialias), (*(e->env))->CallVoidMethod(e->env, P, svg_android_jni.paint_setAntialias, B))
 
 #define ANDROID_GET_DASHEFFECT(a,b,c)		\
-	(*(a->env))->NewObject(a->env, a->dashPathEffect_clazz, a->dashPathEffect_constructor,b,c)
+	(SVG_ANDROID_JNI_COUNT(a, dashPathEffect_constructor), (*(a->env))->NewObject(a->env, svg_android_jni.dashPathEffect_clazz, svg_android_jni.dashPathEffect_constructor,b,c))
 
 
 /* svg_android_state.c */
@@ -380,9 +694,18 @@ _svg_android_state_destroy (svg_android_state_t *state);
 svg_android_state_t *
 _svg_android_state_push (svg_android_t *instance, svg_android_state_t *state, jobject path_cache);
 
+void
+_svg_android_state_store_init (svg_android_t *svg_android);
+
+void
+_svg_android_state_store_deinit (svg_android_t *svg_android);
+
 svg_android_state_t *
 _svg_android_state_pop (svg_android_state_t *state);
 
+void
+_svg_android_state_reset_canvas (svg_android_state_t *state, double width, double height);
+
 /* svg_android_render.c */
 
 	int _svg_android_get_last_bounding_box(void *closure, svg_bounding_box_t *bbox);
@@ -390,10 +713,10 @@ _svg_android_state_pop (svg_android_state_t *state);
 	void _svg_android_update_last_bounding_box(svg_android_t *svg_android, svg_bounding_box_t *bbox);
 
 	svg_status_t
-_svg_android_begin_group (void *closure, double opacity);
+_svg_android_begin_group (void *closure, double opacity, const svg_rect_t *extents);
 
 svg_status_t
-_svg_android_begin_element (void *closure, void *path_cache);
+_svg_android_begin_element (void *closure, void *path_cache, unsigned int changes);
 
 svg_status_t
 _svg_android_end_element (void *closure);
@@ -418,23 +741,6 @@ _svg_android_quadratic_curve_to (void *closure,
 				 double x1, double y1,
 				 double x2, double y2);
 
-svg_status_t
-_svg_android_arc_to (void	       *closure,
-		     double	rx,
-		     double	ry,
-		     double	x_axis_rotation,
-		     int		large_arc_flag,
-		     int		sweep_flag,
-		     double	x,
-		     double	y);
-
-void
-_svg_path_arc_segment (svg_android_t *svg_android,
-		       double   xc,  double yc,
-		       double   th0, double th1,
-		       double   rx,  double ry,
-		       double   x_axis_rotation);
-
 svg_status_t
 _svg_android_close_path (void *closure);
 
@@ -559,7 +865,8 @@ _svg_android_set_viewport_dimension (void *closure,
 svg_status_t
 _svg_android_render_line (void *closure,
 			  svg_length_t *x1_len, svg_length_t *y1_len,
-			  svg_length_t *x2_len, svg_length_t *y2_len);
+			  svg_length_t *x2_len, svg_length_t *y2_len,
+			  svg_length_cache_t *lengths);
 
 svg_status_t
 _svg_android_render_path (void *closure, void **path_cache);
@@ -569,7 +876,8 @@ _svg_android_render_ellipse (void *closure,
 			     svg_length_t *cx,
 			     svg_length_t *cy,
 			     svg_length_t *rx,
-			     svg_length_t *ry);
+			     svg_length_t *ry,
+			     svg_length_cache_t *lengths);
 
 svg_status_t
 _svg_android_render_rect (void 	     *closure,
@@ -578,7 +886,8 @@ _svg_android_render_rect (void 	     *closure,
 			  svg_length_t *width,
 			  svg_length_t *height,
 			  svg_length_t *rx,
-			  svg_length_t *ry);
+			  svg_length_t *ry,
+			  svg_length_cache_t *lengths);
 
 svg_status_t
 _svg_android_render_text (void 	      *closure,
@@ -586,6 +895,9 @@ _svg_android_render_text (void 	      *closure,
 			  svg_length_t  *y_len,
 			  const char    *utf8);
 
+size_t
+strlen_UTF8 (const char *utf8);
+
 svg_status_t
 _svg_android_render_image (void		*closure,
 			   unsigned char	*data,
@@ -594,7 +906,8 @@ _svg_android_render_image (void		*closure,
 			   svg_length_t	*x,
 			   svg_length_t	*y,
 			   svg_length_t	*width,
-			   svg_length_t	*height);
+			   svg_length_t	*height,
+			   svg_length_cache_t *lengths);
 
 svg_status_t
 _svg_android_push_state (svg_android_t     *svg_android,
@@ -604,10 +917,159 @@ _svg_android_push_state (svg_android_t     *svg_android,
 svg_status_t
 _svg_android_pop_state (svg_android_t *svg_android);
 
+/* svg_android_path.c */
+void
+_svg_android_path_buffer_init (svg_android_path_buffer_t *buffer);
+
+void
+_svg_android_path_buffer_deinit (svg_android_t *svg_android);
+
+void
+_svg_android_path_buffer_clear (svg_android_t *svg_android);
+
+svg_status_t
+_svg_android_path_buffer_add (svg_android_t *svg_android, svg_android_path_op_t op, int num_args, ...);
+
+svg_status_t
+_svg_android_path_buffer_flush (svg_android_t *svg_android);
+
+void
+_svg_android_path_cache_init (svg_android_t *svg_android);
+
+void
+_svg_android_path_cache_deinit (svg_android_t *svg_android);
+
+jobject
+_svg_android_path_cache_lookup (svg_android_t *svg_android, void *path_cache);
+
+int
+_svg_android_path_cache_hit (svg_android_t *svg_android, void *path_cache,
+			     double *x1, double *y1, double *x2, double *y2);
+
+svg_status_t
+_svg_android_path_cache_store (svg_android_t *svg_android, void **path_cache,
+			       int has_extents, double x1, double y1, double x2, double y2,
+			       const double *stroke_extents);
+
+const double *
+_svg_android_path_cache_stroke_extents (svg_android_t *svg_android, void *path_cache);
+
+void
+_svg_android_path_buffer_flatten (svg_android_path_buffer_t *buffer, svg_polyline_t *polyline);
+
+void
+_svg_android_path_cache_remove (svg_android_t *svg_android, void **path_cache);
+
+/* svg_android_text.c */
+void
+_svg_android_text_cache_init (svg_android_t *svg_android);
+
+void
+_svg_android_text_cache_deinit (svg_android_t *svg_android);
+
+svg_android_text_cache_entry_t *
+_svg_android_text_cache_get (svg_android_t *svg_android, const char *utf8, double x, double y);
+
+/* svg_android_image.c */
+void
+_svg_android_image_cache_init (svg_android_t *svg_android);
+
+void
+_svg_android_image_cache_deinit (svg_android_t *svg_android);
+
+jobject
+_svg_android_image_cache_get (svg_android_t *svg_android,
+			      unsigned char *data,
+			      unsigned int data_width,
+			      unsigned int data_height);
+
+/* svg_android_layer.c */
+void
+_svg_android_layer_pool_init (svg_android_t *svg_android);
+
+void
+_svg_android_layer_pool_deinit (svg_android_t *svg_android);
+
+svg_status_t
+_svg_android_layer_begin (svg_android_t *svg_android, double opacity, const svg_rect_t *extents);
+
+void
+_svg_android_layer_end (svg_android_t *svg_android);
+
 /* svg_android_render_helper.c */
+void
+_svg_android_gradient_cache_init (svg_android_t *svg_android);
+
+void
+_svg_android_gradient_cache_deinit (svg_android_t *svg_android);
+
+void
+_svg_android_pattern_cache_init (svg_android_t *svg_android);
+
+void
+_svg_android_pattern_cache_deinit (svg_android_t *svg_android);
+
+jobject
+_svg_android_scratch_matrix (svg_android_t *svg_android);
+
+jfloatArray
+_svg_android_scratch_floats (svg_android_t *svg_android);
+
+const char *
+_svg_android_intern_font_family (svg_android_t *svg_android, const char *family);
+
+void
+_svg_android_font_cache_init (svg_android_t *svg_android);
+
+void
+_svg_android_font_cache_deinit (svg_android_t *svg_android);
+
+void
+_svg_android_dash_cache_init (svg_android_t *svg_android);
+
+void
+_svg_android_dash_cache_deinit (svg_android_t *svg_android);
+
 svg_status_t
 _svg_android_length_to_pixel (svg_android_t *svg_android, svg_length_t *length, double *pixel);
 
+void
+_svg_android_lengths_to_pixel (svg_android_t *svg_android, svg_length_cache_t *cache,
+			       svg_length_t **lengths, int count, double *pixels);
+
+double
+_svg_android_stroke_width (svg_android_t *svg_android);
+
+void
+_svg_android_ctm_init_identity (svg_android_ctm_t *ctm);
+
+void
+_svg_android_ctm_multiply (svg_android_ctm_t *ctm, const svg_android_ctm_t *other);
+
+void
+_svg_android_ctm_transform_extents (const svg_android_ctm_t *ctm,
+				    double *x1, double *y1,
+				    double *x2, double *y2);
+
+double
+_svg_android_ctm_scale (const svg_android_ctm_t *ctm);
+
+void
+_svg_android_stroke_style (svg_android_t *svg_android, svg_stroke_style_t *style);
+
+void
+_svg_android_clip_to_extents (svg_android_t *svg_android,
+			      double x1, double y1,
+			      double x2, double y2);
+
+void
+_svg_android_bounding_box_from_extents (svg_android_t *svg_android,
+					double x1, double y1,
+					double x2, double y2);
+
+void
+_svg_android_fetch_canvas_state (svg_android_t *svg_android);
+
 svg_status_t
 _svg_android_set_gradient (svg_android_t *svg_android,
 			   svg_gradient_t *gradient,
@@ -629,6 +1091,13 @@ _svg_android_set_pattern (svg_android_t *svg_android,
 svg_status_t
 _svg_android_select_font (svg_android_t *svg_android);
 
+svg_status_t
+_svg_android_select_dash (svg_android_t *svg_android);
+
+int
+_svg_android_fetch_path_bounding_box (svg_android_t *svg_android, jobject path,
+				      svg_bounding_box_t *bbox);
+
 void
 _svg_android_copy_canvas_state (svg_android_t *svg_android);
 
@@ -46,17 +46,25 @@ extern "C" {
 	} svg_android_status_t;
 	
 	typedef struct svg_android svg_android_t;
+
+	/* A document can be used from any thread, but from one at a time:
+	 * renders keep their state and caches in it. Different documents
+	 * can be rendered in parallel. */
 	
 	svg_android_t *svgAndroidCreate();
 	svg_android_status_t svgAndroidDestroy(svg_android_t *svg_android);
 	void svgAndroidSetAntialiasing(svg_android_t *svg_android, jboolean doAntiAlias);
+	svg_status_t svgAndroidSetDpi(svg_android_t *svg_android, double dpi);
 	svg_status_t svgAndroidRender(
 		JNIEnv *env, svg_android_t *svg_android, jobject android_canvas);
 	svg_status_t svgAndroidRenderToArea(
 		JNIEnv *env, svg_android_t *svg_android,
 		jobject android_canvas, int x, int y, int w, int h) ;
-	int svgAndroidGetInternalBoundingBox(svg_bounding_box_t *bbox);
+	svg_status_t svgAndroidRenderToBitmap(
+		JNIEnv *env, svg_android_t *svg_android, jobject android_bitmap);
 	void svgAndroidEnablePathCache(svg_android_t *svg_android);
+	void svgAndroidTrimMemory(svg_android_t *svg_android);
+	size_t svgAndroidGetCacheMemory(svg_android_t *svg_android);
 #ifdef __cplusplus
 }
 #endif
@@ -32,6 +32,7 @@
 #include "math.h"
 
 #include <android/log.h>
+#include <android/bitmap.h>
 
 #include "svg_android_debug.h"
 
@@ -53,6 +54,11 @@
 #endif
 
 svg_render_engine_t SVG_ANDROID_RENDER_ENGINE = {
+	/* no SVG_RENDER_ENGINE_NATIVE_ARCS, the core hands arcs over as
+	 * cubics and arc_to stays NULL */
+	.capabilities = (SVG_RENDER_ENGINE_NEEDS_BOUNDING_BOX |
+			 SVG_RENDER_ENGINE_GROUP_OPACITY |
+			 SVG_RENDER_ENGINE_FILTERS),
 	/* hierarchy */
 	.begin_group = _svg_android_begin_group,
 	.begin_element = _svg_android_begin_element,
@@ -63,7 +69,6 @@ svg_render_engine_t SVG_ANDROID_RENDER_ENGINE = {
 	.line_to = _svg_android_line_to,
 	.curve_to = _svg_android_curve_to,
 	.quadratic_curve_to = _svg_android_quadratic_curve_to,
-	.arc_to = _svg_android_arc_to,
 	.close_path = _svg_android_close_path,
 	.free_path_cache = _svg_android_free_path_cache,
 	/* image cache */
@@ -118,8 +123,36 @@ svg_android_status_t svgAndroidDestroy(svg_android_t *svg_android) {
 
 	_svg_android_pop_state (svg_android);
 
+	if(svg_android->soft)
+		svgSoftDestroy (svg_android->soft);
+
 	status = svg_destroy (svg_android->svg);
 
+	_svg_android_path_cache_deinit (svg_android);
+	_svg_android_path_buffer_deinit (svg_android);
+	svg_polyline_deinit (&svg_android->stroke_path);
+	svg_stroker_deinit (&svg_android->stroker);
+	_svg_android_layer_pool_deinit (svg_android);
+	_svg_android_gradient_cache_deinit (svg_android);
+	_svg_android_pattern_cache_deinit (svg_android);
+	_svg_android_image_cache_deinit (svg_android);
+	_svg_android_text_cache_deinit (svg_android);
+	_svg_android_font_cache_deinit (svg_android);
+	_svg_android_dash_cache_deinit (svg_android);
+	_svg_android_state_store_deinit (svg_android);
+
+	free (svg_android->element_frames);
+	if(svg_android->identity_matrix)
+		(*(svg_android->env))->DeleteGlobalRef(svg_android->env, svg_android->identity_matrix);
+	if(svg_android->scratch_matrix)
+		(*(svg_android->env))->DeleteGlobalRef(svg_android->env, svg_android->scratch_matrix);
+	if(svg_android->scratch_floats)
+		(*(svg_android->env))->DeleteGlobalRef(svg_android->env, svg_android->scratch_floats);
+	if(svg_android->fit_to_MATRIX)
+		(*(svg_android->env))->DeleteGlobalRef(svg_android->env, svg_android->fit_to_MATRIX);
+	if(svg_android->root_bitmap)
+		(*(svg_android->env))->DeleteGlobalRef(svg_android->env, svg_android->root_bitmap);
+
 	free (svg_android);
 
 	return status;
@@ -135,6 +168,35 @@ svg_android_t *svgAndroidCreate(void) {
 
 		svg_android->canvas = NULL;
 		svg_android->state = NULL;
+		_svg_android_state_store_init (svg_android);
+
+		_svg_android_path_buffer_init (&svg_android->path_buffer);
+		_svg_android_path_cache_init (svg_android);
+		svg_polyline_init (&svg_android->stroke_path);
+		svg_stroker_init (&svg_android->stroker);
+
+		svg_android->element_frames = NULL;
+		svg_android->num_element_frames = 0;
+		svg_android->element_frames_size = 0;
+		svg_android->identity_matrix = NULL;
+
+		_svg_android_layer_pool_init (svg_android);
+		_svg_android_gradient_cache_init (svg_android);
+		_svg_android_pattern_cache_init (svg_android);
+		_svg_android_image_cache_init (svg_android);
+		_svg_android_font_cache_init (svg_android);
+		_svg_android_text_cache_init (svg_android);
+		_svg_android_dash_cache_init (svg_android);
+		svg_android->scratch_matrix = NULL;
+		svg_android->scratch_floats = NULL;
+		svg_android->fit_to_MATRIX = NULL;
+		svg_android->path_has_extents = 0;
+
+		svg_android->root_bitmap = NULL;
+		svg_android->root_bitmap_width = 0;
+		svg_android->root_bitmap_height = 0;
+
+		svg_android->soft = NULL;
 
 		if(svg_create (&(svg_android)->svg, &SVG_ANDROID_RENDER_ENGINE, svg_android)) {
 			free(svg_android);
@@ -165,6 +227,8 @@ JNIEXPORT jint JNICALL Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidDestr
 	uint32_t t = (uint32_t)_svg_android_r;
 	svg_android_t *svg_android = (svg_android_t *)t;
 #endif
+	// the global refs we hold are released through this env
+	svg_android->env = env;
 	return svgAndroidDestroy(svg_android);
 }
 
@@ -187,6 +251,31 @@ JNIEXPORT jint JNICALL Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidParse
 	return status;
 }
 
+/* relative image hrefs of documents parsed from a buffer are resolved
+ * against this, pass null to use them as they are */
+JNIEXPORT jint JNICALL Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidSetBaseUri
+(JNIEnv *env, jclass jc, jlong _svg_android_r, jstring _base_uri)
+{
+#ifdef ENVIRONMENT64
+	svg_android_t *svg_android = (svg_android_t *)_svg_android_r;
+#else
+	uint32_t t = (uint32_t)_svg_android_r;
+	svg_android_t *svg_android = (svg_android_t *)t;
+#endif
+	svg_android_status_t status;
+
+	if(_base_uri == NULL)
+		return svg_set_base_uri (svg_android->svg, NULL);
+
+	const char *base_uri = (*env)->GetStringUTFChars(env, _base_uri, JNI_FALSE);
+
+	status = svg_set_base_uri (svg_android->svg, base_uri);
+
+	(*env)->ReleaseStringUTFChars(env, _base_uri, base_uri);
+
+	return status;
+}
+
 JNIEXPORT jint JNICALL Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidParseChunkBegin
 (JNIEnv *env, jclass jc, jlong _svg_android_r)
 {
@@ -230,372 +319,247 @@ JNIEXPORT jint JNICALL Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidParse
 	return svg_parse_chunk_end (svg_android->svg);
 }
 
-static jclass canvas_clazz = NULL; // android Canvas classj
-static jclass raster_clazz = NULL; // android SvgRaster class
-static jclass bitmap_clazz = NULL; // android Bitmap class
-static jclass matrix_clazz = NULL; // android matrix class
-static jclass shader_clazz = NULL; // android shader class
-static jclass path_clazz = NULL;   // android path class
-static jclass paint_clazz = NULL; // android paint class
-static jclass dashPathEffect_clazz = NULL; // android paint dash effect class
-
-void __prepare_android_interface(svg_android_t *svg_android, JNIEnv *env, jobject *android_canvas) {
-	jclass d;
-
-	svg_android->canvas = android_canvas;
-	if(svg_android->env == env) {
-#if 0
-		/***************/
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "canvas_constructor: %p", svg_android->canvas_constructor);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "canvas_save: %p", svg_android->canvas_save);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "canvas_restore: %p", svg_android->canvas_restore);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->canvas_clip_rect);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->canvas_concat_matrix);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "canvas_draw_bitmap: %p", svg_android->canvas_draw_bitmap);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "canvas_draw_path: %p", svg_android->canvas_draw_path);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "canvas_draw_text: %p", svg_android->canvas_draw_text);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "canvas_drawRGB: %p", svg_android->canvas_drawRGB);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "canvas_getWidth: %p", svg_android->canvas_getWidth);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "canvas_getHeight: %p", svg_android->canvas_getHeight);
-
-		/***************/
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "raster_setTypeface: %p", svg_android->raster_setTypeface);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "raster_getBounds: %p", svg_android->raster_getBounds);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "raster_matrixInit: %p", svg_android->raster_matrixInit);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "raster_createBitmap: %p", svg_android->raster_createBitmap);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "raster_data2bitmap: %p", svg_android->raster_data2bitmap);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "raster_setFillRule: %p", svg_android->raster_setFillRule);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "raster_setPaintStyle: %p", svg_android->raster_setPaintStyle);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "raster_setStrokeCap: %p", svg_android->raster_setStrokeCap);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "raster_setStrokeJoin: %p", svg_android->raster_setStrokeJoin);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "raster_createBitmapShader: %p", svg_android->raster_createBitmapShader);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "raster_createLinearGradient: %p", svg_android->raster_createLinearGradient);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "raster_createRadialGradient: %p", svg_android->raster_createRadialGradient);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "raster_matrixInvert: %p", svg_android->raster_matrixInvert);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->raster_getBoundingBox);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "raster_drawEllipse: %p", svg_android->raster_drawEllipse);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "raster_drawRect: %p", svg_android->raster_drawRect);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "raster_debugMatrix: %p", svg_android->raster_debugMatrix);
+svg_android_jni_t svg_android_jni;
+static int svg_android_jni_ready = 0;
+
+static const struct {
+	jclass *clazz;
+	const char *name;
+} svg_android_jni_classes[] = {
+	{ &svg_android_jni.filter_clazz, "com/toolkits/libsvgandroid/Filter" },
+	{ &svg_android_jni.canvas_clazz, "android/graphics/Canvas" },
+	{ &svg_android_jni.raster_clazz, "com/toolkits/libsvgandroid/SvgRaster" },
+	{ &svg_android_jni.bitmap_clazz, "android/graphics/Bitmap" },
+	{ &svg_android_jni.matrix_clazz, "android/graphics/Matrix" },
+	{ &svg_android_jni.shader_clazz, "android/graphics/Shader" },
+	{ &svg_android_jni.path_clazz, "android/graphics/Path" },
+	{ &svg_android_jni.paint_clazz, "android/graphics/Paint" },
+	{ &svg_android_jni.dashPathEffect_clazz, "android/graphics/DashPathEffect" },
+};
 
-		/* android bitmap method references */
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->bitmap_erase_color);
+#define SVG_ANDROID_METHOD(c,m,n,s) { &svg_android_jni.m, &svg_android_jni.c, n, s, 0 }
+#define SVG_ANDROID_STATIC_METHOD(c,m,n,s) { &svg_android_jni.m, &svg_android_jni.c, n, s, 1 }
+
+static const struct {
+	jmethodID *method;
+	jclass *clazz;
+	const char *name;
+	const char *signature;
+	int is_static;
+} svg_android_jni_methods[] = {
+	// com/toolkits/libsvgandroid/Filter
+	SVG_ANDROID_STATIC_METHOD(filter_clazz, create_filter, "createFilter",
+				  "()Lcom/toolkits/libsvgandroid/Filter;"),
+	SVG_ANDROID_METHOD(filter_clazz, begin_filter, "beginFilter", "(Ljava/lang/String;)V"),
+	SVG_ANDROID_METHOD(filter_clazz, set_filter, "setFilter", "(Ljava/lang/String;)V"),
+	SVG_ANDROID_METHOD(filter_clazz, add_filter_feBlend, "addFilter_feBlend", "(IIIIIII)V"),
+	SVG_ANDROID_METHOD(filter_clazz, add_filter_feComposite, "addFilter_feComposite", "(IIIIIIIDDDD)V"),
+	SVG_ANDROID_METHOD(filter_clazz, add_filter_feFlood, "addFilter_feFlood", "(IIIIIID)V"),
+	SVG_ANDROID_METHOD(filter_clazz, add_filter_feGaussianBlur, "addFilter_feGaussianBlur", "(IIIIIDD)V"),
+	SVG_ANDROID_METHOD(filter_clazz, add_filter_feOffset, "addFilter_feOffset", "(IIIIIDD)V"),
+	SVG_ANDROID_METHOD(filter_clazz, filter_execute, "execute",
+			   "(Landroid/graphics/Bitmap;Landroid/graphics/Bitmap;)Landroid/graphics/Bitmap;"),
+
+	// android/graphics/Canvas
+	SVG_ANDROID_METHOD(canvas_clazz, canvas_constructor, "<init>", "(Landroid/graphics/Bitmap;)V"),
+	SVG_ANDROID_METHOD(canvas_clazz, canvas_save, "save", "()I"),
+	SVG_ANDROID_METHOD(canvas_clazz, canvas_restore, "restore", "()V"),
+	SVG_ANDROID_METHOD(canvas_clazz, canvas_clip_rect, "clipRect", "(FFFF)Z"),
+	SVG_ANDROID_METHOD(canvas_clazz, canvas_concat, "concat", "(Landroid/graphics/Matrix;)V"),
+	SVG_ANDROID_METHOD(canvas_clazz, canvas_draw_bitmap, "drawBitmap",
+			   "(Landroid/graphics/Bitmap;Landroid/graphics/Matrix;Landroid/graphics/Paint;)V"),
+	SVG_ANDROID_METHOD(canvas_clazz, canvas_draw_bitmap2, "drawBitmap",
+			   "(Landroid/graphics/Bitmap;FFLandroid/graphics/Paint;)V"),
+	SVG_ANDROID_METHOD(canvas_clazz, canvas_draw_path, "drawPath",
+			   "(Landroid/graphics/Path;Landroid/graphics/Paint;)V"),
+	SVG_ANDROID_METHOD(canvas_clazz, canvas_draw_text, "drawText",
+			   "(Ljava/lang/String;FFLandroid/graphics/Paint;)V"),
+	SVG_ANDROID_METHOD(canvas_clazz, canvas_drawRGB, "drawRGB", "(III)V"),
+	SVG_ANDROID_METHOD(canvas_clazz, canvas_getWidth, "getWidth", "()I"),
+	SVG_ANDROID_METHOD(canvas_clazz, canvas_getHeight, "getHeight", "()I"),
+
+	// com/toolkits/libsvgandroid/SvgRaster
+	SVG_ANDROID_STATIC_METHOD(raster_clazz, raster_setTypeface, "setTypeface",
+				  "(Landroid/graphics/Paint;Landroid/graphics/Typeface;FI)V"),
+	SVG_ANDROID_STATIC_METHOD(raster_clazz, raster_createTypeface, "createTypeface",
+				  "(Ljava/lang/String;I)Landroid/graphics/Typeface;"),
+	SVG_ANDROID_STATIC_METHOD(raster_clazz, raster_getBounds, "getBounds",
+				  "(Landroid/graphics/Path;[F)V"),
+	SVG_ANDROID_STATIC_METHOD(raster_clazz, raster_matrixCreate, "matrixCreate",
+				  "(FFFFFF)Landroid/graphics/Matrix;"),
+	SVG_ANDROID_STATIC_METHOD(raster_clazz, raster_matrixInit, "matrixInit",
+				  "(Landroid/graphics/Matrix;FFFFFF)V"),
+	SVG_ANDROID_STATIC_METHOD(raster_clazz, raster_createBitmap, "createBitmap",
+				  "(II)Landroid/graphics/Bitmap;"),
+	SVG_ANDROID_STATIC_METHOD(raster_clazz, raster_data2bitmap, "data2bitmap",
+				  "(II[I)Landroid/graphics/Bitmap;"),
+	SVG_ANDROID_STATIC_METHOD(raster_clazz, raster_setFillRule, "setFillRule",
+				  "(Landroid/graphics/Path;Z)V"),
+	SVG_ANDROID_STATIC_METHOD(raster_clazz, raster_setPaintStyle, "setPaintStyle",
+				  "(Landroid/graphics/Paint;Z)V"),
+	SVG_ANDROID_STATIC_METHOD(raster_clazz, raster_setStrokeCap, "setStrokeCap",
+				  "(Landroid/graphics/Paint;I)V"),
+	SVG_ANDROID_STATIC_METHOD(raster_clazz, raster_setStrokeJoin, "setStrokeJoin",
+				  "(Landroid/graphics/Paint;I)V"),
+	SVG_ANDROID_STATIC_METHOD(raster_clazz, raster_createBitmapShader, "createBitmapShader",
+				  "(Landroid/graphics/Bitmap;)Landroid/graphics/Shader;"),
+	SVG_ANDROID_STATIC_METHOD(raster_clazz, raster_createLinearGradient, "createLinearGradient",
+				  "(FFFF[I[FI)Landroid/graphics/Shader;"),
+	SVG_ANDROID_STATIC_METHOD(raster_clazz, raster_createRadialGradient, "createRadialGradient",
+				  "(FFF[I[FI)Landroid/graphics/Shader;"),
+	SVG_ANDROID_STATIC_METHOD(raster_clazz, raster_matrixInvert, "matrixInvert",
+				  "(Landroid/graphics/Matrix;)Landroid/graphics/Matrix;"),
+	SVG_ANDROID_STATIC_METHOD(raster_clazz, raster_getBoundingBox, "getBoundingBox",
+				  "(Landroid/graphics/Path;Landroid/graphics/Canvas;[F)V"),
+	SVG_ANDROID_STATIC_METHOD(raster_clazz, raster_drawEllipse, "drawEllipse",
+				  "(Landroid/graphics/Canvas;Landroid/graphics/Paint;FFFF)V"),
+	SVG_ANDROID_STATIC_METHOD(raster_clazz, raster_drawRect, "drawRect",
+				  "(Landroid/graphics/Canvas;Landroid/graphics/Paint;FFFFFF)V"),
+	SVG_ANDROID_STATIC_METHOD(raster_clazz, raster_debugMatrix, "debugMatrix",
+				  "(Landroid/graphics/Matrix;)V"),
+	SVG_ANDROID_STATIC_METHOD(raster_clazz, raster_replayPath, "replayPath",
+				  "(Landroid/graphics/Path;Z[BI[F)V"),
+	SVG_ANDROID_STATIC_METHOD(raster_clazz, raster_getCanvasState, "getCanvasState",
+				  "(Landroid/graphics/Canvas;[F)V"),
+	SVG_ANDROID_STATIC_METHOD(raster_clazz, raster_beginLayer, "beginLayer",
+				  "(Landroid/graphics/Canvas;Landroid/graphics/Bitmap;FFFFFF)V"),
+	SVG_ANDROID_STATIC_METHOD(raster_clazz, raster_drawLayer, "drawLayer",
+				  "(Landroid/graphics/Canvas;Landroid/graphics/Bitmap;IIFFFFFFI)V"),
+
+	// android/graphics/Bitmap
+	SVG_ANDROID_METHOD(bitmap_clazz, bitmap_erase_color, "eraseColor", "(I)V"),
+
+	// android/graphics/Matrix
+	SVG_ANDROID_METHOD(matrix_clazz, matrix_constructor, "<init>", "()V"),
+	SVG_ANDROID_METHOD(matrix_clazz, matrix_postTranslate, "postTranslate", "(FF)Z"),
+	SVG_ANDROID_METHOD(matrix_clazz, matrix_postScale, "postScale", "(FF)Z"),
+	SVG_ANDROID_METHOD(matrix_clazz, matrix_postConcat, "postConcat", "(Landroid/graphics/Matrix;)Z"),
+	SVG_ANDROID_METHOD(matrix_clazz, matrix_reset, "reset", "()V"),
+	SVG_ANDROID_METHOD(matrix_clazz, matrix_set, "set", "(Landroid/graphics/Matrix;)V"),
+
+	// android/graphics/Shader
+	SVG_ANDROID_METHOD(shader_clazz, shader_setLocalMatrix, "setLocalMatrix", "(Landroid/graphics/Matrix;)V"),
+
+	// android/graphics/Path
+	SVG_ANDROID_METHOD(path_clazz, path_constructor, "<init>", "()V"),
+	SVG_ANDROID_METHOD(path_clazz, path_clone_constructor, "<init>", "(Landroid/graphics/Path;)V"),
+	SVG_ANDROID_METHOD(path_clazz, path_transform, "transform", "(Landroid/graphics/Matrix;)V"),
+	SVG_ANDROID_METHOD(path_clazz, path_moveTo, "moveTo", "(FF)V"),
+	SVG_ANDROID_METHOD(path_clazz, path_lineTo, "lineTo", "(FF)V"),
+	SVG_ANDROID_METHOD(path_clazz, path_cubicTo, "cubicTo", "(FFFFFF)V"),
+	SVG_ANDROID_METHOD(path_clazz, path_quadTo, "quadTo", "(FFFF)V"),
+	SVG_ANDROID_METHOD(path_clazz, path_close, "close", "()V"),
+	SVG_ANDROID_METHOD(path_clazz, path_reset, "reset", "()V"),
+
+	// android/graphics/Paint
+	SVG_ANDROID_METHOD(paint_clazz, paint_constructor, "<init>", "()V"),
+	SVG_ANDROID_METHOD(paint_clazz, paint_setPathEffect, "setPathEffect",
+			   "(Landroid/graphics/PathEffect;)Landroid/graphics/PathEffect;"),
+	SVG_ANDROID_METHOD(paint_clazz, paint_setARGB, "setARGB", "(IIII)V"),
+	SVG_ANDROID_METHOD(paint_clazz, paint_setShader, "setShader",
+			   "(Landroid/graphics/Shader;)Landroid/graphics/Shader;"),
+	SVG_ANDROID_METHOD(paint_clazz, paint_setStrokeMiter, "setStrokeMiter", "(F)V"),
+	SVG_ANDROID_METHOD(paint_clazz, paint_setStrokeWidth, "setStrokeWidth", "(F)V"),
+	SVG_ANDROID_METHOD(paint_clazz, paint_getTextPath, "getTextPath",
+			   "(Ljava/lang/String;IIFFLandroid/graphics/Path;)V"),
+	SVG_ANDROID_METHOD(paint_clazz, paint_setAntialias, "setAntiAlias", "(Z)V"),
+	SVG_ANDROID_METHOD(paint_clazz, paint_set, "set", "(Landroid/graphics/Paint;)V"),
+	SVG_ANDROID_METHOD(paint_clazz, paint_reset, "reset", "()V"),
+
+	// android/graphics/DashPathEffect
+	SVG_ANDROID_METHOD(dashPathEffect_clazz, dashPathEffect_constructor, "<init>", "([FF)V"),
+};
 
-		/* android matrix method references */
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->matrix_constructor);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->matrix_postTranslate);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->matrix_postScale);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->matrix_postConcat);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->matrix_reset);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->matrix_set);
+#undef SVG_ANDROID_METHOD
+#undef SVG_ANDROID_STATIC_METHOD
 
-		/* android shader method references */
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->shader_setLocalMatrix);
+/* Resolve every class and method id in svg_android_jni. Normally done
+ * once by JNI_OnLoad, the table is never written again after that.
+ * Returns 0 on success, -1 leaves the exception pending. */
+static int __prepare_android_interface(JNIEnv *env) {
+	jclass d;
+	jmethodID m;
+	int k;
 
-		/* android path method references */
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->path_constructor);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->path_clone_constructor);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->path_transform);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->path_moveTo);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->path_lineTo);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->path_cubicTo);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->path_quadTo);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->path_close);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->path_reset);
+	if(svg_android_jni_ready)
+		return 0;
 
-		/* android paint method references */
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->paint_constructor);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->paint_setPathEffect);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->paint_setARGB);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->paint_setShader);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->paint_setStrokeMiter);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->paint_setStrokeWidth);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->paint_getTextPath);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->paint_setAntialias);
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->paint_set);
+	for(k = 0; k < sizeof(svg_android_jni_classes) / sizeof(svg_android_jni_classes[0]); k++) {
+		if(*(svg_android_jni_classes[k].clazz))
+			continue;
 
-		/* DashPathEffect method/constructors refs */
-		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
-				    "local reference at line %d is %p", __LINE__, svg_android->dashPathEffect_constructor);
-#endif
-		return;
+		d = (*env)->FindClass(env, svg_android_jni_classes[k].name);
+		if(d == NULL) {
+			SVG_ANDROID_ERROR("__prepare_android_interface() - could not find class %s\n",
+					  svg_android_jni_classes[k].name);
+			return -1;
+		}
+		*(svg_android_jni_classes[k].clazz) = (jclass)((*env)->NewGlobalRef(env, (jobject)d));
+		(*env)->DeleteLocalRef(env, d);
 	}
 
-	svg_android->env = env;
-
-	// prepare canvas class/methods
-	if(!canvas_clazz) {
-		d = (*env)->FindClass(env, "android/graphics/Canvas");
-		canvas_clazz = (jclass)((*env)->NewGlobalRef(env, (jobject)d));
-	}
-	svg_android->canvas_clazz = canvas_clazz;
-
-	svg_android->canvas_constructor = (*env)->GetMethodID(env,
-		svg_android->canvas_clazz, "<init>", "(Landroid/graphics/Bitmap;)V");
-	svg_android->canvas_save = (*env)->GetMethodID(env,svg_android->canvas_clazz, "save", "()I");
-	svg_android->canvas_restore = (*env)->GetMethodID(env,svg_android->canvas_clazz, "restore", "()V");
-	svg_android->canvas_clip_rect = (*env)->GetMethodID(env,
-		svg_android->canvas_clazz, "clipRect",
-		"(FFFF)Z");
-	svg_android->canvas_concat = (*env)->GetMethodID(env,
-		svg_android->canvas_clazz, "concat",
-		"(Landroid/graphics/Matrix;)V");
-	svg_android->canvas_draw_bitmap = (*env)->GetMethodID(env,
-		svg_android->canvas_clazz, "drawBitmap",
-		"(Landroid/graphics/Bitmap;Landroid/graphics/Matrix;Landroid/graphics/Paint;)V");
-	svg_android->canvas_draw_bitmap2 = (*env)->GetMethodID(env,
-		svg_android->canvas_clazz, "drawBitmap",
-		"(Landroid/graphics/Bitmap;FFLandroid/graphics/Paint;)V");
-	svg_android->canvas_draw_path = (*env)->GetMethodID(env,
-		svg_android->canvas_clazz, "drawPath",
-		"(Landroid/graphics/Path;Landroid/graphics/Paint;)V");
-	svg_android->canvas_draw_text = (*env)->GetMethodID(env,
-		svg_android->canvas_clazz, "drawText",
-		"(Ljava/lang/String;FFLandroid/graphics/Paint;)V");
-	svg_android->canvas_drawRGB =  (*env)->GetMethodID(env,
-		svg_android->canvas_clazz, "drawRGB",
-		"(III)V");
-	svg_android->canvas_getWidth =  (*env)->GetMethodID(env,
-		svg_android->canvas_clazz, "getWidth",
-		"()I");
-	svg_android->canvas_getHeight =  (*env)->GetMethodID(env,
-		svg_android->canvas_clazz, "getHeight",
-		"()I");
-
-	// prepare raster
-	if(!raster_clazz) {
-		d = (*env)->FindClass(env, "com/toolkits/libsvgandroid/SvgRaster");
-		raster_clazz = (jclass)((*env)->NewGlobalRef(env, (jobject)d));
-	}
-	svg_android->raster_clazz = raster_clazz;
-
-	svg_android->raster_setTypeface = (*env)->GetStaticMethodID(
-		env,
-		svg_android->raster_clazz, "setTypeface",
-		"(Landroid/graphics/Paint;Ljava/lang/String;IFI)V"
-		);
-	svg_android->raster_getBounds = (*env)->GetStaticMethodID(env,
-		svg_android->raster_clazz, "getBounds",
-		"(Landroid/graphics/Path;)[F"
-		);
-	svg_android->raster_matrixCreate = (*env)->GetStaticMethodID(env,
-		svg_android->raster_clazz, "matrixCreate",
-		"(FFFFFF)Landroid/graphics/Matrix;"
-		);
-	svg_android->raster_matrixInit = (*env)->GetStaticMethodID(env,
-		svg_android->raster_clazz, "matrixInit",
-		"(Landroid/graphics/Matrix;FFFFFF)V"
-		);
-	svg_android->raster_createBitmap = (*env)->GetStaticMethodID(env,
-		svg_android->raster_clazz, "createBitmap",
-		"(II)Landroid/graphics/Bitmap;"
-		);
-	svg_android->raster_data2bitmap = (*env)->GetStaticMethodID(env,
-		svg_android->raster_clazz, "data2bitmap",
-		"(II[I)Landroid/graphics/Bitmap;"
-		);
-	svg_android->raster_setFillRule = (*env)->GetStaticMethodID(env,
-		svg_android->raster_clazz, "setFillRule",
-		"(Landroid/graphics/Path;Z)V"
-		);
-	svg_android->raster_setPaintStyle = (*env)->GetStaticMethodID(env,
-		svg_android->raster_clazz, "setPaintStyle",
-		"(Landroid/graphics/Paint;Z)V"
-		);
-	svg_android->raster_setStrokeCap = (*env)->GetStaticMethodID(env,
-		svg_android->raster_clazz, "setStrokeCap",
-		"(Landroid/graphics/Paint;I)V"
-		);
-	svg_android->raster_setStrokeJoin = (*env)->GetStaticMethodID(env,
-		svg_android->raster_clazz, "setStrokeJoin",
-		"(Landroid/graphics/Paint;I)V"
-		);
-	svg_android->raster_createBitmapShader = (*env)->GetStaticMethodID(env,
-		svg_android->raster_clazz, "createBitmapShader",
-		"(Landroid/graphics/Bitmap;)Landroid/graphics/Shader;"
-		);
-	svg_android->raster_createLinearGradient = (*env)->GetStaticMethodID(env,
-		svg_android->raster_clazz, "createLinearGradient",
-		"(FFFF[I[FI)Landroid/graphics/Shader;"
-		);
-	svg_android->raster_createRadialGradient = (*env)->GetStaticMethodID(env,
-		svg_android->raster_clazz, "createRadialGradient",
-		"(FFF[I[FI)Landroid/graphics/Shader;"
-		);
-	svg_android->raster_matrixInvert = (*env)->GetStaticMethodID(env,
-		svg_android->raster_clazz, "matrixInvert", "(Landroid/graphics/Matrix;)Landroid/graphics/Matrix;");
-	svg_android->raster_getBoundingBox = (*env)->GetStaticMethodID(
-		env, svg_android->raster_clazz, "getBoundingBox", "(Landroid/graphics/Path;Landroid/graphics/Canvas;)V");
-	svg_android->raster_drawEllipse = (*env)->GetStaticMethodID(env,
-		svg_android->raster_clazz, "drawEllipse", "(Landroid/graphics/Canvas;Landroid/graphics/Paint;FFFF)V");
-	svg_android->raster_drawRect = (*env)->GetStaticMethodID(env,
-		svg_android->raster_clazz, "drawRect", "(Landroid/graphics/Canvas;Landroid/graphics/Paint;FFFFFF)V");
-	svg_android->raster_debugMatrix = (*env)->GetStaticMethodID(env,
-		svg_android->raster_clazz, "debugMatrix", "(Landroid/graphics/Matrix;)V");
-
-	// prepare bitmap class/methods
-	if(!bitmap_clazz) {
-		d = (*env)->FindClass(env, "android/graphics/Bitmap");
-		bitmap_clazz = (jclass)((*env)->NewGlobalRef(env, (jobject)d));
+	for(k = 0; k < sizeof(svg_android_jni_methods) / sizeof(svg_android_jni_methods[0]); k++) {
+		if(svg_android_jni_methods[k].is_static)
+			m = (*env)->GetStaticMethodID(env, *(svg_android_jni_methods[k].clazz),
+						      svg_android_jni_methods[k].name,
+						      svg_android_jni_methods[k].signature);
+		else
+			m = (*env)->GetMethodID(env, *(svg_android_jni_methods[k].clazz),
+						svg_android_jni_methods[k].name,
+						svg_android_jni_methods[k].signature);
+		if(m == NULL) {
+			SVG_ANDROID_ERROR("__prepare_android_interface() - could not get %s%s\n",
+					  svg_android_jni_methods[k].name,
+					  svg_android_jni_methods[k].signature);
+			return -1;
+		}
+		*(svg_android_jni_methods[k].method) = m;
 	}
-	svg_android->bitmap_clazz = bitmap_clazz;
 
-	svg_android->bitmap_erase_color = (*env)->GetMethodID(env,
-		svg_android->bitmap_clazz, "eraseColor",
-		"(I)V"
-		);
+	svg_android_jni_ready = -1;
+	return 0;
+}
 
-	// prepare matrix class/methods
-	if(!matrix_clazz) {
-		d = (*env)->FindClass(env, "android/graphics/Matrix");
-		matrix_clazz = (jclass)((*env)->NewGlobalRef(env, (jobject)d));
-	}
-	svg_android->matrix_clazz = matrix_clazz;
-
-	svg_android->matrix_constructor = (*env)->GetMethodID(env,
-		svg_android->matrix_clazz, "<init>", "()V");
-	svg_android->matrix_postTranslate = (*env)->GetMethodID(env,
-		svg_android->matrix_clazz, "postTranslate", "(FF)Z");
-	svg_android->matrix_postScale = (*env)->GetMethodID(env,
-		svg_android->matrix_clazz, "postScale", "(FF)Z");
-	svg_android->matrix_postConcat = (*env)->GetMethodID(env,
-		svg_android->matrix_clazz, "postConcat", "(Landroid/graphics/Matrix;)Z");
-	svg_android->matrix_reset = (*env)->GetMethodID(env,
-		svg_android->matrix_clazz, "reset", "()V");
-	svg_android->matrix_set = (*env)->GetMethodID(env,
-		svg_android->matrix_clazz, "set", "(Landroid/graphics/Matrix;)V");
-
-	// prepare shader class/methods
-	if(!shader_clazz) {
-		d = (*env)->FindClass(env, "android/graphics/Shader");
-		shader_clazz = (jclass)((*env)->NewGlobalRef(env, (jobject)d));
-	}
-	svg_android->shader_clazz = shader_clazz;
+#ifdef SVG_ANDROID_JNI_STATS
+static const char *__jni_class_name(jclass *clazz) {
+	int k;
 
-	svg_android->shader_setLocalMatrix = (*env)->GetMethodID(env,
-		svg_android->shader_clazz, "setLocalMatrix", "(Landroid/graphics/Matrix;)V");
+	for(k = 0; k < sizeof(svg_android_jni_classes) / sizeof(svg_android_jni_classes[0]); k++)
+		if(svg_android_jni_classes[k].clazz == clazz)
+			return svg_android_jni_classes[k].name;
+	return "?";
+}
 
-	// prepare path class/methods
-	if(!path_clazz) {
-		d = (*env)->FindClass(env, "android/graphics/Path");
-		path_clazz = (jclass)((*env)->NewGlobalRef(env, (jobject)d));
-	}
-	svg_android->path_clazz = path_clazz;
-
-	svg_android->path_constructor = (*env)->GetMethodID(env,
-		svg_android->path_clazz, "<init>", "()V");
-	svg_android->path_clone_constructor = (*env)->GetMethodID(env,
-		svg_android->path_clazz, "<init>", "(Landroid/graphics/Path;)V");
-	svg_android->path_transform = (*env)->GetMethodID(env,
-		svg_android->path_clazz, "transform", "(Landroid/graphics/Matrix;)V");
-	svg_android->path_moveTo = (*env)->GetMethodID(env,
-		svg_android->path_clazz, "moveTo", "(FF)V");
-	svg_android->path_lineTo = (*env)->GetMethodID(env,
-		svg_android->path_clazz, "lineTo", "(FF)V");
-	svg_android->path_cubicTo = (*env)->GetMethodID(env,
-		svg_android->path_clazz, "cubicTo", "(FFFFFF)V");
-	svg_android->path_quadTo = (*env)->GetMethodID(env,
-		svg_android->path_clazz, "quadTo", "(FFFF)V");
-	svg_android->path_close = (*env)->GetMethodID(env,
-		svg_android->path_clazz, "close", "()V");
-	svg_android->path_reset = (*env)->GetMethodID(env,
-		svg_android->path_clazz, "reset", "()V");
-
-	// prepare paint class/methods
-	if(!paint_clazz) {
-		d = (*env)->FindClass(env, "android/graphics/Paint");
-		paint_clazz = (jclass)((*env)->NewGlobalRef(env, (jobject)d));
-	}
-	svg_android->paint_clazz = paint_clazz;
-
-	svg_android->paint_constructor = (*env)->GetMethodID(env,
-		svg_android->paint_clazz, "<init>", "()V");
-	svg_android->paint_setPathEffect = (*env)->GetMethodID(
-		env,
-		svg_android->paint_clazz, "setPathEffect",
-		"(Landroid/graphics/PathEffect;)Landroid/graphics/PathEffect;");
-	svg_android->paint_setARGB = (*env)->GetMethodID(env,
-		svg_android->paint_clazz, "setARGB", "(IIII)V");
-	svg_android->paint_setShader = (*env)->GetMethodID(env,
-		svg_android->paint_clazz, "setShader", "(Landroid/graphics/Shader;)Landroid/graphics/Shader;");
-	svg_android->paint_setStrokeMiter = (*env)->GetMethodID(env,
-		svg_android->paint_clazz, "setStrokeMiter", "(F)V");
-	svg_android->paint_setStrokeWidth = (*env)->GetMethodID(env,
-		svg_android->paint_clazz, "setStrokeWidth", "(F)V");
-	svg_android->paint_getTextPath = (*env)->GetMethodID(
-		env,
-		svg_android->paint_clazz, "getTextPath",
-		"(Ljava/lang/String;IIFFLandroid/graphics/Path;)V");
-	svg_android->paint_setAntialias = (*env)->GetMethodID(env,
-		svg_android->paint_clazz, "setAntiAlias", "(Z)V");
-	svg_android->paint_set = (*env)->GetMethodID(env,
-		svg_android->paint_clazz, "set", "(Landroid/graphics/Paint;)V");
-	svg_android->paint_reset = (*env)->GetMethodID(env,
-		svg_android->paint_clazz, "reset", "()V");
-
-	// prepare dash path effect class/methods
-	if(!dashPathEffect_clazz) {
-		d = (*env)->FindClass(env, "android/graphics/DashPathEffect");
-		dashPathEffect_clazz = (jclass)((*env)->NewGlobalRef(env, (jobject)d));
+/* log the calls made into java since the render began, one line for
+ * every method that was called at least once */
+static void __report_jni_stats(svg_android_t *svg_android, const char *what) {
+	unsigned int count, total = 0;
+	size_t slot;
+	int k;
+
+	for(k = 0; k < sizeof(svg_android_jni_methods) / sizeof(svg_android_jni_methods[0]); k++) {
+		slot = (jmethodID *)svg_android_jni_methods[k].method - (jmethodID *)&svg_android_jni;
+		count = svg_android->jni_calls[slot];
+		if(count == 0)
+			continue;
+		total += count;
+		__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
+				    "jni %s: %6u %s.%s%s", what, count,
+				    __jni_class_name(svg_android_jni_methods[k].clazz),
+				    svg_android_jni_methods[k].name,
+				    svg_android_jni_methods[k].signature);
 	}
-	svg_android->dashPathEffect_clazz = dashPathEffect_clazz;
+	__android_log_print(ANDROID_LOG_INFO, "libsvg-android",
+			    "jni %s: %6u calls in total", what, total);
+}
 
-	svg_android->dashPathEffect_constructor = (*env)->GetMethodID(env,
-		svg_android->dashPathEffect_clazz, "<init>", "([FF)V");
+static void __reset_jni_stats(svg_android_t *svg_android) {
+	memset(svg_android->jni_calls, 0, sizeof(svg_android->jni_calls));
 }
+#else
+#define __report_jni_stats(s,w)
+#define __reset_jni_stats(s)
+#endif
 
 void svgAndroidSetAntialiasing(svg_android_t *svg_android, jboolean doAntiAlias) {
 	svg_android->do_antialias = doAntiAlias;
@@ -613,27 +577,74 @@ JNIEXPORT int JNICALL Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidSetAnt
 	return 0;
 }
 
+/* Resolution used for physical units (in, cm, mm, pt, pc), pass the
+ * density of the display the document is drawn on. Lengths resolved
+ * before are worked out again on the next render.
+ */
+svg_status_t svgAndroidSetDpi(svg_android_t *svg_android, double dpi) {
+	return svg_set_dpi(svg_android->svg, dpi);
+}
+
+JNIEXPORT jint JNICALL Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidSetDpi
+(JNIEnv *env, jclass jc, jlong _svg_android_r, jdouble dpi)
+{
+#ifdef ENVIRONMENT64
+	svg_android_t *svg_android = (svg_android_t *)_svg_android_r;
+#else
+	uint32_t t = (uint32_t)_svg_android_r;
+	svg_android_t *svg_android = (svg_android_t *)t;
+#endif
+	return svgAndroidSetDpi(svg_android, dpi);
+}
+
 svg_status_t svgAndroidRender
 (JNIEnv *env, svg_android_t *svg_android, jobject android_canvas)
 {
-	__prepare_android_interface(svg_android, env, android_canvas);
+	/* a no-op once JNI_OnLoad has run, only native code linking against
+	 * us without going through System.loadLibrary() resolves here */
+	if(__prepare_android_interface(env))
+		return SVG_STATUS_INVALID_CALL;
+
+	svg_android->env = env;
+	svg_android->canvas = android_canvas;
+	__reset_jni_stats(svg_android);
 
 	int width = ANDROID_GET_WIDTH(svg_android);
 	int height = ANDROID_GET_HEIGHT(svg_android);
 	svg_android->viewport_width = width;
 	svg_android->viewport_height = height;
 
-	/* we always need a valid bitmap, since we must pass it
-	 * as the background when processing filters
-	 */
-	SVG_ANDROID_DEBUG("svgAndroidRender() --> offscreen: (%d, %d)\n",
-			  (int)width,
-			  (int)height);
-	jobject offscreen_bitmap = ANDROID_CREATE_BITMAP(svg_android, width, height);
-	ANDROID_FILL_BITMAP(svg_android, offscreen_bitmap, 0x00000000);
+	if(svg_uses_filters(svg_android->svg)) {
+		/* filters need a valid bitmap, since we must pass it
+		 * as the background when processing them. It is kept
+		 * for the next frame as long as the size stays the same.
+		 */
+		if(svg_android->root_bitmap == NULL ||
+		   svg_android->root_bitmap_width != width ||
+		   svg_android->root_bitmap_height != height) {
+			SVG_ANDROID_DEBUG("svgAndroidRender() --> offscreen: (%d, %d)\n",
+					  (int)width,
+					  (int)height);
+			if(svg_android->root_bitmap)
+				(*env)->DeleteGlobalRef(env, svg_android->root_bitmap);
+
+			jobject bitmap = ANDROID_CREATE_BITMAP(svg_android, width, height);
+			svg_android->root_bitmap = (*env)->NewGlobalRef(env, bitmap);
+			(*env)->DeleteLocalRef(env, bitmap);
+			svg_android->root_bitmap_width = width;
+			svg_android->root_bitmap_height = height;
+		}
+		ANDROID_FILL_BITMAP(svg_android, svg_android->root_bitmap, 0x00000000);
+
+		/* create initial state */
+		_svg_android_push_state (svg_android, svg_android->root_bitmap, NULL);
+	} else {
+		/* nothing needs a background, draw straight to the canvas */
+		_svg_android_push_state (svg_android, NULL, NULL);
 
-	/* create initial state */
-	_svg_android_push_state (svg_android, offscreen_bitmap, NULL);
+		/* the canvas is not ours, it might already be transformed and clipped */
+		_svg_android_fetch_canvas_state (svg_android);
+	}
 
 	svg_android->fit_to_area = 0;
 	svg_status_t return_status = svg_render (svg_android->svg);
@@ -642,6 +653,8 @@ svg_status_t svgAndroidRender
 
 	(void) _svg_android_pop_state (svg_android);
 
+	__report_jni_stats(svg_android, "svgAndroidRender");
+
 	SVG_ANDROID_DEBUG("svgAndroidRender() --> finished render -- check exception...\n");
 	if((*(svg_android->env))->ExceptionOccurred(svg_android->env)) {
 		SVG_ANDROID_DEBUG("svgAndroidRender() --> exception found...\n");
@@ -665,16 +678,23 @@ JNIEXPORT jint JNICALL Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidRende
 }
 
 svg_status_t svgAndroidRenderToArea(JNIEnv *env, svg_android_t *svg_android, jobject android_canvas, int x, int y, int w, int h) {
-	__prepare_android_interface(svg_android, env, android_canvas);
+	if(__prepare_android_interface(env))
+		return SVG_STATUS_INVALID_CALL;
+
+	svg_android->env = env;
+	svg_android->canvas = android_canvas;
+	__reset_jni_stats(svg_android);
 
 	_svg_android_push_state (svg_android, NULL, NULL);
 
+	/* the canvas is not ours, it might already be transformed and clipped */
+	_svg_android_fetch_canvas_state (svg_android);
+
 	svg_android->fit_to_area = -1;
 	svg_android->fit_to_x = x;
 	svg_android->fit_to_y = y;
 	svg_android->fit_to_w = w;
 	svg_android->fit_to_h = h;
-	svg_android->fit_to_MATRIX = NULL;
 
 	svg_android->viewport_width = w;
 	svg_android->viewport_height = h;
@@ -683,6 +703,8 @@ svg_status_t svgAndroidRenderToArea(JNIEnv *env, svg_android_t *svg_android, job
 
 	_svg_android_pop_state (svg_android);
 
+	__report_jni_stats(svg_android, "svgAndroidRenderToArea");
+
 	return return_status;
 }
 
@@ -699,31 +721,161 @@ JNIEXPORT jint JNICALL Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidRende
 	return svgAndroidRenderToArea(env, svg_android, android_canvas, x, y, w, h);
 }
 
-static int __internal_bounding_box_is_in_clip;
-static svg_bounding_box_t __internal_bounding_box;
-JNIEXPORT void JNICALL Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidSetBoundingBox
-(JNIEnv *env, jclass jc, jboolean is_in_clip, jint left, jint top, jint right, jint bottom)
-{
-	if(left < 0) left = 0;
-	if(top < 0) top = 0;
-	if(right < 0) right = 0;
-	if(bottom < 0) bottom = 0;
-
-	__internal_bounding_box_is_in_clip = is_in_clip == JNI_TRUE ? -1 : 0;
-	__internal_bounding_box.left = left;
-	__internal_bounding_box.top = top;
-	__internal_bounding_box.right = right;
-	__internal_bounding_box.bottom = bottom;
+/* Draw without a canvas, straight into the pixels of an ARGB_8888
+ * bitmap, using the software engine. Nothing calls back into java
+ * while rendering, so this may run on any thread that has an env.
+ * Like every render it uses state kept in the document though, so one
+ * document must not be rendered by two threads at the same time.
+ */
+svg_status_t svgAndroidRenderToBitmap(JNIEnv *env, svg_android_t *svg_android, jobject android_bitmap) {
+	AndroidBitmapInfo info;
+	void *pixels;
+	svg_status_t return_status;
+
+	if(AndroidBitmap_getInfo(env, android_bitmap, &info) != ANDROID_BITMAP_RESULT_SUCCESS)
+		return SVG_STATUS_INVALID_CALL;
+
+	if(info.format != ANDROID_BITMAP_FORMAT_RGBA_8888)
+		return SVG_STATUS_INVALID_VALUE;
+
+	if(svg_android->soft == NULL) {
+		svg_android->soft = svgSoftCreate (svg_android->svg);
+		if(svg_android->soft == NULL)
+			return SVG_STATUS_NO_MEMORY;
+	}
+
+	if(AndroidBitmap_lockPixels(env, android_bitmap, &pixels) != ANDROID_BITMAP_RESULT_SUCCESS)
+		return SVG_STATUS_INVALID_CALL;
+
+	return_status = svgSoftRender (svg_android->soft, (unsigned char *)pixels,
+				       (int)info.width, (int)info.height, (int)info.stride);
+
+	AndroidBitmap_unlockPixels(env, android_bitmap);
+
+	return return_status;
 }
 
-int svgAndroidGetInternalBoundingBox(svg_bounding_box_t *bbox) {
-	*bbox = __internal_bounding_box; // straight copy of data
-	return __internal_bounding_box_is_in_clip;
+JNIEXPORT jint JNICALL Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidRenderToBitmap
+(JNIEnv *env, jclass jc, jlong _svg_android_r, jobject android_bitmap)
+{
+#ifdef ENVIRONMENT64
+	svg_android_t *svg_android = (svg_android_t *)_svg_android_r;
+#else
+	uint32_t t = (uint32_t)_svg_android_r;
+	svg_android_t *svg_android = (svg_android_t *)t;
+#endif
+	return svgAndroidRenderToBitmap(env, svg_android, android_bitmap);
 }
 
 void svgAndroidEnablePathCache(svg_android_t *svg_android) {
-
-#if 0 // caching does not work on all devices it seems, I do not know why...
 	svg_enable_path_cache(svg_android->svg);
+}
+
+/* Drop every bitmap and text outline we keep between renders, they are
+ * recreated when they are needed again. Meant to be called from
+ * onTrimMemory(), never while a render is in progress.
+ */
+void svgAndroidTrimMemory(svg_android_t *svg_android) {
+	_svg_android_image_cache_deinit (svg_android);
+	_svg_android_pattern_cache_deinit (svg_android);
+	_svg_android_layer_pool_deinit (svg_android);
+	_svg_android_text_cache_deinit (svg_android);
+
+	if(svg_android->root_bitmap)
+		(*(svg_android->env))->DeleteGlobalRef(svg_android->env, svg_android->root_bitmap);
+	svg_android->root_bitmap = NULL;
+	svg_android->root_bitmap_width = 0;
+	svg_android->root_bitmap_height = 0;
+}
+
+JNIEXPORT void JNICALL Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidTrimMemory
+(JNIEnv *env, jclass jc, jlong _svg_android_r)
+{
+#ifdef ENVIRONMENT64
+	svg_android_t *svg_android = (svg_android_t *)_svg_android_r;
+#else
+	uint32_t t = (uint32_t)_svg_android_r;
+	svg_android_t *svg_android = (svg_android_t *)t;
+#endif
+	svg_android->env = env;
+	svgAndroidTrimMemory(svg_android);
+}
+
+/* bytes of bitmap memory held between renders */
+size_t svgAndroidGetCacheMemory(svg_android_t *svg_android) {
+	size_t bytes = svg_android->image_cache_bytes + svg_android->pattern_cache_bytes;
+	int k;
+
+	for(k = 0; k < SVG_ANDROID_LAYER_POOL_SIZE; k++)
+		if(svg_android->layer_pool[k].bitmap)
+			bytes += (size_t)svg_android->layer_pool[k].width * svg_android->layer_pool[k].height * 4;
+
+	if(svg_android->root_bitmap)
+		bytes += (size_t)svg_android->root_bitmap_width * svg_android->root_bitmap_height * 4;
+
+	return bytes;
+}
+
+JNIEXPORT jlong JNICALL Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidGetCacheMemory
+(JNIEnv *env, jclass jc, jlong _svg_android_r)
+{
+#ifdef ENVIRONMENT64
+	svg_android_t *svg_android = (svg_android_t *)_svg_android_r;
+#else
+	uint32_t t = (uint32_t)_svg_android_r;
+	svg_android_t *svg_android = (svg_android_t *)t;
 #endif
+	return (jlong)svgAndroidGetCacheMemory(svg_android);
+}
+
+static JNINativeMethod svg_android_natives[] = {
+	{ "svgAndroidCreate", "()J",
+	  (void *)Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidCreate },
+	{ "svgAndroidDestroy", "(J)V",
+	  (void *)Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidDestroy },
+	{ "svgAndroidParseBuffer", "(JLjava/lang/String;)I",
+	  (void *)Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidParseBuffer },
+	{ "svgAndroidSetBaseUri", "(JLjava/lang/String;)I",
+	  (void *)Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidSetBaseUri },
+	{ "svgAndroidParseChunkBegin", "(J)I",
+	  (void *)Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidParseChunkBegin },
+	{ "svgAndroidParseChunk", "(JLjava/lang/String;)I",
+	  (void *)Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidParseChunk },
+	{ "svgAndroidParseChunkEnd", "(J)I",
+	  (void *)Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidParseChunkEnd },
+	{ "svgAndroidSetAntialiasing", "(JZ)I",
+	  (void *)Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidSetAntialiasing },
+	{ "svgAndroidSetDpi", "(JD)I",
+	  (void *)Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidSetDpi },
+	{ "svgAndroidRender", "(JLandroid/graphics/Canvas;)I",
+	  (void *)Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidRender },
+	{ "svgAndroidRenderToArea", "(JLandroid/graphics/Canvas;IIII)I",
+	  (void *)Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidRenderToArea },
+	{ "svgAndroidRenderToBitmap", "(JLandroid/graphics/Bitmap;)I",
+	  (void *)Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidRenderToBitmap },
+	{ "svgAndroidTrimMemory", "(J)V",
+	  (void *)Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidTrimMemory },
+	{ "svgAndroidGetCacheMemory", "(J)J",
+	  (void *)Java_com_toolkits_libsvgandroid_SvgRaster_svgAndroidGetCacheMemory },
+};
+
+/* Runs once when System.loadLibrary() loads us. Everything the engine
+ * calls into Java is resolved here, and the natives are bound directly
+ * so the VM does not have to look them up by symbol name either. */
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved) {
+	JNIEnv *env;
+
+	if((*vm)->GetEnv(vm, (void **)&env, JNI_VERSION_1_6) != JNI_OK)
+		return JNI_ERR;
+
+	if(__prepare_android_interface(env))
+		return JNI_ERR;
+
+	if((*env)->RegisterNatives(env, svg_android_jni.raster_clazz, svg_android_natives,
+				   sizeof(svg_android_natives) / sizeof(svg_android_natives[0])) < 0) {
+		SVG_ANDROID_ERROR("JNI_OnLoad() - could not register natives\n");
+		return JNI_ERR;
+	}
+
+	return JNI_VERSION_1_6;
 }
@@ -30,122 +30,13 @@
 #define __DO_SVG_ANDROID_DEBUG
 #include "svg_android_debug.h"
 
+/* the Filter class and its methods are resolved by JNI_OnLoad, all we
+ * need here is the instance that collects this document's filters */
 static int prep_filter(JNIEnv* env, svg_android_t* svg_android) {
-	svg_android->filter_clazz =
-		(*env)->FindClass(env, "com/toolkits/libsvgandroid/Filter");
-
-	if(svg_android->filter_clazz == NULL) {
-		SVG_ANDROID_ERROR("svg_android_filter.c:prep_filter() - could not get Filter class.\n");
-		return -1;
-	}
-
-	svg_android->create_filter = (*env)->GetStaticMethodID(
-		env,
-		svg_android->filter_clazz, "createFilter",
-		"()Lcom/toolkits/libsvgandroid/Filter;"
-		);
-
-	if(svg_android->create_filter == NULL) {
-		SVG_ANDROID_ERROR("svg_android_filter.c:prep_filter() - could not get Filter::createFilter().\n");
-		return -1;
-	}
-
-	svg_android->begin_filter = (*env)->GetMethodID(
-		env,
-		svg_android->filter_clazz, "beginFilter",
-		"(Ljava/lang/String;)V"
-		);
-
-	if(svg_android->begin_filter == NULL) {
-		SVG_ANDROID_ERROR("svg_android_filter.c:prep_filter() - could not get Filter::beginFilter().\n");
-		return -1;
-	}
-
-	svg_android->set_filter = (*env)->GetMethodID(
-		env,
-		svg_android->filter_clazz, "setFilter",
-		"(Ljava/lang/String;)V"
-		);
-
-	if(svg_android->set_filter == NULL) {
-		SVG_ANDROID_ERROR("svg_android_filter.c:prep_filter() - could not get Filter::setFilter().\n");
-		return -1;
-	}
-
-	svg_android->add_filter_feBlend = (*env)->GetMethodID(
-		env,
-		svg_android->filter_clazz, "addFilter_feBlend",
-		"(IIIIIII)V"
-		);
-
-	if(svg_android->add_filter_feBlend == NULL) {
-		SVG_ANDROID_ERROR(
-			"svg_android_filter.c:prep_filter() - could not get Filter::addFilter_feBlend().\n");
-		return -1;
-	}
-
-	svg_android->add_filter_feComposite = (*env)->GetMethodID(
-		env,
-		svg_android->filter_clazz, "addFilter_feComposite",
-		"(IIIIIIIDDDD)V"
-		);
-
-	if(svg_android->add_filter_feComposite == NULL) {
-		SVG_ANDROID_ERROR(
-			"svg_android_filter.c:prep_filter() - could not get Filter::addFilter_feComposite().\n");
-		return -1;
-	}
-
-	svg_android->add_filter_feFlood = (*env)->GetMethodID(
-		env,
-		svg_android->filter_clazz, "addFilter_feFlood",
-		"(IIIIIID)V"
-		);
-
-	if(svg_android->add_filter_feFlood == NULL) {
-		SVG_ANDROID_ERROR(
-			"svg_android_filter.c:prep_filter() - could not get Filter::addFilter_feFlood().\n");
-		return -1;
-	}
-
-	svg_android->add_filter_feGaussianBlur = (*env)->GetMethodID(
-		env,
-		svg_android->filter_clazz, "addFilter_feGaussianBlur",
-		"(IIIIIDD)V"
-		);
-
-	if(svg_android->add_filter_feGaussianBlur == NULL) {
-		SVG_ANDROID_ERROR(
-			"svg_android_filter.c:prep_filter() - could not get Filter::addFilter_feGaussianBlur().\n");
-		return -1;
-	}
-
-	svg_android->add_filter_feOffset = (*env)->GetMethodID(
-		env,
-		svg_android->filter_clazz, "addFilter_feOffset",
-		"(IIIIIDD)V"
-		);
-
-	if(svg_android->add_filter_feOffset == NULL) {
-		SVG_ANDROID_ERROR(
-			"svg_android_filter.c:prep_filter() - could not get Filter::addFilter_feOffset().\n");
-		return -1;
-	}
-
-	svg_android->filter_execute = (*env)->GetMethodID(
-		env,
-		svg_android->filter_clazz, "execute",
-		"(Landroid/graphics/Bitmap;Landroid/graphics/Bitmap;)Landroid/graphics/Bitmap;");
-
-	if(svg_android->filter_execute == NULL) {
-		SVG_ANDROID_ERROR(
-			"svg_android_filter.c:prep_filter() - could not get Filter::execute().\n");
-		return -1;
-	}
-
+	SVG_ANDROID_JNI_COUNT(svg_android, create_filter);
 	svg_android->filter = (*env)->CallStaticObjectMethod(env,
-							     svg_android->filter_clazz,
-							     svg_android->create_filter);
+							     svg_android_jni.filter_clazz,
+							     svg_android_jni.create_filter);
 
 	if(svg_android->filter == NULL) {
 		SVG_ANDROID_ERROR(
@@ -175,9 +66,10 @@ svg_status_t _svg_android_set_filter (void *closure, const char* id) {
 	SVG_ANDROID_DEBUG(" --- _svg_android_add_filter_feFlood = %p\n",
 			  _svg_android_add_filter_feFlood);
 
+	SVG_ANDROID_JNI_COUNT(svg_android, set_filter);
 	(*env)->CallVoidMethod(env,
 			       svg_android->filter,
-			       svg_android->set_filter,
+			       svg_android_jni.set_filter,
 			       (*env)->NewStringUTF(env, id));
 
 	_svg_android_prepare_filter(svg_android);
@@ -192,9 +84,10 @@ svg_status_t _svg_android_begin_filter (void *closure, const char* id) {
 	if(svg_android->filter == NULL && prep_filter(env, svg_android))
 		return SVG_ANDROID_STATUS_NO_MEMORY;
 
+	SVG_ANDROID_JNI_COUNT(svg_android, begin_filter);
 	(*env)->CallVoidMethod(env,
 			       svg_android->filter,
-			       svg_android->begin_filter,
+			       svg_android_jni.begin_filter,
 			       (*env)->NewStringUTF(env, id));
 
 	return SVG_ANDROID_STATUS_SUCCESS;
@@ -272,9 +165,10 @@ svg_status_t _svg_android_add_filter_feBlend (void *closure,
 		break;
 	}
 
+	SVG_ANDROID_JNI_COUNT(svg_android, add_filter_feBlend);
 	(*env)->CallVoidMethod(env,
 			       svg_android->filter,
-			       svg_android->add_filter_feBlend,
+			       svg_android_jni.add_filter_feBlend,
 			       (int)__x, (int)__y, (int)__w, (int)__h,
 			       __in, __in2,
 			       bmode
@@ -329,9 +223,10 @@ svg_status_t _svg_android_add_filter_feComposite (void *closure,
 		break;
 	}
 
+	SVG_ANDROID_JNI_COUNT(svg_android, add_filter_feComposite);
 	(*env)->CallVoidMethod(env,
 			       svg_android->filter,
-			       svg_android->add_filter_feComposite,
+			       svg_android_jni.add_filter_feComposite,
 			       (int)__x, (int)__y, (int)__w, (int)__h,
 			       boprt,
 			       __in, __in2,
@@ -363,9 +258,10 @@ svg_status_t _svg_android_add_filter_feFlood (void *closure,
 	int __in = in2int(in, in_op_reference);
 	int _color = (0x00ffffff) & (color->rgb);
 
+	SVG_ANDROID_JNI_COUNT(svg_android, add_filter_feFlood);
 	(*env)->CallVoidMethod(env,
 			       svg_android->filter,
-			       svg_android->add_filter_feFlood,
+			       svg_android_jni.add_filter_feFlood,
 			       (int)__x, (int)__y, (int)__w, (int)__h,
 			       __in,
 			       _color, opacity
@@ -396,9 +292,10 @@ svg_status_t _svg_android_add_filter_feGaussianBlur (void *closure,
 
 	int __in = in2int(in, in_op_reference);
 
+	SVG_ANDROID_JNI_COUNT(svg_android, add_filter_feGaussianBlur);
 	(*env)->CallVoidMethod(env,
 			       svg_android->filter,
-			       svg_android->add_filter_feGaussianBlur,
+			       svg_android_jni.add_filter_feGaussianBlur,
 			       (int)__x, (int)__y, (int)__w, (int)__h,
 			       __in,
 			       std_dev_x, std_dev_y
@@ -428,9 +325,10 @@ svg_status_t _svg_android_add_filter_feOffset (void *closure,
 
 	int __in = in2int(in, in_op_reference);
 
+	SVG_ANDROID_JNI_COUNT(svg_android, add_filter_feOffset);
 	(*env)->CallVoidMethod(env,
 			       svg_android->filter,
-			       svg_android->add_filter_feOffset,
+			       svg_android_jni.add_filter_feOffset,
 			       (int)__x, (int)__y, (int)__w, (int)__h,
 			       __in,
 			       dx, dy
@@ -458,6 +356,10 @@ _svg_android_prepare_filter (svg_android_t* svg_android) {
 	svg_android->state->saved_filter_canvas = svg_android->canvas;
 	svg_android->canvas = new_canvas;
 
+	_svg_android_state_reset_canvas (svg_android->state,
+					 (int)svg_android->state->viewport_width,
+					 (int)svg_android->state->viewport_height);
+
 	_svg_android_copy_canvas_state (svg_android);
 }
 
@@ -473,10 +375,11 @@ _svg_android_execute_filter (svg_android_t* svg_android) {
 
 		SVG_ANDROID_DEBUG("_svg_android_execute_filter() - B\n");
 
+		SVG_ANDROID_JNI_COUNT(svg_android, filter_execute);
 		jobject final_bitmap = (*env)->CallObjectMethod(
 			env,
 			svg_android->filter,
-			svg_android->filter_execute,
+			svg_android_jni.filter_execute,
 			svg_android->state->background_bitmap,
 			svg_android->state->filter_source_bitmap
 			);
@@ -0,0 +1,163 @@
+/* libsvg-android - Render SVG documents to an Android canvas
+ *
+ * Copyright © 2002 University of Southern California
+ * Copyright © 2016 Anton Persson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy (COPYING.LESSER) of the
+ * GNU Lesser General Public License along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Original Cairo-version:
+ * Author: Carl D. Worth <cworth@isi.edu>
+ *
+ * Android modification:
+ * Author: Anton Persson {don d0t juanton 4t gmail d0t com}
+ *
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "svg-android-internal.h"
+
+//#define __DO_SVG_ANDROID_DEBUG
+#include "svg_android_debug.h"
+
+/* Decoded images are turned into android Bitmaps once and kept here,
+ * keyed on the pixel data libsvg owns (svg_image_t.data). libsvg tells
+ * us through free_image_cache when that data goes away, which also
+ * happens when the href of the image changes. The bitmaps are bounded
+ * by a byte budget and can be dropped at any time by svgAndroidTrimMemory,
+ * they are simply recreated on the next render.
+ */
+
+void
+_svg_android_image_cache_init (svg_android_t *svg_android)
+{
+	svg_android->image_cache_head = NULL;
+	svg_android->image_cache_bytes = 0;
+}
+
+static void
+_svg_android_image_cache_free_entry (svg_android_t *svg_android,
+				     svg_android_image_cache_entry_t *entry)
+{
+	svg_android_image_cache_entry_t **p;
+
+	for(p = &svg_android->image_cache_head; *p; p = &(*p)->next) {
+		if(*p == entry) {
+			*p = entry->next;
+			break;
+		}
+	}
+
+	svg_android->image_cache_bytes -= entry->bytes;
+	(*(svg_android->env))->DeleteGlobalRef(svg_android->env, entry->bitmap);
+	free(entry);
+}
+
+void
+_svg_android_image_cache_deinit (svg_android_t *svg_android)
+{
+	while(svg_android->image_cache_head)
+		_svg_android_image_cache_free_entry (svg_android, svg_android->image_cache_head);
+}
+
+/* drop the least recently used bitmaps until another one of the given
+ * size fits the budget */
+static void
+_svg_android_image_cache_make_room (svg_android_t *svg_android, size_t bytes)
+{
+	svg_android_image_cache_entry_t *entry, *victim;
+
+	while(svg_android->image_cache_head &&
+	      svg_android->image_cache_bytes + bytes > SVG_ANDROID_IMAGE_CACHE_BYTES) {
+		victim = NULL;
+		for(entry = svg_android->image_cache_head; entry; entry = entry->next)
+			if(victim == NULL || entry->last_used < victim->last_used)
+				victim = entry;
+
+		SVG_ANDROID_DEBUG("_svg_android_image_cache_make_room() - evicting %p\n", victim->data);
+		_svg_android_image_cache_free_entry (svg_android, victim);
+	}
+}
+
+/* returns a global ref to the bitmap for the image data, creating it
+ * if needed. The ref stays owned by the cache. */
+jobject
+_svg_android_image_cache_get (svg_android_t *svg_android,
+			      unsigned char *data,
+			      unsigned int data_width,
+			      unsigned int data_height)
+{
+	JNIEnv *env = svg_android->env;
+	svg_android_image_cache_entry_t *entry;
+	jintArray iarr;
+	jobject bitmap;
+
+	for(entry = svg_android->image_cache_head; entry; entry = entry->next) {
+		if(entry->data == data) {
+			entry->last_used = ++svg_android->image_clock;
+			return entry->bitmap;
+		}
+	}
+
+	entry = malloc(sizeof(svg_android_image_cache_entry_t));
+	if(entry == NULL)
+		return NULL;
+
+	entry->data = data;
+	entry->bytes = (size_t)data_width * (size_t)data_height * 4;
+	_svg_android_image_cache_make_room (svg_android, entry->bytes);
+
+	// copy bitmap into an java int array
+	iarr = (*env)->NewIntArray(env, data_width * data_height);
+	if(iarr == NULL) {
+		free(entry);
+		return NULL; /* out of memory error thrown */
+	}
+	(*env)->SetIntArrayRegion(env, iarr, 0, data_width * data_height , (jint *)data);
+
+	// create bitmap
+	bitmap = ANDROID_DATA_2_BITMAP(svg_android, iarr, data_width, data_height);
+	(*env)->DeleteLocalRef(env, iarr);
+
+	entry->bitmap = bitmap ? (*env)->NewGlobalRef(env, bitmap) : NULL;
+	(*env)->DeleteLocalRef(env, bitmap);
+	if(entry->bitmap == NULL) {
+		free(entry);
+		return NULL;
+	}
+
+	entry->last_used = ++svg_android->image_clock;
+	entry->next = svg_android->image_cache_head;
+	svg_android->image_cache_head = entry;
+	svg_android->image_cache_bytes += entry->bytes;
+
+	return entry->bitmap;
+}
+
+void
+_svg_android_free_image_cache (void *closure, unsigned char *data)
+{
+	svg_android_t *svg_android = closure;
+	svg_android_image_cache_entry_t *entry;
+
+	for(entry = svg_android->image_cache_head; entry; entry = entry->next) {
+		if(entry->data == data) {
+			_svg_android_image_cache_free_entry (svg_android, entry);
+			return;
+		}
+	}
+}
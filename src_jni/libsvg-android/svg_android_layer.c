@@ -0,0 +1,271 @@
+/* libsvg-android - Render SVG documents to an Android canvas
+ *
+ * Copyright © 2002 University of Southern California
+ * Copyright © 2016 Anton Persson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy (COPYING.LESSER) of the
+ * GNU Lesser General Public License along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Original Cairo-version:
+ * Author: Carl D. Worth <cworth@isi.edu>
+ *
+ * Android modification:
+ * Author: Anton Persson {don d0t juanton 4t gmail d0t com}
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "svg-android-internal.h"
+
+//#define __DO_SVG_ANDROID_DEBUG
+#include "svg_android_debug.h"
+
+/* Translucent groups are drawn into an offscreen layer which is then
+ * composited with the group opacity. The layer only covers the part of
+ * the canvas the group can actually draw to (its extents, when the core
+ * could tell them, within the current device clip), and the bitmaps are
+ * bucketed by size and kept in a small pool so that they survive from
+ * one render to the next.
+ */
+
+#define SVG_ANDROID_LAYER_BUCKET 64
+
+void
+_svg_android_layer_pool_init (svg_android_t *svg_android)
+{
+	memset(svg_android->layer_pool, 0, sizeof(svg_android->layer_pool));
+	svg_android->layer_clock = 0;
+}
+
+static void
+_svg_android_layer_destroy (svg_android_t *svg_android, svg_android_layer_t *layer)
+{
+	JNIEnv *env = svg_android->env;
+
+	if(layer->canvas)
+		(*env)->DeleteGlobalRef(env, layer->canvas);
+	if(layer->bitmap)
+		(*env)->DeleteGlobalRef(env, layer->bitmap);
+
+	layer->canvas = NULL;
+	layer->bitmap = NULL;
+	layer->width = layer->height = 0;
+}
+
+void
+_svg_android_layer_pool_deinit (svg_android_t *svg_android)
+{
+	int k;
+
+	for(k = 0; k < SVG_ANDROID_LAYER_POOL_SIZE; k++)
+		_svg_android_layer_destroy (svg_android, &svg_android->layer_pool[k]);
+}
+
+static svg_status_t
+_svg_android_layer_create (svg_android_t *svg_android, svg_android_layer_t *layer, int width, int height)
+{
+	JNIEnv *env = svg_android->env;
+	jobject bitmap, canvas;
+
+	bitmap = ANDROID_CREATE_BITMAP(svg_android, width, height);
+	if(bitmap == NULL)
+		return SVG_STATUS_NO_MEMORY; /* out of memory error thrown */
+	canvas = ANDROID_CANVAS_CREATE(svg_android, bitmap);
+	if(canvas == NULL) {
+		(*env)->DeleteLocalRef(env, bitmap);
+		return SVG_STATUS_NO_MEMORY;
+	}
+
+	layer->bitmap = (*env)->NewGlobalRef(env, bitmap);
+	layer->canvas = (*env)->NewGlobalRef(env, canvas);
+	(*env)->DeleteLocalRef(env, bitmap);
+	(*env)->DeleteLocalRef(env, canvas);
+
+	layer->width = width;
+	layer->height = height;
+
+	return SVG_STATUS_SUCCESS;
+}
+
+static svg_android_layer_t *
+_svg_android_layer_acquire (svg_android_t *svg_android, int width, int height)
+{
+	svg_android_layer_t *layer = NULL;
+	int k;
+
+	// round up to the bucket size, so that slightly different groups share bitmaps
+	width = (width + SVG_ANDROID_LAYER_BUCKET - 1) & ~(SVG_ANDROID_LAYER_BUCKET - 1);
+	height = (height + SVG_ANDROID_LAYER_BUCKET - 1) & ~(SVG_ANDROID_LAYER_BUCKET - 1);
+
+	for(k = 0; k < SVG_ANDROID_LAYER_POOL_SIZE; k++) {
+		svg_android_layer_t *l = &svg_android->layer_pool[k];
+
+		if(l->in_use)
+			continue;
+
+		if(l->bitmap && l->width == width && l->height == height) {
+			layer = l;
+			break;
+		}
+
+		// otherwise prefer an empty slot, then the least recently used one
+		if(layer == NULL ||
+		   (layer->bitmap && (l->bitmap == NULL || l->last_used < layer->last_used)))
+			layer = l;
+	}
+
+	if(layer == NULL) {
+		// nested deeper than the pool, use a one-off layer
+		layer = calloc(1, sizeof(svg_android_layer_t));
+		if(layer == NULL)
+			return NULL;
+	} else {
+		layer->pooled = 1;
+	}
+
+	if(layer->bitmap == NULL || layer->width != width || layer->height != height) {
+		SVG_ANDROID_DEBUG("_svg_android_layer_acquire() - new layer (%d, %d)\n", width, height);
+
+		_svg_android_layer_destroy (svg_android, layer);
+		if(_svg_android_layer_create (svg_android, layer, width, height)) {
+			if(!layer->pooled)
+				free(layer);
+			return NULL;
+		}
+	}
+
+	layer->in_use = 1;
+	layer->last_used = ++svg_android->layer_clock;
+
+	return layer;
+}
+
+static void
+_svg_android_layer_release (svg_android_t *svg_android, svg_android_layer_t *layer)
+{
+	if(layer->pooled) {
+		layer->in_use = 0;
+	} else {
+		_svg_android_layer_destroy (svg_android, layer);
+		free(layer);
+	}
+}
+
+/* Redirect drawing of the current (group) state into a layer. If no
+ * layer can be had the group is drawn directly, without the opacity,
+ * which is how it was done before layers existed.
+ */
+svg_status_t
+_svg_android_layer_begin (svg_android_t *svg_android, double opacity, const svg_rect_t *extents)
+{
+	svg_android_state_t *state = svg_android->state;
+	svg_android_layer_t *layer;
+	svg_android_ctm_t *ctm = &state->ctm;
+	svg_android_ctm_t canvas_matrix, offset;
+	double x1, y1, x2, y2, ex1, ey1, ex2, ey2, det;
+	int lx, ly, width, height;
+
+	if(state->has_clip) {
+		x1 = state->clip_x1; y1 = state->clip_y1;
+		x2 = state->clip_x2; y2 = state->clip_y2;
+	} else {
+		x1 = 0.0; y1 = 0.0;
+		x2 = svg_android->viewport_width;
+		y2 = svg_android->viewport_height;
+	}
+
+	if(extents) {
+		if(extents->width < 0.0 || extents->height < 0.0)
+			return SVG_STATUS_SUCCESS; // the group draws nothing
+
+		ex1 = extents->x; ey1 = extents->y;
+		ex2 = ex1 + extents->width; ey2 = ey1 + extents->height;
+		_svg_android_ctm_transform_extents (ctm, &ex1, &ey1, &ex2, &ey2);
+
+		// a pixel more for the antialiased edges
+		if(ex1 - 1.0 > x1) x1 = ex1 - 1.0;
+		if(ey1 - 1.0 > y1) y1 = ey1 - 1.0;
+		if(ex2 + 1.0 < x2) x2 = ex2 + 1.0;
+		if(ey2 + 1.0 < y2) y2 = ey2 + 1.0;
+		if(x2 <= x1 || y2 <= y1)
+			return SVG_STATUS_SUCCESS; // all of it is clipped away
+	}
+
+	lx = (int)floor(x1);
+	ly = (int)floor(y1);
+	width = (int)ceil(x2) - lx;
+	height = (int)ceil(y2) - ly;
+
+	det = ctm->xx * ctm->yy - ctm->xy * ctm->yx;
+	if(width <= 0 || height <= 0 || det == 0.0)
+		return SVG_STATUS_SUCCESS; // nothing of the group will be visible anyway
+
+	layer = _svg_android_layer_acquire (svg_android, width, height);
+	if(layer == NULL) {
+		SVG_ANDROID_ERROR("_svg_android_layer_begin() - could not get a (%d, %d) layer.\n", width, height);
+		(*(svg_android->env))->ExceptionClear(svg_android->env);
+		return SVG_STATUS_SUCCESS;
+	}
+
+	// the layer canvas gets the current matrix, moved to the layer origin
+	canvas_matrix = *ctm;
+	canvas_matrix.x0 -= lx;
+	canvas_matrix.y0 -= ly;
+	ANDROID_BEGIN_LAYER(svg_android, layer->canvas, layer->bitmap, &canvas_matrix);
+
+	// and compositing maps it back: inverse(ctm) * translate(lx, ly)
+	state->layer_ctm.xx = ctm->yy / det;
+	state->layer_ctm.yx = -ctm->yx / det;
+	state->layer_ctm.xy = -ctm->xy / det;
+	state->layer_ctm.yy = ctm->xx / det;
+	state->layer_ctm.x0 = (ctm->xy * ctm->y0 - ctm->yy * ctm->x0) / det;
+	state->layer_ctm.y0 = (ctm->yx * ctm->x0 - ctm->xx * ctm->y0) / det;
+	offset.xx = 1.0; offset.yx = 0.0;
+	offset.xy = 0.0; offset.yy = 1.0;
+	offset.x0 = lx; offset.y0 = ly;
+	_svg_android_ctm_multiply (&state->layer_ctm, &offset);
+
+	state->layer = layer;
+	state->layer_width = width;
+	state->layer_height = height;
+	state->layer_opacity = opacity;
+
+	state->saved_canvas = svg_android->canvas;
+	svg_android->canvas = layer->canvas;
+
+	return SVG_STATUS_SUCCESS;
+}
+
+/* composite the layer of the current state, the canvas must already be
+ * switched back to the parent one */
+void
+_svg_android_layer_end (svg_android_t *svg_android)
+{
+	svg_android_state_t *state = svg_android->state;
+	jint alpha;
+
+	if(state == NULL || state->layer == NULL)
+		return;
+
+	alpha = (jint)(state->layer_opacity * 255.0 + 0.5);
+	ANDROID_DRAW_LAYER(svg_android, state->layer->bitmap,
+			   state->layer_width, state->layer_height,
+			   &state->layer_ctm, alpha);
+
+	_svg_android_layer_release (svg_android, state->layer);
+	state->layer = NULL;
+}
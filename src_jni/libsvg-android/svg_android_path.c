@@ -0,0 +1,451 @@
+/* libsvg-android - Render SVG documents to an Android canvas
+ *
+ * Copyright © 2002 University of Southern California
+ * Copyright © 2016 Anton Persson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy (COPYING.LESSER) of the
+ * GNU Lesser General Public License along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Original Cairo-version:
+ * Author: Carl D. Worth <cworth@isi.edu>
+ *
+ * Android modification:
+ * Author: Anton Persson {don d0t juanton 4t gmail d0t com}
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "svg-android-internal.h"
+
+//#define __DO_SVG_ANDROID_DEBUG
+#include "svg_android_debug.h"
+
+/* Path segments are not pushed into the android.graphics.Path one by
+ * one, that would cost us one JNI transition per segment. Instead they
+ * are collected here and handed over to SvgRaster.replayPath() in a
+ * single call when somebody actually needs the Java path object.
+ */
+
+#define SVG_ANDROID_PATH_BUFFER_INITIAL_OPS 64
+
+void
+_svg_android_path_buffer_init (svg_android_path_buffer_t *buffer)
+{
+	memset(buffer, 0, sizeof(svg_android_path_buffer_t));
+}
+
+void
+_svg_android_path_buffer_deinit (svg_android_t *svg_android)
+{
+	svg_android_path_buffer_t *buffer = &svg_android->path_buffer;
+
+	if(buffer->ops_array)
+		(*(svg_android->env))->DeleteGlobalRef(svg_android->env, buffer->ops_array);
+	if(buffer->args_array)
+		(*(svg_android->env))->DeleteGlobalRef(svg_android->env, buffer->args_array);
+
+	free(buffer->ops);
+	free(buffer->args);
+
+	_svg_android_path_buffer_init (buffer);
+}
+
+void
+_svg_android_path_buffer_clear (svg_android_t *svg_android)
+{
+	svg_android->path_buffer.num_ops = 0;
+	svg_android->path_buffer.num_args = 0;
+	svg_android->path_buffer.has_extents = 0;
+}
+
+static svg_status_t
+_svg_android_path_buffer_grow (svg_android_path_buffer_t *buffer, int num_args)
+{
+	if(buffer->num_ops + 1 > buffer->ops_size) {
+		int new_size = buffer->ops_size ? 2 * buffer->ops_size : SVG_ANDROID_PATH_BUFFER_INITIAL_OPS;
+		jbyte *new_ops = realloc(buffer->ops, new_size * sizeof(jbyte));
+
+		if(new_ops == NULL)
+			return SVG_STATUS_NO_MEMORY;
+
+		buffer->ops = new_ops;
+		buffer->ops_size = new_size;
+	}
+
+	if(buffer->num_args + num_args > buffer->args_size) {
+		// a cubic is the most expensive op, six arguments
+		int new_size = buffer->args_size ? 2 * buffer->args_size : 6 * SVG_ANDROID_PATH_BUFFER_INITIAL_OPS;
+		jfloat *new_args = realloc(buffer->args, new_size * sizeof(jfloat));
+
+		if(new_args == NULL)
+			return SVG_STATUS_NO_MEMORY;
+
+		buffer->args = new_args;
+		buffer->args_size = new_size;
+	}
+
+	return SVG_STATUS_SUCCESS;
+}
+
+/* append the buffered segments to a polyline, for the stroker */
+void
+_svg_android_path_buffer_flatten (svg_android_path_buffer_t *buffer, svg_polyline_t *polyline)
+{
+	const jfloat *a = buffer->args;
+	double cur_x = 0.0, cur_y = 0.0, move_x = 0.0, move_y = 0.0;
+	int k;
+
+	for(k = 0; k < buffer->num_ops; k++) {
+		switch(buffer->ops[k]) {
+		case SVG_ANDROID_PATH_OP_MOVE_TO:
+			svg_polyline_move_to (polyline, a[0], a[1]);
+			move_x = cur_x = a[0]; move_y = cur_y = a[1];
+			a += 2;
+			break;
+		case SVG_ANDROID_PATH_OP_LINE_TO:
+			svg_polyline_line_to (polyline, a[0], a[1]);
+			cur_x = a[0]; cur_y = a[1];
+			a += 2;
+			break;
+		case SVG_ANDROID_PATH_OP_CURVE_TO:
+			svg_polyline_curve_to (polyline, cur_x, cur_y,
+					       a[0], a[1], a[2], a[3], a[4], a[5]);
+			cur_x = a[4]; cur_y = a[5];
+			a += 6;
+			break;
+		case SVG_ANDROID_PATH_OP_QUAD_TO:
+			// degree elevation of the quadratic
+			svg_polyline_curve_to (polyline, cur_x, cur_y,
+					       cur_x + 2.0 / 3.0 * (a[0] - cur_x),
+					       cur_y + 2.0 / 3.0 * (a[1] - cur_y),
+					       a[2] + 2.0 / 3.0 * (a[0] - a[2]),
+					       a[3] + 2.0 / 3.0 * (a[1] - a[3]),
+					       a[2], a[3]);
+			cur_x = a[2]; cur_y = a[3];
+			a += 4;
+			break;
+		case SVG_ANDROID_PATH_OP_CLOSE_PATH:
+			svg_polyline_close_path (polyline);
+			cur_x = move_x; cur_y = move_y;
+			break;
+		}
+	}
+}
+
+svg_status_t
+_svg_android_path_buffer_add (svg_android_t *svg_android, svg_android_path_op_t op, int num_args, ...)
+{
+	svg_android_path_buffer_t *buffer = &svg_android->path_buffer;
+	svg_status_t status;
+	va_list va;
+	int i;
+
+	if(buffer->num_ops + 1 > buffer->ops_size ||
+	   buffer->num_args + num_args > buffer->args_size) {
+		status = _svg_android_path_buffer_grow (buffer, num_args);
+		if(status)
+			return status;
+	}
+
+	buffer->ops[buffer->num_ops++] = (jbyte)op;
+
+	va_start (va, num_args);
+	for(i = 0; i < num_args; i += 2) {
+		double x = va_arg (va, double);
+		double y = va_arg (va, double);
+
+		buffer->args[buffer->num_args++] = (jfloat)x;
+		buffer->args[buffer->num_args++] = (jfloat)y;
+
+		if(!buffer->has_extents) {
+			buffer->x1 = buffer->x2 = x;
+			buffer->y1 = buffer->y2 = y;
+			buffer->has_extents = 1;
+		} else {
+			if(x < buffer->x1) buffer->x1 = x;
+			if(y < buffer->y1) buffer->y1 = y;
+			if(x > buffer->x2) buffer->x2 = x;
+			if(y > buffer->y2) buffer->y2 = y;
+		}
+	}
+	va_end (va);
+
+	return SVG_STATUS_SUCCESS;
+}
+
+/* make sure the java side arrays can hold the current buffer content,
+ * they are kept as global references so that they can be reused for the
+ * next path.
+ */
+static svg_status_t
+_svg_android_path_buffer_prepare_arrays (svg_android_t *svg_android)
+{
+	svg_android_path_buffer_t *buffer = &svg_android->path_buffer;
+	JNIEnv *env = svg_android->env;
+
+	if(buffer->ops_array == NULL || buffer->ops_array_size < buffer->num_ops) {
+		jbyteArray arr;
+
+		if(buffer->ops_array)
+			(*env)->DeleteGlobalRef(env, buffer->ops_array);
+		buffer->ops_array = NULL;
+		buffer->ops_array_size = 0;
+
+		arr = (*env)->NewByteArray(env, buffer->ops_size);
+		if(arr == NULL)
+			return SVG_STATUS_NO_MEMORY; /* out of memory error thrown */
+
+		buffer->ops_array = (*env)->NewGlobalRef(env, arr);
+		(*env)->DeleteLocalRef(env, arr);
+		buffer->ops_array_size = buffer->ops_size;
+	}
+
+	if(buffer->args_array == NULL || buffer->args_array_size < buffer->num_args) {
+		jfloatArray arr;
+
+		if(buffer->args_array)
+			(*env)->DeleteGlobalRef(env, buffer->args_array);
+		buffer->args_array = NULL;
+		buffer->args_array_size = 0;
+
+		arr = (*env)->NewFloatArray(env, buffer->args_size);
+		if(arr == NULL)
+			return SVG_STATUS_NO_MEMORY; /* out of memory error thrown */
+
+		buffer->args_array = (*env)->NewGlobalRef(env, arr);
+		(*env)->DeleteLocalRef(env, arr);
+		buffer->args_array_size = buffer->args_size;
+	}
+
+	return SVG_STATUS_SUCCESS;
+}
+
+/* hand all pending path segments over to the current android path */
+svg_status_t
+_svg_android_path_buffer_flush (svg_android_t *svg_android)
+{
+	svg_android_path_buffer_t *buffer = &svg_android->path_buffer;
+	JNIEnv *env = svg_android->env;
+	svg_status_t status;
+
+	if(buffer->num_ops == 0)
+		return SVG_STATUS_SUCCESS;
+
+	status = _svg_android_path_buffer_prepare_arrays (svg_android);
+	if(status) {
+		SVG_ANDROID_ERROR("_svg_android_path_buffer_flush() - failed to allocate java arrays.\n");
+		_svg_android_path_buffer_clear (svg_android);
+		return status;
+	}
+
+	(*env)->SetByteArrayRegion(env, buffer->ops_array, 0, buffer->num_ops, buffer->ops);
+	if(buffer->num_args)
+		(*env)->SetFloatArrayRegion(env, buffer->args_array, 0, buffer->num_args, buffer->args);
+
+	ANDROID_PATH_REPLAY(svg_android, svg_android->state->path,
+			    svg_android->state->fill_rule == SVG_FILL_RULE_EVEN_ODD ? JNI_TRUE : JNI_FALSE,
+			    buffer->ops_array, buffer->num_ops, buffer->args_array);
+
+	SVG_ANDROID_DEBUG("_svg_android_path_buffer_flush() - %d ops, %d args\n",
+			  buffer->num_ops, buffer->num_args);
+
+	_svg_android_path_buffer_clear (svg_android);
+
+	return SVG_STATUS_SUCCESS;
+}
+
+/* The path cache. Entries are owned by us, libsvg only holds on to the
+ * pointer (svg_path_t.cache) and hands it back to us. The number of
+ * global refs we keep is bounded, some devices have a very small global
+ * reference table and abort the process when it overflows.
+ */
+
+void
+_svg_android_path_cache_init (svg_android_t *svg_android)
+{
+	svg_android->path_cache_head = NULL;
+	svg_android->path_cache_tail = NULL;
+	svg_android->path_cache_entries = 0;
+}
+
+static void
+_svg_android_path_cache_unlink (svg_android_t *svg_android, svg_android_path_cache_entry_t *entry)
+{
+	if(entry->prev)
+		entry->prev->next = entry->next;
+	else
+		svg_android->path_cache_head = entry->next;
+
+	if(entry->next)
+		entry->next->prev = entry->prev;
+	else
+		svg_android->path_cache_tail = entry->prev;
+
+	entry->prev = entry->next = NULL;
+}
+
+static void
+_svg_android_path_cache_link_head (svg_android_t *svg_android, svg_android_path_cache_entry_t *entry)
+{
+	entry->prev = NULL;
+	entry->next = svg_android->path_cache_head;
+
+	if(svg_android->path_cache_head)
+		svg_android->path_cache_head->prev = entry;
+	else
+		svg_android->path_cache_tail = entry;
+
+	svg_android->path_cache_head = entry;
+}
+
+static void
+_svg_android_path_cache_free_entry (svg_android_t *svg_android, svg_android_path_cache_entry_t *entry)
+{
+	_svg_android_path_cache_unlink (svg_android, entry);
+	svg_android->path_cache_entries--;
+
+	(*(svg_android->env))->DeleteGlobalRef(svg_android->env, entry->path);
+	free(entry);
+}
+
+/* libsvg is done with the documents at this point, so the owners are
+ * gone and must not be touched. Normally svg_destroy() has released
+ * every entry already through free_path_cache. */
+void
+_svg_android_path_cache_deinit (svg_android_t *svg_android)
+{
+	while(svg_android->path_cache_head)
+		_svg_android_path_cache_free_entry (svg_android, svg_android->path_cache_head);
+}
+
+/* returns the cached android path and marks it as recently used */
+jobject
+_svg_android_path_cache_lookup (svg_android_t *svg_android, void *path_cache)
+{
+	svg_android_path_cache_entry_t *entry = path_cache;
+
+	if(entry == NULL)
+		return NULL;
+
+	if(entry != svg_android->path_cache_head) {
+		_svg_android_path_cache_unlink (svg_android, entry);
+		_svg_android_path_cache_link_head (svg_android, entry);
+	}
+
+	return entry->path;
+}
+
+/* prepare a cached path for drawing with the current state, returns
+ * non-zero if the user space extents are known */
+int
+_svg_android_path_cache_hit (svg_android_t *svg_android, void *path_cache,
+			     double *x1, double *y1, double *x2, double *y2)
+{
+	svg_android_path_cache_entry_t *entry = path_cache;
+
+	// the fill rule is part of the path object, but not of the geometry
+	if(entry->fill_rule != svg_android->state->fill_rule) {
+		ANDROID_SET_FILL_TYPE(svg_android, entry->path,
+				      svg_android->state->fill_rule == SVG_FILL_RULE_EVEN_ODD ? JNI_TRUE : JNI_FALSE);
+		entry->fill_rule = svg_android->state->fill_rule;
+	}
+
+	*x1 = entry->x1; *y1 = entry->y1;
+	*x2 = entry->x2; *y2 = entry->y2;
+
+	return entry->has_extents;
+}
+
+/* the stroke extents of a cached path, or NULL if they were made for
+ * another stroke style than the current one */
+const double *
+_svg_android_path_cache_stroke_extents (svg_android_t *svg_android, void *path_cache)
+{
+	svg_android_path_cache_entry_t *entry = path_cache;
+	svg_stroke_style_t style;
+
+	if(!entry->has_stroke_extents)
+		return NULL;
+
+	_svg_android_stroke_style (svg_android, &style);
+	if(style.width != entry->stroke_style.width ||
+	   style.line_cap != entry->stroke_style.line_cap ||
+	   style.line_join != entry->stroke_style.line_join ||
+	   style.miter_limit != entry->stroke_style.miter_limit)
+		return NULL;
+
+	return entry->stroke_extents;
+}
+
+/* keep a copy of the current path for the element owning path_cache,
+ * the least recently used entries are dropped when over budget */
+svg_status_t
+_svg_android_path_cache_store (svg_android_t *svg_android, void **path_cache,
+			       int has_extents, double x1, double y1, double x2, double y2,
+			       const double *stroke_extents)
+{
+	JNIEnv *env = svg_android->env;
+	svg_android_path_cache_entry_t *entry;
+	jobject cloned_path;
+
+	entry = malloc(sizeof(svg_android_path_cache_entry_t));
+	if(entry == NULL)
+		return SVG_STATUS_NO_MEMORY;
+
+	cloned_path = ANDROID_PATH_CLONE(svg_android, svg_android->state->path);
+	entry->path = (*env)->NewGlobalRef(env, cloned_path);
+	(*env)->DeleteLocalRef(env, cloned_path);
+	if(entry->path == NULL) {
+		free(entry);
+		return SVG_STATUS_NO_MEMORY;
+	}
+
+	entry->owner = path_cache;
+	entry->fill_rule = svg_android->state->fill_rule;
+	entry->has_extents = has_extents;
+	entry->x1 = x1; entry->y1 = y1;
+	entry->x2 = x2; entry->y2 = y2;
+
+	entry->has_stroke_extents = stroke_extents != NULL;
+	if(stroke_extents) {
+		_svg_android_stroke_style (svg_android, &entry->stroke_style);
+		memcpy(entry->stroke_extents, stroke_extents, sizeof(entry->stroke_extents));
+	}
+
+	_svg_android_path_cache_link_head (svg_android, entry);
+	svg_android->path_cache_entries++;
+	*path_cache = entry;
+
+	while(svg_android->path_cache_entries > SVG_ANDROID_PATH_CACHE_MAX_ENTRIES) {
+		svg_android_path_cache_entry_t *victim = svg_android->path_cache_tail;
+
+		SVG_ANDROID_DEBUG("_svg_android_path_cache_store() - evicting %p\n", victim);
+		*(victim->owner) = NULL;
+		_svg_android_path_cache_free_entry (svg_android, victim);
+	}
+
+	return SVG_STATUS_SUCCESS;
+}
+
+void
+_svg_android_path_cache_remove (svg_android_t *svg_android, void **path_cache)
+{
+	if(*path_cache == NULL)
+		return;
+
+	_svg_android_path_cache_free_entry (svg_android, *path_cache);
+	*path_cache = NULL;
+}
@@ -107,11 +107,20 @@ _svg_android_set_viewport_dimension (void *closure,
 		x0 = (double)(svg_android->fit_to_x);
 		y0 = (double)(svg_android->fit_to_y);
 
-		svg_android->fit_to_MATRIX =
-			ANDROID_MATRIX_CREATE(svg_android, xx, 0.0, 0.0, yy, x0, y0);
+		// kept on the instance, so that a render creates no matrix
+		if(svg_android->fit_to_MATRIX == NULL) {
+			jobject m = ANDROID_IDENTITY_MATRIX(svg_android);
+			svg_android->fit_to_MATRIX = (*(svg_android->env))->NewGlobalRef(svg_android->env, m);
+			(*(svg_android->env))->DeleteLocalRef(svg_android->env, m);
+		}
+		ANDROID_MATRIX_INIT(svg_android, svg_android->fit_to_MATRIX, xx, 0.0, 0.0, yy, x0, y0);
 
 		ANDROID_CANVAS_CONCAT_MATRIX(svg_android, svg_android->fit_to_MATRIX);
 
+		{
+			svg_android_ctm_t fit = {xx, 0.0, 0.0, yy, x0, y0};
+			_svg_android_ctm_multiply (&svg_android->state->ctm, &fit);
+		}
 	} else svg_android->fit_to_scale = 1.0;
 
 	DEBUG_EXIT("set_viewpoert_dimension");
@@ -119,47 +128,94 @@ _svg_android_set_viewport_dimension (void *closure,
 }
 
 svg_status_t
-_svg_android_begin_group (void *closure, double opacity)
+_svg_android_begin_group (void *closure, double opacity, const svg_rect_t *extents)
 {
 	svg_android_t *svg_android = closure;
-	jobject offscreen_bitmap = NULL;
+	svg_status_t status;
 
 	DEBUG_ENTRY("begin_group");
 
 	ANDROID_SAVE(svg_android);
 
-	if (opacity != 1.0) {
-		opacity *= 255;
-		jint opacity_i = opacity;
-		opacity_i = ((opacity_i & 0xff) << 24) & 0xffffffff;
-
-		SVG_ANDROID_ERROR("_svg_android_begin_group() --> offscreen: (%d, %d)\n",
-				  (int)svg_android->state->viewport_width,
-				  (int)svg_android->state->viewport_height);
-
-		offscreen_bitmap = ANDROID_CREATE_BITMAP(svg_android,
-							 (int)svg_android->state->viewport_width,
-							 (int)svg_android->state->viewport_height);
-		ANDROID_FILL_BITMAP(svg_android, offscreen_bitmap, opacity_i);
-	}
+	status = _svg_android_push_state (svg_android, NULL, NULL);
+	if (status)
+		return status;
 
-	_svg_android_push_state (svg_android, offscreen_bitmap, NULL);
+	if (opacity != 1.0)
+		_svg_android_layer_begin (svg_android, opacity, extents);
 
 	DEBUG_EXIT("begin_group");
 	return SVG_ANDROID_STATUS_SUCCESS;
 }
 
-/* XXX: begin_element could be made more efficient in that no extra
-   group is needed if there is only one element in a group */
+static svg_android_element_frame_t *
+_svg_android_push_element_frame (svg_android_t *svg_android)
+{
+	if(svg_android->num_element_frames == svg_android->element_frames_size) {
+		int new_size = svg_android->element_frames_size ? 2 * svg_android->element_frames_size : 16;
+		svg_android_element_frame_t *new_frames =
+			realloc(svg_android->element_frames, new_size * sizeof(svg_android_element_frame_t));
+
+		if(new_frames == NULL)
+			return NULL;
+
+		svg_android->element_frames = new_frames;
+		svg_android->element_frames_size = new_size;
+	}
+
+	return &svg_android->element_frames[svg_android->num_element_frames++];
+}
+
+/* An element that neither transforms nor changes any style property
+ * draws with the state of its parent as it is, so we skip the canvas
+ * save and the state push (and the Paint/Matrix/Path JNI traffic that
+ * comes with it). Only the bits an element writes to its state are
+ * swapped out here and put back in end_element.
+ */
 svg_status_t
-_svg_android_begin_element (void *closure, void *path_cache)
+_svg_android_begin_element (void *closure, void *path_cache, unsigned int changes)
 {
 	svg_android_t *svg_android = closure;
+	svg_android_element_frame_t *frame;
+	jobject cached_path = _svg_android_path_cache_lookup (svg_android, path_cache);
 
 	DEBUG_ENTRY("begin_element");
-	ANDROID_SAVE(svg_android);
 
-	_svg_android_push_state (svg_android, NULL, (jobject)path_cache);
+	frame = _svg_android_push_element_frame (svg_android);
+	if(frame == NULL)
+		return SVG_STATUS_NO_MEMORY;
+
+	frame->light = (changes == 0 && svg_android->state != NULL);
+
+	if(frame->light) {
+		svg_android_state_t *state = svg_android->state;
+
+		if(svg_android->identity_matrix == NULL) {
+			jobject matrix = ANDROID_IDENTITY_MATRIX(svg_android);
+			svg_android->identity_matrix = (*(svg_android->env))->NewGlobalRef(svg_android->env, matrix);
+			(*(svg_android->env))->DeleteLocalRef(svg_android->env, matrix);
+		}
+
+		frame->bounding_box = state->bounding_box;
+		frame->path = state->path;
+		frame->matrix = state->matrix;
+
+		state->bounding_box.left = -1;
+		state->bounding_box.top = -1;
+		state->bounding_box.right = 0;
+		state->bounding_box.bottom = 0;
+		if(cached_path)
+			state->path = cached_path;
+		state->matrix = svg_android->identity_matrix;
+
+		// a pushed state has a local frame of its own, give one to this
+		// element as well so that deep documents can't fill up the table
+		(*(svg_android->env))->PushLocalFrame(svg_android->env, 32);
+	} else {
+		ANDROID_SAVE(svg_android);
+
+		_svg_android_push_state (svg_android, NULL, cached_path);
+	}
 
 	DEBUG_EXIT("begin_element");
 	return SVG_ANDROID_STATUS_SUCCESS;
@@ -170,10 +226,31 @@ _svg_android_end_element (void *closure)
 {
 	svg_android_t *svg_android = closure;
 
+	svg_android_element_frame_t *frame;
+
 	DEBUG_ENTRY("end_element");
-	_svg_android_pop_state (svg_android);
+	// drop segments that never made it to a render_path call
+	_svg_android_path_buffer_clear (svg_android);
 
-	ANDROID_RESTORE(svg_android);
+	if(svg_android->num_element_frames == 0)
+		return SVG_STATUS_INVALID_CALL;
+	frame = &svg_android->element_frames[--svg_android->num_element_frames];
+
+	if(frame->light) {
+		svg_android_state_t *state = svg_android->state;
+		svg_bounding_box_t bbox = state->bounding_box;
+
+		state->bounding_box = frame->bounding_box;
+		_svg_android_update_bounding_box(&(state->bounding_box), &bbox);
+		state->path = frame->path;
+		state->matrix = frame->matrix;
+
+		(*(svg_android->env))->PopLocalFrame(svg_android->env, NULL);
+	} else {
+		_svg_android_pop_state (svg_android);
+
+		ANDROID_RESTORE(svg_android);
+	}
 
 	DEBUG_EXIT("end_element");
 	return SVG_ANDROID_STATUS_SUCCESS;
@@ -200,9 +277,8 @@ _svg_android_move_to (void *closure, double x, double y)
 	svg_android_t *svg_android = closure;
 
 	DEBUG_ENTRY("move_to");
-	ANDROID_PATH_MOVE_TO(svg_android, x, y);
-	svg_android->state->last_x = x;
-	svg_android->state->last_y = y;
+	if(_svg_android_path_buffer_add (svg_android, SVG_ANDROID_PATH_OP_MOVE_TO, 2, x, y))
+		return SVG_ANDROID_STATUS_NO_MEMORY;
 	DEBUG_EXIT("move_to");
 
 	return SVG_ANDROID_STATUS_SUCCESS;
@@ -214,9 +290,8 @@ _svg_android_line_to (void *closure, double x, double y)
 	svg_android_t *svg_android = closure;
 
 	DEBUG_ENTRY("line_to");
-	ANDROID_PATH_LINE_TO(svg_android, x, y);
-	svg_android->state->last_x = x;
-	svg_android->state->last_y = y;
+	if(_svg_android_path_buffer_add (svg_android, SVG_ANDROID_PATH_OP_LINE_TO, 2, x, y))
+		return SVG_ANDROID_STATUS_NO_MEMORY;
 	DEBUG_EXIT("line_to");
 
 	return SVG_ANDROID_STATUS_SUCCESS;
@@ -231,9 +306,9 @@ _svg_android_curve_to (void *closure,
 	svg_android_t *svg_android = closure;
 
 	DEBUG_ENTRY("curve_to");
-	ANDROID_PATH_CURVE_TO(svg_android, x1, y1, x2, y2, x3, y3);
-	svg_android->state->last_x = x3;
-	svg_android->state->last_y = y3;
+	if(_svg_android_path_buffer_add (svg_android, SVG_ANDROID_PATH_OP_CURVE_TO, 6,
+					 x1, y1, x2, y2, x3, y3))
+		return SVG_ANDROID_STATUS_NO_MEMORY;
 	DEBUG_EXIT("curve_to");
 
 	return SVG_ANDROID_STATUS_SUCCESS;
@@ -247,9 +322,9 @@ _svg_android_quadratic_curve_to (void *closure,
 	svg_android_t *svg_android = closure;
 
 	DEBUG_ENTRY("quadratic_curve_to");
-	ANDROID_PATH_QUADRATIC_CURVE_TO(svg_android, x1, y1, x2, y2);
-	svg_android->state->last_x = x2;
-	svg_android->state->last_y = y2;
+	if(_svg_android_path_buffer_add (svg_android, SVG_ANDROID_PATH_OP_QUAD_TO, 4,
+					 x1, y1, x2, y2))
+		return SVG_ANDROID_STATUS_NO_MEMORY;
 	DEBUG_EXIT("quadratic_curve_to");
 
 	return SVG_ANDROID_STATUS_SUCCESS;
@@ -261,9 +336,8 @@ _svg_android_close_path (void *closure)
 	svg_android_t *svg_android = closure;
 
 	DEBUG_ENTRY("close_path");
-	ANDROID_PATH_CLOSE(svg_android);
-	svg_android->state->last_x = 0.0; // don't know if this is right, really...
-	svg_android->state->last_y = 0.0;
+	if(_svg_android_path_buffer_add (svg_android, SVG_ANDROID_PATH_OP_CLOSE_PATH, 0))
+		return SVG_ANDROID_STATUS_NO_MEMORY;
 	DEBUG_EXIT("close_path");
 
 	return SVG_ANDROID_STATUS_SUCCESS;
@@ -273,13 +347,7 @@ void
 _svg_android_free_path_cache(void *closure, void **path_cache) {
 	svg_android_t *svg_android = closure;
 
-	(*(svg_android->env))->DeleteGlobalRef(svg_android->env, (jobject)(*path_cache));
-	*path_cache = NULL;
-}
-
-void
-_svg_android_free_image_cache(void *closure, unsigned char *data) {
-	/* no image caching is done currently */
+	_svg_android_path_cache_remove (svg_android, path_cache);
 }
 
 svg_status_t
@@ -324,15 +392,10 @@ _svg_android_set_fill_rule (void *closure, svg_fill_rule_t fill_rule)
 	svg_android_t *svg_android = closure;
 
 	DEBUG_ENTRY("set_fill_rule");
-	switch (fill_rule) {
-	case SVG_FILL_RULE_NONZERO:
-		ANDROID_SET_FILL_TYPE(svg_android, svg_android->state->path, JNI_FALSE);
-		break;
-	case SVG_FILL_RULE_EVEN_ODD:
-		ANDROID_SET_FILL_TYPE(svg_android, svg_android->state->path, JNI_TRUE);
-		break;
-	}
-
+	/* applied to the android path when the path buffer is flushed,
+	 * each state has its own path object so the fill type would
+	 * not be inherited by child elements otherwise.
+	 */
 	svg_android->state->fill_rule = fill_rule;
 
 	DEBUG_EXIT("set_fill_rule");
@@ -343,13 +406,17 @@ svg_status_t
 _svg_android_set_font_family (void *closure, const char *family)
 {
 	svg_android_t *svg_android = closure;
+	const char *interned;
 
 	DEBUG_ENTRY("set_font_family");
-	if (svg_android->state->font_family)
-		free (svg_android->state->font_family);
+	interned = _svg_android_intern_font_family (svg_android, family);
+	if (interned == NULL)
+		return SVG_ANDROID_STATUS_NO_MEMORY;
 
-	svg_android->state->font_family = strdup (family);
-	svg_android->state->font_dirty = 1;
+	if (interned != svg_android->state->font_family) {
+		svg_android->state->font_family = interned;
+		svg_android->state->font_dirty = 1;
+	}
 	DEBUG_EXIT("set_font_family");
 
 	return SVG_ANDROID_STATUS_SUCCESS;
@@ -361,8 +428,10 @@ _svg_android_set_font_size (void *closure, double size)
 	svg_android_t *svg_android = closure;
 
 	DEBUG_ENTRY("set_font_size");
-	svg_android->state->font_size = size;
-	svg_android->state->font_dirty = 1;
+	if (svg_android->state->font_size != size) {
+		svg_android->state->font_size = size;
+		svg_android->state->font_dirty = 1;
+	}
 	DEBUG_EXIT("set_font_size");
 
 	return SVG_ANDROID_STATUS_SUCCESS;
@@ -374,8 +443,10 @@ _svg_android_set_font_style (void *closure, svg_font_style_t font_style)
 	svg_android_t *svg_android = closure;
 
 	DEBUG_ENTRY("set_font_style");
-	svg_android->state->font_style = font_style;
-	svg_android->state->font_dirty = 1;
+	if (svg_android->state->font_style != font_style) {
+		svg_android->state->font_style = font_style;
+		svg_android->state->font_dirty = 1;
+	}
 	DEBUG_EXIT("set_font_style");
 
 	return SVG_ANDROID_STATUS_SUCCESS;
@@ -387,8 +458,10 @@ _svg_android_set_font_weight (void *closure, unsigned int font_weight)
 	svg_android_t *svg_android = closure;
 
 	DEBUG_ENTRY("set_font_weight");
-	svg_android->state->font_weight = font_weight;
-	svg_android->state->font_dirty = 1;
+	if (svg_android->state->font_weight != font_weight) {
+		svg_android->state->font_weight = font_weight;
+		svg_android->state->font_dirty = 1;
+	}
 	DEBUG_EXIT("set_font_weight");
 
 	return SVG_ANDROID_STATUS_SUCCESS;
@@ -400,7 +473,10 @@ _svg_android_set_opacity (void *closure, double opacity)
 	svg_android_t *svg_android = closure;
 
 	DEBUG_ENTRY("set_opacity");
-	svg_android->state->opacity = opacity;
+	// a group draws through a layer composited with this opacity
+	// already, without one it falls back to the paint alpha
+	if (svg_android->state->layer == NULL)
+		svg_android->state->opacity = opacity;
 	DEBUG_EXIT("set_opacity");
 
 	return SVG_ANDROID_STATUS_SUCCESS;
@@ -412,7 +488,7 @@ _svg_android_set_stroke_dash_array (void *closure, double *dash, int num_dashes)
 	svg_android_t *svg_android = closure;
 
 	DEBUG_ENTRY("set_stroke_dash_array");
-	if(svg_android->state->dash != NULL) {
+	if(svg_android->state->dash != NULL && svg_android->state->num_dashes != num_dashes) {
 		free (svg_android->state->dash);
 		svg_android->state->dash = NULL;
 	}
@@ -420,50 +496,18 @@ _svg_android_set_stroke_dash_array (void *closure, double *dash, int num_dashes)
 	svg_android->state->num_dashes = num_dashes;
 
 	if (svg_android->state->num_dashes) {
-		jfloatArray farr;
-
-		svg_android->state->dash = malloc(svg_android->state->num_dashes * sizeof(double));
-		if (svg_android->state->dash == NULL)
-			return SVG_STATUS_NO_MEMORY;
-
-		memcpy(svg_android->state->dash, dash, svg_android->state->num_dashes * sizeof(double));
-
-		// prepare Android float array with dashes, make sure the array is even in length..
-		{
-			int max_k;
-			int k;
-			jfloat *buf;
-
-			max_k = svg_android->state->num_dashes;
-			if(max_k & 0x1) max_k++; // make even
-
-			buf = (jfloat *)malloc(sizeof(jfloat) * max_k);
-			if(buf == NULL)
+		if (svg_android->state->dash == NULL) {
+			svg_android->state->dash = malloc(svg_android->state->num_dashes * sizeof(double));
+			if (svg_android->state->dash == NULL)
 				return SVG_STATUS_NO_MEMORY;
-
-			farr = (*(svg_android->env))->NewFloatArray(svg_android->env, max_k);
-
-			if (farr == NULL) {
-				free(buf);
-				return SVG_ANDROID_STATUS_NO_MEMORY; /* out of memory error thrown */
-			}
-
-			for(k = 0; k < svg_android->state->num_dashes; k++) {
-				buf[k] = svg_android->state->dash[k];
-			}
-			for(; k < max_k; k++) buf[k] = 0.0;
-
-			(*(svg_android->env))->SetFloatArrayRegion(svg_android->env, farr, 0, max_k, buf);
-
-			free(buf);
 		}
 
-		jobject effect = ANDROID_GET_DASHEFFECT(
-			svg_android, farr,
-			svg_android->state->dash_offset);
-		ANDROID_PAINT_SET_EFFECT(svg_android, effect);
+		memcpy(svg_android->state->dash, dash, svg_android->state->num_dashes * sizeof(double));
 	}
 
+	// the effect is created by _svg_android_select_dash() before stroking
+	svg_android->state->dash_dirty = 1;
+
 	DEBUG_EXIT("set_stroke_dash_array");
 	return SVG_ANDROID_STATUS_SUCCESS;
 }
@@ -479,45 +523,7 @@ _svg_android_set_stroke_dash_offset (void *closure, svg_length_t *offset_len)
 	_svg_android_length_to_pixel (svg_android, offset_len, &offset);
 
 	svg_android->state->dash_offset = offset;
-
-	if (svg_android->state->num_dashes) {
-		jfloatArray farr;
-
-		// prepare Android float array with dashes, make sure the array is even in length..
-		{
-			int max_k;
-			int k;
-			jfloat *buf;
-
-			max_k = svg_android->state->num_dashes;
-			if(max_k & 0x1) max_k++; // make even
-
-			buf = (jfloat *)malloc(sizeof(jfloat) * max_k);
-			if(buf == NULL)
-				return SVG_STATUS_NO_MEMORY;
-
-			farr = (*(svg_android->env))->NewFloatArray(svg_android->env, max_k);
-
-			if (farr == NULL) {
-				free(buf);
-				return SVG_ANDROID_STATUS_NO_MEMORY; /* out of memory error thrown */
-			}
-
-			for(k = 0; k < svg_android->state->num_dashes; k++) {
-				buf[k] = svg_android->state->dash[k];
-			}
-			for(; k < max_k; k++) buf[k] = 0.0;
-
-			(*(svg_android->env))->SetFloatArrayRegion(svg_android->env, farr, 0, max_k, buf);
-
-			free(buf);
-		}
-
-		jobject effect = ANDROID_GET_DASHEFFECT(
-			svg_android, farr,
-			svg_android->state->dash_offset);
-		ANDROID_PAINT_SET_EFFECT(svg_android, effect);
-	}
+	svg_android->state->dash_dirty = 1;
 
 	DEBUG_EXIT("set_stroke_dash_offset");
 	return SVG_ANDROID_STATUS_SUCCESS;
@@ -616,13 +622,16 @@ svg_status_t
 _svg_android_set_stroke_width (void *closure, svg_length_t *width_len)
 {
 	svg_android_t *svg_android = closure;
+	svg_android_state_t *state = svg_android->state;
 	double width;
 
 	DEBUG_ENTRY("set_stroke_width");
-	_svg_android_length_to_pixel (svg_android, width_len, &width);
-
-	svg_android->state->width_len.unit = width_len->unit;
-	svg_android->state->width_len.value = width_len->value;
+	if (state->width_len.unit != width_len->unit || state->width_len.value != width_len->value) {
+		state->width_len.unit = width_len->unit;
+		state->width_len.value = width_len->value;
+		state->width_cache.count = 0;
+	}
+	width = _svg_android_stroke_width (svg_android);
 
 	// make sure stroke width is also scaled to fit area...
 	ANDROID_PAINT_SET_STROKE_WIDTH(svg_android, width * svg_android->fit_to_scale);
@@ -668,6 +677,7 @@ _svg_android_apply_clip_box (void *closure,
 				 (float)(x), (float)(y),
 				 (float)(width),
 				 (float)(height));
+	_svg_android_clip_to_extents (svg_android, x, y, width, height);
 
 	DEBUG_EXIT("apply_clip_box");
 
@@ -683,11 +693,13 @@ _svg_android_transform (void *closure,
 	svg_android_t *svg_android = closure;
 
 	jobject new_matrix = svg_android->state->matrix;
+	svg_android_ctm_t ctm = {xx, yx, xy, yy, x0, y0};
 
 	DEBUG_ENTRY("transform");
 	ANDROID_MATRIX_INIT(svg_android, new_matrix, xx, yx, xy, yy, x0, y0);
 
 	ANDROID_CANVAS_CONCAT_MATRIX(svg_android, new_matrix);
+	_svg_android_ctm_multiply (&svg_android->state->ctm, &ctm);
 
 	DEBUG_EXIT("transform");
 
@@ -697,23 +709,22 @@ _svg_android_transform (void *closure,
 svg_status_t
 _svg_android_render_line (void *closure,
 			  svg_length_t *x1_len, svg_length_t *y1_len,
-			  svg_length_t *x2_len, svg_length_t *y2_len)
+			  svg_length_t *x2_len, svg_length_t *y2_len,
+			  svg_length_cache_t *lengths)
 {
 	svg_android_t *svg_android = closure;
 	svg_status_t status;
-	double x1, y1, x2, y2;
+	svg_length_t *len[4] = {x1_len, y1_len, x2_len, y2_len};
+	double v[4];
 
 	DEBUG_ENTRY("render_line");
-	_svg_android_length_to_pixel (svg_android, x1_len, &x1);
-	_svg_android_length_to_pixel (svg_android, y1_len, &y1);
-	_svg_android_length_to_pixel (svg_android, x2_len, &x2);
-	_svg_android_length_to_pixel (svg_android, y2_len, &y2);
+	_svg_android_lengths_to_pixel (svg_android, lengths, len, 4, v);
 
-	status = _svg_android_move_to (svg_android, x1, y1);
+	status = _svg_android_move_to (svg_android, v[0], v[1]);
 	if (status)
 		return status;
 
-	status = _svg_android_line_to (svg_android, x2, y2);
+	status = _svg_android_line_to (svg_android, v[2], v[3]);
 	if (status)
 		return status;
 
@@ -726,13 +737,74 @@ _svg_android_render_line (void *closure,
 
 }
 
-svg_status_t
-_svg_android_render_path (void *closure, void **path_cache)
+/* empty svg_android->stroke_path, its curves are flattened just as
+ * precisely as the current ctm needs */
+static void
+_svg_android_stroke_path_begin (svg_android_t *svg_android)
+{
+	double scale = _svg_android_ctm_scale (&svg_android->state->ctm);
+
+	svg_polyline_clear (&svg_android->stroke_path);
+	svg_android->stroke_path.tolerance = scale > 0.0 ?
+		SVG_ANDROID_STROKE_TOLERANCE / scale : SVG_ANDROID_STROKE_TOLERANCE;
+}
+
+/* user space extents of stroking svg_android->stroke_path with the
+ * current style, NULL if it covers nothing */
+static const double *
+_svg_android_stroke_extents (svg_android_t *svg_android, double *extents)
+{
+	svg_stroke_style_t style;
+
+	_svg_android_stroke_style (svg_android, &style);
+	if(!svg_stroker_extents (&svg_android->stroker, &svg_android->stroke_path, &style,
+				 &extents[0], &extents[1], &extents[2], &extents[3]))
+		return NULL;
+
+	return extents;
+}
+
+/* update the bounding box with the extents of a shape, grown to cover
+ * its stroke - without stroke_extents we can only assume the stroke
+ * reaches as far as its style allows in every direction */
+static void
+_svg_android_bounding_box_from_shape (svg_android_t *svg_android,
+				      double x1, double y1, double x2, double y2,
+				      const double *stroke_extents)
+{
+	svg_stroke_style_t style;
+	double reach;
+
+	if(svg_android->state->stroke_paint.type) {
+		if(stroke_extents) {
+			if(stroke_extents[0] < x1) x1 = stroke_extents[0];
+			if(stroke_extents[1] < y1) y1 = stroke_extents[1];
+			if(stroke_extents[2] > x2) x2 = stroke_extents[2];
+			if(stroke_extents[3] > y2) y2 = stroke_extents[3];
+		} else {
+			_svg_android_stroke_style (svg_android, &style);
+			reach = svg_stroke_reach (&style);
+			x1 -= reach; y1 -= reach;
+			x2 += reach; y2 += reach;
+		}
+	}
+
+	_svg_android_bounding_box_from_extents (svg_android, x1, y1, x2, y2);
+}
+
+/* fill and stroke state->path, the extents are in user space */
+static void
+_svg_android_paint_path (svg_android_t *svg_android,
+			 int has_extents, double x1, double y1, double x2, double y2,
+			 const double *stroke_extents)
 {
-	svg_android_t *svg_android = closure;
 	svg_paint_t *fill_paint, *stroke_paint;
 
-	DEBUG_ENTRY("render_path");
+	// bounding box units of a gradient are resolved against this
+	svg_android->path_has_extents = has_extents;
+	svg_android->path_x1 = x1; svg_android->path_y1 = y1;
+	svg_android->path_x2 = x2; svg_android->path_y2 = y2;
+
 	fill_paint = &svg_android->state->fill_paint;
 	stroke_paint = &svg_android->state->stroke_paint;
 
@@ -760,20 +832,75 @@ _svg_android_render_path (void *closure, void **path_cache)
 		ANDROID_DRAW_PATH(svg_android, svg_android->state->path, svg_android->state->paint);
 	}
 
-	{
-		ANDROID_GET_PATH_BOUNDING_BOX(svg_android, svg_android->state->path);
-		static svg_bounding_box_t bbox;
-		if(svgAndroidGetInternalBoundingBox(&bbox)) {
+	if(has_extents) {
+		_svg_android_bounding_box_from_shape (svg_android, x1, y1, x2, y2, stroke_extents);
+	} else {
+		// outline without known extents, only java knows the geometry
+		svg_bounding_box_t bbox;
+		if(_svg_android_fetch_path_bounding_box(svg_android, svg_android->state->path, &bbox)) {
+			if(stroke_paint->type) {
+				// java leaves the stroke out, grow it in device pixels
+				svg_stroke_style_t style;
+				unsigned int reach;
+
+				_svg_android_stroke_style (svg_android, &style);
+				reach = (unsigned int)ceil(svg_stroke_reach (&style) *
+							   _svg_android_ctm_scale (&svg_android->state->ctm));
+				bbox.left = bbox.left > reach ? bbox.left - reach : 0;
+				bbox.top = bbox.top > reach ? bbox.top - reach : 0;
+				bbox.right += reach;
+				bbox.bottom += reach;
+			}
 			_svg_android_update_last_bounding_box(svg_android, &bbox);
 		}
 
 	}
+}
+
+svg_status_t
+_svg_android_render_path (void *closure, void **path_cache)
+{
+	svg_android_t *svg_android = closure;
+	svg_android_path_buffer_t *buffer = &svg_android->path_buffer;
+	int has_extents, has_stroke = svg_android->state->stroke_paint.type != SVG_PAINT_TYPE_NONE;
+	double x1, y1, x2, y2, stroke_extents[4];
+	const double *stroke = NULL;
+
+	DEBUG_ENTRY("render_path");
+
+	if(path_cache && *path_cache) {
+		// state->path is the cached object, nothing was buffered
+		has_extents = _svg_android_path_cache_hit (svg_android, *path_cache,
+							   &x1, &y1, &x2, &y2);
+		if(has_stroke)
+			stroke = _svg_android_path_cache_stroke_extents (svg_android, *path_cache);
+	} else {
+		// the flush will reset the buffer, so save the extents first
+		has_extents = buffer->has_extents;
+		x1 = buffer->x1; y1 = buffer->y1;
+		x2 = buffer->x2; y2 = buffer->y2;
+
+		// java leaves the stroke out of its bounds, so we stroke it
+		// ourselves - but only when the cache keeps the result, every
+		// other frame makes do with the reach of the stroke style
+		if(has_stroke && has_extents && path_cache) {
+			_svg_android_stroke_path_begin (svg_android);
+			_svg_android_path_buffer_flatten (buffer, &svg_android->stroke_path);
+			stroke = _svg_android_stroke_extents (svg_android, stroke_extents);
+		}
+
+		_svg_android_path_buffer_flush (svg_android);
+	}
+
+	_svg_android_paint_path (svg_android, has_extents, x1, y1, x2, y2, stroke);
 
 	if(path_cache && (*path_cache == NULL)) {
-		jobject cloned_path = ANDROID_PATH_CLONE(svg_android, svg_android->state->path);
-		cloned_path = (*(svg_android->state->instance->env))->NewGlobalRef(
-				svg_android->state->instance->env, cloned_path);
-		*path_cache = (void *)cloned_path;
+		// not fatal, we just go without a cache for this element
+		(void) _svg_android_path_cache_store (svg_android, path_cache,
+						      has_extents, x1, y1, x2, y2, stroke);
+
+		// the path might belong to a parent state (light element)
+		ANDROID_PATH_CLEAR(svg_android, svg_android->state->path);
 	} else if(!path_cache) {
 		ANDROID_PATH_CLEAR(svg_android, svg_android->state->path);
 	}
@@ -787,24 +914,28 @@ _svg_android_render_ellipse (void *closure,
 			     svg_length_t *cx_len,
 			     svg_length_t *cy_len,
 			     svg_length_t *rx_len,
-			     svg_length_t *ry_len)
+			     svg_length_t *ry_len,
+			     svg_length_cache_t *lengths)
 {
 	svg_android_t *svg_android = closure;
 
-	double cx, cy, rx, ry;
+	svg_length_t *len[4] = {cx_len, cy_len, rx_len, ry_len};
+	double v[4], cx, cy, rx, ry;
 
 	DEBUG_ENTRY("render_ellipse");
 
-	_svg_android_length_to_pixel (svg_android, cx_len, &cx);
-	_svg_android_length_to_pixel (svg_android, cy_len, &cy);
-	_svg_android_length_to_pixel (svg_android, rx_len, &rx);
-	_svg_android_length_to_pixel (svg_android, ry_len, &ry);
+	_svg_android_lengths_to_pixel (svg_android, lengths, len, 4, v);
+	cx = v[0]; cy = v[1]; rx = v[2]; ry = v[3];
 
 	svg_paint_t *fill_paint, *stroke_paint;
 
 	fill_paint = &svg_android->state->fill_paint;
 	stroke_paint = &svg_android->state->stroke_paint;
 
+	svg_android->path_has_extents = 1;
+	svg_android->path_x1 = cx - rx; svg_android->path_y1 = cy - ry;
+	svg_android->path_x2 = cx + rx; svg_android->path_y2 = cy + ry;
+
 	if (fill_paint->type) {
 		_svg_android_set_paint_and_opacity (svg_android, fill_paint,
 						    svg_android->state->fill_opacity,
@@ -819,12 +950,9 @@ _svg_android_render_ellipse (void *closure,
 		ANDROID_DRAW_ELLIPSE(svg_android, cx, cy, rx, ry);
 	}
 
-	{
-		static svg_bounding_box_t bbox;
-		if(svgAndroidGetInternalBoundingBox(&bbox)) {
-			_svg_android_update_last_bounding_box(svg_android, &bbox);
-		}
-	}
+	// the bounding box is only hit tested, the reach of the stroke
+	// bounds it well enough without stroking the outline every frame
+	_svg_android_bounding_box_from_shape (svg_android, cx - rx, cy - ry, cx + rx, cy + ry, NULL);
 
 	DEBUG_EXIT("render_ellipse");
 	return SVG_ANDROID_STATUS_SUCCESS;
@@ -837,19 +965,17 @@ _svg_android_render_rect (void *closure,
 			  svg_length_t *width_len,
 			  svg_length_t *height_len,
 			  svg_length_t *rx_len,
-			  svg_length_t *ry_len)
+			  svg_length_t *ry_len,
+			  svg_length_cache_t *lengths)
 {
 	svg_android_t *svg_android = closure;
 
-	double x, y, width, height, rx, ry;
+	svg_length_t *len[6] = {x_len, y_len, width_len, height_len, rx_len, ry_len};
+	double v[6], x, y, width, height, rx, ry;
 
 	DEBUG_ENTRY("render_rect");
-	_svg_android_length_to_pixel (svg_android, x_len, &x);
-	_svg_android_length_to_pixel (svg_android, y_len, &y);
-	_svg_android_length_to_pixel (svg_android, width_len, &width);
-	_svg_android_length_to_pixel (svg_android, height_len, &height);
-	_svg_android_length_to_pixel (svg_android, rx_len, &rx);
-	_svg_android_length_to_pixel (svg_android, ry_len, &ry);
+	_svg_android_lengths_to_pixel (svg_android, lengths, len, 6, v);
+	x = v[0]; y = v[1]; width = v[2]; height = v[3]; rx = v[4]; ry = v[5];
 
 	if (rx > width / 2.0)
 		rx = width / 2.0;
@@ -861,6 +987,10 @@ _svg_android_render_rect (void *closure,
 	fill_paint = &svg_android->state->fill_paint;
 	stroke_paint = &svg_android->state->stroke_paint;
 
+	svg_android->path_has_extents = 1;
+	svg_android->path_x1 = x; svg_android->path_y1 = y;
+	svg_android->path_x2 = x + width; svg_android->path_y2 = y + height;
+
 	if (fill_paint->type) {
 		_svg_android_set_paint_and_opacity (svg_android, fill_paint,
 						    svg_android->state->fill_opacity,
@@ -877,12 +1007,8 @@ _svg_android_render_rect (void *closure,
 		ANDROID_DRAW_RECT(svg_android, x, y, width, height, rx, ry);
 	}
 
-	{
-		static svg_bounding_box_t bbox;
-		if(svgAndroidGetInternalBoundingBox(&bbox)) {
-			_svg_android_update_last_bounding_box(svg_android, &bbox);
-		}
-	}
+	// see render_ellipse
+	_svg_android_bounding_box_from_shape (svg_android, x, y, x + width, y + height, NULL);
 
 	DEBUG_EXIT("render_rect");
 	return SVG_ANDROID_STATUS_SUCCESS;
@@ -927,40 +1053,27 @@ _svg_android_render_text (void *closure,
 			  const char *utf8)
 {
 	svg_android_t *svg_android = closure;
+	svg_android_text_cache_entry_t *outline;
 	double x, y;
-	svg_status_t status;
-	svg_paint_t *fill_paint, *stroke_paint;
+	jobject path;
 
 	DEBUG_ENTRY("render_text");
-	fill_paint = &svg_android->state->fill_paint;
-	stroke_paint = &svg_android->state->stroke_paint;
 
 	_svg_android_select_font (svg_android);
 
 	_svg_android_length_to_pixel (svg_android, x_len, &x);
 	_svg_android_length_to_pixel (svg_android, y_len, &y);
 
-	status = _svg_android_move_to (svg_android, x, y);
-	if (status)
-		return status;
-
-	ANDROID_TEXT_PATH(svg_android, utf8, x, y);
-	_svg_android_close_path (svg_android);
-
-	if (fill_paint->type) {
-		_svg_android_set_paint_and_opacity (svg_android, fill_paint,
-						    svg_android->state->fill_opacity,
-						    SVG_ANDROID_RENDER_TYPE_FILL);
-		_svg_android_render_path (svg_android, NULL);
-
-	}
+	outline = _svg_android_text_cache_get (svg_android, utf8, x, y);
+	if (outline == NULL)
+		return SVG_STATUS_NO_MEMORY;
 
-	if (stroke_paint->type) {
-		_svg_android_set_paint_and_opacity (svg_android, stroke_paint,
-						    svg_android->state->stroke_opacity,
-						    SVG_ANDROID_RENDER_TYPE_STROKE);
-		_svg_android_render_path (svg_android, NULL);
-	}
+	// fill and stroke share the one outline, state->path is left untouched
+	path = svg_android->state->path;
+	svg_android->state->path = outline->path;
+	_svg_android_paint_path (svg_android, outline->has_extents,
+				 outline->x1, outline->y1, outline->x2, outline->y2, NULL);
+	svg_android->state->path = path;
 
 	DEBUG_EXIT("render_text");
 	return SVG_ANDROID_STATUS_SUCCESS;
@@ -974,34 +1087,34 @@ _svg_android_render_image (void		*closure,
 			   svg_length_t	*x_len,
 			   svg_length_t	*y_len,
 			   svg_length_t	*width_len,
-			   svg_length_t	*height_len)
+			   svg_length_t	*height_len,
+			   svg_length_cache_t *lengths)
 {
 	svg_android_t *svg_android = closure;
-	double x, y, width, height;
+	svg_length_t *len[4] = {x_len, y_len, width_len, height_len};
+	double v[4], x, y, width, height;
+	double scale_x, scale_y;
 
-	jintArray iarr;
 	jobject bitmap;
 	jobject matrix;
 
 	DEBUG_ENTRY("render_image");
 	ANDROID_SAVE(svg_android);
 
-	_svg_android_length_to_pixel (svg_android, x_len, &x);
-	_svg_android_length_to_pixel (svg_android, y_len, &y);
-	_svg_android_length_to_pixel (svg_android, width_len, &width);
-	_svg_android_length_to_pixel (svg_android, height_len, &height);
-
-	// copy bitmap into an java int array
-	iarr = (*(svg_android->env))->NewIntArray(svg_android->env, data_width * data_height);
-	(*(svg_android->env))->SetIntArrayRegion(svg_android->env, iarr, 0, data_width * data_height , (jint *)data);
+	_svg_android_lengths_to_pixel (svg_android, lengths, len, 4, v);
+	x = v[0]; y = v[1]; width = v[2]; height = v[3];
 
-	// create bitmap
-	bitmap = ANDROID_DATA_2_BITMAP(svg_android, iarr, data_width, data_height);
+	bitmap = _svg_android_image_cache_get (svg_android, data, data_width, data_height);
+	if(bitmap == NULL) {
+		ANDROID_RESTORE(svg_android);
+		return SVG_ANDROID_STATUS_NO_MEMORY;
+	}
 
-	// prepare matrix
-	matrix = ANDROID_IDENTITY_MATRIX(svg_android);
-	ANDROID_MATRIX_TRANSLATE(svg_android, matrix, x, y);
-	ANDROID_MATRIX_SCALE(svg_android, matrix, width / data_width, height / data_height);
+	// prepare matrix, same as postTranslate(x, y) followed by postScale()
+	scale_x = width / data_width;
+	scale_y = height / data_height;
+	matrix = _svg_android_scratch_matrix (svg_android);
+	ANDROID_MATRIX_INIT(svg_android, matrix, scale_x, 0.0, 0.0, scale_y, scale_x * x, scale_y * y);
 
 	// and draw!
 	ANDROID_DRAW_BITMAP(svg_android, bitmap, matrix);
@@ -1031,6 +1144,11 @@ _svg_android_push_state (svg_android_t     *svg_android,
 		svg_android->state->saved_canvas = svg_android->canvas;
 		svg_android->canvas = new_canvas;
 
+		// offscreen bitmaps are created with the size of the viewport
+		_svg_android_state_reset_canvas (svg_android->state,
+						 (int)svg_android->state->viewport_width,
+						 (int)svg_android->state->viewport_height);
+
 		_svg_android_copy_canvas_state (svg_android);
 	}
 
@@ -1052,6 +1170,8 @@ _svg_android_pop_state (svg_android_t *svg_android)
 		svg_android->state->saved_canvas = NULL;
 	}
 
+	_svg_android_layer_end (svg_android);
+
 	if (svg_android->state && svg_android->state->offscreen_bitmap) {
 		ANDROID_DRAW_BITMAP2(svg_android, svg_android->state->offscreen_bitmap, 0.0f, 0.0f);
 	}
@@ -1148,158 +1268,3 @@ _svg_android_apply_view_box (void *closure,
 	DEBUG_EXIT("apply_view_box");
 	return SVG_STATUS_SUCCESS;
 }
-
-/* The ellipse and arc functions below are:
-
-   Copyright (C) 2000 Eazel, Inc.
-
-   Author: Raph Levien <raph@artofcode.com>
-
-   This is adapted from svg-path in Gill.
-*/
-void
-_svg_path_arc_segment (svg_android_t *svg_android,
-		       double xc, double yc,
-		       double th0, double th1,
-		       double rx, double ry, double x_axis_rotation)
-{
-	double sin_th, cos_th;
-	double a00, a01, a10, a11;
-	double x1, y1, x2, y2, x3, y3;
-	double t;
-	double th_half;
-
-	sin_th = sin (x_axis_rotation * (M_PI / 180.0));
-	cos_th = cos (x_axis_rotation * (M_PI / 180.0));
-	/* inverse transform compared with rsvg_path_arc */
-	a00 = cos_th * rx;
-	a01 = -sin_th * ry;
-	a10 = sin_th * rx;
-	a11 = cos_th * ry;
-
-	th_half = 0.5 * (th1 - th0);
-	t = (8.0 / 3.0) * sin (th_half * 0.5) * sin (th_half * 0.5) / sin (th_half);
-	x1 = xc + cos (th0) - t * sin (th0);
-	y1 = yc + sin (th0) + t * cos (th0);
-	x3 = xc + cos (th1);
-	y3 = yc + sin (th1);
-	x2 = x3 + t * sin (th1);
-	y2 = y3 - t * cos (th1);
-
-	ANDROID_PATH_CURVE_TO(svg_android,
-			      a00 * x1 + a01 * y1, a10 * x1 + a11 * y1,
-			      a00 * x2 + a01 * y2, a10 * x2 + a11 * y2,
-			      a00 * x3 + a01 * y3, a10 * x3 + a11 * y3);
-}
-
-/**
- * _svg_android_path_arc_to: Add an arc to the given path
- *
- * rx: Radius in x direction (before rotation).
- * ry: Radius in y direction (before rotation).
- * x_axis_rotation: Rotation angle for axes.
- * large_arc_flag: 0 for arc length <= 180, 1 for arc >= 180.
- * sweep: 0 for "negative angle", 1 for "positive angle".
- * x: New x coordinate.
- * y: New y coordinate.
- *
- **/
-svg_status_t
-_svg_android_arc_to (void		*closure,
-		     double		rx,
-		     double		ry,
-		     double		x_axis_rotation,
-		     int		large_arc_flag,
-		     int		sweep_flag,
-		     double		x,
-		     double		y)
-{
-	svg_android_t *svg_android = closure;
-	double sin_th, cos_th;
-	double a00, a01, a10, a11;
-	double x0, y0, x1, y1, xc, yc;
-	double d, sfactor, sfactor_sq;
-	double th0, th1, th_arc;
-	int i, n_segs;
-	double dx, dy, dx1, dy1, Pr1, Pr2, Px, Py, check;
-	double curx, cury;
-
-	DEBUG_ENTRY("arc_to");
-
-	rx = fabs (rx);
-	ry = fabs (ry);
-
-	curx = svg_android->state->last_x;
-	cury = svg_android->state->last_y;
-
-	svg_android->state->last_x = x;
-	svg_android->state->last_y = y;
-
-	sin_th = sin (x_axis_rotation * (M_PI / 180.0));
-	cos_th = cos (x_axis_rotation * (M_PI / 180.0));
-
-	dx = (curx - x) / 2.0;
-	dy = (cury - y) / 2.0;
-	dx1 =  cos_th * dx + sin_th * dy;
-	dy1 = -sin_th * dx + cos_th * dy;
-	Pr1 = rx * rx;
-	Pr2 = ry * ry;
-	Px = dx1 * dx1;
-	Py = dy1 * dy1;
-	/* Spec : check if radii are large enough */
-	check = Px / Pr1 + Py / Pr2;
-	if(check > 1)
-	{
-		rx = rx * sqrt(check);
-		ry = ry * sqrt(check);
-	}
-
-	a00 = cos_th / rx;
-	a01 = sin_th / rx;
-	a10 = -sin_th / ry;
-	a11 = cos_th / ry;
-	x0 = a00 * curx + a01 * cury;
-	y0 = a10 * curx + a11 * cury;
-	x1 = a00 * x + a01 * y;
-	y1 = a10 * x + a11 * y;
-	/* (x0, y0) is current point in transformed coordinate space.
-	   (x1, y1) is new point in transformed coordinate space.
-
-	   The arc fits a unit-radius circle in this space.
-	*/
-	d = (x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0);
-	sfactor_sq = 1.0 / d - 0.25;
-	if (sfactor_sq < 0) sfactor_sq = 0;
-	sfactor = sqrt (sfactor_sq);
-	if (sweep_flag == large_arc_flag) sfactor = -sfactor;
-	xc = 0.5 * (x0 + x1) - sfactor * (y1 - y0);
-	yc = 0.5 * (y0 + y1) + sfactor * (x1 - x0);
-	/* (xc, yc) is center of the circle. */
-
-	th0 = atan2 (y0 - yc, x0 - xc);
-	th1 = atan2 (y1 - yc, x1 - xc);
-
-	th_arc = th1 - th0;
-	if (th_arc < 0 && sweep_flag)
-		th_arc += 2 * M_PI;
-	else if (th_arc > 0 && !sweep_flag)
-		th_arc -= 2 * M_PI;
-
-	/* XXX: I still need to evaluate the math performed in this
-	   function. The critical behavior desired is that the arc must be
-	   approximated within an arbitrary error tolerance, (which the
-	   user should be able to specify as well). I don't yet know the
-	   bounds of the error from the following computation of
-	   n_segs. Plus the "+ 0.001" looks just plain fishy. -cworth */
-	n_segs = ceil (fabs (th_arc / (M_PI * 0.5 + 0.001)));
-
-	for (i = 0; i < n_segs; i++) {
-		_svg_path_arc_segment (svg_android, xc, yc,
-				       th0 + i * th_arc / n_segs,
-				       th0 + (i + 1) * th_arc / n_segs,
-				       rx, ry, x_axis_rotation);
-	}
-
-	DEBUG_EXIT("arc_to");
-	return SVG_ANDROID_STATUS_SUCCESS;
-}
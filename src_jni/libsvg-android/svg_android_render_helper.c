@@ -42,34 +42,222 @@
 #define DEBUG_EXIT(s)
 #endif
 
+void
+_svg_android_gradient_cache_init (svg_android_t *svg_android)
+{
+	memset(svg_android->gradient_cache, 0, sizeof(svg_android->gradient_cache));
+	svg_android->gradient_clock = 0;
+}
+
+static void
+_svg_android_gradient_cache_release (svg_android_t *svg_android,
+				     svg_android_gradient_cache_entry_t *entry)
+{
+	if(entry->shader)
+		(*(svg_android->env))->DeleteGlobalRef(svg_android->env, entry->shader);
+	free(entry->offsets);
+	free(entry->colors);
+
+	memset(entry, 0, sizeof(svg_android_gradient_cache_entry_t));
+}
+
+void
+_svg_android_gradient_cache_deinit (svg_android_t *svg_android)
+{
+	int k;
+
+	for(k = 0; k < SVG_ANDROID_GRADIENT_CACHE_SIZE; k++)
+		_svg_android_gradient_cache_release (svg_android, &svg_android->gradient_cache[k]);
+}
+
+/* a matrix for one-off use, shader local matrices and the like */
+jobject
+_svg_android_scratch_matrix (svg_android_t *svg_android)
+{
+	if(svg_android->scratch_matrix == NULL) {
+		jobject m = ANDROID_IDENTITY_MATRIX(svg_android);
+		svg_android->scratch_matrix = (*(svg_android->env))->NewGlobalRef(svg_android->env, m);
+		(*(svg_android->env))->DeleteLocalRef(svg_android->env, m);
+	}
+
+	return svg_android->scratch_matrix;
+}
+
+/* a float[] for values handed back from java, large enough for
+ * getCanvasState() */
+jfloatArray
+_svg_android_scratch_floats (svg_android_t *svg_android)
+{
+	if(svg_android->scratch_floats == NULL) {
+		jfloatArray a = (*(svg_android->env))->NewFloatArray(svg_android->env, 10);
+		svg_android->scratch_floats = (*(svg_android->env))->NewGlobalRef(svg_android->env, a);
+		(*(svg_android->env))->DeleteLocalRef(svg_android->env, a);
+	}
+
+	return svg_android->scratch_floats;
+}
+
+/* find the shader for this gradient, or the slot where it should go */
+static svg_android_gradient_cache_entry_t *
+_svg_android_gradient_cache_lookup (svg_android_t *svg_android,
+				    svg_gradient_t *gradient,
+				    const double *geometry,
+				    const jfloat *offsets,
+				    const jint *colors,
+				    int *hit)
+{
+	svg_android_gradient_cache_entry_t *entry, *victim = NULL;
+	int k;
+
+	*hit = 0;
+
+	for(k = 0; k < SVG_ANDROID_GRADIENT_CACHE_SIZE; k++) {
+		entry = &svg_android->gradient_cache[k];
+
+		if(entry->gradient == gradient) {
+			*hit = entry->type == gradient->type &&
+				entry->spread == gradient->spread &&
+				entry->num_stops == gradient->num_stops &&
+				memcmp(entry->geometry, geometry, sizeof(entry->geometry)) == 0 &&
+				memcmp(entry->offsets, offsets, gradient->num_stops * sizeof(jfloat)) == 0 &&
+				memcmp(entry->colors, colors, gradient->num_stops * sizeof(jint)) == 0;
+			return entry; // a stale entry is rebuilt in place
+		}
+
+		if(victim == NULL || entry->last_used < victim->last_used)
+			victim = entry;
+	}
+
+	return victim;
+}
+
+static svg_status_t
+_svg_android_gradient_cache_fill (svg_android_t *svg_android,
+				  svg_android_gradient_cache_entry_t *entry,
+				  svg_gradient_t *gradient,
+				  const double *geometry,
+				  const jfloat *offsets,
+				  const jint *colors)
+{
+	JNIEnv *env = svg_android->env;
+	jfloatArray offsets_a;
+	jintArray colors_a;
+	jobject shader = NULL;
+	int spreadType;
+
+	_svg_android_gradient_cache_release (svg_android, entry);
+
+	switch (gradient->spread) {
+	case SVG_GRADIENT_SPREAD_REPEAT:
+		spreadType = 0;
+		break;
+	case SVG_GRADIENT_SPREAD_REFLECT:
+		spreadType = 1;
+		break;
+	default:
+		spreadType = 2;
+		break;
+	}
+
+	offsets_a = (*env)->NewFloatArray(env, gradient->num_stops);
+	colors_a = (*env)->NewIntArray(env, gradient->num_stops);
+	if(offsets_a == NULL || colors_a == NULL)
+		return SVG_STATUS_NO_MEMORY;
+
+	(*env)->SetFloatArrayRegion(env, offsets_a, 0, gradient->num_stops, offsets);
+	(*env)->SetIntArrayRegion(env, colors_a, 0, gradient->num_stops, colors);
+
+	switch (gradient->type) {
+	case SVG_GRADIENT_LINEAR:
+		shader = ANDROID_CREATE_LINEAR_GRADIENT(svg_android,
+							geometry[0], geometry[1],
+							geometry[2], geometry[3],
+							colors_a, offsets_a, spreadType);
+		break;
+	case SVG_GRADIENT_RADIAL:
+#if 0 // note here that there is a start and an end circel, android doesn't support that. The end circle in Android always have the same coords as the start circle
+		pattern = cairo_pattern_create_radial (fx, fy, 0.0, cx, cy, r);
+#endif
+		shader = ANDROID_CREATE_RADIAL_GRADIENT(svg_android,
+							geometry[0], geometry[1], geometry[2],
+							colors_a, offsets_a, spreadType);
+		break;
+	}
+
+	(*env)->DeleteLocalRef(env, offsets_a);
+	(*env)->DeleteLocalRef(env, colors_a);
+
+	if((*env)->ExceptionOccurred(env)) {
+		(*env)->ExceptionDescribe(env);
+	}
+	if(shader == NULL)
+		return SVG_STATUS_NO_MEMORY;
+
+	entry->shader = (*env)->NewGlobalRef(env, shader);
+	(*env)->DeleteLocalRef(env, shader);
+
+	entry->offsets = malloc(gradient->num_stops * sizeof(jfloat));
+	entry->colors = malloc(gradient->num_stops * sizeof(jint));
+	if(entry->shader == NULL || entry->offsets == NULL || entry->colors == NULL) {
+		_svg_android_gradient_cache_release (svg_android, entry);
+		return SVG_STATUS_NO_MEMORY;
+	}
+
+	entry->gradient = gradient;
+	entry->type = gradient->type;
+	entry->spread = gradient->spread;
+	memcpy(entry->geometry, geometry, sizeof(entry->geometry));
+	entry->num_stops = gradient->num_stops;
+	memcpy(entry->offsets, offsets, gradient->num_stops * sizeof(jfloat));
+	memcpy(entry->colors, colors, gradient->num_stops * sizeof(jint));
+
+	return SVG_STATUS_SUCCESS;
+}
+
 svg_status_t _svg_android_set_gradient (svg_android_t *svg_android,
 			   svg_gradient_t *gradient,
 			   svg_android_render_type_t type)
 {
 	svg_gradient_stop_t *stop;
-	int i;
-	jobject matrix, gradient_matrix;
-	jobject gradient_shader = NULL;
+	svg_android_gradient_cache_entry_t *entry;
+	svg_android_ctm_t matrix;
+	double geometry[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
+	svg_status_t status;
+	int i, hit;
 
-	matrix = ANDROID_IDENTITY_MATRIX(svg_android);
+	matrix.xx = gradient->transform[0]; matrix.yx = gradient->transform[1];
+	matrix.xy = gradient->transform[2]; matrix.yy = gradient->transform[3];
+	matrix.x0 = gradient->transform[4]; matrix.y0 = gradient->transform[5];
 
 	switch (gradient->units) {
 	case SVG_GRADIENT_UNITS_USER:
 		break;
 	case SVG_GRADIENT_UNITS_BBOX:
 	{
-		jfloatArray farr;
-		jfloat *coords;
-		
-		farr = ANDROID_PATH_GET_BOUNDS(svg_android, svg_android->state->path);
-		
-		coords = (*(svg_android->env))->GetFloatArrayElements((svg_android->env), farr, 0);
+		double x1, y1, x2, y2;
+		svg_android_ctm_t bbox;
+
+		if(svg_android->path_has_extents) {
+			x1 = svg_android->path_x1; y1 = svg_android->path_y1;
+			x2 = svg_android->path_x2; y2 = svg_android->path_y2;
+		} else {
+			// text outline, only java knows the geometry
+			jfloatArray farr = _svg_android_scratch_floats (svg_android);
+			jfloat coords[4];
+
+			ANDROID_PATH_GET_BOUNDS(svg_android, svg_android->state->path, farr);
+			(*(svg_android->env))->GetFloatArrayRegion(svg_android->env, farr, 0, 4, coords);
+			x1 = coords[0]; y1 = coords[1];
+			x2 = coords[2]; y2 = coords[3];
+		}
 
 		// Maybe we need to add the stroke width to be correct here? (if type == SVG_ANDROID_RENDER_TYPE_STROKE)
-		ANDROID_MATRIX_TRANSLATE(svg_android, matrix, coords[0], coords[1]);
-		ANDROID_MATRIX_SCALE(svg_android, matrix, coords[2] - coords[0], coords[3] - coords[1]);
-		(*(svg_android->env))->ReleaseFloatArrayElements(svg_android->env, farr, coords, 0);		
-		
+		// same as Matrix.postTranslate(x1, y1) followed by postScale(w, h)
+		bbox.xx = x2 - x1; bbox.yx = 0.0;
+		bbox.xy = 0.0; bbox.yy = y2 - y1;
+		bbox.x0 = (x2 - x1) * x1; bbox.y0 = (y2 - y1) * y1;
+		_svg_android_ctm_multiply (&matrix, &bbox);
+
 #if 0 // note here how the cairo version checks for fill or stroke, the extents might be different.. but for android I use the bounds of the path, this doesn't account for stroke painting outside..
 		double x1, y1, x2, y2;
 
@@ -86,7 +274,23 @@ svg_status_t _svg_android_set_gradient (svg_android_t *svg_android,
 	} break;
 	}
 
-	// create java float array for the stops offsets, and int array for the colors
+	switch (gradient->type) {
+	case SVG_GRADIENT_LINEAR:
+		_svg_android_length_to_pixel (svg_android, &gradient->u.linear.x1, &geometry[0]);
+		_svg_android_length_to_pixel (svg_android, &gradient->u.linear.y1, &geometry[1]);
+		_svg_android_length_to_pixel (svg_android, &gradient->u.linear.x2, &geometry[2]);
+		_svg_android_length_to_pixel (svg_android, &gradient->u.linear.y2, &geometry[3]);
+		break;
+	case SVG_GRADIENT_RADIAL:
+		_svg_android_length_to_pixel (svg_android, &gradient->u.radial.fx, &geometry[0]);
+		_svg_android_length_to_pixel (svg_android, &gradient->u.radial.fy, &geometry[1]);
+		_svg_android_length_to_pixel (svg_android, &gradient->u.radial.r, &geometry[2]);
+		break;
+	}
+
+	svg_android->state->bbox = 0;
+
+	// stop offsets and colors as java wants them
 	jfloat offsets[gradient->num_stops];
 	jint colors[gradient->num_stops];
 	for (i = 0; i < gradient->num_stops; i++) {
@@ -101,84 +305,30 @@ svg_status_t _svg_android_set_gradient (svg_android_t *svg_android,
 			(o & 0xff) << 24 |
 			(r & 0xff) << 16 |
 			(g & 0xff) << 8 |
-			(b & 0xff);		
+			(b & 0xff);
 	}
-	jfloatArray offsets_a;
-	jintArray colors_a;
-	offsets_a = (*(svg_android->env))->NewFloatArray(svg_android->env, gradient->num_stops);
-	colors_a = (*(svg_android->env))->NewIntArray(svg_android->env, gradient->num_stops);
-
-	(*(svg_android->env))->SetFloatArrayRegion(svg_android->env, offsets_a, 0, gradient->num_stops, offsets);
-	(*(svg_android->env))->SetIntArrayRegion(svg_android->env, colors_a, 0, gradient->num_stops, colors);
 
-	int spreadType = 2;
-	
-	switch (gradient->spread) {
-	case SVG_GRADIENT_SPREAD_REPEAT:
-		spreadType = 0;
-		break;
-	case SVG_GRADIENT_SPREAD_REFLECT:
-		spreadType = 1;
-		break;
-	default:
-		spreadType = 2;
-		break;
+	entry = _svg_android_gradient_cache_lookup (svg_android, gradient, geometry, offsets, colors, &hit);
+	if(!hit) {
+		status = _svg_android_gradient_cache_fill (svg_android, entry, gradient, geometry, offsets, colors);
+		if(status)
+			return status;
 	}
-	    
-	switch (gradient->type) {
-	case SVG_GRADIENT_LINEAR:
-	{
-		double x1, y1, x2, y2;
+	entry->last_used = ++svg_android->gradient_clock;
 
-		_svg_android_length_to_pixel (svg_android, &gradient->u.linear.x1, &x1);
-		_svg_android_length_to_pixel (svg_android, &gradient->u.linear.y1, &y1);
-		_svg_android_length_to_pixel (svg_android, &gradient->u.linear.x2, &x2);
-		_svg_android_length_to_pixel (svg_android, &gradient->u.linear.y2, &y2);
+	// only the local matrix depends on the element we paint
+	ANDROID_MATRIX_INIT(svg_android, _svg_android_scratch_matrix (svg_android),
+			    matrix.xx, matrix.yx, matrix.xy, matrix.yy, matrix.x0, matrix.y0);
 
-		if((*(svg_android->env))->ExceptionOccurred(svg_android->env)) {
-			(*(svg_android->env))->ExceptionDescribe(svg_android->env);
-		}
-		gradient_shader = ANDROID_CREATE_LINEAR_GRADIENT(svg_android, x1, y1, x2, y2, colors_a, offsets_a, spreadType);
-		if((*(svg_android->env))->ExceptionOccurred(svg_android->env)) {
-			(*(svg_android->env))->ExceptionDescribe(svg_android->env);
-		}
-	}
-	break;
-	case SVG_GRADIENT_RADIAL:
-	{
-		double cx, cy, r, fx, fy;
-      
-		_svg_android_length_to_pixel (svg_android, &gradient->u.radial.cx, &cx);
-		_svg_android_length_to_pixel (svg_android, &gradient->u.radial.cy, &cy);
-		_svg_android_length_to_pixel (svg_android, &gradient->u.radial.r, &r);
-		_svg_android_length_to_pixel (svg_android, &gradient->u.radial.fx, &fx);
-		_svg_android_length_to_pixel (svg_android, &gradient->u.radial.fy, &fy);
-
-		gradient_shader = ANDROID_CREATE_RADIAL_GRADIENT(svg_android, fx, fy, r, colors_a, offsets_a, spreadType);
-#if 0 // note here that there is a start and an end circel, android doesn't support that. The end circle in Android always have the same coords as the start circle
-		pattern = cairo_pattern_create_radial (fx, fy, 0.0, cx, cy, r);
-#endif
-	} break;
-	}    
+	if(svg_android->state->matrix != svg_android->identity_matrix)
+		ANDROID_MATRIX_MULTIPLY(svg_android, svg_android->scratch_matrix, svg_android->state->matrix);
 
-	gradient_matrix = ANDROID_MATRIX_CREATE(svg_android,
-						gradient->transform[0], gradient->transform[1],
-						gradient->transform[2], gradient->transform[3],
-						gradient->transform[4], gradient->transform[5]);
-	ANDROID_MATRIX_MULTIPLY(svg_android, matrix, gradient_matrix);
-
-	ANDROID_MATRIX_MULTIPLY(svg_android, matrix, svg_android->state->matrix);
-	
 	if(svg_android->fit_to_area)
-		ANDROID_MATRIX_MULTIPLY(svg_android, matrix, svg_android->fit_to_MATRIX);
+		ANDROID_MATRIX_MULTIPLY(svg_android, svg_android->scratch_matrix, svg_android->fit_to_MATRIX);
+
+	ANDROID_SHADER_SET_MATRIX(svg_android, entry->shader, svg_android->scratch_matrix);
+	ANDROID_PAINT_SET_SHADER(svg_android, entry->shader);
 
-	if(gradient_shader) {
-		ANDROID_SHADER_SET_MATRIX(svg_android, gradient_shader, matrix);
-		ANDROID_PAINT_SET_SHADER(svg_android, gradient_shader);
-	}
-	
-	svg_android->state->bbox = 0;
-    
 	return SVG_STATUS_SUCCESS;
 }
 
@@ -221,37 +371,127 @@ svg_status_t _svg_android_set_paint_and_opacity (svg_android_t *svg_android, svg
 		status = _svg_android_set_gradient (svg_android, paint->p.gradient, type);
 		if (status)
 			return status;
+		// the paint may have been used by a sibling, don't inherit its alpha
+		ANDROID_PAINT_SET_COLOR(svg_android, (int)(opacity * 255.0), 0, 0, 0);
 		break;
 	case SVG_PAINT_TYPE_PATTERN:
 		status = _svg_android_set_pattern (svg_android, paint->p.pattern_element, type);
 		if (status)
 			return status;
+		ANDROID_PAINT_SET_COLOR(svg_android, (int)(opacity * 255.0), 0, 0, 0);
 		break;
 	}
 
 	if(type == SVG_ANDROID_RENDER_TYPE_FILL) {
 		ANDROID_SET_PAINT_STYLE(svg_android, svg_android->state->paint, JNI_FALSE);
 	} else {
+		// dashes only apply to strokes, so they are resolved here
+		status = _svg_android_select_dash (svg_android);
+		if (status)
+			return status;
 		ANDROID_SET_PAINT_STYLE(svg_android, svg_android->state->paint, JNI_TRUE);
 	}
 	
 	return SVG_STATUS_SUCCESS;
 }
 
-svg_status_t _svg_android_set_pattern (svg_android_t *svg_android,
-				       svg_element_t *pattern_element,
-				       svg_android_render_type_t type)
+void
+_svg_android_pattern_cache_init (svg_android_t *svg_android)
 {
-	svg_pattern_t *pattern = svg_element_pattern (pattern_element);
-	jobject pattern_bitmap;
-	jobject pattern_shader;
-	double x_px, y_px, width_px, height_px;
-	jobject path;
+	memset(svg_android->pattern_cache, 0, sizeof(svg_android->pattern_cache));
+	svg_android->pattern_clock = 0;
+	svg_android->pattern_cache_bytes = 0;
+}
 
-	_svg_android_length_to_pixel (svg_android, &pattern->x, &x_px);
-	_svg_android_length_to_pixel (svg_android, &pattern->y, &y_px);
-	_svg_android_length_to_pixel (svg_android, &pattern->width, &width_px);
-	_svg_android_length_to_pixel (svg_android, &pattern->height, &height_px);
+static void
+_svg_android_pattern_cache_release (svg_android_t *svg_android,
+				    svg_android_pattern_cache_entry_t *entry)
+{
+	if(entry->shader)
+		(*(svg_android->env))->DeleteGlobalRef(svg_android->env, entry->shader);
+	if(entry->bitmap)
+		(*(svg_android->env))->DeleteGlobalRef(svg_android->env, entry->bitmap);
+	svg_android->pattern_cache_bytes -= entry->bytes;
+
+	memset(entry, 0, sizeof(svg_android_pattern_cache_entry_t));
+}
+
+void
+_svg_android_pattern_cache_deinit (svg_android_t *svg_android)
+{
+	int k;
+
+	for(k = 0; k < SVG_ANDROID_PATTERN_CACHE_SIZE; k++)
+		_svg_android_pattern_cache_release (svg_android, &svg_android->pattern_cache[k]);
+}
+
+static svg_android_pattern_cache_entry_t *
+_svg_android_pattern_cache_lookup (svg_android_t *svg_android,
+				   const svg_android_pattern_cache_entry_t *key)
+{
+	svg_android_pattern_cache_entry_t *entry;
+	int k;
+
+	for(k = 0; k < SVG_ANDROID_PATTERN_CACHE_SIZE; k++) {
+		entry = &svg_android->pattern_cache[k];
+
+		if(entry->shader != NULL &&
+		   entry->pattern_element == key->pattern_element &&
+		   entry->generation == key->generation &&
+		   entry->units == key->units &&
+		   entry->content_units == key->content_units &&
+		   entry->width == key->width &&
+		   entry->height == key->height &&
+		   entry->tile_width == key->tile_width &&
+		   entry->tile_height == key->tile_height)
+			return entry;
+	}
+
+	return NULL;
+}
+
+/* make room for a tile of the given size, returns the slot to use */
+static svg_android_pattern_cache_entry_t *
+_svg_android_pattern_cache_make_room (svg_android_t *svg_android, size_t bytes)
+{
+	svg_android_pattern_cache_entry_t *entry, *victim;
+	int k;
+
+	do {
+		victim = NULL;
+		for(k = 0; k < SVG_ANDROID_PATTERN_CACHE_SIZE; k++) {
+			entry = &svg_android->pattern_cache[k];
+
+			if(entry->shader == NULL) {
+				if(svg_android->pattern_cache_bytes + bytes <= SVG_ANDROID_PATTERN_CACHE_BYTES)
+					return entry;
+				continue;
+			}
+
+			if(victim == NULL || entry->last_used < victim->last_used)
+				victim = entry;
+		}
+
+		if(victim == NULL)
+			return NULL;
+
+		DEBUG_ANDROID("evicting pattern tile");
+		_svg_android_pattern_cache_release (svg_android, victim);
+	} while(1);
+}
+
+/* render the pattern content into a new bitmap, scaled from pattern
+ * space to the device resolution of the tile */
+static jobject
+_svg_android_pattern_render_tile (svg_android_t *svg_android,
+				  svg_pattern_t *pattern,
+				  int tile_width, int tile_height,
+				  double scale_x, double scale_y)
+{
+	svg_android_ctm_t scale = {scale_x, 0.0, 0.0, scale_y, 0.0, 0.0};
+	jobject tile_bitmap;
+	jobject scale_matrix;
+	jobject path;
 
 	/* OK. We've got the final path to be filled/stroked inside the
 	 * android context right now. But we're also going to re-use that
@@ -267,35 +507,212 @@ svg_status_t _svg_android_set_pattern (svg_android_t *svg_android,
 	svg_android->state->path = ANDROID_PATH_CREATE(svg_android);
 	ANDROID_SAVE(svg_android);
 
-	pattern_bitmap = ANDROID_CREATE_BITMAP(svg_android,
-					       (int) (width_px + 0.5),
-					       (int) (height_px + 0.5));
-	
-	_svg_android_push_state (svg_android, pattern_bitmap, NULL);
+	tile_bitmap = ANDROID_CREATE_BITMAP(svg_android, tile_width, tile_height);
+
+	_svg_android_push_state (svg_android, tile_bitmap, NULL);
+	_svg_android_state_reset_canvas (svg_android->state, tile_width, tile_height);
+
+	scale_matrix = ANDROID_MATRIX_CREATE(svg_android, scale_x, 0.0, 0.0, scale_y, 0.0, 0.0);
+	ANDROID_CANVAS_CONCAT_MATRIX(svg_android, scale_matrix);
+	_svg_android_ctm_multiply (&svg_android->state->ctm, &scale);
 
-	svg_android->state->matrix = ANDROID_IDENTITY_MATRIX(svg_android);
-    
 	svg_android->state->fill_paint.type = SVG_PAINT_TYPE_NONE;
 	svg_android->state->stroke_paint.type = SVG_PAINT_TYPE_NONE;
-    
+
 	svg_element_render (pattern->group_element, &SVG_ANDROID_RENDER_ENGINE, svg_android);
+
+	// the tile is only used through the shader, pop_state must not draw it
+	svg_android->state->offscreen_bitmap = NULL;
 	_svg_android_pop_state (svg_android);
 
 	ANDROID_RESTORE(svg_android);
 
-	svg_android->state->path = path ;
+	svg_android->state->path = path;
+
+	return tile_bitmap;
+}
+
+svg_status_t _svg_android_set_pattern (svg_android_t *svg_android,
+				       svg_element_t *pattern_element,
+				       svg_android_render_type_t type)
+{
+	svg_pattern_t *pattern = svg_element_pattern (pattern_element);
+	svg_android_pattern_cache_entry_t key, *entry;
+	svg_android_ctm_t *ctm = &svg_android->state->ctm;
+	jobject pattern_bitmap;
+	jobject pattern_shader;
+	double x_px, y_px, width_px, height_px;
+	double tile_w, tile_h;
+
+	_svg_android_length_to_pixel (svg_android, &pattern->x, &x_px);
+	_svg_android_length_to_pixel (svg_android, &pattern->y, &y_px);
+	_svg_android_length_to_pixel (svg_android, &pattern->width, &width_px);
+	_svg_android_length_to_pixel (svg_android, &pattern->height, &height_px);
+
+	if(width_px <= 0.0 || height_px <= 0.0) {
+		// an empty tile disables the paint
+		ANDROID_PAINT_SET_SHADER(svg_android, NULL);
+		return SVG_STATUS_SUCCESS;
+	}
+
+	// the size of the tile on the device, so that zooming in stays sharp
+	tile_w = ceil(width_px * sqrt(ctm->xx * ctm->xx + ctm->yx * ctm->yx));
+	tile_h = ceil(height_px * sqrt(ctm->xy * ctm->xy + ctm->yy * ctm->yy));
+	if(tile_w < 1.0) tile_w = 1.0;
+	if(tile_h < 1.0) tile_h = 1.0;
+	if(tile_w > SVG_ANDROID_PATTERN_MAX_TILE) tile_w = SVG_ANDROID_PATTERN_MAX_TILE;
+	if(tile_h > SVG_ANDROID_PATTERN_MAX_TILE) tile_h = SVG_ANDROID_PATTERN_MAX_TILE;
+
+	memset(&key, 0, sizeof(key));
+	key.pattern_element = pattern_element;
+	key.generation = svg_content_generation (svg_android->svg);
+	key.units = pattern->units;
+	key.content_units = pattern->content_units;
+	key.width = width_px;
+	key.height = height_px;
+	key.tile_width = (int)tile_w;
+	key.tile_height = (int)tile_h;
+	key.bytes = (size_t)key.tile_width * (size_t)key.tile_height * 4;
 
-	pattern_shader = ANDROID_CREATE_BITMAP_SHADER(svg_android, pattern_bitmap);
+	entry = _svg_android_pattern_cache_lookup (svg_android, &key);
+	if(entry) {
+		pattern_shader = entry->shader;
+	} else {
+		pattern_bitmap = _svg_android_pattern_render_tile (svg_android, pattern,
+								   key.tile_width, key.tile_height,
+								   tile_w / width_px, tile_h / height_px);
+		pattern_shader = ANDROID_CREATE_BITMAP_SHADER(svg_android, pattern_bitmap);
+
+		// a tile larger than the whole budget is used once and dropped
+		if(key.bytes <= SVG_ANDROID_PATTERN_CACHE_BYTES &&
+		   (entry = _svg_android_pattern_cache_make_room (svg_android, key.bytes)) != NULL) {
+			*entry = key;
+			entry->bitmap = (*(svg_android->env))->NewGlobalRef(svg_android->env, pattern_bitmap);
+			entry->shader = (*(svg_android->env))->NewGlobalRef(svg_android->env, pattern_shader);
+			svg_android->pattern_cache_bytes += entry->bytes;
+		}
+	}
+	if(entry)
+		entry->last_used = ++svg_android->pattern_clock;
+
+	// map the device sized tile back to pattern space
+	ANDROID_MATRIX_INIT(svg_android, _svg_android_scratch_matrix (svg_android),
+			    width_px / tile_w, 0.0, 0.0, height_px / tile_h, 0.0, 0.0);
+	ANDROID_SHADER_SET_MATRIX(svg_android, pattern_shader, svg_android->scratch_matrix);
 	ANDROID_PAINT_SET_SHADER(svg_android, pattern_shader);
-	
+
 	return SVG_STATUS_SUCCESS;
 }
 
+void
+_svg_android_font_cache_init (svg_android_t *svg_android)
+{
+	svg_android->font_families = NULL;
+	svg_android->num_font_families = 0;
+	svg_android->font_families_size = 0;
+
+	memset(svg_android->typeface_cache, 0, sizeof(svg_android->typeface_cache));
+	svg_android->typeface_clock = 0;
+}
+
+void
+_svg_android_font_cache_deinit (svg_android_t *svg_android)
+{
+	int k;
+
+	for(k = 0; k < SVG_ANDROID_TYPEFACE_CACHE_SIZE; k++) {
+		if(svg_android->typeface_cache[k].typeface)
+			(*(svg_android->env))->DeleteGlobalRef(svg_android->env,
+							       svg_android->typeface_cache[k].typeface);
+	}
+	memset(svg_android->typeface_cache, 0, sizeof(svg_android->typeface_cache));
+
+	for(k = 0; k < svg_android->num_font_families; k++)
+		free(svg_android->font_families[k]);
+	free(svg_android->font_families);
+
+	svg_android->font_families = NULL;
+	svg_android->num_font_families = 0;
+	svg_android->font_families_size = 0;
+}
+
+/* returns the one copy of family we keep, a document only uses a handful */
+const char *
+_svg_android_intern_font_family (svg_android_t *svg_android, const char *family)
+{
+	char *copy;
+	int k;
+
+	for(k = 0; k < svg_android->num_font_families; k++)
+		if(strcmp(svg_android->font_families[k], family) == 0)
+			return svg_android->font_families[k];
+
+	if(svg_android->num_font_families == svg_android->font_families_size) {
+		int new_size = svg_android->font_families_size ? 2 * svg_android->font_families_size : 8;
+		char **new_families = realloc(svg_android->font_families, new_size * sizeof(char *));
+
+		if(new_families == NULL)
+			return NULL;
+
+		svg_android->font_families = new_families;
+		svg_android->font_families_size = new_size;
+	}
+
+	copy = strdup(family);
+	if(copy == NULL)
+		return NULL;
+
+	svg_android->font_families[svg_android->num_font_families++] = copy;
+
+	return copy;
+}
+
+static jobject
+_svg_android_get_typeface (svg_android_t *svg_android, const char *family, int weight_n_slant)
+{
+	JNIEnv *env = svg_android->env;
+	svg_android_typeface_cache_entry_t *entry, *victim = NULL;
+	jstring family_string;
+	jobject typeface;
+	int k;
+
+	for(k = 0; k < SVG_ANDROID_TYPEFACE_CACHE_SIZE; k++) {
+		entry = &svg_android->typeface_cache[k];
+
+		if(entry->typeface && entry->family == family && entry->weight_n_slant == weight_n_slant) {
+			entry->last_used = ++svg_android->typeface_clock;
+			return entry->typeface;
+		}
+
+		if(victim == NULL ||
+		   (victim->typeface && (entry->typeface == NULL || entry->last_used < victim->last_used)))
+			victim = entry;
+	}
+
+	family_string = (*env)->NewStringUTF(env, family);
+	typeface = ANDROID_CREATE_TYPEFACE(svg_android, family_string, weight_n_slant);
+	(*env)->DeleteLocalRef(env, family_string);
+	if(typeface == NULL)
+		return NULL;
+
+	if(victim->typeface)
+		(*env)->DeleteGlobalRef(env, victim->typeface);
+
+	victim->family = family;
+	victim->weight_n_slant = weight_n_slant;
+	victim->typeface = (*env)->NewGlobalRef(env, typeface);
+	victim->last_used = ++svg_android->typeface_clock;
+	(*env)->DeleteLocalRef(env, typeface);
+
+	return victim->typeface;
+}
+
 svg_status_t _svg_android_select_font (svg_android_t *svg_android)
 {
-	char *family = svg_android->state->font_family;
+	const char *family = svg_android->state->font_family;
 	unsigned int font_weight = svg_android->state->font_weight;
 	svg_font_style_t font_style = svg_android->state->font_style;
+	jobject typeface;
 
 	int text_align = 0;
 	int weight_n_slant = 0x0;
@@ -332,13 +749,144 @@ svg_status_t _svg_android_select_font (svg_android_t *svg_android)
 		break;
 	}
 
-	ANDROID_SET_TYPEFACE(svg_android, family, weight_n_slant, svg_android->state->font_size, text_align);
-	
+	typeface = _svg_android_get_typeface (svg_android, family, weight_n_slant);
+	ANDROID_SET_TYPEFACE(svg_android, typeface, svg_android->state->font_size, text_align);
+
 	svg_android->state->font_dirty = 0;
 
 	return SVG_ANDROID_STATUS_SUCCESS;
 }
 
+void
+_svg_android_dash_cache_init (svg_android_t *svg_android)
+{
+	memset(svg_android->dash_cache, 0, sizeof(svg_android->dash_cache));
+	svg_android->dash_clock = 0;
+}
+
+void
+_svg_android_dash_cache_deinit (svg_android_t *svg_android)
+{
+	int k;
+
+	for(k = 0; k < SVG_ANDROID_DASH_CACHE_SIZE; k++) {
+		if(svg_android->dash_cache[k].effect)
+			(*(svg_android->env))->DeleteGlobalRef(svg_android->env,
+							       svg_android->dash_cache[k].effect);
+		free(svg_android->dash_cache[k].dash);
+	}
+	memset(svg_android->dash_cache, 0, sizeof(svg_android->dash_cache));
+}
+
+static int
+_svg_android_dash_cache_match (svg_android_dash_cache_entry_t *entry,
+			       double *dash, int num_dashes, int max_k, jfloat offset)
+{
+	int k;
+
+	if(entry->effect == NULL || entry->num_dashes != max_k || entry->offset != offset)
+		return 0;
+
+	for(k = 0; k < max_k; k++)
+		if(entry->dash[k] != (k < num_dashes ? (jfloat)dash[k] : 0.0f))
+			return 0;
+
+	return 1;
+}
+
+/* returns the DashPathEffect for the dash array and offset of the
+ * current state, the ref stays owned by the cache */
+static jobject
+_svg_android_get_dash_effect (svg_android_t *svg_android)
+{
+	JNIEnv *env = svg_android->env;
+	svg_android_state_t *state = svg_android->state;
+	svg_android_dash_cache_entry_t *entry, *victim = NULL;
+	jfloat offset = state->dash_offset;
+	jfloatArray farr;
+	jfloat *buf;
+	jobject effect;
+	int max_k;
+	int k;
+
+	// make sure the array is even in length..
+	max_k = state->num_dashes;
+	if(max_k & 0x1) max_k++;
+
+	for(k = 0; k < SVG_ANDROID_DASH_CACHE_SIZE; k++) {
+		entry = &svg_android->dash_cache[k];
+
+		if(_svg_android_dash_cache_match (entry, state->dash, state->num_dashes, max_k, offset)) {
+			entry->last_used = ++svg_android->dash_clock;
+			return entry->effect;
+		}
+
+		if(victim == NULL ||
+		   (victim->effect && (entry->effect == NULL || entry->last_used < victim->last_used)))
+			victim = entry;
+	}
+
+	buf = (jfloat *)malloc(sizeof(jfloat) * max_k);
+	if(buf == NULL)
+		return NULL;
+
+	for(k = 0; k < state->num_dashes; k++) {
+		buf[k] = state->dash[k];
+	}
+	for(; k < max_k; k++) buf[k] = 0.0;
+
+	farr = (*env)->NewFloatArray(env, max_k);
+	if (farr == NULL) {
+		free(buf);
+		return NULL; /* out of memory error thrown */
+	}
+	(*env)->SetFloatArrayRegion(env, farr, 0, max_k, buf);
+
+	effect = ANDROID_GET_DASHEFFECT(svg_android, farr, offset);
+	(*env)->DeleteLocalRef(env, farr);
+	if(effect == NULL) {
+		free(buf);
+		return NULL;
+	}
+
+	if(victim->effect)
+		(*env)->DeleteGlobalRef(env, victim->effect);
+	free(victim->dash);
+
+	victim->dash = buf;
+	victim->num_dashes = max_k;
+	victim->offset = offset;
+	victim->effect = (*env)->NewGlobalRef(env, effect);
+	victim->last_used = ++svg_android->dash_clock;
+	(*env)->DeleteLocalRef(env, effect);
+
+	return victim->effect;
+}
+
+/* apply a changed dash array and/or offset to the paint, done once per
+ * change no matter how many of the two were set */
+svg_status_t _svg_android_select_dash (svg_android_t *svg_android)
+{
+	jobject effect = NULL;
+
+	if (! svg_android->state->dash_dirty)
+		return SVG_STATUS_SUCCESS;
+
+	if (svg_android->state->num_dashes) {
+		effect = _svg_android_get_dash_effect (svg_android);
+		if (effect == NULL)
+			return SVG_STATUS_NO_MEMORY;
+	}
+
+	// setPathEffect() hands back its argument as a new local reference
+	(*(svg_android->env))->DeleteLocalRef(svg_android->env,
+					      ANDROID_PAINT_SET_EFFECT(svg_android, effect));
+
+	svg_android->state->dash_dirty = 0;
+
+	return SVG_STATUS_SUCCESS;
+}
+
 void _svg_android_copy_canvas_state (svg_android_t *svg_android)
 {
 	_svg_android_set_fill_rule(svg_android, svg_android->state->fill_rule);
@@ -354,56 +902,241 @@ void _svg_android_copy_canvas_state (svg_android_t *svg_android)
 	
 }
 
-#define	DPI	100.0 // This is NOT what we want. How to reach global DPI? (Rob)
+void _svg_android_ctm_init_identity (svg_android_ctm_t *ctm)
+{
+	ctm->xx = 1.0; ctm->yx = 0.0;
+	ctm->xy = 0.0; ctm->yy = 1.0;
+	ctm->x0 = 0.0; ctm->y0 = 0.0;
+}
+
+/* same as Canvas.concat(other), other is applied first */
+void _svg_android_ctm_multiply (svg_android_ctm_t *ctm, const svg_android_ctm_t *other)
+{
+	svg_android_ctm_t r;
+
+	r.xx = ctm->xx * other->xx + ctm->xy * other->yx;
+	r.yx = ctm->yx * other->xx + ctm->yy * other->yx;
+	r.xy = ctm->xx * other->xy + ctm->xy * other->yy;
+	r.yy = ctm->yx * other->xy + ctm->yy * other->yy;
+	r.x0 = ctm->xx * other->x0 + ctm->xy * other->y0 + ctm->x0;
+	r.y0 = ctm->yx * other->x0 + ctm->yy * other->y0 + ctm->y0;
+
+	*ctm = r;
+}
+
+/* map a user space rectangle to the device space rectangle enclosing
+ * it, like Matrix.mapRect() does */
+void _svg_android_ctm_transform_extents (const svg_android_ctm_t *ctm,
+					 double *x1, double *y1,
+					 double *x2, double *y2)
+{
+	double px[4] = {*x1, *x2, *x2, *x1};
+	double py[4] = {*y1, *y1, *y2, *y2};
+	double tx, ty;
+	int k;
+
+	for(k = 0; k < 4; k++) {
+		tx = ctm->xx * px[k] + ctm->xy * py[k] + ctm->x0;
+		ty = ctm->yx * px[k] + ctm->yy * py[k] + ctm->y0;
+
+		if(k == 0 || tx < *x1) *x1 = tx;
+		if(k == 0 || ty < *y1) *y1 = ty;
+		if(k == 0 || tx > *x2) *x2 = tx;
+		if(k == 0 || ty > *y2) *y2 = ty;
+	}
+}
+
+/* the largest factor a user space length is scaled by */
+double _svg_android_ctm_scale (const svg_android_ctm_t *ctm)
+{
+	double sx = sqrt(ctm->xx * ctm->xx + ctm->yx * ctm->yx);
+	double sy = sqrt(ctm->xy * ctm->xy + ctm->yy * ctm->yy);
+
+	return sx > sy ? sx : sy;
+}
+
+/* the stroke of the current state the way it is drawn, for finding its
+ * bounds - dashes are left out, the whole stroke covers all of them */
+void _svg_android_stroke_style (svg_android_t *svg_android, svg_stroke_style_t *style)
+{
+	svg_android_state_t *state = svg_android->state;
+	double width, scale;
+
+	width = _svg_android_stroke_width (svg_android);
+	scale = _svg_android_ctm_scale (&state->ctm);
+
+	style->width = width * svg_android->fit_to_scale;
+	style->line_cap = state->line_cap;
+	style->line_join = state->line_join;
+	style->miter_limit = state->miter_limit;
+	style->dash = NULL;
+	style->num_dashes = 0;
+	style->dash_offset = 0.0;
+	style->tolerance = scale > 0.0 ? SVG_ANDROID_STROKE_TOLERANCE / scale : 0.0;
+}
+
+/* intersect the device clip of the current state with a user space rectangle */
+void _svg_android_clip_to_extents (svg_android_t *svg_android,
+				   double x1, double y1,
+				   double x2, double y2)
+{
+	svg_android_state_t *state = svg_android->state;
+
+	_svg_android_ctm_transform_extents (&state->ctm, &x1, &y1, &x2, &y2);
+
+	if(state->has_clip) {
+		if(x1 < state->clip_x1) x1 = state->clip_x1;
+		if(y1 < state->clip_y1) y1 = state->clip_y1;
+		if(x2 > state->clip_x2) x2 = state->clip_x2;
+		if(y2 > state->clip_y2) y2 = state->clip_y2;
+	}
+
+	state->clip_x1 = x1;
+	state->clip_y1 = y1;
+	state->clip_x2 = x2;
+	state->clip_y2 = y2;
+
+	// an empty clip is treated like no clip at all, just as
+	// Canvas.getClipBounds() returning false did on the java side
+	state->has_clip = (x1 < x2 && y1 < y2) ? 1 : 0;
+}
+
+/* update the bounding box of the current state with a user space
+ * rectangle, provided it touches the current clip */
+void _svg_android_bounding_box_from_extents (svg_android_t *svg_android,
+					     double x1, double y1,
+					     double x2, double y2)
+{
+	svg_android_state_t *state = svg_android->state;
+	svg_bounding_box_t bbox;
+
+	_svg_android_ctm_transform_extents (&state->ctm, &x1, &y1, &x2, &y2);
+
+	if(state->has_clip) {
+		if(!(x1 < x2 && y1 < y2 &&
+		     x1 < state->clip_x2 && state->clip_x1 < x2 &&
+		     y1 < state->clip_y2 && state->clip_y1 < y2))
+			return; // not inside the clip
+
+		if(x1 < state->clip_x1) x1 = state->clip_x1;
+		if(y1 < state->clip_y1) y1 = state->clip_y1;
+		if(x2 > state->clip_x2) x2 = state->clip_x2;
+		if(y2 > state->clip_y2) y2 = state->clip_y2;
+	}
+
+	bbox.left = x1 < 0.0 ? 0 : (unsigned int)x1;
+	bbox.top = y1 < 0.0 ? 0 : (unsigned int)y1;
+	bbox.right = x2 < 0.0 ? 0 : (unsigned int)x2;
+	bbox.bottom = y2 < 0.0 ? 0 : (unsigned int)y2;
+
+	_svg_android_update_last_bounding_box(svg_android, &bbox);
+}
+
+/* Read matrix and clip of a canvas handed to us from the outside, the
+ * values are already adjusted for the current screen canvas offset.
+ */
+void _svg_android_fetch_canvas_state (svg_android_t *svg_android)
+{
+	svg_android_state_t *state = svg_android->state;
+	jfloatArray farr = _svg_android_scratch_floats (svg_android);
+	jfloat v[10];
+
+	if(farr == NULL)
+		return;
+
+	ANDROID_GET_CANVAS_STATE(svg_android, farr);
+	(*(svg_android->env))->GetFloatArrayRegion(svg_android->env, farr, 0, 10, v);
+
+	state->ctm.xx = v[0]; state->ctm.yx = v[1];
+	state->ctm.xy = v[2]; state->ctm.yy = v[3];
+	state->ctm.x0 = v[4]; state->ctm.y0 = v[5];
+
+	state->clip_x1 = v[6];
+	state->clip_y1 = v[7];
+	state->clip_x2 = v[8];
+	state->clip_y2 = v[9];
+	state->has_clip = (v[6] < v[8] && v[7] < v[9]) ? 1 : 0;
+}
+
+/* Device space bounding box of a path, clipped to the canvas. Returns
+ * zero if the path lies outside the clip, the box is left alone then.
+ */
+int _svg_android_fetch_path_bounding_box (svg_android_t *svg_android, jobject path,
+					  svg_bounding_box_t *bbox)
+{
+	jfloatArray farr = _svg_android_scratch_floats (svg_android);
+	jfloat v[5];
+	int k;
+
+	if(farr == NULL)
+		return 0;
+
+	ANDROID_GET_PATH_BOUNDING_BOX(svg_android, path, farr);
+	(*(svg_android->env))->GetFloatArrayRegion(svg_android->env, farr, 0, 5, v);
+
+	if(v[0] == 0.0f)
+		return 0;
+
+	for(k = 1; k < 5; k++)
+		if(v[k] < 0.0f) v[k] = 0.0f;
+
+	bbox->left = (unsigned int)v[1];
+	bbox->top = (unsigned int)v[2];
+	bbox->right = (unsigned int)v[3];
+	bbox->bottom = (unsigned int)v[4];
+
+	return -1;
+}
+
+/* what lengths resolve against in the current state, percentages of
+ * bounding box units against a 1x1 box */
+static void
+_svg_android_length_context (svg_android_t *svg_android, svg_length_context_t *context)
+{
+	if (svg_android->state->bbox) {
+		context->viewport_width = 1.0;
+		context->viewport_height = 1.0;
+	} else {
+		context->viewport_width = svg_android->state->viewport_width;
+		context->viewport_height = svg_android->state->viewport_height;
+	}
+	context->font_size = svg_android->state->font_size;
+	context->dpi = svg_get_dpi (svg_android->svg);
+}
 
 svg_status_t
 _svg_android_length_to_pixel (svg_android_t * svg_android, svg_length_t *length, double *pixel)
 {
-	double width, height;
+	svg_length_context_t context;
 
-	switch (length->unit) {
-	case SVG_LENGTH_UNIT_PX:
-		*pixel = length->value;
-		break;
-	case SVG_LENGTH_UNIT_CM:
-		*pixel = (length->value / 2.54) * DPI;
-		break;
-	case SVG_LENGTH_UNIT_MM:
-		*pixel = (length->value / 25.4) * DPI;
-		break;
-	case SVG_LENGTH_UNIT_IN:
-		*pixel = length->value * DPI;
-		break;
-	case SVG_LENGTH_UNIT_PT:
-		*pixel = (length->value / 72.0) * DPI;
-		break;
-	case SVG_LENGTH_UNIT_PC:
-		*pixel = (length->value / 6.0) * DPI;
-		break;
-	case SVG_LENGTH_UNIT_EM:
-		*pixel = length->value * svg_android->state->font_size;
-		break;
-	case SVG_LENGTH_UNIT_EX:
-		*pixel = length->value * svg_android->state->font_size / 2.0;
-		break;
-	case SVG_LENGTH_UNIT_PCT:
-		if (svg_android->state->bbox) {
-			width = 1.0;
-			height = 1.0;
-		} else {
-			width = svg_android->state->viewport_width;
-			height = svg_android->state->viewport_height;
-		}
-		if (length->orientation == SVG_LENGTH_ORIENTATION_HORIZONTAL)
-			*pixel = (length->value / 100.0) * width;
-		else if (length->orientation == SVG_LENGTH_ORIENTATION_VERTICAL)
-			*pixel = (length->value / 100.0) * height;
-		else
-			*pixel = (length->value / 100.0) * sqrt(pow(width, 2) + pow(height, 2)) * sqrt(2);
-		break;
-	default:
-		*pixel = length->value;
-	}
+	_svg_android_length_context (svg_android, &context);
+	*pixel = svg_length_resolve (length, &context);
 
 	return SVG_STATUS_SUCCESS;
 }
+
+/* Resolve the lengths of one element through the cache it keeps them
+ * in, they are only worked out again when viewport, font size or dpi
+ * differ from the last time. */
+void
+_svg_android_lengths_to_pixel (svg_android_t *svg_android, svg_length_cache_t *cache,
+			       svg_length_t **lengths, int count, double *pixels)
+{
+	svg_length_context_t context;
+
+	_svg_android_length_context (svg_android, &context);
+	svg_length_cache_resolve (cache, &context, lengths, count, pixels);
+}
+
+/* stroke width of the current state in user units */
+double
+_svg_android_stroke_width (svg_android_t *svg_android)
+{
+	svg_android_state_t *state = svg_android->state;
+	svg_length_t *width_len = &state->width_len;
+	double width;
+
+	_svg_android_lengths_to_pixel (svg_android, &state->width_cache, &width_len, 1, &width);
+
+	return width;
+}
@@ -47,8 +47,12 @@
 //#define __DO_SVG_ANDROID_DEBUG
 #include "svg_android_debug.h"
 
-static svg_android_state_t *state_store = NULL;
-static size_t state_store_level = 0, state_store_depth = 0;
+/* States are recycled through a per-instance store, so that the
+ * Matrix/Paint/Path global refs each of them holds are created only once.
+ * The store is an array of pointers, the states themselves never move
+ * since state->next points into it. Nothing here is shared between
+ * instances, different documents can be rendered on different threads.
+ */
 
 static void clear_state(svg_android_state_t *state) {
 	memset(state, 0, sizeof(svg_android_state_t));
@@ -58,38 +62,36 @@ static void clear_state(svg_android_state_t *state) {
 	state->state_path = NULL;
 }
 
-static int dig_stack_deeper() {
-	size_t new_store_depth = 2 * state_store_depth;
+static int dig_stack_deeper(svg_android_t *svg_android) {
+	size_t new_store_depth = 2 * svg_android->state_store_depth;
 
 	if(new_store_depth == 0) new_store_depth = 10; // default
 
-	svg_android_state_t *new_stack = NULL;
-
-	if(state_store == NULL) {
-		new_stack = (svg_android_state_t *)calloc(sizeof(svg_android_state_t), new_store_depth);
-	} else {
-		new_stack = (svg_android_state_t *)realloc(state_store, sizeof(svg_android_state_t) * new_store_depth);
-	}
+	svg_android_state_t **new_stack =
+		(svg_android_state_t **)realloc(svg_android->state_store,
+						sizeof(svg_android_state_t *) * new_store_depth);
 
 	if(new_stack == NULL) return -1;
+	svg_android->state_store = new_stack;
 
-	int k;
-	for(k = state_store_depth; k < new_store_depth; k++) {
-		clear_state(&new_stack[k]);
-	}
+	size_t k;
+	for(k = svg_android->state_store_depth; k < new_store_depth; k++) {
+		new_stack[k] = (svg_android_state_t *)malloc(sizeof(svg_android_state_t));
+		if(new_stack[k] == NULL) return -1;
 
-	state_store = new_stack;
-	state_store_depth = new_store_depth;
+		clear_state(new_stack[k]);
+		svg_android->state_store_depth = k + 1;
+	}
 
 	return 0;
 }
 
 static svg_android_status_t pop_state_store(svg_android_state_t **_state, svg_android_t *svg_android) {
 	svg_android_state_t *state = NULL;
-	if(state_store_level == state_store_depth)
-		if(dig_stack_deeper()) return SVG_ANDROID_STATUS_NO_MEMORY; // failure
+	if(svg_android->state_store_level == svg_android->state_store_depth)
+		if(dig_stack_deeper(svg_android)) return SVG_ANDROID_STATUS_NO_MEMORY; // failure
 
-	state = &state_store[state_store_level++];
+	state = svg_android->state_store[svg_android->state_store_level++];
 
 	/******** set initial values, the missing stuff is filled in by copy and/or init *****/
 
@@ -103,6 +105,7 @@ static svg_android_status_t pop_state_store(svg_android_state_t **_state, svg_an
 
 	state->offscreen_bitmap = NULL;
 	state->saved_canvas = NULL;
+	state->layer = NULL;
 
 	state->font_family = NULL;
 	state->font_size = 1.0;
@@ -115,9 +118,22 @@ static svg_android_status_t pop_state_store(svg_android_state_t **_state, svg_an
 	state->bounding_box.right = 0;
 	state->bounding_box.bottom = 0;
 
+	_svg_android_ctm_init_identity (&state->ctm);
+	state->has_clip = 0;
+
+	// libsvg sets these before anything is stroked, start out
+	// with the SVG defaults anyway
+	state->width_len.unit = SVG_LENGTH_UNIT_PX;
+	state->width_len.value = 1.0;
+	state->width_cache.count = 0;
+	state->line_cap = SVG_STROKE_LINE_CAP_BUTT;
+	state->line_join = SVG_STROKE_LINE_JOIN_MITER;
+	state->miter_limit = 4.0;
+
 	state->dash = NULL;
 	state->num_dashes = 0;
 	state->dash_offset = 0;
+	state->dash_dirty = 0;
 
 	state->opacity = 1.0;
 
@@ -128,19 +144,21 @@ static svg_android_status_t pop_state_store(svg_android_state_t **_state, svg_an
 	state->next = NULL;
 
 	if(state->matrix == NULL) {
-		state->matrix = ANDROID_IDENTITY_MATRIX(state->instance);
+		jobject local = ANDROID_IDENTITY_MATRIX(state->instance);
 		state->matrix =
 			(*(state->instance->env))->NewGlobalRef(
-				state->instance->env, state->matrix);
+				state->instance->env, local);
+		(*(state->instance->env))->DeleteLocalRef(state->instance->env, local);
 	} else {
 		ANDROID_MATRIX_RESET(state->instance, state->matrix);
 	}
 
 	if(state->paint == NULL) {
-		state->paint = ANDROID_PAINT_CREATE(state->instance);
+		jobject local = ANDROID_PAINT_CREATE(state->instance);
 		state->paint =
 			(*(state->instance->env))->NewGlobalRef(
-				state->instance->env, state->paint);
+				state->instance->env, local);
+		(*(state->instance->env))->DeleteLocalRef(state->instance->env, local);
 	} else {
 		DEBUG_ANDROID1("   paint before reset %p", state->paint);
 		ANDROID_PAINT_RESET(state->instance, state->paint);
@@ -148,10 +166,11 @@ static svg_android_status_t pop_state_store(svg_android_state_t **_state, svg_an
 	}
 
 	if(state->state_path == NULL) {
-		state->state_path = ANDROID_PATH_CREATE(state->instance);
+		jobject local = ANDROID_PATH_CREATE(state->instance);
 		state->state_path =
 			(*(state->instance->env))->NewGlobalRef(
-				state->instance->env, state->state_path);
+				state->instance->env, local);
+		(*(state->instance->env))->DeleteLocalRef(state->instance->env, local);
 		DEBUG_ANDROID1("   new path created %p", state->state_path);
 	} else {
 		DEBUG_ANDROID1("   path before clear %p", state->state_path);
@@ -165,17 +184,47 @@ static svg_android_status_t pop_state_store(svg_android_state_t **_state, svg_an
 	return SVG_ANDROID_STATUS_SUCCESS;
 }
 
-static svg_android_status_t push_state_store() {
-	state_store_level--;
-	if(state_store_level < 0) {
-		DEBUG_ANDROID1("     state store level failure: %d", state_store_level);
-		state_store_level = 0;
+static svg_android_status_t push_state_store(svg_android_t *svg_android) {
+	if(svg_android->state_store_level == 0) {
+		DEBUG_ANDROID("     state store level failure");
 		return SVG_ANDROID_STATUS_INVALID_CALL;
 	}
+	svg_android->state_store_level--;
 
 	return SVG_ANDROID_STATUS_SUCCESS;
 }
 
+void
+_svg_android_state_store_init (svg_android_t *svg_android)
+{
+	svg_android->state_store = NULL;
+	svg_android->state_store_level = 0;
+	svg_android->state_store_depth = 0;
+}
+
+/* release the global refs of every state we ever handed out */
+void
+_svg_android_state_store_deinit (svg_android_t *svg_android)
+{
+	JNIEnv *env = svg_android->env;
+	size_t k;
+
+	for(k = 0; k < svg_android->state_store_depth; k++) {
+		svg_android_state_t *state = svg_android->state_store[k];
+
+		if(state->matrix)
+			(*env)->DeleteGlobalRef(env, state->matrix);
+		if(state->paint)
+			(*env)->DeleteGlobalRef(env, state->paint);
+		if(state->state_path)
+			(*env)->DeleteGlobalRef(env, state->state_path);
+		free(state);
+	}
+	free(svg_android->state_store);
+
+	_svg_android_state_store_init (svg_android);
+}
+
 svg_android_status_t
 _svg_android_state_init (svg_android_state_t *state)
 {
@@ -190,7 +239,8 @@ _svg_android_state_init (svg_android_state_t *state)
 
 	// this might already be set by copy
 	if(state->font_family == NULL) {
-		state->font_family = strdup (SVG_ANDROID_FONT_FAMILY_DEFAULT);
+		state->font_family = _svg_android_intern_font_family (state->instance,
+								      SVG_ANDROID_FONT_FAMILY_DEFAULT);
 		if (state->font_family == NULL)
 			return SVG_ANDROID_STATUS_NO_MEMORY;
 	}
@@ -228,6 +278,7 @@ _svg_android_state_init_copy (svg_android_state_t *state, const svg_android_stat
 	/* We don't need our own child_surface or saved cr at this point. */
 	state->offscreen_bitmap = NULL;
 	state->saved_canvas = NULL;
+	state->layer = NULL;
 
 	/* We must clear the filter related saved canvas/bitmap */
 	state->filter_source_bitmap = NULL;
@@ -236,16 +287,15 @@ _svg_android_state_init_copy (svg_android_state_t *state, const svg_android_stat
 	// copy paint
 	ANDROID_PAINT_SET(state->instance, state->paint, other->paint);
 
-	// copy matrix
-	ANDROID_MATRIX_SET(state->instance, state->matrix, other->matrix);
+	/* The matrix is not copied, it holds the transform of the element
+	 * owning the state (the canvas has the accumulated one) and was
+	 * already reset to identity by pop_state_store().
+	 */
 
 	DEBUG_ANDROID("-----------------------------");
 	DEBUG_ANDROID1("COPY created global refs for paint at %p", state->paint);
-	DEBUG_ANDROID1("COPY created global refs for matrix at %p", state->matrix);
 
-	// We need to duplicate the string
-	if (other->font_family)
-		state->font_family = strdup ((char *) other->font_family);
+	// the font family is interned, the pointer copy above is all we need
 
 	// XXX anton: are these not copied already?!
 	state->viewport_width = other->viewport_width;
@@ -279,10 +329,7 @@ _svg_android_state_deinit (svg_android_state_t *state)
 		state->saved_canvas = NULL;
 	}
 
-	if (state->font_family) {
-		free (state->font_family);
-		state->font_family = NULL;
-	}
+	state->font_family = NULL; // interned, owned by the instance
 
 	if (state->dash) {
 		free (state->dash);
@@ -301,7 +348,7 @@ _svg_android_state_destroy (svg_android_state_t *state)
 
 	(*(state->instance->env))->PopLocalFrame(state->instance->env, NULL);
 
-	return push_state_store();
+	return push_state_store(state->instance);
 }
 
 svg_android_state_t *
@@ -343,7 +390,7 @@ _svg_android_state_push (svg_android_t *instance, svg_android_state_t *state, jo
 	DEBUG_ANDROID1("RETURNING global refs for state_path at %p", new->state_path);
 	DEBUG_ANDROID1("RETURNING global refs for paint at %p", new->paint);
 	DEBUG_ANDROID1("RETURNING global refs for matrix at %p", new->matrix);
-	DEBUG_ANDROID1("     state store level %d", state_store_level);
+	DEBUG_ANDROID1("     state store level %d", (int)instance->state_store_level);
 	DEBUG_ANDROID ("     ");
 
 	(*(instance->env))->PushLocalFrame(instance->env, 32);
@@ -368,7 +415,7 @@ _svg_android_state_pop (svg_android_state_t *state)
 		DEBUG_ANDROID1("   next global refs for paint at %p", state->next->paint);
 		DEBUG_ANDROID1("   next global refs for matrix at %p", state->next->matrix);
 	}
-	DEBUG_ANDROID1("     state store level %d", state_store_level);
+	DEBUG_ANDROID1("     state store level %d", (int)state->instance->state_store_level);
 	DEBUG_ANDROID ("     ");
 
 	next = state->next;
@@ -380,3 +427,17 @@ _svg_android_state_pop (svg_android_state_t *state)
 
 	return next;
 }
+
+/* a fresh canvas was created for this state, it starts out with an
+ * identity matrix and is clipped to its bitmap */
+void
+_svg_android_state_reset_canvas (svg_android_state_t *state, double width, double height)
+{
+	_svg_android_ctm_init_identity (&state->ctm);
+
+	state->clip_x1 = 0.0;
+	state->clip_y1 = 0.0;
+	state->clip_x2 = width;
+	state->clip_y2 = height;
+	state->has_clip = (width > 0.0 && height > 0.0) ? 1 : 0;
+}
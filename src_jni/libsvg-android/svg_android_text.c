@@ -0,0 +1,271 @@
+/* libsvg-android - Render SVG documents to an Android canvas
+ *
+ * Copyright © 2002 University of Southern California
+ * Copyright © 2016 Anton Persson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy (COPYING.LESSER) of the
+ * GNU Lesser General Public License along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Original Cairo-version:
+ * Author: Carl D. Worth <cworth@isi.edu>
+ *
+ * Android modification:
+ * Author: Anton Persson {don d0t juanton 4t gmail d0t com}
+ *
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "svg-android-internal.h"
+
+//#define __DO_SVG_ANDROID_DEBUG
+#include "svg_android_debug.h"
+
+/* Paint.getTextPath() shapes and outlines the whole run each time it is
+ * called, which is by far the most expensive thing a text element does.
+ * The outline only depends on the string, the font, the anchor and the
+ * position, so we keep it keyed on exactly those. A changed text or font
+ * is a different key, the stale outline is never hit again and is
+ * dropped when it becomes the least recently used one.
+ */
+
+void
+_svg_android_text_cache_init (svg_android_t *svg_android)
+{
+	memset(svg_android->text_cache, 0, sizeof(svg_android->text_cache));
+	svg_android->text_cache_head = NULL;
+	svg_android->text_cache_tail = NULL;
+	svg_android->text_cache_entries = 0;
+}
+
+static void
+_svg_android_text_cache_unlink (svg_android_t *svg_android, svg_android_text_cache_entry_t *entry)
+{
+	if(entry->prev)
+		entry->prev->next = entry->next;
+	else
+		svg_android->text_cache_head = entry->next;
+
+	if(entry->next)
+		entry->next->prev = entry->prev;
+	else
+		svg_android->text_cache_tail = entry->prev;
+
+	entry->prev = entry->next = NULL;
+}
+
+static void
+_svg_android_text_cache_link_head (svg_android_t *svg_android, svg_android_text_cache_entry_t *entry)
+{
+	entry->prev = NULL;
+	entry->next = svg_android->text_cache_head;
+
+	if(svg_android->text_cache_head)
+		svg_android->text_cache_head->prev = entry;
+	else
+		svg_android->text_cache_tail = entry;
+
+	svg_android->text_cache_head = entry;
+}
+
+static void
+_svg_android_text_cache_free_entry (svg_android_t *svg_android, svg_android_text_cache_entry_t *entry)
+{
+	svg_android_text_cache_entry_t **p;
+
+	p = &svg_android->text_cache[entry->hash % SVG_ANDROID_TEXT_CACHE_BUCKETS];
+	for(; *p; p = &(*p)->bucket_next) {
+		if(*p == entry) {
+			*p = entry->bucket_next;
+			break;
+		}
+	}
+
+	_svg_android_text_cache_unlink (svg_android, entry);
+	svg_android->text_cache_entries--;
+
+	(*(svg_android->env))->DeleteGlobalRef(svg_android->env, entry->path);
+	free(entry->utf8);
+	free(entry);
+}
+
+void
+_svg_android_text_cache_deinit (svg_android_t *svg_android)
+{
+	while(svg_android->text_cache_head)
+		_svg_android_text_cache_free_entry (svg_android, svg_android->text_cache_head);
+}
+
+static unsigned int
+_svg_android_text_hash_bytes (unsigned int hash, const void *data, size_t length)
+{
+	const unsigned char *p = data;
+
+	while(length--)
+		hash = hash * 33 + *p++;
+
+	return hash;
+}
+
+static unsigned int
+_svg_android_text_hash (svg_android_state_t *state, const char *utf8, double x, double y)
+{
+	unsigned int hash = 5381;
+
+	hash = _svg_android_text_hash_bytes (hash, utf8, strlen(utf8));
+	hash = _svg_android_text_hash_bytes (hash, &state->font_family, sizeof(state->font_family));
+	hash = _svg_android_text_hash_bytes (hash, &state->font_weight, sizeof(state->font_weight));
+	hash = _svg_android_text_hash_bytes (hash, &state->font_style, sizeof(state->font_style));
+	hash = _svg_android_text_hash_bytes (hash, &state->font_size, sizeof(state->font_size));
+	hash = _svg_android_text_hash_bytes (hash, &state->text_anchor, sizeof(state->text_anchor));
+	hash = _svg_android_text_hash_bytes (hash, &x, sizeof(x));
+	hash = _svg_android_text_hash_bytes (hash, &y, sizeof(y));
+
+	return hash;
+}
+
+static int
+_svg_android_text_cache_match (svg_android_text_cache_entry_t *entry, unsigned int hash,
+			       svg_android_state_t *state, const char *utf8, double x, double y)
+{
+	return entry->hash == hash &&
+		entry->font_family == state->font_family &&
+		entry->font_weight == state->font_weight &&
+		entry->font_style == state->font_style &&
+		entry->font_size == state->font_size &&
+		entry->text_anchor == state->text_anchor &&
+		entry->x == x && entry->y == y &&
+		strcmp(entry->utf8, utf8) == 0;
+}
+
+/* outline utf8 at (x, y) with the current paint into a new path */
+static jobject
+_svg_android_text_outline (svg_android_t *svg_android, const char *utf8, double x, double y)
+{
+	JNIEnv *env = svg_android->env;
+	jobject path, global_path;
+	jstring text;
+
+	path = ANDROID_PATH_CREATE(svg_android);
+	if(path == NULL)
+		return NULL;
+
+	text = (*env)->NewStringUTF(env, utf8);
+	if(text == NULL) {
+		(*env)->DeleteLocalRef(env, path);
+		return NULL;
+	}
+
+	ANDROID_TEXT_PATH(svg_android, text, strlen_UTF8(utf8), x, y, path);
+	(*env)->DeleteLocalRef(env, text);
+
+	if(svg_android->state->fill_rule == SVG_FILL_RULE_EVEN_ODD)
+		ANDROID_SET_FILL_TYPE(svg_android, path, JNI_TRUE);
+
+	global_path = (*env)->NewGlobalRef(env, path);
+	(*env)->DeleteLocalRef(env, path);
+
+	return global_path;
+}
+
+/* returns the outline of utf8 drawn at (x, y) with the current font,
+ * outlining it only if it is not cached already. The entry stays owned
+ * by the cache, NULL means we ran out of memory. */
+svg_android_text_cache_entry_t *
+_svg_android_text_cache_get (svg_android_t *svg_android, const char *utf8, double x, double y)
+{
+	JNIEnv *env = svg_android->env;
+	svg_android_state_t *state = svg_android->state;
+	svg_android_text_cache_entry_t *entry, **bucket;
+	unsigned int hash;
+	jfloatArray farr;
+	jfloat coords[4];
+
+	hash = _svg_android_text_hash (state, utf8, x, y);
+	bucket = &svg_android->text_cache[hash % SVG_ANDROID_TEXT_CACHE_BUCKETS];
+
+	for(entry = *bucket; entry; entry = entry->bucket_next) {
+		if(_svg_android_text_cache_match (entry, hash, state, utf8, x, y)) {
+			if(entry != svg_android->text_cache_head) {
+				_svg_android_text_cache_unlink (svg_android, entry);
+				_svg_android_text_cache_link_head (svg_android, entry);
+			}
+
+			// the fill rule is part of the path object, but not of the outline
+			if(entry->fill_rule != state->fill_rule) {
+				ANDROID_SET_FILL_TYPE(svg_android, entry->path,
+						      state->fill_rule == SVG_FILL_RULE_EVEN_ODD ? JNI_TRUE : JNI_FALSE);
+				entry->fill_rule = state->fill_rule;
+			}
+
+			return entry;
+		}
+	}
+
+	entry = malloc(sizeof(svg_android_text_cache_entry_t));
+	if(entry == NULL)
+		return NULL;
+
+	entry->utf8 = strdup(utf8);
+	if(entry->utf8 == NULL) {
+		free(entry);
+		return NULL;
+	}
+
+	entry->path = _svg_android_text_outline (svg_android, utf8, x, y);
+	if(entry->path == NULL) {
+		free(entry->utf8);
+		free(entry);
+		return NULL;
+	}
+
+	entry->hash = hash;
+	entry->font_family = state->font_family;
+	entry->font_weight = state->font_weight;
+	entry->font_style = state->font_style;
+	entry->font_size = state->font_size;
+	entry->text_anchor = state->text_anchor;
+	entry->x = x;
+	entry->y = y;
+	entry->fill_rule = state->fill_rule;
+
+	// user space extents, so that drawing needs no bounding box from java
+	farr = _svg_android_scratch_floats (svg_android);
+	if(farr) {
+		ANDROID_PATH_GET_BOUNDS(svg_android, entry->path, farr);
+		(*env)->GetFloatArrayRegion(env, farr, 0, 4, coords);
+		entry->x1 = coords[0]; entry->y1 = coords[1];
+		entry->x2 = coords[2]; entry->y2 = coords[3];
+
+		// blanks have no outline, leave those to java like before
+		entry->has_extents = entry->x2 > entry->x1 || entry->y2 > entry->y1;
+	} else {
+		entry->has_extents = 0;
+	}
+
+	if(svg_android->text_cache_entries >= SVG_ANDROID_TEXT_CACHE_MAX_ENTRIES) {
+		SVG_ANDROID_DEBUG("_svg_android_text_cache_get() - evicting \"%s\"\n",
+				  svg_android->text_cache_tail->utf8);
+		_svg_android_text_cache_free_entry (svg_android, svg_android->text_cache_tail);
+	}
+
+	entry->bucket_next = *bucket;
+	*bucket = entry;
+	_svg_android_text_cache_link_head (svg_android, entry);
+	svg_android->text_cache_entries++;
+
+	return entry;
+}
@@ -0,0 +1,378 @@
+/* libsvg-soft - Render SVG documents into RGBA pixel buffers
+ *
+ * Copyright © 2016 Anton Persson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy (COPYING.LESSER) of the
+ * GNU Lesser General Public License along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Anton Persson {don d0t juanton 4t gmail d0t com}
+ *
+ */
+
+#ifndef SVG_SOFT_INTERNAL_H
+#define SVG_SOFT_INTERNAL_H
+
+#include "svg-soft.h"
+
+/* allowed distance between a curve, round join or cap and its polygon, in pixels */
+#define SVG_SOFT_TOLERANCE 0.25
+
+#define SVG_SOFT_GRADIENT_CACHE_SIZE 8
+#define SVG_SOFT_PATTERN_MAX_TILE 1024
+
+typedef struct svg_soft_ctm {
+	double xx, yx, xy, yy, x0, y0;
+} svg_soft_ctm_t;
+
+/* Pixels of the surface we draw on. A layer only covers part of the
+ * device, (origin_x, origin_y) is the device pixel of its first byte. */
+typedef struct svg_soft_surface {
+	unsigned char *pixels;
+	int origin_x, origin_y;
+	int width, height, stride;
+} svg_soft_surface_t;
+
+/* One pixel touched by an edge, in 24.8 subpixel units: cover is the
+ * height of the edge inside the cell, area twice the covered area. */
+typedef struct svg_soft_cell {
+	int x, y;
+	int cover, area;
+} svg_soft_cell_t;
+
+typedef struct svg_soft_rasterizer {
+	svg_soft_cell_t *cells;
+	int num_cells, cells_size;
+	svg_soft_cell_t cur;
+
+	// device pixels, x2 and y2 are exclusive
+	int clip_x1, clip_y1, clip_x2, clip_y2;
+
+	unsigned char *covers; // one scanline of coverage
+	int covers_size;
+
+	int error;
+} svg_soft_rasterizer_t;
+
+typedef enum svg_soft_paint_type {
+	SVG_SOFT_PAINT_NONE,
+	SVG_SOFT_PAINT_SOLID,
+	SVG_SOFT_PAINT_LINEAR,
+	SVG_SOFT_PAINT_RADIAL,
+	SVG_SOFT_PAINT_TEXTURE
+} svg_soft_paint_type_t;
+
+/* a paint resolved against the current state, ready to fill spans */
+typedef struct svg_soft_paint {
+	svg_soft_paint_type_t type;
+	unsigned int alpha; // 0 - 256
+
+	unsigned char color[4]; // premultiplied
+
+	// maps device pixels to gradient or texture space
+	svg_soft_ctm_t inverse;
+
+	svg_gradient_spread_t spread;
+	const unsigned char *lut; // 256 premultiplied colors
+
+	double x1, y1, dx, dy; // linear, dx and dy are divided by the length squared
+	double cx, cy, fx, fy, r; // radial
+
+	const unsigned char *texture; // premultiplied RGBA
+	int texture_width, texture_height, texture_stride;
+	int texture_repeat; // wrap around instead of clamping to the edge
+	int texture_bgra; // blue first, like the images svg_image.c decodes
+	unsigned char *owned_texture; // a pattern tile, freed with the paint
+} svg_soft_paint_t;
+
+typedef struct svg_soft_gradient_cache_entry {
+	svg_gradient_t *gradient;
+	unsigned int generation;
+	unsigned int last_used;
+	unsigned char lut[256 * 4];
+} svg_soft_gradient_cache_entry_t;
+
+typedef struct svg_soft_state {
+	svg_soft_ctm_t ctm;
+	int clip_x1, clip_y1, clip_x2, clip_y2; // device pixels
+
+	svg_color_t color;
+	svg_paint_t fill_paint;
+	svg_paint_t stroke_paint;
+	double fill_opacity;
+	double stroke_opacity;
+	double opacity;
+	svg_fill_rule_t fill_rule;
+
+	double stroke_width;
+	svg_stroke_line_cap_t line_cap;
+	svg_stroke_line_join_t line_join;
+	double miter_limit;
+
+	double *dash;
+	int num_dashes;
+	int owns_dash; // otherwise it belongs to a parent state
+	double dash_offset;
+
+	double font_size;
+
+	double viewport_width;
+	double viewport_height;
+
+	int bbox;
+
+	// group opacity layer, composited into saved_surface when popped
+	unsigned char *layer;
+	double layer_opacity;
+	svg_soft_surface_t saved_surface;
+} svg_soft_state_t;
+
+struct svg_soft {
+	svg_t *svg;
+
+	svg_soft_surface_t surface;
+
+	// a stack of pointers, state points at the top of it - the states
+	// never move, painting a pattern pushes more of them while the one
+	// below is in use, and they are kept for the next render
+	svg_soft_state_t **states;
+	int num_states, states_size;
+	svg_soft_state_t *state;
+
+	svg_polyline_t path; // flattened, in user space
+	double last_x, last_y; // current point of the path
+	double start_x, start_y; // first point of the current subpath
+
+	svg_polyline_t stroke; // outline of the last stroked path
+	svg_stroker_t stroker;
+	svg_soft_rasterizer_t rasterizer;
+
+	// user space extents of the shape being painted
+	double shape_x1, shape_y1, shape_x2, shape_y2;
+
+	svg_soft_gradient_cache_entry_t gradient_cache[SVG_SOFT_GRADIENT_CACHE_SIZE];
+	unsigned int gradient_clock;
+};
+
+/* svg_soft.c */
+svg_status_t
+_svg_soft_push_state (svg_soft_t *svg_soft);
+
+svg_status_t
+_svg_soft_pop_state (svg_soft_t *svg_soft);
+
+/* svg_soft_render.c */
+svg_status_t
+_svg_soft_begin_group (void *closure, double opacity, const svg_rect_t *extents);
+
+svg_status_t
+_svg_soft_begin_element (void *closure, void *path_cache, unsigned int changes);
+
+svg_status_t
+_svg_soft_end_element (void *closure);
+
+svg_status_t
+_svg_soft_end_group (void *closure, double opacity);
+
+svg_status_t
+_svg_soft_move_to (void *closure, double x, double y);
+
+svg_status_t
+_svg_soft_line_to (void *closure, double x, double y);
+
+svg_status_t
+_svg_soft_curve_to (void *closure,
+		    double x1, double y1,
+		    double x2, double y2,
+		    double x3, double y3);
+
+svg_status_t
+_svg_soft_close_path (void *closure);
+
+svg_status_t
+_svg_soft_set_color (void *closure, const svg_color_t *color);
+
+svg_status_t
+_svg_soft_set_fill_opacity (void *closure, double fill_opacity);
+
+svg_status_t
+_svg_soft_set_fill_paint (void *closure, const svg_paint_t *paint);
+
+svg_status_t
+_svg_soft_set_fill_rule (void *closure, svg_fill_rule_t fill_rule);
+
+svg_status_t
+_svg_soft_set_font_size (void *closure, double size);
+
+svg_status_t
+_svg_soft_set_opacity (void *closure, double opacity);
+
+svg_status_t
+_svg_soft_set_stroke_dash_array (void *closure, double *dash, int num_dashes);
+
+svg_status_t
+_svg_soft_set_stroke_dash_offset (void *closure, svg_length_t *offset_len);
+
+svg_status_t
+_svg_soft_set_stroke_line_cap (void *closure, svg_stroke_line_cap_t line_cap);
+
+svg_status_t
+_svg_soft_set_stroke_line_join (void *closure, svg_stroke_line_join_t line_join);
+
+svg_status_t
+_svg_soft_set_stroke_miter_limit (void *closure, double limit);
+
+svg_status_t
+_svg_soft_set_stroke_opacity (void *closure, double stroke_opacity);
+
+svg_status_t
+_svg_soft_set_stroke_paint (void *closure, const svg_paint_t *paint);
+
+svg_status_t
+_svg_soft_set_stroke_width (void *closure, svg_length_t *width_len);
+
+svg_status_t
+_svg_soft_apply_clip_box (void *closure,
+			  svg_length_t *x_l,
+			  svg_length_t *y_l,
+			  svg_length_t *width_l,
+			  svg_length_t *height_l);
+
+svg_status_t
+_svg_soft_transform (void *closure,
+		     double xx, double yx,
+		     double xy, double yy,
+		     double x0, double y0);
+
+svg_status_t
+_svg_soft_apply_view_box (void *closure,
+			  svg_view_box_t view_box,
+			  svg_length_t *width,
+			  svg_length_t *height);
+
+svg_status_t
+_svg_soft_set_viewport_dimension (void *closure,
+				  svg_length_t *width,
+				  svg_length_t *height);
+
+svg_status_t
+_svg_soft_render_line (void *closure,
+		       svg_length_t *x1_len, svg_length_t *y1_len,
+		       svg_length_t *x2_len, svg_length_t *y2_len,
+		       svg_length_cache_t *lengths);
+
+svg_status_t
+_svg_soft_render_path (void *closure, void **path_cache);
+
+svg_status_t
+_svg_soft_render_ellipse (void *closure,
+			  svg_length_t *cx_len,
+			  svg_length_t *cy_len,
+			  svg_length_t *rx_len,
+			  svg_length_t *ry_len,
+			  svg_length_cache_t *lengths);
+
+svg_status_t
+_svg_soft_render_rect (void *closure,
+		       svg_length_t *x_len,
+		       svg_length_t *y_len,
+		       svg_length_t *width_len,
+		       svg_length_t *height_len,
+		       svg_length_t *rx_len,
+		       svg_length_t *ry_len,
+		       svg_length_cache_t *lengths);
+
+svg_status_t
+_svg_soft_render_text (void *closure,
+		       svg_length_t *x_len,
+		       svg_length_t *y_len,
+		       const char *utf8);
+
+svg_status_t
+_svg_soft_render_image (void		*closure,
+			unsigned char	*data,
+			unsigned int	data_width,
+			unsigned int	data_height,
+			svg_length_t	*x_len,
+			svg_length_t	*y_len,
+			svg_length_t	*width_len,
+			svg_length_t	*height_len,
+			svg_length_cache_t *lengths);
+
+int
+_svg_soft_get_last_bounding_box (void *closure, svg_bounding_box_t *bbox);
+
+svg_status_t
+_svg_soft_length_to_pixel (svg_soft_t *svg_soft, svg_length_t *length, double *pixel);
+
+void
+_svg_soft_lengths_to_pixel (svg_soft_t *svg_soft, svg_length_cache_t *cache,
+			    svg_length_t **lengths, int count, double *pixels);
+
+/* svg_soft_ctm.c */
+void _svg_soft_ctm_init_identity (svg_soft_ctm_t *ctm);
+void _svg_soft_ctm_multiply (svg_soft_ctm_t *ctm, const svg_soft_ctm_t *other);
+int _svg_soft_ctm_invert (svg_soft_ctm_t *ctm);
+double _svg_soft_ctm_scale (const svg_soft_ctm_t *ctm);
+void _svg_soft_ctm_transform_extents (const svg_soft_ctm_t *ctm,
+				      double *x1, double *y1,
+				      double *x2, double *y2);
+
+/* svg_soft_raster.c */
+void
+_svg_soft_rasterizer_init (svg_soft_rasterizer_t *rasterizer);
+
+void
+_svg_soft_rasterizer_deinit (svg_soft_rasterizer_t *rasterizer);
+
+void
+_svg_soft_rasterizer_reset (svg_soft_rasterizer_t *rasterizer,
+			    int clip_x1, int clip_y1, int clip_x2, int clip_y2);
+
+void
+_svg_soft_rasterizer_add_path (svg_soft_rasterizer_t *rasterizer,
+			       const svg_polyline_t *path,
+			       const svg_soft_ctm_t *ctm);
+
+svg_status_t
+_svg_soft_rasterizer_fill (svg_soft_t *svg_soft,
+			   svg_fill_rule_t fill_rule,
+			   const svg_soft_paint_t *paint);
+
+/* svg_soft_paint.c */
+void
+_svg_soft_gradient_cache_init (svg_soft_t *svg_soft);
+
+svg_status_t
+_svg_soft_paint_init (svg_soft_t *svg_soft, svg_soft_paint_t *paint,
+		      const svg_paint_t *svg_paint, double opacity);
+
+void
+_svg_soft_paint_fini (svg_soft_paint_t *paint);
+
+void
+_svg_soft_paint_texture (svg_soft_t *svg_soft, svg_soft_paint_t *paint,
+			 const unsigned char *data, int width, int height,
+			 const svg_soft_ctm_t *texture_to_user, double opacity);
+
+void
+_svg_soft_paint_span (svg_soft_t *svg_soft, const svg_soft_paint_t *paint,
+		      int x, int y, int length, const unsigned char *covers);
+
+svg_status_t
+_svg_soft_layer_begin (svg_soft_t *svg_soft, double opacity, const svg_rect_t *extents);
+
+void
+_svg_soft_layer_end (svg_soft_t *svg_soft);
+
+#endif
@@ -0,0 +1,54 @@
+/* libsvg-soft - Render SVG documents into RGBA pixel buffers
+ *
+ * Copyright © 2016 Anton Persson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy (COPYING.LESSER) of the
+ * GNU Lesser General Public License along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Anton Persson {don d0t juanton 4t gmail d0t com}
+ *
+ */
+
+#ifndef SVG_SOFT_H
+#define SVG_SOFT_H
+
+#include <svg.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/* A render engine in plain C, it needs neither JNI nor a canvas.
+	 * The pixels are premultiplied RGBA8888, in that order in memory,
+	 * which is what an android ARGB_8888 bitmap holds as well.
+	 */
+	typedef struct svg_soft svg_soft_t;
+
+	/* the document stays owned by the caller, it must outlive the engine */
+	svg_soft_t *svgSoftCreate(svg_t *svg);
+	void svgSoftDestroy(svg_soft_t *svg_soft);
+
+	/* draw the document on top of what pixels already holds, with the
+	 * viewport set to width x height */
+	svg_status_t svgSoftRender(svg_soft_t *svg_soft,
+				   unsigned char *pixels,
+				   int width, int height, int stride);
+
+	extern svg_render_engine_t SVG_SOFT_RENDER_ENGINE;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
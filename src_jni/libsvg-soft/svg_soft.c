@@ -0,0 +1,232 @@
+/* libsvg-soft - Render SVG documents into RGBA pixel buffers
+ *
+ * Copyright © 2016 Anton Persson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy (COPYING.LESSER) of the
+ * GNU Lesser General Public License along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Anton Persson {don d0t juanton 4t gmail d0t com}
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "svg-soft-internal.h"
+
+/* Text needs a font engine and filters need the offscreen machinery
+ * of the android engine, neither is available here. Text elements
+ * draw nothing and filters are ignored, the rest of the document is
+ * rendered as usual.
+ */
+svg_render_engine_t SVG_SOFT_RENDER_ENGINE = {
+	/* everything arrives as lines and cubics, that is all the flattener knows */
+	.capabilities = (SVG_RENDER_ENGINE_CUBICS_ONLY |
+			 SVG_RENDER_ENGINE_GROUP_OPACITY),
+	/* hierarchy */
+	.begin_group = _svg_soft_begin_group,
+	.begin_element = _svg_soft_begin_element,
+	.end_element = _svg_soft_end_element,
+	.end_group = _svg_soft_end_group,
+	/* path creation */
+	.move_to = _svg_soft_move_to,
+	.line_to = _svg_soft_line_to,
+	.curve_to = _svg_soft_curve_to,
+	.close_path = _svg_soft_close_path,
+	/* style */
+	.set_color = _svg_soft_set_color,
+	.set_fill_opacity = _svg_soft_set_fill_opacity,
+	.set_fill_paint = _svg_soft_set_fill_paint,
+	.set_fill_rule = _svg_soft_set_fill_rule,
+	.set_font_size = _svg_soft_set_font_size,
+	.set_opacity = _svg_soft_set_opacity,
+	.set_stroke_dash_array = _svg_soft_set_stroke_dash_array,
+	.set_stroke_dash_offset = _svg_soft_set_stroke_dash_offset,
+	.set_stroke_line_cap = _svg_soft_set_stroke_line_cap,
+	.set_stroke_line_join = _svg_soft_set_stroke_line_join,
+	.set_stroke_miter_limit = _svg_soft_set_stroke_miter_limit,
+	.set_stroke_opacity = _svg_soft_set_stroke_opacity,
+	.set_stroke_paint = _svg_soft_set_stroke_paint,
+	.set_stroke_width = _svg_soft_set_stroke_width,
+	/* transform */
+	.apply_clip_box = _svg_soft_apply_clip_box,
+	.transform = _svg_soft_transform,
+	.apply_view_box = _svg_soft_apply_view_box,
+	.set_viewport_dimension = _svg_soft_set_viewport_dimension,
+	/* drawing */
+	.render_line = _svg_soft_render_line,
+	.render_path = _svg_soft_render_path,
+	.render_ellipse = _svg_soft_render_ellipse,
+	.render_rect = _svg_soft_render_rect,
+	.render_text = _svg_soft_render_text,
+	.render_image = _svg_soft_render_image,
+	.get_last_bounding_box = _svg_soft_get_last_bounding_box
+};
+
+svg_soft_t *svgSoftCreate(svg_t *svg) {
+	svg_soft_t *svg_soft;
+
+	svg_soft = (svg_soft_t *)malloc (sizeof (svg_soft_t));
+	if (svg_soft == NULL)
+		return NULL;
+
+	svg_soft->svg = svg;
+	memset(&svg_soft->surface, 0, sizeof(svg_soft->surface));
+
+	svg_soft->states = NULL;
+	svg_soft->num_states = 0;
+	svg_soft->states_size = 0;
+	svg_soft->state = NULL;
+
+	svg_polyline_init (&svg_soft->path);
+	svg_polyline_init (&svg_soft->stroke);
+	svg_stroker_init (&svg_soft->stroker);
+	_svg_soft_rasterizer_init (&svg_soft->rasterizer);
+	_svg_soft_gradient_cache_init (svg_soft);
+
+	return svg_soft;
+}
+
+void svgSoftDestroy(svg_soft_t *svg_soft) {
+	int k;
+
+	while(svg_soft->num_states)
+		_svg_soft_pop_state (svg_soft);
+	for(k = 0; k < svg_soft->states_size; k++)
+		free (svg_soft->states[k]);
+	free (svg_soft->states);
+
+	svg_polyline_deinit (&svg_soft->path);
+	svg_polyline_deinit (&svg_soft->stroke);
+	svg_stroker_deinit (&svg_soft->stroker);
+	_svg_soft_rasterizer_deinit (&svg_soft->rasterizer);
+
+	free (svg_soft);
+}
+
+/* The new state starts out as a copy of its parent. The dash array
+ * is shared with the parent until the element sets one of its own.
+ */
+svg_status_t
+_svg_soft_push_state (svg_soft_t *svg_soft)
+{
+	svg_soft_state_t *state;
+
+	if(svg_soft->num_states == svg_soft->states_size) {
+		int new_size = svg_soft->states_size ? 2 * svg_soft->states_size : 16;
+		svg_soft_state_t **new_states =
+			realloc(svg_soft->states, new_size * sizeof(svg_soft_state_t *));
+
+		if(new_states == NULL)
+			return SVG_STATUS_NO_MEMORY;
+
+		memset(new_states + svg_soft->states_size, 0,
+		       (new_size - svg_soft->states_size) * sizeof(svg_soft_state_t *));
+		svg_soft->states = new_states;
+		svg_soft->states_size = new_size;
+	}
+
+	state = svg_soft->states[svg_soft->num_states];
+	if(state == NULL) {
+		state = malloc(sizeof(svg_soft_state_t));
+		if(state == NULL)
+			return SVG_STATUS_NO_MEMORY;
+		svg_soft->states[svg_soft->num_states] = state;
+	}
+
+	if(svg_soft->num_states) {
+		*state = *svg_soft->state;
+	} else {
+		memset(state, 0, sizeof(svg_soft_state_t));
+
+		_svg_soft_ctm_init_identity (&state->ctm);
+		state->clip_x1 = 0;
+		state->clip_y1 = 0;
+		state->clip_x2 = svg_soft->surface.width;
+		state->clip_y2 = svg_soft->surface.height;
+
+		state->fill_opacity = 1.0;
+		state->stroke_opacity = 1.0;
+		state->opacity = 1.0;
+		state->fill_rule = SVG_FILL_RULE_NONZERO;
+		state->stroke_width = 1.0;
+		state->line_cap = SVG_STROKE_LINE_CAP_BUTT;
+		state->line_join = SVG_STROKE_LINE_JOIN_MITER;
+		state->miter_limit = 4.0;
+		state->font_size = 1.0;
+		state->viewport_width = svg_soft->surface.width;
+		state->viewport_height = svg_soft->surface.height;
+	}
+
+	state->owns_dash = 0;
+	state->layer = NULL;
+	state->layer_opacity = 1.0;
+	state->bbox = 0;
+
+	svg_soft->state = state;
+	svg_soft->num_states++;
+
+	return SVG_STATUS_SUCCESS;
+}
+
+svg_status_t
+_svg_soft_pop_state (svg_soft_t *svg_soft)
+{
+	svg_soft_state_t *state = svg_soft->state;
+
+	if(svg_soft->num_states == 0)
+		return SVG_STATUS_INVALID_CALL;
+
+	if(state->layer)
+		_svg_soft_layer_end (svg_soft);
+
+	if(state->owns_dash)
+		free(state->dash);
+
+	svg_soft->num_states--;
+	svg_soft->state = svg_soft->num_states ? svg_soft->states[svg_soft->num_states - 1] : NULL;
+
+	return SVG_STATUS_SUCCESS;
+}
+
+svg_status_t svgSoftRender(svg_soft_t *svg_soft,
+			   unsigned char *pixels,
+			   int width, int height, int stride) {
+	svg_status_t status, return_status;
+
+	if(pixels == NULL || width <= 0 || height <= 0 || stride < 4 * width)
+		return SVG_STATUS_INVALID_VALUE;
+
+	svg_soft->surface.pixels = pixels;
+	svg_soft->surface.origin_x = 0;
+	svg_soft->surface.origin_y = 0;
+	svg_soft->surface.width = width;
+	svg_soft->surface.height = height;
+	svg_soft->surface.stride = stride;
+
+	status = _svg_soft_push_state (svg_soft);
+	if(status)
+		return status;
+
+	return_status = svg_render_with_engine (svg_soft->svg, &SVG_SOFT_RENDER_ENGINE, svg_soft);
+
+	// a failed render may leave states behind
+	while(svg_soft->num_states)
+		_svg_soft_pop_state (svg_soft);
+
+	svg_polyline_clear (&svg_soft->path);
+	memset(&svg_soft->surface, 0, sizeof(svg_soft->surface));
+
+	return return_status;
+}
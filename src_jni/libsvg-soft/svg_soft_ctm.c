@@ -0,0 +1,96 @@
+/* libsvg-soft - Render SVG documents into RGBA pixel buffers
+ *
+ * Copyright © 2016 Anton Persson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy (COPYING.LESSER) of the
+ * GNU Lesser General Public License along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Anton Persson {don d0t juanton 4t gmail d0t com}
+ *
+ */
+
+#include <math.h>
+
+#include "svg-soft-internal.h"
+
+void _svg_soft_ctm_init_identity (svg_soft_ctm_t *ctm)
+{
+	ctm->xx = 1.0; ctm->yx = 0.0;
+	ctm->xy = 0.0; ctm->yy = 1.0;
+	ctm->x0 = 0.0; ctm->y0 = 0.0;
+}
+
+/* other is applied first */
+void _svg_soft_ctm_multiply (svg_soft_ctm_t *ctm, const svg_soft_ctm_t *other)
+{
+	svg_soft_ctm_t r;
+
+	r.xx = ctm->xx * other->xx + ctm->xy * other->yx;
+	r.yx = ctm->yx * other->xx + ctm->yy * other->yx;
+	r.xy = ctm->xx * other->xy + ctm->xy * other->yy;
+	r.yy = ctm->yx * other->xy + ctm->yy * other->yy;
+	r.x0 = ctm->xx * other->x0 + ctm->xy * other->y0 + ctm->x0;
+	r.y0 = ctm->yx * other->x0 + ctm->yy * other->y0 + ctm->y0;
+
+	*ctm = r;
+}
+
+/* returns non-zero if the matrix is singular, it is left alone then */
+int _svg_soft_ctm_invert (svg_soft_ctm_t *ctm)
+{
+	svg_soft_ctm_t r;
+	double det = ctm->xx * ctm->yy - ctm->yx * ctm->xy;
+
+	if(det == 0.0 || !isfinite(det))
+		return -1;
+
+	r.xx = ctm->yy / det;
+	r.yx = -ctm->yx / det;
+	r.xy = -ctm->xy / det;
+	r.yy = ctm->xx / det;
+	r.x0 = -(r.xx * ctm->x0 + r.xy * ctm->y0);
+	r.y0 = -(r.yx * ctm->x0 + r.yy * ctm->y0);
+
+	*ctm = r;
+	return 0;
+}
+
+/* the largest factor a user space length is scaled by */
+double _svg_soft_ctm_scale (const svg_soft_ctm_t *ctm)
+{
+	double sx = sqrt(ctm->xx * ctm->xx + ctm->yx * ctm->yx);
+	double sy = sqrt(ctm->xy * ctm->xy + ctm->yy * ctm->yy);
+
+	return sx > sy ? sx : sy;
+}
+
+void _svg_soft_ctm_transform_extents (const svg_soft_ctm_t *ctm,
+				      double *x1, double *y1,
+				      double *x2, double *y2)
+{
+	double px[4] = {*x1, *x2, *x2, *x1};
+	double py[4] = {*y1, *y1, *y2, *y2};
+	double tx, ty;
+	int k;
+
+	for(k = 0; k < 4; k++) {
+		tx = ctm->xx * px[k] + ctm->xy * py[k] + ctm->x0;
+		ty = ctm->yx * px[k] + ctm->yy * py[k] + ctm->y0;
+
+		if(k == 0 || tx < *x1) *x1 = tx;
+		if(k == 0 || ty < *y1) *y1 = ty;
+		if(k == 0 || tx > *x2) *x2 = tx;
+		if(k == 0 || ty > *y2) *y2 = ty;
+	}
+}
@@ -0,0 +1,585 @@
+/* libsvg-soft - Render SVG documents into RGBA pixel buffers
+ *
+ * Copyright © 2016 Anton Persson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy (COPYING.LESSER) of the
+ * GNU Lesser General Public License along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Anton Persson {don d0t juanton 4t gmail d0t com}
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "svg-soft-internal.h"
+
+/* x / 255 for x in 0 - 255 * 255, rounded */
+#define DIV255(x) (((x) + 128 + (((x) + 128) >> 8)) >> 8)
+
+/* Gradients are looked up in a table of 256 premultiplied colors. The
+ * table only depends on the stops, so it is kept per gradient and
+ * rebuilt when the document changes.
+ */
+
+void
+_svg_soft_gradient_cache_init (svg_soft_t *svg_soft)
+{
+	memset(svg_soft->gradient_cache, 0, sizeof(svg_soft->gradient_cache));
+	svg_soft->gradient_clock = 0;
+}
+
+static void
+_svg_soft_gradient_fill_lut (svg_gradient_t *gradient, unsigned char *lut)
+{
+	svg_gradient_stop_t *stops = gradient->stops;
+	int i, k = 0;
+
+	for(i = 0; i < 256; i++) {
+		double t = i / 255.0, f, c[4], a;
+		svg_gradient_stop_t *s0, *s1;
+
+		while(k < gradient->num_stops - 1 && stops[k + 1].offset <= t)
+			k++;
+
+		s0 = &stops[k];
+		s1 = k < gradient->num_stops - 1 ? &stops[k + 1] : s0;
+
+		if(t <= s0->offset || s1 == s0 || s1->offset <= s0->offset)
+			f = t <= s0->offset ? 0.0 : 1.0;
+		else
+			f = (t - s0->offset) / (s1->offset - s0->offset);
+
+		if(f == 1.0) s0 = s1;
+
+		c[0] = svg_color_get_red (&s0->color) +
+			f * ((double)svg_color_get_red (&s1->color) - svg_color_get_red (&s0->color));
+		c[1] = svg_color_get_green (&s0->color) +
+			f * ((double)svg_color_get_green (&s1->color) - svg_color_get_green (&s0->color));
+		c[2] = svg_color_get_blue (&s0->color) +
+			f * ((double)svg_color_get_blue (&s1->color) - svg_color_get_blue (&s0->color));
+		a = (s0->opacity + f * (s1->opacity - s0->opacity)) * 255.0;
+		if(a < 0.0) a = 0.0;
+		if(a > 255.0) a = 255.0;
+
+		lut[4 * i + 0] = (unsigned char)(c[0] * a / 255.0 + 0.5);
+		lut[4 * i + 1] = (unsigned char)(c[1] * a / 255.0 + 0.5);
+		lut[4 * i + 2] = (unsigned char)(c[2] * a / 255.0 + 0.5);
+		lut[4 * i + 3] = (unsigned char)(a + 0.5);
+	}
+}
+
+static const unsigned char *
+_svg_soft_gradient_lut (svg_soft_t *svg_soft, svg_gradient_t *gradient)
+{
+	svg_soft_gradient_cache_entry_t *entry, *oldest = NULL;
+	unsigned int generation = svg_content_generation (svg_soft->svg);
+	int k;
+
+	for(k = 0; k < SVG_SOFT_GRADIENT_CACHE_SIZE; k++) {
+		entry = &svg_soft->gradient_cache[k];
+
+		if(entry->gradient == gradient && entry->generation == generation) {
+			entry->last_used = ++svg_soft->gradient_clock;
+			return entry->lut;
+		}
+
+		if(oldest == NULL || entry->last_used < oldest->last_used)
+			oldest = entry;
+	}
+
+	_svg_soft_gradient_fill_lut (gradient, oldest->lut);
+	oldest->gradient = gradient;
+	oldest->generation = generation;
+	oldest->last_used = ++svg_soft->gradient_clock;
+
+	return oldest->lut;
+}
+
+static void
+_svg_soft_paint_solid (svg_soft_paint_t *paint, const svg_color_t *color, double opacity)
+{
+	paint->type = SVG_SOFT_PAINT_SOLID;
+	paint->color[0] = svg_color_get_red (color);
+	paint->color[1] = svg_color_get_green (color);
+	paint->color[2] = svg_color_get_blue (color);
+	paint->color[3] = 255;
+	paint->alpha = (unsigned int)(opacity * 256.0 + 0.5);
+}
+
+static svg_status_t
+_svg_soft_paint_gradient (svg_soft_t *svg_soft, svg_soft_paint_t *paint,
+			  svg_gradient_t *gradient, double opacity)
+{
+	svg_soft_state_t *state = svg_soft->state;
+	svg_soft_ctm_t matrix, transform;
+
+	if(gradient->num_stops == 0)
+		return SVG_STATUS_SUCCESS; // paints nothing
+
+	if(gradient->num_stops == 1) {
+		_svg_soft_paint_solid (paint, &gradient->stops[0].color, opacity * gradient->stops[0].opacity);
+		return SVG_STATUS_SUCCESS;
+	}
+
+	matrix = state->ctm;
+
+	if(gradient->units == SVG_GRADIENT_UNITS_BBOX) {
+		svg_soft_ctm_t bbox = {svg_soft->shape_x2 - svg_soft->shape_x1, 0.0,
+				       0.0, svg_soft->shape_y2 - svg_soft->shape_y1,
+				       svg_soft->shape_x1, svg_soft->shape_y1};
+
+		_svg_soft_ctm_multiply (&matrix, &bbox);
+		state->bbox = 1;
+	}
+
+	transform.xx = gradient->transform[0]; transform.yx = gradient->transform[1];
+	transform.xy = gradient->transform[2]; transform.yy = gradient->transform[3];
+	transform.x0 = gradient->transform[4]; transform.y0 = gradient->transform[5];
+	_svg_soft_ctm_multiply (&matrix, &transform);
+
+	switch (gradient->type) {
+	case SVG_GRADIENT_LINEAR:
+	{
+		double x2, y2, length2;
+
+		_svg_soft_length_to_pixel (svg_soft, &gradient->u.linear.x1, &paint->x1);
+		_svg_soft_length_to_pixel (svg_soft, &gradient->u.linear.y1, &paint->y1);
+		_svg_soft_length_to_pixel (svg_soft, &gradient->u.linear.x2, &x2);
+		_svg_soft_length_to_pixel (svg_soft, &gradient->u.linear.y2, &y2);
+
+		length2 = (x2 - paint->x1) * (x2 - paint->x1) + (y2 - paint->y1) * (y2 - paint->y1);
+		paint->dx = length2 > 0.0 ? (x2 - paint->x1) / length2 : 0.0;
+		paint->dy = length2 > 0.0 ? (y2 - paint->y1) / length2 : 0.0;
+		paint->type = SVG_SOFT_PAINT_LINEAR;
+	} break;
+	case SVG_GRADIENT_RADIAL:
+	{
+		double fdx, fdy, fd;
+
+		_svg_soft_length_to_pixel (svg_soft, &gradient->u.radial.cx, &paint->cx);
+		_svg_soft_length_to_pixel (svg_soft, &gradient->u.radial.cy, &paint->cy);
+		_svg_soft_length_to_pixel (svg_soft, &gradient->u.radial.r, &paint->r);
+		_svg_soft_length_to_pixel (svg_soft, &gradient->u.radial.fx, &paint->fx);
+		_svg_soft_length_to_pixel (svg_soft, &gradient->u.radial.fy, &paint->fy);
+
+		// a focal point on or outside the circle is moved just inside it
+		fdx = paint->fx - paint->cx;
+		fdy = paint->fy - paint->cy;
+		fd = sqrt(fdx * fdx + fdy * fdy);
+		if(fd > paint->r * 0.99) {
+			paint->fx = paint->cx + fdx * paint->r * 0.99 / fd;
+			paint->fy = paint->cy + fdy * paint->r * 0.99 / fd;
+		}
+		paint->type = SVG_SOFT_PAINT_RADIAL;
+	} break;
+	}
+
+	state->bbox = 0;
+
+	paint->inverse = matrix;
+	if(_svg_soft_ctm_invert (&paint->inverse)) {
+		paint->type = SVG_SOFT_PAINT_NONE;
+		return SVG_STATUS_SUCCESS;
+	}
+
+	paint->lut = _svg_soft_gradient_lut (svg_soft, gradient);
+	paint->spread = gradient->spread;
+	paint->alpha = (unsigned int)(opacity * 256.0 + 0.5);
+
+	return SVG_STATUS_SUCCESS;
+}
+
+void
+_svg_soft_paint_texture (svg_soft_t *svg_soft, svg_soft_paint_t *paint,
+			 const unsigned char *data, int width, int height,
+			 const svg_soft_ctm_t *texture_to_user, double opacity)
+{
+	svg_soft_ctm_t matrix = svg_soft->state->ctm;
+
+	_svg_soft_ctm_multiply (&matrix, texture_to_user);
+
+	paint->inverse = matrix;
+	if(_svg_soft_ctm_invert (&paint->inverse))
+		return;
+
+	paint->type = SVG_SOFT_PAINT_TEXTURE;
+	paint->texture = data;
+	paint->texture_width = width;
+	paint->texture_height = height;
+	paint->texture_stride = 4 * width;
+	paint->alpha = (unsigned int)(opacity * 256.0 + 0.5);
+}
+
+/* Render the pattern content into a tile at device resolution, with a
+ * fresh state of its own on top of the stack. */
+static svg_status_t
+_svg_soft_paint_pattern (svg_soft_t *svg_soft, svg_soft_paint_t *paint,
+			 svg_element_t *pattern_element, double opacity)
+{
+	svg_pattern_t *pattern = svg_element_pattern (pattern_element);
+	svg_soft_state_t *state = svg_soft->state;
+	svg_soft_surface_t saved_surface = svg_soft->surface;
+	svg_polyline_t saved_path = svg_soft->path;
+	double saved_points[4] = {svg_soft->last_x, svg_soft->last_y,
+				  svg_soft->start_x, svg_soft->start_y};
+	double saved_shape[4] = {svg_soft->shape_x1, svg_soft->shape_y1,
+				 svg_soft->shape_x2, svg_soft->shape_y2};
+	svg_soft_ctm_t tile_to_user;
+	double x_px, y_px, width_px, height_px;
+	double scale, tile_w, tile_h;
+	unsigned char *tile;
+	svg_status_t status;
+
+	_svg_soft_length_to_pixel (svg_soft, &pattern->x, &x_px);
+	_svg_soft_length_to_pixel (svg_soft, &pattern->y, &y_px);
+	_svg_soft_length_to_pixel (svg_soft, &pattern->width, &width_px);
+	_svg_soft_length_to_pixel (svg_soft, &pattern->height, &height_px);
+
+	if(width_px <= 0.0 || height_px <= 0.0)
+		return SVG_STATUS_SUCCESS; // an empty tile disables the paint
+
+	scale = _svg_soft_ctm_scale (&state->ctm);
+	tile_w = ceil(width_px * scale);
+	tile_h = ceil(height_px * scale);
+	if(tile_w < 1.0) tile_w = 1.0;
+	if(tile_h < 1.0) tile_h = 1.0;
+	if(tile_w > SVG_SOFT_PATTERN_MAX_TILE) tile_w = SVG_SOFT_PATTERN_MAX_TILE;
+	if(tile_h > SVG_SOFT_PATTERN_MAX_TILE) tile_h = SVG_SOFT_PATTERN_MAX_TILE;
+
+	tile = calloc((size_t)tile_w * (size_t)tile_h, 4);
+	if(tile == NULL)
+		return SVG_STATUS_NO_MEMORY;
+
+	status = _svg_soft_push_state (svg_soft);
+	if(status) {
+		free(tile);
+		return status;
+	}
+
+	// the content gets a path of its own, ours is painted when we return
+	svg_polyline_init (&svg_soft->path);
+
+	svg_soft->surface.pixels = tile;
+	svg_soft->surface.origin_x = 0;
+	svg_soft->surface.origin_y = 0;
+	svg_soft->surface.width = (int)tile_w;
+	svg_soft->surface.height = (int)tile_h;
+	svg_soft->surface.stride = 4 * (int)tile_w;
+
+	state = svg_soft->state;
+	state->ctm.xx = tile_w / width_px; state->ctm.yx = 0.0;
+	state->ctm.xy = 0.0; state->ctm.yy = tile_h / height_px;
+	state->ctm.x0 = 0.0; state->ctm.y0 = 0.0;
+	state->clip_x1 = 0;
+	state->clip_y1 = 0;
+	state->clip_x2 = (int)tile_w;
+	state->clip_y2 = (int)tile_h;
+	state->fill_paint.type = SVG_PAINT_TYPE_NONE;
+	state->stroke_paint.type = SVG_PAINT_TYPE_NONE;
+
+	status = svg_element_render (pattern->group_element, &SVG_SOFT_RENDER_ENGINE, svg_soft);
+
+	_svg_soft_pop_state (svg_soft);
+	svg_soft->surface = saved_surface;
+
+	svg_polyline_deinit (&svg_soft->path);
+	svg_soft->path = saved_path;
+	svg_soft->last_x = saved_points[0]; svg_soft->last_y = saved_points[1];
+	svg_soft->start_x = saved_points[2]; svg_soft->start_y = saved_points[3];
+	svg_soft->shape_x1 = saved_shape[0]; svg_soft->shape_y1 = saved_shape[1];
+	svg_soft->shape_x2 = saved_shape[2]; svg_soft->shape_y2 = saved_shape[3];
+
+	if(status) {
+		free(tile);
+		return status;
+	}
+
+	tile_to_user.xx = pattern->transform[0]; tile_to_user.yx = pattern->transform[1];
+	tile_to_user.xy = pattern->transform[2]; tile_to_user.yy = pattern->transform[3];
+	tile_to_user.x0 = pattern->transform[4]; tile_to_user.y0 = pattern->transform[5];
+	{
+		svg_soft_ctm_t place = {width_px / tile_w, 0.0, 0.0, height_px / tile_h, x_px, y_px};
+		_svg_soft_ctm_multiply (&tile_to_user, &place);
+	}
+
+	_svg_soft_paint_texture (svg_soft, paint, tile, (int)tile_w, (int)tile_h, &tile_to_user, opacity);
+	paint->texture_repeat = 1;
+	paint->owned_texture = tile;
+
+	return SVG_STATUS_SUCCESS;
+}
+
+svg_status_t
+_svg_soft_paint_init (svg_soft_t *svg_soft, svg_soft_paint_t *paint,
+		      const svg_paint_t *svg_paint, double opacity)
+{
+	const svg_color_t *color;
+
+	memset(paint, 0, sizeof(svg_soft_paint_t));
+	paint->type = SVG_SOFT_PAINT_NONE;
+
+	opacity *= svg_soft->state->opacity;
+
+	switch (svg_paint->type) {
+	case SVG_PAINT_TYPE_NONE:
+		break;
+	case SVG_PAINT_TYPE_COLOR:
+		color = &svg_paint->p.color;
+		if (color->is_current_color)
+			color = &svg_soft->state->color;
+		_svg_soft_paint_solid (paint, color, opacity);
+		break;
+	case SVG_PAINT_TYPE_GRADIENT:
+		return _svg_soft_paint_gradient (svg_soft, paint, svg_paint->p.gradient, opacity);
+	case SVG_PAINT_TYPE_PATTERN:
+		return _svg_soft_paint_pattern (svg_soft, paint, svg_paint->p.pattern_element, opacity);
+	}
+
+	return SVG_STATUS_SUCCESS;
+}
+
+void
+_svg_soft_paint_fini (svg_soft_paint_t *paint)
+{
+	free(paint->owned_texture);
+	paint->owned_texture = NULL;
+	paint->type = SVG_SOFT_PAINT_NONE;
+}
+
+static int
+_svg_soft_spread (svg_gradient_spread_t spread, double t)
+{
+	switch(spread) {
+	case SVG_GRADIENT_SPREAD_REPEAT:
+		t = t - floor(t);
+		break;
+	case SVG_GRADIENT_SPREAD_REFLECT:
+		t = fmod(fabs(t), 2.0);
+		if(t > 1.0)
+			t = 2.0 - t;
+		break;
+	case SVG_GRADIENT_SPREAD_PAD:
+	default:
+		if(t < 0.0) t = 0.0;
+		if(t > 1.0) t = 1.0;
+		break;
+	}
+
+	return (int)(t * 255.0 + 0.5);
+}
+
+static int
+_svg_soft_wrap (int v, int size, int repeat)
+{
+	if(repeat) {
+		v %= size;
+		return v < 0 ? v + size : v;
+	}
+
+	return v < 0 ? 0 : (v >= size ? size - 1 : v);
+}
+
+/* bilinear sample at texture pixel (u, v), pixel centers at .5 */
+static void
+_svg_soft_sample (const svg_soft_paint_t *paint, double u, double v, unsigned char *rgba)
+{
+	double fu = u - 0.5, fv = v - 0.5;
+	int x0 = (int)floor(fu), y0 = (int)floor(fv);
+	int wx = (int)((fu - x0) * 256.0), wy = (int)((fv - y0) * 256.0);
+	int xa = _svg_soft_wrap (x0, paint->texture_width, paint->texture_repeat);
+	int xb = _svg_soft_wrap (x0 + 1, paint->texture_width, paint->texture_repeat);
+	int ya = _svg_soft_wrap (y0, paint->texture_height, paint->texture_repeat);
+	int yb = _svg_soft_wrap (y0 + 1, paint->texture_height, paint->texture_repeat);
+	const unsigned char *p00 = paint->texture + ya * paint->texture_stride + 4 * xa;
+	const unsigned char *p01 = paint->texture + ya * paint->texture_stride + 4 * xb;
+	const unsigned char *p10 = paint->texture + yb * paint->texture_stride + 4 * xa;
+	const unsigned char *p11 = paint->texture + yb * paint->texture_stride + 4 * xb;
+	int c;
+
+	for(c = 0; c < 4; c++) {
+		int top = p00[c] * (256 - wx) + p01[c] * wx;
+		int bottom = p10[c] * (256 - wx) + p11[c] * wx;
+		rgba[c] = (top * (256 - wy) + bottom * wy) >> 16;
+	}
+
+	if(paint->texture_bgra) {
+		unsigned char blue = rgba[0];
+
+		rgba[0] = rgba[2];
+		rgba[2] = blue;
+	}
+}
+
+/* the premultiplied source color of device pixel (x, y) */
+static void
+_svg_soft_paint_color (const svg_soft_paint_t *paint, int x, int y, unsigned char *rgba)
+{
+	const svg_soft_ctm_t *m = &paint->inverse;
+	double px = x + 0.5, py = y + 0.5;
+	double u = m->xx * px + m->xy * py + m->x0;
+	double v = m->yx * px + m->yy * py + m->y0;
+	const unsigned char *c;
+	double t;
+
+	switch(paint->type) {
+	case SVG_SOFT_PAINT_LINEAR:
+		t = (u - paint->x1) * paint->dx + (v - paint->y1) * paint->dy;
+		c = &paint->lut[4 * _svg_soft_spread (paint->spread, t)];
+		break;
+	case SVG_SOFT_PAINT_RADIAL:
+	{
+		// t is where (u, v) lies on the line from the focus to the circle
+		double dx = u - paint->fx, dy = v - paint->fy;
+		double cfx = paint->cx - paint->fx, cfy = paint->cy - paint->fy;
+		double dd = dx * dx + dy * dy;
+		double dc = dx * cfx + dy * cfy;
+		double root = dc * dc + dd * (paint->r * paint->r - cfx * cfx - cfy * cfy);
+
+		t = (dd > 0.0 && root >= 0.0) ? dd / (dc + sqrt(root)) : 0.0;
+		c = &paint->lut[4 * _svg_soft_spread (paint->spread, t)];
+	} break;
+	case SVG_SOFT_PAINT_TEXTURE:
+		if(!paint->texture_repeat &&
+		   (u < 0.0 || v < 0.0 || u > paint->texture_width || v > paint->texture_height)) {
+			rgba[0] = rgba[1] = rgba[2] = rgba[3] = 0;
+			return;
+		}
+		_svg_soft_sample (paint, u, v, rgba);
+		return;
+	default:
+		c = paint->color;
+		break;
+	}
+
+	rgba[0] = c[0]; rgba[1] = c[1]; rgba[2] = c[2]; rgba[3] = c[3];
+}
+
+/* src over, src premultiplied and scaled by alpha (0 - 255) */
+static void
+_svg_soft_blend (unsigned char *dst, const unsigned char *src, unsigned int alpha)
+{
+	unsigned int sa = DIV255(src[3] * alpha);
+	unsigned int inv = 255 - sa;
+
+	dst[0] = DIV255(src[0] * alpha) + DIV255(dst[0] * inv);
+	dst[1] = DIV255(src[1] * alpha) + DIV255(dst[1] * inv);
+	dst[2] = DIV255(src[2] * alpha) + DIV255(dst[2] * inv);
+	dst[3] = sa + DIV255(dst[3] * inv);
+}
+
+void
+_svg_soft_paint_span (svg_soft_t *svg_soft, const svg_soft_paint_t *paint,
+		      int x, int y, int length, const unsigned char *covers)
+{
+	svg_soft_surface_t *surface = &svg_soft->surface;
+	unsigned char *dst;
+	unsigned char rgba[4];
+	int k;
+
+	dst = surface->pixels + (y - surface->origin_y) * surface->stride + 4 * (x - surface->origin_x);
+
+	for(k = 0; k < length; k++, dst += 4) {
+		unsigned int alpha = (covers[k] * paint->alpha) >> 8;
+
+		if(alpha == 0)
+			continue;
+
+		if(paint->type == SVG_SOFT_PAINT_SOLID) {
+			_svg_soft_blend (dst, paint->color, alpha);
+		} else {
+			_svg_soft_paint_color (paint, x + k, y, rgba);
+			_svg_soft_blend (dst, rgba, alpha);
+		}
+	}
+}
+
+/* Everything drawn until the state is popped goes to a cleared layer
+ * covering the current clip, which is then drawn with the opacity. When
+ * the extents of the group are known the clip is narrowed to them
+ * first, nothing of the group can land outside anyway. */
+svg_status_t
+_svg_soft_layer_begin (svg_soft_t *svg_soft, double opacity, const svg_rect_t *extents)
+{
+	svg_soft_state_t *state = svg_soft->state;
+	double x1, y1, x2, y2;
+	int width, height;
+
+	if(extents) {
+		if(extents->width < 0.0 || extents->height < 0.0)
+			return SVG_STATUS_SUCCESS; // the group draws nothing
+
+		x1 = extents->x; y1 = extents->y;
+		x2 = x1 + extents->width; y2 = y1 + extents->height;
+		_svg_soft_ctm_transform_extents (&state->ctm, &x1, &y1, &x2, &y2);
+
+		if(x1 > state->clip_x2 || y1 > state->clip_y2 ||
+		   x2 < state->clip_x1 || y2 < state->clip_y1)
+			return SVG_STATUS_SUCCESS; // all of it is clipped away
+
+		// a pixel more for the antialiased edges
+		if(floor(x1) - 1 > state->clip_x1) state->clip_x1 = (int)floor(x1) - 1;
+		if(floor(y1) - 1 > state->clip_y1) state->clip_y1 = (int)floor(y1) - 1;
+		if(ceil(x2) + 1 < state->clip_x2) state->clip_x2 = (int)ceil(x2) + 1;
+		if(ceil(y2) + 1 < state->clip_y2) state->clip_y2 = (int)ceil(y2) + 1;
+	}
+
+	width = state->clip_x2 - state->clip_x1;
+	height = state->clip_y2 - state->clip_y1;
+
+	if(width <= 0 || height <= 0)
+		return SVG_STATUS_SUCCESS; // nothing will show anyway
+
+	state->layer = calloc((size_t)width * (size_t)height, 4);
+	if(state->layer == NULL)
+		return SVG_STATUS_NO_MEMORY;
+
+	state->layer_opacity = opacity;
+	state->saved_surface = svg_soft->surface;
+
+	svg_soft->surface.pixels = state->layer;
+	svg_soft->surface.origin_x = state->clip_x1;
+	svg_soft->surface.origin_y = state->clip_y1;
+	svg_soft->surface.width = width;
+	svg_soft->surface.height = height;
+	svg_soft->surface.stride = 4 * width;
+
+	return SVG_STATUS_SUCCESS;
+}
+
+void
+_svg_soft_layer_end (svg_soft_t *svg_soft)
+{
+	svg_soft_state_t *state = svg_soft->state;
+	svg_soft_surface_t *layer = &svg_soft->surface;
+	svg_soft_surface_t *parent = &state->saved_surface;
+	unsigned int alpha = (unsigned int)(state->layer_opacity * 255.0 + 0.5);
+	int x, y;
+
+	for(y = 0; y < layer->height; y++) {
+		unsigned char *src = layer->pixels + y * layer->stride;
+		unsigned char *dst = parent->pixels +
+			(layer->origin_y + y - parent->origin_y) * parent->stride +
+			4 * (layer->origin_x - parent->origin_x);
+
+		for(x = 0; x < layer->width; x++, src += 4, dst += 4)
+			if(src[3])
+				_svg_soft_blend (dst, src, alpha);
+	}
+
+	svg_soft->surface = state->saved_surface;
+	free(state->layer);
+	state->layer = NULL;
+}
@@ -0,0 +1,652 @@
+/* libsvg-soft - Render SVG documents into RGBA pixel buffers
+ *
+ * Copyright © 2016 Anton Persson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy (COPYING.LESSER) of the
+ * GNU Lesser General Public License along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Anton Persson {don d0t juanton 4t gmail d0t com}
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "svg-soft-internal.h"
+
+/* Scanline polygon rasterizer with exact area coverage, the same
+ * scheme as the ones in FreeType and AGG. Every edge is walked through
+ * the pixels it crosses, leaving the covered height and area in a cell
+ * per pixel. The cells are then sorted and swept one scanline at a
+ * time, the running sum of the heights is the winding number of the
+ * area to the right of a cell.
+ *
+ * Coordinates are 24.8 fixed point from here on.
+ */
+
+#define SUBPIXEL_SHIFT	8
+#define SUBPIXEL_SCALE	(1 << SUBPIXEL_SHIFT)
+#define SUBPIXEL_MASK	(SUBPIXEL_SCALE - 1)
+
+/* edges longer than this are split, or the area products overflow */
+#define DX_LIMIT	(16384 << SUBPIXEL_SHIFT)
+
+void
+_svg_soft_rasterizer_init (svg_soft_rasterizer_t *rasterizer)
+{
+	memset(rasterizer, 0, sizeof(svg_soft_rasterizer_t));
+}
+
+void
+_svg_soft_rasterizer_deinit (svg_soft_rasterizer_t *rasterizer)
+{
+	free(rasterizer->cells);
+	free(rasterizer->covers);
+	_svg_soft_rasterizer_init (rasterizer);
+}
+
+void
+_svg_soft_rasterizer_reset (svg_soft_rasterizer_t *rasterizer,
+			    int clip_x1, int clip_y1, int clip_x2, int clip_y2)
+{
+	rasterizer->num_cells = 0;
+	rasterizer->cur.x = 0x7fffffff;
+	rasterizer->cur.y = 0x7fffffff;
+	rasterizer->cur.cover = 0;
+	rasterizer->cur.area = 0;
+
+	rasterizer->clip_x1 = clip_x1;
+	rasterizer->clip_y1 = clip_y1;
+	rasterizer->clip_x2 = clip_x2;
+	rasterizer->clip_y2 = clip_y2;
+
+	rasterizer->error = 0;
+}
+
+static void
+_svg_soft_add_cur_cell (svg_soft_rasterizer_t *rasterizer)
+{
+	if((rasterizer->cur.area | rasterizer->cur.cover) == 0)
+		return;
+
+	// cells outside the clip rows never make it to a scanline
+	if(rasterizer->cur.y < rasterizer->clip_y1 || rasterizer->cur.y >= rasterizer->clip_y2)
+		return;
+
+	if(rasterizer->num_cells == rasterizer->cells_size) {
+		int new_size = rasterizer->cells_size ? 2 * rasterizer->cells_size : 1024;
+		svg_soft_cell_t *new_cells =
+			realloc(rasterizer->cells, new_size * sizeof(svg_soft_cell_t));
+
+		if(new_cells == NULL) {
+			rasterizer->error = 1;
+			return;
+		}
+
+		rasterizer->cells = new_cells;
+		rasterizer->cells_size = new_size;
+	}
+
+	rasterizer->cells[rasterizer->num_cells++] = rasterizer->cur;
+}
+
+static void
+_svg_soft_set_cur_cell (svg_soft_rasterizer_t *rasterizer, int x, int y)
+{
+	if(rasterizer->cur.x != x || rasterizer->cur.y != y) {
+		_svg_soft_add_cur_cell (rasterizer);
+		rasterizer->cur.x = x;
+		rasterizer->cur.y = y;
+		rasterizer->cur.cover = 0;
+		rasterizer->cur.area = 0;
+	}
+}
+
+/* the part of an edge inside scanline ey, y1 and y2 are relative to it */
+static void
+_svg_soft_raster_hline (svg_soft_rasterizer_t *rasterizer,
+			int ey, int x1, int y1, int x2, int y2)
+{
+	int ex1 = x1 >> SUBPIXEL_SHIFT;
+	int ex2 = x2 >> SUBPIXEL_SHIFT;
+	int fx1 = x1 & SUBPIXEL_MASK;
+	int fx2 = x2 & SUBPIXEL_MASK;
+	int delta, p, first, dx, incr, lift, mod, rem;
+
+	// a horizontal edge has no cover, it only moves us along
+	if(y1 == y2) {
+		_svg_soft_set_cur_cell (rasterizer, ex2, ey);
+		return;
+	}
+
+	// all in a single cell
+	if(ex1 == ex2) {
+		delta = y2 - y1;
+		rasterizer->cur.cover += delta;
+		rasterizer->cur.area += (fx1 + fx2) * delta;
+		return;
+	}
+
+	// a run of adjacent cells on the same scanline
+	p = (SUBPIXEL_SCALE - fx1) * (y2 - y1);
+	first = SUBPIXEL_SCALE;
+	incr = 1;
+
+	dx = x2 - x1;
+
+	if(dx < 0) {
+		p = fx1 * (y2 - y1);
+		first = 0;
+		incr = -1;
+		dx = -dx;
+	}
+
+	delta = p / dx;
+	mod = p % dx;
+
+	if(mod < 0) {
+		delta--;
+		mod += dx;
+	}
+
+	rasterizer->cur.cover += delta;
+	rasterizer->cur.area += (fx1 + first) * delta;
+
+	ex1 += incr;
+	_svg_soft_set_cur_cell (rasterizer, ex1, ey);
+	y1 += delta;
+
+	if(ex1 != ex2) {
+		p = SUBPIXEL_SCALE * (y2 - y1 + delta);
+		lift = p / dx;
+		rem = p % dx;
+
+		if(rem < 0) {
+			lift--;
+			rem += dx;
+		}
+
+		mod -= dx;
+
+		while(ex1 != ex2) {
+			delta = lift;
+			mod += rem;
+			if(mod >= 0) {
+				mod -= dx;
+				delta++;
+			}
+
+			rasterizer->cur.cover += delta;
+			rasterizer->cur.area += SUBPIXEL_SCALE * delta;
+			y1 += delta;
+			ex1 += incr;
+			_svg_soft_set_cur_cell (rasterizer, ex1, ey);
+		}
+	}
+
+	delta = y2 - y1;
+	rasterizer->cur.cover += delta;
+	rasterizer->cur.area += (fx2 + SUBPIXEL_SCALE - first) * delta;
+}
+
+static void
+_svg_soft_raster_line (svg_soft_rasterizer_t *rasterizer, int x1, int y1, int x2, int y2)
+{
+	int ex1, ey1, ey2, fy1, fy2;
+	int dx, dy, x_from, x_to;
+	int p, rem, mod, lift, delta, first, incr;
+
+	dx = x2 - x1;
+
+	if(dx >= DX_LIMIT || dx <= -DX_LIMIT) {
+		int cx = (x1 + x2) >> 1;
+		int cy = (y1 + y2) >> 1;
+
+		_svg_soft_raster_line (rasterizer, x1, y1, cx, cy);
+		_svg_soft_raster_line (rasterizer, cx, cy, x2, y2);
+		return;
+	}
+
+	dy = y2 - y1;
+	ex1 = x1 >> SUBPIXEL_SHIFT;
+	ey1 = y1 >> SUBPIXEL_SHIFT;
+	ey2 = y2 >> SUBPIXEL_SHIFT;
+	fy1 = y1 & SUBPIXEL_MASK;
+	fy2 = y2 & SUBPIXEL_MASK;
+
+	_svg_soft_set_cur_cell (rasterizer, ex1, ey1);
+
+	// everything on a single scanline
+	if(ey1 == ey2) {
+		_svg_soft_raster_hline (rasterizer, ey1, x1, fy1, x2, fy2);
+		return;
+	}
+
+	incr = 1;
+
+	// vertical line, no need for hlines
+	if(dx == 0) {
+		int ex = x1 >> SUBPIXEL_SHIFT;
+		int two_fx = (x1 - (ex << SUBPIXEL_SHIFT)) << 1;
+		int area;
+
+		first = SUBPIXEL_SCALE;
+		if(dy < 0) {
+			first = 0;
+			incr = -1;
+		}
+
+		delta = first - fy1;
+		rasterizer->cur.cover += delta;
+		rasterizer->cur.area += two_fx * delta;
+
+		ey1 += incr;
+		_svg_soft_set_cur_cell (rasterizer, ex, ey1);
+
+		delta = first + first - SUBPIXEL_SCALE;
+		area = two_fx * delta;
+		while(ey1 != ey2) {
+			rasterizer->cur.cover = delta;
+			rasterizer->cur.area = area;
+			ey1 += incr;
+			_svg_soft_set_cur_cell (rasterizer, ex, ey1);
+		}
+
+		delta = fy2 - SUBPIXEL_SCALE + first;
+		rasterizer->cur.cover += delta;
+		rasterizer->cur.area += two_fx * delta;
+		return;
+	}
+
+	// several scanlines
+	p = (SUBPIXEL_SCALE - fy1) * dx;
+	first = SUBPIXEL_SCALE;
+
+	if(dy < 0) {
+		p = fy1 * dx;
+		first = 0;
+		incr = -1;
+		dy = -dy;
+	}
+
+	delta = p / dy;
+	mod = p % dy;
+
+	if(mod < 0) {
+		delta--;
+		mod += dy;
+	}
+
+	x_from = x1 + delta;
+	_svg_soft_raster_hline (rasterizer, ey1, x1, fy1, x_from, first);
+
+	ey1 += incr;
+	_svg_soft_set_cur_cell (rasterizer, x_from >> SUBPIXEL_SHIFT, ey1);
+
+	if(ey1 != ey2) {
+		p = SUBPIXEL_SCALE * dx;
+		lift = p / dy;
+		rem = p % dy;
+
+		if(rem < 0) {
+			lift--;
+			rem += dy;
+		}
+		mod -= dy;
+
+		while(ey1 != ey2) {
+			delta = lift;
+			mod += rem;
+			if(mod >= 0) {
+				mod -= dy;
+				delta++;
+			}
+
+			x_to = x_from + delta;
+			_svg_soft_raster_hline (rasterizer, ey1, x_from, SUBPIXEL_SCALE - first, x_to, first);
+			x_from = x_to;
+
+			ey1 += incr;
+			_svg_soft_set_cur_cell (rasterizer, x_from >> SUBPIXEL_SHIFT, ey1);
+		}
+	}
+
+	_svg_soft_raster_hline (rasterizer, ey1, x_from, SUBPIXEL_SCALE - first, x2, fy2);
+}
+
+static int
+_svg_soft_fixed (double v)
+{
+	return (int)floor(v * SUBPIXEL_SCALE + 0.5);
+}
+
+#ifdef LIBSVG_FIXED_POINT
+
+/* device coordinates further out than this are clamped, which keeps
+ * the products in the clipping below inside 64 bits */
+#define DEVICE_LIMIT	((int64_t)1 << 30)
+
+static int64_t
+_svg_soft_clamp (int64_t v)
+{
+	return v < -DEVICE_LIMIT ? -DEVICE_LIMIT : (v > DEVICE_LIMIT ? DEVICE_LIMIT : v);
+}
+
+/* _svg_soft_clip_line on 24.8 device coordinates, no floating point */
+static void
+_svg_soft_clip_line_fixed (svg_soft_rasterizer_t *rasterizer,
+			   int64_t x1, int64_t y1, int64_t x2, int64_t y2)
+{
+	int64_t cx1 = (int64_t)rasterizer->clip_x1 << SUBPIXEL_SHIFT;
+	int64_t cx2 = (int64_t)rasterizer->clip_x2 << SUBPIXEL_SHIFT;
+	int64_t cy1 = (int64_t)rasterizer->clip_y1 << SUBPIXEL_SHIFT;
+	int64_t cy2 = (int64_t)rasterizer->clip_y2 << SUBPIXEL_SHIFT;
+	int64_t px[4], py[4], border[2];
+	int n, k;
+
+	if(y1 == y2)
+		return; // no cover
+
+	if((y1 <= cy1 && y2 <= cy1) || (y1 >= cy2 && y2 >= cy2))
+		return;
+
+	if(y1 < cy1) { x1 += (x2 - x1) * (cy1 - y1) / (y2 - y1); y1 = cy1; }
+	else if(y1 > cy2) { x1 += (x2 - x1) * (cy2 - y1) / (y2 - y1); y1 = cy2; }
+	if(y2 < cy1) { x2 += (x1 - x2) * (cy1 - y2) / (y1 - y2); y2 = cy1; }
+	else if(y2 > cy2) { x2 += (x1 - x2) * (cy2 - y2) / (y1 - y2); y2 = cy2; }
+
+	// split where the edge crosses the left or right border, in the
+	// order the edge runs into them
+	n = 0;
+	px[n] = x1; py[n++] = y1;
+	border[0] = x2 > x1 ? cx1 : cx2;
+	border[1] = x2 > x1 ? cx2 : cx1;
+	for(k = 0; k < 2; k++) {
+		if((x1 < border[k] && border[k] < x2) || (x2 < border[k] && border[k] < x1)) {
+			px[n] = border[k];
+			py[n++] = y1 + (y2 - y1) * (border[k] - x1) / (x2 - x1);
+		}
+	}
+	px[n] = x2; py[n++] = y2;
+
+	for(k = 0; k < n; k++) {
+		if(px[k] < cx1) px[k] = cx1; else if(px[k] > cx2) px[k] = cx2;
+	}
+
+	for(k = 1; k < n; k++)
+		_svg_soft_raster_line (rasterizer, (int)px[k - 1], (int)py[k - 1], (int)px[k], (int)py[k]);
+}
+
+/* Every subpath is filled as if it was closed. The points are 16.16,
+ * the ctm is taken to 16.16 as well and maps them straight to 24.8.
+ */
+void
+_svg_soft_rasterizer_add_path (svg_soft_rasterizer_t *rasterizer,
+			       const svg_polyline_t *path,
+			       const svg_soft_ctm_t *ctm)
+{
+	const svg_polyline_point_t *p;
+	int64_t xx = svg_coord_from_double (ctm->xx), yx = svg_coord_from_double (ctm->yx);
+	int64_t xy = svg_coord_from_double (ctm->xy), yy = svg_coord_from_double (ctm->yy);
+	int64_t x0 = _svg_soft_fixed (ctm->x0), y0 = _svg_soft_fixed (ctm->y0);
+	int64_t x, y, px, py, sx, sy;
+	int s, k;
+
+#define TRANSFORM_X(p) _svg_soft_clamp (((xx * (p)->x + xy * (p)->y) >> (32 - SUBPIXEL_SHIFT)) + x0)
+#define TRANSFORM_Y(p) _svg_soft_clamp (((yx * (p)->x + yy * (p)->y) >> (32 - SUBPIXEL_SHIFT)) + y0)
+
+	for(s = 0; s < path->num_subpaths; s++) {
+		if(path->subpaths[s].count < 2)
+			continue;
+
+		p = &path->points[path->subpaths[s].first];
+
+		sx = px = TRANSFORM_X (p);
+		sy = py = TRANSFORM_Y (p);
+
+		for(k = 1; k < path->subpaths[s].count; k++) {
+			p++;
+			x = TRANSFORM_X (p);
+			y = TRANSFORM_Y (p);
+
+			_svg_soft_clip_line_fixed (rasterizer, px, py, x, y);
+			px = x; py = y;
+		}
+
+		_svg_soft_clip_line_fixed (rasterizer, px, py, sx, sy);
+	}
+
+#undef TRANSFORM_X
+#undef TRANSFORM_Y
+}
+
+#else /* LIBSVG_FIXED_POINT */
+
+/* Clip a device space edge to the clip rows and hand it on. The parts
+ * left or right of the clip are moved onto its border instead of being
+ * dropped, they still count for the winding of what is inside.
+ */
+static void
+_svg_soft_clip_line (svg_soft_rasterizer_t *rasterizer,
+		     double x1, double y1, double x2, double y2)
+{
+	double cx1 = rasterizer->clip_x1, cx2 = rasterizer->clip_x2;
+	double cy1 = rasterizer->clip_y1, cy2 = rasterizer->clip_y2;
+	double t[4], xa, ya, xb, yb;
+	int n, k, j;
+
+	if(y1 == y2)
+		return; // no cover
+
+	if((y1 <= cy1 && y2 <= cy1) || (y1 >= cy2 && y2 >= cy2))
+		return;
+
+	if(y1 < cy1) { x1 += (x2 - x1) * (cy1 - y1) / (y2 - y1); y1 = cy1; }
+	else if(y1 > cy2) { x1 += (x2 - x1) * (cy2 - y1) / (y2 - y1); y1 = cy2; }
+	if(y2 < cy1) { x2 += (x1 - x2) * (cy1 - y2) / (y1 - y2); y2 = cy1; }
+	else if(y2 > cy2) { x2 += (x1 - x2) * (cy2 - y2) / (y1 - y2); y2 = cy2; }
+
+	// split where the edge crosses the left or right border
+	n = 0;
+	t[n++] = 0.0;
+	if(x1 != x2) {
+		double tc1 = (cx1 - x1) / (x2 - x1);
+		double tc2 = (cx2 - x1) / (x2 - x1);
+
+		if(tc1 > 0.0 && tc1 < 1.0) t[n++] = tc1;
+		if(tc2 > 0.0 && tc2 < 1.0) t[n++] = tc2;
+		if(n == 3 && t[1] > t[2]) {
+			double tmp = t[1]; t[1] = t[2]; t[2] = tmp;
+		}
+	}
+	t[n++] = 1.0;
+
+	for(k = 0, j = 1; j < n; k++, j++) {
+		xa = x1 + (x2 - x1) * t[k]; ya = y1 + (y2 - y1) * t[k];
+		xb = x1 + (x2 - x1) * t[j]; yb = y1 + (y2 - y1) * t[j];
+
+		if(xa < cx1) xa = cx1; else if(xa > cx2) xa = cx2;
+		if(xb < cx1) xb = cx1; else if(xb > cx2) xb = cx2;
+
+		_svg_soft_raster_line (rasterizer,
+				       _svg_soft_fixed (xa), _svg_soft_fixed (ya),
+				       _svg_soft_fixed (xb), _svg_soft_fixed (yb));
+	}
+}
+
+/* every subpath is filled as if it was closed */
+void
+_svg_soft_rasterizer_add_path (svg_soft_rasterizer_t *rasterizer,
+			       const svg_polyline_t *path,
+			       const svg_soft_ctm_t *ctm)
+{
+	const svg_polyline_point_t *p;
+	double x, y, px, py, sx, sy;
+	int s, k;
+
+	for(s = 0; s < path->num_subpaths; s++) {
+		if(path->subpaths[s].count < 2)
+			continue;
+
+		p = &path->points[path->subpaths[s].first];
+
+		sx = px = ctm->xx * p->x + ctm->xy * p->y + ctm->x0;
+		sy = py = ctm->yx * p->x + ctm->yy * p->y + ctm->y0;
+
+		for(k = 1; k < path->subpaths[s].count; k++) {
+			p++;
+			x = ctm->xx * p->x + ctm->xy * p->y + ctm->x0;
+			y = ctm->yx * p->x + ctm->yy * p->y + ctm->y0;
+
+			_svg_soft_clip_line (rasterizer, px, py, x, y);
+			px = x; py = y;
+		}
+
+		_svg_soft_clip_line (rasterizer, px, py, sx, sy);
+	}
+}
+
+#endif /* LIBSVG_FIXED_POINT */
+
+static int
+_svg_soft_cell_compare (const void *a, const void *b)
+{
+	const svg_soft_cell_t *ca = a, *cb = b;
+
+	if(ca->y != cb->y)
+		return ca->y < cb->y ? -1 : 1;
+	if(ca->x != cb->x)
+		return ca->x < cb->x ? -1 : 1;
+	return 0;
+}
+
+static unsigned int
+_svg_soft_alpha (int area, svg_fill_rule_t fill_rule)
+{
+	int cover = area >> (SUBPIXEL_SHIFT * 2 + 1 - 8);
+
+	if(cover < 0)
+		cover = -cover;
+
+	if(fill_rule == SVG_FILL_RULE_EVEN_ODD) {
+		cover &= 511;
+		if(cover > 256)
+			cover = 512 - cover;
+	}
+
+	return cover > 255 ? 255 : cover;
+}
+
+/* sweep the cells and paint the covered spans, one scanline at a time */
+svg_status_t
+_svg_soft_rasterizer_fill (svg_soft_t *svg_soft,
+			   svg_fill_rule_t fill_rule,
+			   const svg_soft_paint_t *paint)
+{
+	svg_soft_rasterizer_t *rasterizer = &svg_soft->rasterizer;
+	svg_soft_cell_t *cell, *end, *row_end;
+	int width = rasterizer->clip_x2 - rasterizer->clip_x1;
+	unsigned int alpha;
+	int cover, area, x, y, span_x, span_end;
+
+	_svg_soft_add_cur_cell (rasterizer);
+	rasterizer->cur.x = rasterizer->cur.y = 0x7fffffff;
+	rasterizer->cur.cover = rasterizer->cur.area = 0;
+
+	if(rasterizer->error)
+		return SVG_STATUS_NO_MEMORY;
+
+	if(rasterizer->num_cells == 0 || width <= 0)
+		return SVG_STATUS_SUCCESS;
+
+	if(rasterizer->covers_size < width) {
+		unsigned char *covers = realloc(rasterizer->covers, width);
+
+		if(covers == NULL)
+			return SVG_STATUS_NO_MEMORY;
+
+		rasterizer->covers = covers;
+		rasterizer->covers_size = width;
+	}
+
+	qsort(rasterizer->cells, rasterizer->num_cells, sizeof(svg_soft_cell_t), _svg_soft_cell_compare);
+
+	cell = rasterizer->cells;
+	end = cell + rasterizer->num_cells;
+
+	while(cell < end) {
+		y = cell->y;
+		for(row_end = cell; row_end < end && row_end->y == y; row_end++)
+			;
+
+		cover = 0;
+		span_x = -1;
+		span_end = -1;
+
+		while(cell < row_end) {
+			x = cell->x;
+			area = cell->area;
+			cover += cell->cover;
+
+			// cells of the same pixel from different edges
+			for(cell++; cell < row_end && cell->x == x; cell++) {
+				area += cell->area;
+				cover += cell->cover;
+			}
+
+			if(x >= rasterizer->clip_x2)
+				break; // only the ones at the border are left
+
+			if(area) {
+				alpha = _svg_soft_alpha (cover * (2 * SUBPIXEL_SCALE) - area, fill_rule);
+				if(x >= rasterizer->clip_x1) {
+					if(span_x < 0)
+						span_x = x;
+					else if(span_end < x)
+						memset(&rasterizer->covers[span_end - rasterizer->clip_x1], 0, x - span_end);
+					rasterizer->covers[x - rasterizer->clip_x1] = alpha;
+					span_end = x + 1;
+				}
+				x++;
+			}
+
+			if(cell < row_end && cell->x > x) {
+				int run_end = cell->x < rasterizer->clip_x2 ? cell->x : rasterizer->clip_x2;
+
+				if(x < rasterizer->clip_x1)
+					x = rasterizer->clip_x1;
+
+				alpha = _svg_soft_alpha (cover * (2 * SUBPIXEL_SCALE), fill_rule);
+				if(alpha && x < run_end) {
+					if(span_x < 0)
+						span_x = x;
+					else if(span_end < x)
+						memset(&rasterizer->covers[span_end - rasterizer->clip_x1], 0, x - span_end);
+					memset(&rasterizer->covers[x - rasterizer->clip_x1], alpha, run_end - x);
+					span_end = run_end;
+				}
+			}
+		}
+		cell = row_end;
+
+		if(span_x >= 0)
+			_svg_soft_paint_span (svg_soft, paint, span_x, y, span_end - span_x,
+					      &rasterizer->covers[span_x - rasterizer->clip_x1]);
+	}
+
+	rasterizer->num_cells = 0;
+
+	return SVG_STATUS_SUCCESS;
+}
@@ -0,0 +1,709 @@
+/* libsvg-soft - Render SVG documents into RGBA pixel buffers
+ *
+ * Copyright © 2016 Anton Persson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy (COPYING.LESSER) of the
+ * GNU Lesser General Public License along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Anton Persson {don d0t juanton 4t gmail d0t com}
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "svg-soft-internal.h"
+
+svg_status_t
+_svg_soft_begin_group (void *closure, double opacity, const svg_rect_t *extents)
+{
+	svg_soft_t *svg_soft = closure;
+	svg_status_t status;
+
+	status = _svg_soft_push_state (svg_soft);
+	if (status)
+		return status;
+
+	// set_opacity follows with the same value, it must not apply it twice
+	svg_soft->state->layer_opacity = opacity;
+
+	if (opacity != 1.0)
+		return _svg_soft_layer_begin (svg_soft, opacity, extents);
+
+	return SVG_STATUS_SUCCESS;
+}
+
+svg_status_t
+_svg_soft_begin_element (void *closure, void *path_cache, unsigned int changes)
+{
+	svg_soft_t *svg_soft = closure;
+
+	// a state is just a struct copy here, no need to skip it for light elements
+	svg_polyline_clear (&svg_soft->path);
+
+	return _svg_soft_push_state (svg_soft);
+}
+
+svg_status_t
+_svg_soft_end_element (void *closure)
+{
+	svg_soft_t *svg_soft = closure;
+
+	svg_polyline_clear (&svg_soft->path);
+
+	return _svg_soft_pop_state (svg_soft);
+}
+
+svg_status_t
+_svg_soft_end_group (void *closure, double opacity)
+{
+	svg_soft_t *svg_soft = closure;
+
+	return _svg_soft_pop_state (svg_soft);
+}
+
+/* SVG_SOFT_TOLERANCE in user space, for flattening curves under the current ctm */
+static double
+_svg_soft_user_tolerance (svg_soft_t *svg_soft)
+{
+	double scale = _svg_soft_ctm_scale (&svg_soft->state->ctm);
+
+	return scale > 0.0 ? SVG_SOFT_TOLERANCE / scale : SVG_SOFT_TOLERANCE;
+}
+
+svg_status_t
+_svg_soft_move_to (void *closure, double x, double y)
+{
+	svg_soft_t *svg_soft = closure;
+
+	// the ctm stays the same until the path is painted
+	if (svg_soft->path.num_subpaths == 0)
+		svg_soft->path.tolerance = _svg_soft_user_tolerance (svg_soft);
+
+	svg_polyline_move_to (&svg_soft->path, x, y);
+	svg_soft->last_x = svg_soft->start_x = x;
+	svg_soft->last_y = svg_soft->start_y = y;
+
+	return svg_soft->path.error ? SVG_STATUS_NO_MEMORY : SVG_STATUS_SUCCESS;
+}
+
+svg_status_t
+_svg_soft_line_to (void *closure, double x, double y)
+{
+	svg_soft_t *svg_soft = closure;
+
+	svg_polyline_line_to (&svg_soft->path, x, y);
+	svg_soft->last_x = x;
+	svg_soft->last_y = y;
+
+	return svg_soft->path.error ? SVG_STATUS_NO_MEMORY : SVG_STATUS_SUCCESS;
+}
+
+svg_status_t
+_svg_soft_curve_to (void *closure,
+		    double x1, double y1,
+		    double x2, double y2,
+		    double x3, double y3)
+{
+	svg_soft_t *svg_soft = closure;
+
+	svg_polyline_curve_to (&svg_soft->path,
+				 svg_soft->last_x, svg_soft->last_y,
+				 x1, y1, x2, y2, x3, y3);
+	svg_soft->last_x = x3;
+	svg_soft->last_y = y3;
+
+	return svg_soft->path.error ? SVG_STATUS_NO_MEMORY : SVG_STATUS_SUCCESS;
+}
+
+svg_status_t
+_svg_soft_close_path (void *closure)
+{
+	svg_soft_t *svg_soft = closure;
+
+	svg_polyline_close_path (&svg_soft->path);
+	svg_soft->last_x = svg_soft->start_x;
+	svg_soft->last_y = svg_soft->start_y;
+
+	return svg_soft->path.error ? SVG_STATUS_NO_MEMORY : SVG_STATUS_SUCCESS;
+}
+
+svg_status_t
+_svg_soft_set_color (void *closure, const svg_color_t *color)
+{
+	svg_soft_t *svg_soft = closure;
+
+	svg_soft->state->color = *color;
+
+	return SVG_STATUS_SUCCESS;
+}
+
+svg_status_t
+_svg_soft_set_fill_opacity (void *closure, double fill_opacity)
+{
+	svg_soft_t *svg_soft = closure;
+
+	svg_soft->state->fill_opacity = fill_opacity;
+
+	return SVG_STATUS_SUCCESS;
+}
+
+svg_status_t
+_svg_soft_set_fill_paint (void *closure, const svg_paint_t *paint)
+{
+	svg_soft_t *svg_soft = closure;
+
+	svg_soft->state->fill_paint = *paint;
+
+	return SVG_STATUS_SUCCESS;
+}
+
+svg_status_t
+_svg_soft_set_fill_rule (void *closure, svg_fill_rule_t fill_rule)
+{
+	svg_soft_t *svg_soft = closure;
+
+	svg_soft->state->fill_rule = fill_rule;
+
+	return SVG_STATUS_SUCCESS;
+}
+
+svg_status_t
+_svg_soft_set_font_size (void *closure, double size)
+{
+	svg_soft_t *svg_soft = closure;
+
+	svg_soft->state->font_size = size;
+
+	return SVG_STATUS_SUCCESS;
+}
+
+svg_status_t
+_svg_soft_set_opacity (void *closure, double opacity)
+{
+	svg_soft_t *svg_soft = closure;
+
+	// a group draws through a layer with this opacity already
+	if (svg_soft->state->layer_opacity != 1.0)
+		return SVG_STATUS_SUCCESS;
+
+	svg_soft->state->opacity = opacity;
+
+	return SVG_STATUS_SUCCESS;
+}
+
+svg_status_t
+_svg_soft_set_stroke_dash_array (void *closure, double *dash, int num_dashes)
+{
+	svg_soft_t *svg_soft = closure;
+	svg_soft_state_t *state = svg_soft->state;
+	double *copy = NULL;
+
+	if (num_dashes) {
+		copy = malloc(num_dashes * sizeof(double));
+		if (copy == NULL)
+			return SVG_STATUS_NO_MEMORY;
+		memcpy(copy, dash, num_dashes * sizeof(double));
+	}
+
+	if (state->owns_dash)
+		free(state->dash);
+
+	state->dash = copy;
+	state->num_dashes = num_dashes;
+	state->owns_dash = 1;
+
+	return SVG_STATUS_SUCCESS;
+}
+
+svg_status_t
+_svg_soft_set_stroke_dash_offset (void *closure, svg_length_t *offset_len)
+{
+	svg_soft_t *svg_soft = closure;
+
+	return _svg_soft_length_to_pixel (svg_soft, offset_len, &svg_soft->state->dash_offset);
+}
+
+svg_status_t
+_svg_soft_set_stroke_line_cap (void *closure, svg_stroke_line_cap_t line_cap)
+{
+	svg_soft_t *svg_soft = closure;
+
+	svg_soft->state->line_cap = line_cap;
+
+	return SVG_STATUS_SUCCESS;
+}
+
+svg_status_t
+_svg_soft_set_stroke_line_join (void *closure, svg_stroke_line_join_t line_join)
+{
+	svg_soft_t *svg_soft = closure;
+
+	svg_soft->state->line_join = line_join;
+
+	return SVG_STATUS_SUCCESS;
+}
+
+svg_status_t
+_svg_soft_set_stroke_miter_limit (void *closure, double limit)
+{
+	svg_soft_t *svg_soft = closure;
+
+	svg_soft->state->miter_limit = limit;
+
+	return SVG_STATUS_SUCCESS;
+}
+
+svg_status_t
+_svg_soft_set_stroke_opacity (void *closure, double stroke_opacity)
+{
+	svg_soft_t *svg_soft = closure;
+
+	svg_soft->state->stroke_opacity = stroke_opacity;
+
+	return SVG_STATUS_SUCCESS;
+}
+
+svg_status_t
+_svg_soft_set_stroke_paint (void *closure, const svg_paint_t *paint)
+{
+	svg_soft_t *svg_soft = closure;
+
+	svg_soft->state->stroke_paint = *paint;
+
+	return SVG_STATUS_SUCCESS;
+}
+
+svg_status_t
+_svg_soft_set_stroke_width (void *closure, svg_length_t *width_len)
+{
+	svg_soft_t *svg_soft = closure;
+
+	return _svg_soft_length_to_pixel (svg_soft, width_len, &svg_soft->state->stroke_width);
+}
+
+/* The clip is kept as a device pixel rectangle, a rotated or skewed
+ * clip box is approximated by its device extents. */
+svg_status_t
+_svg_soft_apply_clip_box (void *closure,
+			  svg_length_t *x_l,
+			  svg_length_t *y_l,
+			  svg_length_t *width_l,
+			  svg_length_t *height_l)
+{
+	svg_soft_t *svg_soft = closure;
+	svg_soft_state_t *state = svg_soft->state;
+	double x1, y1, x2, y2;
+	int clip;
+
+	_svg_soft_length_to_pixel (svg_soft, x_l, &x1);
+	_svg_soft_length_to_pixel (svg_soft, y_l, &y1);
+	_svg_soft_length_to_pixel (svg_soft, width_l, &x2);
+	_svg_soft_length_to_pixel (svg_soft, height_l, &y2);
+
+	x2 += x1; y2 += y1;
+	_svg_soft_ctm_transform_extents (&state->ctm, &x1, &y1, &x2, &y2);
+
+	clip = (int)floor(x1 + 0.5);
+	if (clip > state->clip_x1) state->clip_x1 = clip;
+	clip = (int)floor(y1 + 0.5);
+	if (clip > state->clip_y1) state->clip_y1 = clip;
+	clip = (int)floor(x2 + 0.5);
+	if (clip < state->clip_x2) state->clip_x2 = clip;
+	clip = (int)floor(y2 + 0.5);
+	if (clip < state->clip_y2) state->clip_y2 = clip;
+
+	if (state->clip_x2 < state->clip_x1) state->clip_x2 = state->clip_x1;
+	if (state->clip_y2 < state->clip_y1) state->clip_y2 = state->clip_y1;
+
+	return SVG_STATUS_SUCCESS;
+}
+
+svg_status_t
+_svg_soft_transform (void *closure,
+		     double xx, double yx,
+		     double xy, double yy,
+		     double x0, double y0)
+{
+	svg_soft_t *svg_soft = closure;
+	svg_soft_ctm_t ctm = {xx, yx, xy, yy, x0, y0};
+
+	_svg_soft_ctm_multiply (&svg_soft->state->ctm, &ctm);
+
+	return SVG_STATUS_SUCCESS;
+}
+
+svg_status_t
+_svg_soft_apply_view_box (void *closure,
+			  svg_view_box_t view_box,
+			  svg_length_t *width,
+			  svg_length_t *height)
+{
+	svg_soft_t *svg_soft = closure;
+	svg_soft_ctm_t ctm;
+	double phys_width, phys_height;
+	double scale_x, scale_y;
+	double align_x = 0.0, align_y = 0.0;
+
+	_svg_soft_length_to_pixel (svg_soft, width, &phys_width);
+	_svg_soft_length_to_pixel (svg_soft, height, &phys_height);
+
+	if (view_box.box.width <= 0.0 || view_box.box.height <= 0.0)
+		return SVG_STATUS_SUCCESS;
+
+	scale_x = phys_width / view_box.box.width;
+	scale_y = phys_height / view_box.box.height;
+
+	if (view_box.aspect_ratio != SVG_PRESERVE_ASPECT_RATIO_NONE) {
+		if ((scale_x < scale_y) == (view_box.meet_or_slice == SVG_MEET_OR_SLICE_MEET))
+			scale_y = scale_x;
+		else
+			scale_x = scale_y;
+
+		switch (view_box.aspect_ratio) {
+		case SVG_PRESERVE_ASPECT_RATIO_XMIDYMIN:
+		case SVG_PRESERVE_ASPECT_RATIO_XMIDYMID:
+		case SVG_PRESERVE_ASPECT_RATIO_XMIDYMAX:
+			align_x = 0.5;
+			break;
+		case SVG_PRESERVE_ASPECT_RATIO_XMAXYMIN:
+		case SVG_PRESERVE_ASPECT_RATIO_XMAXYMID:
+		case SVG_PRESERVE_ASPECT_RATIO_XMAXYMAX:
+			align_x = 1.0;
+			break;
+		default:
+			break;
+		}
+
+		switch (view_box.aspect_ratio) {
+		case SVG_PRESERVE_ASPECT_RATIO_XMINYMID:
+		case SVG_PRESERVE_ASPECT_RATIO_XMIDYMID:
+		case SVG_PRESERVE_ASPECT_RATIO_XMAXYMID:
+			align_y = 0.5;
+			break;
+		case SVG_PRESERVE_ASPECT_RATIO_XMINYMAX:
+		case SVG_PRESERVE_ASPECT_RATIO_XMIDYMAX:
+		case SVG_PRESERVE_ASPECT_RATIO_XMAXYMAX:
+			align_y = 1.0;
+			break;
+		default:
+			break;
+		}
+	}
+
+	ctm.xx = scale_x; ctm.yx = 0.0;
+	ctm.xy = 0.0; ctm.yy = scale_y;
+	ctm.x0 = -view_box.box.x * scale_x + align_x * (phys_width - view_box.box.width * scale_x);
+	ctm.y0 = -view_box.box.y * scale_y + align_y * (phys_height - view_box.box.height * scale_y);
+
+	_svg_soft_ctm_multiply (&svg_soft->state->ctm, &ctm);
+
+	return SVG_STATUS_SUCCESS;
+}
+
+svg_status_t
+_svg_soft_set_viewport_dimension (void *closure,
+				  svg_length_t *width,
+				  svg_length_t *height)
+{
+	svg_soft_t *svg_soft = closure;
+	double vwidth, vheight;
+
+	_svg_soft_length_to_pixel (svg_soft, width, &vwidth);
+	_svg_soft_length_to_pixel (svg_soft, height, &vheight);
+
+	svg_soft->state->viewport_width = vwidth;
+	svg_soft->state->viewport_height = vheight;
+
+	return SVG_STATUS_SUCCESS;
+}
+
+static svg_status_t
+_svg_soft_fill_path (svg_soft_t *svg_soft, const svg_polyline_t *path,
+		     svg_fill_rule_t fill_rule, const svg_soft_paint_t *paint)
+{
+	svg_soft_state_t *state = svg_soft->state;
+	svg_soft_rasterizer_t *rasterizer = &svg_soft->rasterizer;
+
+	if (paint->type == SVG_SOFT_PAINT_NONE || paint->alpha == 0)
+		return SVG_STATUS_SUCCESS;
+
+	_svg_soft_rasterizer_reset (rasterizer, state->clip_x1, state->clip_y1,
+				    state->clip_x2, state->clip_y2);
+	_svg_soft_rasterizer_add_path (rasterizer, path, &state->ctm);
+
+	return _svg_soft_rasterizer_fill (svg_soft, fill_rule, paint);
+}
+
+/* the outline of path as stroked with the current state, in user space */
+static svg_status_t
+_svg_soft_stroke_path (svg_soft_t *svg_soft, const svg_polyline_t *path)
+{
+	svg_soft_state_t *state = svg_soft->state;
+	svg_stroke_style_t style;
+	double scale = _svg_soft_ctm_scale (&state->ctm);
+
+	svg_polyline_clear (&svg_soft->stroke);
+	if (scale <= 0.0)
+		return SVG_STATUS_SUCCESS;
+
+	style.width = state->stroke_width;
+	style.line_cap = state->line_cap;
+	style.line_join = state->line_join;
+	style.miter_limit = state->miter_limit;
+	style.dash = state->dash;
+	style.num_dashes = state->num_dashes;
+	style.dash_offset = state->dash_offset;
+	style.tolerance = SVG_SOFT_TOLERANCE / scale;
+
+	return svg_stroker_stroke (&svg_soft->stroker, path, &style, &svg_soft->stroke);
+}
+
+/* fill and stroke path, the extents are in user space */
+static svg_status_t
+_svg_soft_paint_path (svg_soft_t *svg_soft, const svg_polyline_t *path,
+		      double x1, double y1, double x2, double y2)
+{
+	svg_soft_state_t *state = svg_soft->state;
+	svg_soft_paint_t paint;
+	svg_status_t status;
+
+	if (path->error)
+		return SVG_STATUS_NO_MEMORY;
+
+	if (path->num_subpaths == 0 || state->clip_x1 >= state->clip_x2 || state->clip_y1 >= state->clip_y2)
+		return SVG_STATUS_SUCCESS;
+
+	// bounding box units of a gradient are resolved against this
+	svg_soft->shape_x1 = x1; svg_soft->shape_y1 = y1;
+	svg_soft->shape_x2 = x2; svg_soft->shape_y2 = y2;
+
+	if (state->fill_paint.type) {
+		status = _svg_soft_paint_init (svg_soft, &paint, &state->fill_paint, state->fill_opacity);
+		if (status == SVG_STATUS_SUCCESS)
+			status = _svg_soft_fill_path (svg_soft, path, state->fill_rule, &paint);
+		_svg_soft_paint_fini (&paint);
+		if (status)
+			return status;
+	}
+
+	if (state->stroke_paint.type && state->stroke_width > 0.0) {
+		status = _svg_soft_paint_init (svg_soft, &paint, &state->stroke_paint, state->stroke_opacity);
+		if (status == SVG_STATUS_SUCCESS)
+			status = _svg_soft_stroke_path (svg_soft, path);
+		if (status == SVG_STATUS_SUCCESS)
+			status = _svg_soft_fill_path (svg_soft, &svg_soft->stroke, SVG_FILL_RULE_NONZERO, &paint);
+		_svg_soft_paint_fini (&paint);
+		if (status)
+			return status;
+	}
+
+	return SVG_STATUS_SUCCESS;
+}
+
+svg_status_t
+_svg_soft_render_line (void *closure,
+		       svg_length_t *x1_len, svg_length_t *y1_len,
+		       svg_length_t *x2_len, svg_length_t *y2_len,
+		       svg_length_cache_t *lengths)
+{
+	svg_soft_t *svg_soft = closure;
+	svg_length_t *len[4] = {x1_len, y1_len, x2_len, y2_len};
+	double v[4];
+
+	_svg_soft_lengths_to_pixel (svg_soft, lengths, len, 4, v);
+
+	svg_polyline_clear (&svg_soft->path);
+	svg_polyline_move_to (&svg_soft->path, v[0], v[1]);
+	svg_polyline_line_to (&svg_soft->path, v[2], v[3]);
+
+	return _svg_soft_render_path (svg_soft, NULL);
+}
+
+svg_status_t
+_svg_soft_render_path (void *closure, void **path_cache)
+{
+	svg_soft_t *svg_soft = closure;
+	svg_polyline_t *path = &svg_soft->path;
+	svg_status_t status;
+
+	status = _svg_soft_paint_path (svg_soft, path,
+				       SVG_COORD_TO_DOUBLE (path->x1), SVG_COORD_TO_DOUBLE (path->y1),
+				       SVG_COORD_TO_DOUBLE (path->x2), SVG_COORD_TO_DOUBLE (path->y2));
+	svg_polyline_clear (path);
+
+	return status;
+}
+
+svg_status_t
+_svg_soft_render_ellipse (void *closure,
+			  svg_length_t *cx_len,
+			  svg_length_t *cy_len,
+			  svg_length_t *rx_len,
+			  svg_length_t *ry_len,
+			  svg_length_cache_t *lengths)
+{
+	svg_soft_t *svg_soft = closure;
+	svg_status_t status;
+	svg_length_t *len[4] = {cx_len, cy_len, rx_len, ry_len};
+	double v[4], cx, cy, rx, ry;
+
+	_svg_soft_lengths_to_pixel (svg_soft, lengths, len, 4, v);
+	cx = v[0]; cy = v[1]; rx = v[2]; ry = v[3];
+
+	if (rx <= 0.0 || ry <= 0.0)
+		return SVG_STATUS_SUCCESS;
+
+	svg_polyline_clear (&svg_soft->path);
+	svg_soft->path.tolerance = _svg_soft_user_tolerance (svg_soft);
+	svg_polyline_ellipse (&svg_soft->path, cx, cy, rx, ry);
+
+	status = _svg_soft_paint_path (svg_soft, &svg_soft->path, cx - rx, cy - ry, cx + rx, cy + ry);
+	svg_polyline_clear (&svg_soft->path);
+
+	return status;
+}
+
+svg_status_t
+_svg_soft_render_rect (void *closure,
+		       svg_length_t *x_len,
+		       svg_length_t *y_len,
+		       svg_length_t *width_len,
+		       svg_length_t *height_len,
+		       svg_length_t *rx_len,
+		       svg_length_t *ry_len,
+		       svg_length_cache_t *lengths)
+{
+	svg_soft_t *svg_soft = closure;
+	svg_status_t status;
+	svg_length_t *len[6] = {x_len, y_len, width_len, height_len, rx_len, ry_len};
+	double v[6], x, y, width, height, rx, ry;
+
+	_svg_soft_lengths_to_pixel (svg_soft, lengths, len, 6, v);
+	x = v[0]; y = v[1]; width = v[2]; height = v[3]; rx = v[4]; ry = v[5];
+
+	if (width <= 0.0 || height <= 0.0)
+		return SVG_STATUS_SUCCESS;
+
+	if (rx > width / 2.0)
+		rx = width / 2.0;
+	if (ry > height / 2.0)
+		ry = height / 2.0;
+
+	svg_polyline_clear (&svg_soft->path);
+	svg_soft->path.tolerance = _svg_soft_user_tolerance (svg_soft);
+	svg_polyline_rect (&svg_soft->path, x, y, width, height, rx, ry);
+
+	status = _svg_soft_paint_path (svg_soft, &svg_soft->path, x, y, x + width, y + height);
+	svg_polyline_clear (&svg_soft->path);
+
+	return status;
+}
+
+svg_status_t
+_svg_soft_render_text (void *closure,
+		       svg_length_t *x_len,
+		       svg_length_t *y_len,
+		       const char *utf8)
+{
+	// no font engine, see SVG_SOFT_RENDER_ENGINE
+	return SVG_STATUS_SUCCESS;
+}
+
+svg_status_t
+_svg_soft_render_image (void		*closure,
+			unsigned char	*data,
+			unsigned int	data_width,
+			unsigned int	data_height,
+			svg_length_t	*x_len,
+			svg_length_t	*y_len,
+			svg_length_t	*width_len,
+			svg_length_t	*height_len,
+			svg_length_cache_t *lengths)
+{
+	svg_soft_t *svg_soft = closure;
+	svg_soft_state_t *state = svg_soft->state;
+	svg_soft_ctm_t image_to_user;
+	svg_soft_paint_t paint;
+	svg_status_t status;
+	svg_length_t *len[4] = {x_len, y_len, width_len, height_len};
+	double v[4], x, y, width, height;
+
+	_svg_soft_lengths_to_pixel (svg_soft, lengths, len, 4, v);
+	x = v[0]; y = v[1]; width = v[2]; height = v[3];
+
+	if (data == NULL || data_width == 0 || data_height == 0 || width <= 0.0 || height <= 0.0)
+		return SVG_STATUS_SUCCESS;
+
+	image_to_user.xx = width / data_width; image_to_user.yx = 0.0;
+	image_to_user.xy = 0.0; image_to_user.yy = height / data_height;
+	image_to_user.x0 = x; image_to_user.y0 = y;
+
+	memset(&paint, 0, sizeof(paint));
+	_svg_soft_paint_texture (svg_soft, &paint, data, data_width, data_height,
+				 &image_to_user, state->opacity);
+	paint.texture_bgra = 1;
+
+	svg_polyline_clear (&svg_soft->path);
+	svg_polyline_rect (&svg_soft->path, x, y, width, height, 0.0, 0.0);
+
+	status = _svg_soft_fill_path (svg_soft, &svg_soft->path, SVG_FILL_RULE_NONZERO, &paint);
+	svg_polyline_clear (&svg_soft->path);
+
+	return status;
+}
+
+int
+_svg_soft_get_last_bounding_box (void *closure, svg_bounding_box_t *bbox)
+{
+	// not asked for, the engine does not set SVG_RENDER_ENGINE_NEEDS_BOUNDING_BOX
+	return 0;
+}
+
+static void
+_svg_soft_length_context (svg_soft_t *svg_soft, svg_length_context_t *context)
+{
+	if (svg_soft->state->bbox) {
+		context->viewport_width = 1.0;
+		context->viewport_height = 1.0;
+	} else {
+		context->viewport_width = svg_soft->state->viewport_width;
+		context->viewport_height = svg_soft->state->viewport_height;
+	}
+	context->font_size = svg_soft->state->font_size;
+	context->dpi = svg_get_dpi (svg_soft->svg);
+}
+
+svg_status_t
+_svg_soft_length_to_pixel (svg_soft_t *svg_soft, svg_length_t *length, double *pixel)
+{
+	svg_length_context_t context;
+
+	_svg_soft_length_context (svg_soft, &context);
+	*pixel = svg_length_resolve (length, &context);
+
+	return SVG_STATUS_SUCCESS;
+}
+
+/* the lengths of one element, through the cache the element keeps */
+void
+_svg_soft_lengths_to_pixel (svg_soft_t *svg_soft, svg_length_cache_t *cache,
+			    svg_length_t **lengths, int count, double *pixels)
+{
+	svg_length_context_t context;
+
+	_svg_soft_length_context (svg_soft, &context);
+	svg_length_cache_resolve (cache, &context, lengths, count, pixels);
+}
@@ -20,6 +20,7 @@
    Author: Carl Worth <cworth@isi.edu>
 */
 
+#include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <string.h>
@@ -57,6 +58,31 @@ void svg_enable_path_cache(svg_t *svg) {
 	svg->do_path_cache = 1;
 }
 
+int svg_uses_filters(svg_t *svg) {
+	return svg->uses_filters;
+}
+
+unsigned int svg_content_generation(svg_t *svg) {
+	return svg->generation;
+}
+
+svg_status_t
+svg_set_dpi (svg_t *svg, double dpi)
+{
+    if (!(dpi > 0))
+	return SVG_STATUS_INVALID_VALUE;
+
+    svg->dpi = dpi;
+
+    return SVG_STATUS_SUCCESS;
+}
+
+double
+svg_get_dpi (svg_t *svg)
+{
+    return svg->dpi;
+}
+
 static svg_status_t
 _svg_init (svg_t *svg,
 	   svg_render_engine_t	*engine,
@@ -64,7 +90,7 @@ _svg_init (svg_t *svg,
 {
     svg->dpi = 100;
 
-    svg->dir_name = strdup (".");
+    svg->base_uri = NULL;
 
     svg->group_element = NULL;
 
@@ -76,6 +102,10 @@ _svg_init (svg_t *svg,
     svg->element_ids = StrHmapAlloc(100);
 
     svg->do_path_cache = 0;
+    svg->uses_filters = 0;
+    svg->generation = 0;
+    svg->render_style = NULL;
+    svg->fold_opacity = 1.0;
 
     return SVG_STATUS_SUCCESS;
 }
@@ -83,8 +113,8 @@ _svg_init (svg_t *svg,
 static svg_status_t
 _svg_deinit (svg_t *svg)
 {
-    free (svg->dir_name);
-    svg->dir_name = NULL;
+    free (svg->base_uri);
+    svg->base_uri = NULL;
 
     if (svg->group_element)
 	_svg_element_dereference (svg->group_element);
@@ -161,11 +191,14 @@ svg_parse (svg_t *svg, const char *filename)
     FILE *file;
     char *tmp;
 
-    free (svg->dir_name);
     /* awful dirname semantics require some hoops */
     tmp = strdup (filename);
-    svg->dir_name = strdup (dirname (tmp));
+    if (tmp == NULL)
+	return SVG_STATUS_NO_MEMORY;
+    status = svg_set_base_uri (svg, dirname (tmp));
     free (tmp);
+    if (status)
+	return status;
 
     file = fopen (filename, "r");
     if (file == NULL) {
@@ -183,6 +216,68 @@ svg_parse (svg_t *svg, const char *filename)
     return status;
 }
 
+svg_status_t
+svg_set_base_uri (svg_t *svg, const char *base_uri)
+{
+    char *copy = NULL;
+
+    if (base_uri) {
+	copy = strdup (base_uri);
+	if (copy == NULL)
+	    return SVG_STATUS_NO_MEMORY;
+    }
+
+    free (svg->base_uri);
+    svg->base_uri = copy;
+
+    return SVG_STATUS_SUCCESS;
+}
+
+/* absolute paths, and anything with a scheme (http:, data:, ...) */
+static int
+_svg_uri_is_absolute (const char *uri)
+{
+    const char *p = uri;
+
+    if (*uri == '/')
+	return 1;
+
+    if (! isalpha ((unsigned char) *p))
+	return 0;
+    while (isalnum ((unsigned char) *p) || *p == '+' || *p == '-' || *p == '.')
+	p++;
+
+    return *p == ':';
+}
+
+/* Resolve uri against the base URI of the document. The caller owns
+   the result, NULL means we ran out of memory. */
+char *
+_svg_resolve_uri_alloc (svg_t *svg, const char *uri)
+{
+    size_t base_len;
+    char *resolved;
+
+    if (svg->base_uri == NULL || *svg->base_uri == '\0' ||
+	*uri == '\0' || _svg_uri_is_absolute (uri))
+	return strdup (uri);
+
+    base_len = strlen (svg->base_uri);
+    while (base_len > 1 && svg->base_uri[base_len - 1] == '/')
+	base_len--;
+
+    resolved = malloc (base_len + 1 + strlen (uri) + 1);
+    if (resolved == NULL)
+	return NULL;
+
+    memcpy (resolved, svg->base_uri, base_len);
+    if (svg->base_uri[base_len - 1] != '/')
+	resolved[base_len++] = '/';
+    strcpy (resolved + base_len, uri);
+
+    return resolved;
+}
+
 svg_status_t
 svg_parse_buffer (svg_t *svg, const char *buf, size_t count)
 {
@@ -209,6 +304,7 @@ svg_parse_buffer_and_inject (svg_t *svg, svg_element_t *parent, const char *buf,
 	if((parent->type == SVG_ELEMENT_TYPE_SVG_GROUP) ||
 	   (parent->type == SVG_ELEMENT_TYPE_GROUP)) {
 
+		svg->generation++;
 		status = _svg_parser_begin (&svg->parser);
 		if (status) {
 			SVG_ERROR("inject failed when starting the svg parser.\n");
@@ -265,6 +361,7 @@ svg_drop_element(svg_t *svg, svg_element_t *element) {
 			exit(0);
 		}
 		SVG_DEBUG("svg_drop_element %p -> ref count before: %d\n", element, element->ref_count);
+		svg->generation++;
 		return _svg_group_drop_element(&(element->parent->e.group), element);
 	}
 
@@ -274,6 +371,7 @@ svg_drop_element(svg_t *svg, svg_element_t *element) {
 svg_status_t
 svg_parse_chunk_begin (svg_t *svg)
 {
+    svg->generation++;
     return _svg_parser_begin (&svg->parser);
 }
 
@@ -329,25 +427,34 @@ svg_event_coords_match(svg_t *svg, int x, int y) {
 svg_status_t
 svg_render (svg_t		*svg)
 {
-    svg_status_t status;
-    char orig_dir[MAXPATHLEN];
-
     if (svg->group_element == NULL)
 	return SVG_STATUS_SUCCESS;
 
     svg->event_stack = NULL; // reset the event stack
 
-    /* XXX: Currently, the SVG parser doesn't resolve relative URLs
-       properly, so I'll just cheese things in by changing the current
-       directory -- at least I'll be nice about it and restore it
-       afterwards. */
+    /* relative URLs were resolved against svg->base_uri when parsed */
+    return svg_element_render (svg->group_element, svg->engine, svg->closure);
+}
 
-    getcwd (orig_dir, MAXPATHLEN);
-    chdir (svg->dir_name);
+/* Render with an engine other than the one the document was created
+ * for. Cached paths belong to svg->engine, so none are handed out (or
+ * stored) while the other engine draws. */
+svg_status_t
+svg_render_with_engine (svg_t			*svg,
+			svg_render_engine_t	*engine,
+			void			*closure)
+{
+    int do_path_cache = svg->do_path_cache;
+    svg_status_t status;
+
+    if (svg->group_element == NULL)
+	return SVG_STATUS_SUCCESS;
 
-    status = svg_element_render (svg->group_element, svg->engine, svg->closure);
+    svg->event_stack = NULL; // reset the event stack
 
-    chdir (orig_dir);
+    svg->do_path_cache = 0;
+    status = svg_element_render (svg->group_element, engine, closure);
+    svg->do_path_cache = do_path_cache;
 
     return status;
 }
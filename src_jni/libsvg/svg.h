@@ -24,6 +24,9 @@
 #define SVG_H
 
 #include <stdio.h>
+#ifdef LIBSVG_FIXED_POINT
+#include <stdint.h>
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -63,6 +66,26 @@ typedef struct svg_length {
     svg_length_orientation_t orientation : 2;
 } svg_length_t;
 
+/* What lengths are resolved against: percentages against the viewport,
+   em and ex against the font size and physical units against the dpi.
+   A bounding box context is a 1x1 viewport. */
+typedef struct svg_length_context {
+    double viewport_width;
+    double viewport_height;
+    double font_size;
+    double dpi;
+} svg_length_context_t;
+
+/* The lengths of one element resolved to user units, kept with the
+   element and reused for as long as the context stays the same. */
+#define SVG_LENGTH_CACHE_SIZE 6
+
+typedef struct svg_length_cache {
+    svg_length_context_t context;
+    int count; /* 0 until something was resolved */
+    double value[SVG_LENGTH_CACHE_SIZE];
+} svg_length_cache_t;
+
 typedef struct svg_bounding_box {
 	unsigned int left, top, right, bottom;
 } svg_bounding_box_t;
@@ -254,11 +277,29 @@ typedef enum {
     feComposite_atop, feComposite_xor, feComposite_arithmetic
 } feCompositeOperator_t;
 
+/* Render engine capabilities, the core traversal uses these to skip
+ * work the engine has no use for. */
+#define SVG_RENDER_ENGINE_NEEDS_BOUNDING_BOX	0x01 /* get_last_bounding_box is queried after each element */
+#define SVG_RENDER_ENGINE_CUBICS_ONLY		0x02 /* quadratic curves and arcs arrive as curve_to */
+#define SVG_RENDER_ENGINE_NATIVE_ARCS		0x04 /* arcs arrive as arc_to, otherwise they become curves when parsed */
+#define SVG_RENDER_ENGINE_GROUP_OPACITY		0x08 /* begin_group/end_group get the group opacity, otherwise 1.0 */
+#define SVG_RENDER_ENGINE_FILTERS		0x10 /* filter effects are passed on to the engine */
+
+/* What a leaf element is about to change, passed to begin_element so
+ * the engine can skip saving its state when nothing changes. */
+#define SVG_RENDER_ELEMENT_TRANSFORM		0x01 /* a non-identity transform follows */
+#define SVG_RENDER_ELEMENT_STYLE		0x02 /* style properties or a filter follow */
+
 /* XXX: Here's another piece of the API that needs deep consideration. */
 typedef struct svg_render_engine {
+    /* SVG_RENDER_ENGINE_* flags */
+    unsigned int capabilities;
     /* hierarchy */
-    svg_status_t (* begin_group) (void *closure, double opacity);
-	svg_status_t (* begin_element) (void *closure, void *path_cache);
+    /* extents is NULL when not known, otherwise it covers what a group
+       with opacity can draw, in the user space begin_group is called
+       in (empty if width < 0) */
+    svg_status_t (* begin_group) (void *closure, double opacity, const svg_rect_t *extents);
+	svg_status_t (* begin_element) (void *closure, void *path_cache, unsigned int changes);
     svg_status_t (* end_element) (void *closure);
     svg_status_t (* end_group) (void *closure, double opacity);
     /* path creation */
@@ -281,7 +322,7 @@ typedef struct svg_render_engine {
 			     double	y);
 	svg_status_t (* close_path) (void *closure);
 	void (* free_path_cache) (void *closure, void **path_cache);
-    /* style */
+    /* style - any of these may be NULL if the engine does not care */
     svg_status_t (* set_color) (void *closure, const svg_color_t *color);
     svg_status_t (* set_fill_opacity) (void *closure, double fill_opacity);
     svg_status_t (* set_fill_paint) (void *closure, const svg_paint_t *paint);
@@ -350,24 +391,29 @@ typedef struct svg_render_engine {
 				    	     svg_length_t *width,
 				    	     svg_length_t *height);
     /* drawing */
+    /* the svg_length_cache_t belongs to the element, the engine may keep
+       the lengths resolved in it, see svg_length_cache_resolve() */
     svg_status_t (* render_line) (void *closure,
 				  svg_length_t *x1,
 				  svg_length_t *y1,
 				  svg_length_t *x2,
-				  svg_length_t *y2);
+				  svg_length_t *y2,
+				  svg_length_cache_t *lengths);
 	svg_status_t (* render_path) (void *closure, void **path_cache);
     svg_status_t (* render_ellipse) (void *closure,
 				     svg_length_t *cx,
 				     svg_length_t *cy,
 				     svg_length_t *rx,
-				     svg_length_t *ry);
+				     svg_length_t *ry,
+				     svg_length_cache_t *lengths);
     svg_status_t (* render_rect) (void *closure,
 				     svg_length_t *x,
 				     svg_length_t *y,
 				     svg_length_t *width,
 				     svg_length_t *height,
 				     svg_length_t *rx,
-				     svg_length_t *ry);
+				     svg_length_t *ry,
+				     svg_length_cache_t *lengths);
     svg_status_t (* render_text) (void *closure,
 				  svg_length_t *x,
 				  svg_length_t *y,
@@ -381,13 +427,87 @@ typedef struct svg_render_engine {
 				   svg_length_t	 *x,
 				   svg_length_t	 *y,
 				   svg_length_t	 *width,
-				   svg_length_t	 *height);
+				   svg_length_t	 *height,
+				   svg_length_cache_t *lengths);
 
 
 	/* get bounding box of last drawing, in pixels - returns 0 if bounding box is outside the visible clip, non-0 if inside the visible clip */
 	int (*get_last_bounding_box)(void *closure, svg_bounding_box_t *bbox);
 } svg_render_engine_t;
 
+/* Coordinates of flattened geometry. Building with LIBSVG_FIXED_POINT
+   stores them as 16.16 fixed point, and curves are flattened and the
+   soft engine rasterizes in integers. They are then limited to +-32767
+   and clamped to that. Path data, transforms and lengths stay in
+   double, as does everything libsvg-android hands to the canvas. */
+#ifdef LIBSVG_FIXED_POINT
+typedef int32_t svg_coord_t;
+#define SVG_COORD_ONE			65536
+#define SVG_COORD_TO_DOUBLE(c)		((c) * (1.0 / SVG_COORD_ONE))
+#else
+typedef double svg_coord_t;
+#define SVG_COORD_ONE			1.0
+#define SVG_COORD_TO_DOUBLE(c)		(c)
+#endif
+
+/* A path flattened into straight lines, for engines and callers that
+   need the geometry itself rather than a place to draw it. */
+typedef struct svg_polyline_point {
+    svg_coord_t x;
+    svg_coord_t y;
+} svg_polyline_point_t;
+
+typedef struct svg_polyline_subpath {
+    int first;
+    int count;
+    int closed;
+} svg_polyline_subpath_t;
+
+typedef struct svg_polyline {
+    svg_polyline_point_t *points;
+    int num_points;
+    int points_size;
+
+    svg_polyline_subpath_t *subpaths;
+    int num_subpaths;
+    int subpaths_size;
+
+    /* covers the points and the control points of curves */
+    int has_extents;
+    svg_coord_t x1, y1, x2, y2;
+
+    /* how far the lines of a curve may stray from it, in user units
+       - set it to a device pixel fraction over the scale */
+    double tolerance;
+
+    int error;
+} svg_polyline_t;
+
+typedef struct svg_stroke_style {
+    double width;
+    svg_stroke_line_cap_t line_cap;
+    svg_stroke_line_join_t line_join;
+    double miter_limit;
+    const double *dash;
+    int num_dashes;
+    double dash_offset;
+    /* how far the outline of round parts may stray from the true curve */
+    double tolerance;
+} svg_stroke_style_t;
+
+typedef struct svg_stroke_point {
+    double x;
+    double y;
+} svg_stroke_point_t;
+
+/* keeps the buffers of one stroke to the next */
+typedef struct svg_stroker {
+    svg_polyline_t dashed;
+    svg_polyline_t outline;
+    svg_stroke_point_t *scratch;
+    int scratch_size;
+} svg_stroker_t;
+
 svg_status_t
 svg_create (svg_t **svg,
 	    svg_render_engine_t	*engine,
@@ -395,6 +515,35 @@ svg_create (svg_t **svg,
 
 	void svg_enable_path_cache(svg_t *svg);
 
+/* non-zero if the document contains filters, the engine may then need
+   an offscreen surface to act as the filter background */
+	int svg_uses_filters(svg_t *svg);
+
+/* changes whenever content is parsed into or dropped from the document,
+   engines can use it to tell if something they rendered earlier is stale */
+	unsigned int svg_content_generation(svg_t *svg);
+
+/* resolution of physical units (in, cm, mm, pt, pc) in dots per inch,
+   100 unless set otherwise */
+svg_status_t
+svg_set_dpi (svg_t *svg, double dpi);
+
+double
+svg_get_dpi (svg_t *svg);
+
+double
+svg_length_resolve (const svg_length_t		*length,
+		    const svg_length_context_t	*context);
+
+/* Resolve count lengths into values, reusing what the cache holds when
+   it was filled in the same context. A NULL cache resolves every time. */
+void
+svg_length_cache_resolve (svg_length_cache_t		*cache,
+			  const svg_length_context_t	*context,
+			  svg_length_t			**lengths,
+			  int				count,
+			  double			*values);
+
 svg_status_t
 svg_destroy (svg_t *svg);
 
@@ -404,6 +553,12 @@ svg_parse (svg_t *svg, const char *filename);
 svg_status_t
 svg_parse_file (svg_t *svg, FILE *file);
 
+/* relative hrefs (images) are resolved against base_uri, svg_parse
+   sets it to the directory of the file. Set it before parsing a buffer,
+   NULL leaves relative hrefs relative to the working directory. */
+svg_status_t
+svg_set_base_uri (svg_t *svg, const char *base_uri);
+
 svg_status_t
 svg_parse_buffer (svg_t *svg, const char *buf, size_t count);
 
@@ -426,9 +581,17 @@ svg_element_enable_events(svg_element_t *element);
 svg_element_t *
 svg_event_coords_match(svg_t *svg, int x, int y);
 
+/* Rendering writes to the document: resolved styles and lengths and
+ * the path caches live in it. A document must not be rendered from two
+ * threads at once, different documents can be. */
 svg_status_t
 svg_render (svg_t		*svg);
 
+svg_status_t
+svg_render_with_engine (svg_t			*svg,
+			svg_render_engine_t	*engine,
+			void			*closure);
+
 void
 svg_get_size (svg_t *svg,
 	      svg_length_t *width,
@@ -458,6 +621,83 @@ void svg_element_debug_render_tree(svg_element_t *element);
 svg_pattern_t *
 svg_element_pattern (svg_element_t *element);
 
+/* appends the outline of a path element to polyline, in user space,
+   curves are flattened to the tolerance of the polyline */
+svg_status_t
+svg_element_flatten (svg_element_t *element, svg_polyline_t *polyline);
+
+/* svg_polyline */
+
+void
+svg_polyline_init (svg_polyline_t *polyline);
+
+void
+svg_polyline_deinit (svg_polyline_t *polyline);
+
+void
+svg_polyline_clear (svg_polyline_t *polyline);
+
+void
+svg_polyline_move_to (svg_polyline_t *polyline, double x, double y);
+
+void
+svg_polyline_line_to (svg_polyline_t *polyline, double x, double y);
+
+void
+svg_polyline_curve_to (svg_polyline_t *polyline,
+		       double x0, double y0,
+		       double x1, double y1,
+		       double x2, double y2,
+		       double x3, double y3);
+
+void
+svg_polyline_close_path (svg_polyline_t *polyline);
+
+void
+svg_polyline_ellipse (svg_polyline_t *polyline,
+		      double cx, double cy, double rx, double ry);
+
+void
+svg_polyline_rect (svg_polyline_t *polyline,
+		   double x, double y, double width, double height,
+		   double rx, double ry);
+
+int
+svg_polyline_contains (const svg_polyline_t *polyline, svg_fill_rule_t fill_rule,
+		       double x, double y);
+
+svg_coord_t
+svg_coord_from_double (double value);
+
+/* svg_stroker */
+
+void
+svg_stroker_init (svg_stroker_t *stroker);
+
+void
+svg_stroker_deinit (svg_stroker_t *stroker);
+
+svg_status_t
+svg_stroker_stroke (svg_stroker_t		*stroker,
+		    const svg_polyline_t	*path,
+		    const svg_stroke_style_t	*style,
+		    svg_polyline_t		*outline);
+
+int
+svg_stroker_extents (svg_stroker_t		*stroker,
+		     const svg_polyline_t	*path,
+		     const svg_stroke_style_t	*style,
+		     double *x1, double *y1, double *x2, double *y2);
+
+int
+svg_stroker_contains (svg_stroker_t		*stroker,
+		      const svg_polyline_t	*path,
+		      const svg_stroke_style_t	*style,
+		      double x, double y);
+
+double
+svg_stroke_reach (const svg_stroke_style_t *style);
+
 #ifdef __cplusplus
 }
 #endif
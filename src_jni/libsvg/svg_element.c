@@ -20,6 +20,7 @@
    Author: Carl Worth <cworth@isi.edu>
 */
 
+#include <math.h>
 #include <string.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -90,6 +91,9 @@ _svg_element_init (svg_element_t	*element,
 	break;
     case SVG_ELEMENT_TYPE_PATH:
 	status = _svg_path_init (&element->e.path);
+	/* only an engine drawing arcs itself has a use for them */
+	element->e.path.keep_arcs = doc && doc->engine &&
+	    (doc->engine->capabilities & SVG_RENDER_ENGINE_NATIVE_ARCS);
 	break;
     case SVG_ELEMENT_TYPE_CIRCLE:
     case SVG_ELEMENT_TYPE_ELLIPSE:
@@ -238,13 +242,307 @@ _svg_element_get_viewport(svg_element_t *element,
 	}
 }
 
+/* engines without support for group opacity layers always get 1.0 */
+static double
+_svg_element_group_opacity (svg_element_t *element, svg_render_engine_t *engine)
+{
+    if (engine->capabilities & SVG_RENDER_ENGINE_GROUP_OPACITY)
+	return _svg_style_get_opacity (&element->style);
+
+    return 1.0;
+}
+
+/* The style an inherited property of the element comes from, NULL
+   when it has its initial value. */
+static const svg_style_t *
+_svg_element_inherited_style (svg_element_t *element, uint64_t flag)
+{
+    for (; element; element = element->parent) {
+	if (element->style.flags & flag)
+	    return &element->style;
+    }
+
+    return NULL;
+}
+
+/* The paint an element draws with. The initial values are a black
+   fill and no stroke. */
+static svg_paint_type_t
+_svg_element_paint_type (svg_element_t *element, uint64_t flag)
+{
+    const svg_style_t *style = _svg_element_inherited_style (element, flag);
+
+    if (style == NULL)
+	return flag == SVG_STYLE_FLAG_FILL_PAINT ?
+	    SVG_PAINT_TYPE_COLOR : SVG_PAINT_TYPE_NONE;
+
+    return flag == SVG_STYLE_FLAG_FILL_PAINT ?
+	style->fill_paint.type : style->stroke_paint.type;
+}
+
+/* A translucent group holding nothing but a single shape needs no
+   layer, the group opacity can be folded into that of the shape. That
+   only holds while the shape paints once, a fill and a stroke drawn at
+   reduced opacity would show the fill through the stroke. */
+static int
+_svg_element_can_fold_opacity (svg_element_t *element)
+{
+    svg_element_t *child;
+    int fill, stroke;
+
+    if (element->e.group.num_elements != 1)
+	return 0;
+
+    child = element->e.group.element[0];
+    if ((child->style.flags & SVG_STYLE_FLAG_FILTER) && child->style.filter_element)
+	return 0;
+
+    switch (child->type) {
+    case SVG_ELEMENT_TYPE_PATH:
+    case SVG_ELEMENT_TYPE_CIRCLE:
+    case SVG_ELEMENT_TYPE_ELLIPSE:
+    case SVG_ELEMENT_TYPE_LINE:
+    case SVG_ELEMENT_TYPE_RECT:
+	break;
+    default:
+	return 0;
+    }
+
+    fill = _svg_element_paint_type (child, SVG_STYLE_FLAG_FILL_PAINT) != SVG_PAINT_TYPE_NONE;
+    stroke = _svg_element_paint_type (child, SVG_STYLE_FLAG_STROKE_PAINT) != SVG_PAINT_TYPE_NONE;
+
+    return fill != stroke;
+}
+
+/* Lengths that do not depend on the viewport or the font, the only ones
+   that can be resolved without asking the engine. */
+static int
+_svg_element_absolute_lengths (svg_element_t *element, svg_length_t **lengths,
+			       int count, double *values)
+{
+    svg_length_context_t context;
+    int i;
+
+    context.viewport_width = 0.0;
+    context.viewport_height = 0.0;
+    context.font_size = 0.0;
+    context.dpi = element->doc->dpi;
+
+    for (i = 0; i < count; i++) {
+	if (lengths[i]->unit == SVG_LENGTH_UNIT_PCT ||
+	    lengths[i]->unit == SVG_LENGTH_UNIT_EM ||
+	    lengths[i]->unit == SVG_LENGTH_UNIT_EX)
+	    return 0;
+	values[i] = svg_length_resolve (lengths[i], &context);
+    }
+
+    return 1;
+}
+
+/* How far the stroke of a shape can reach out of its geometry. */
+static int
+_svg_element_stroke_reach (svg_element_t *element, double *reach)
+{
+    const svg_style_t *style;
+    svg_stroke_style_t stroke;
+    svg_length_t width, *lengths[1] = { &width };
+
+    *reach = 0.0;
+    if (_svg_element_paint_type (element, SVG_STYLE_FLAG_STROKE_PAINT) == SVG_PAINT_TYPE_NONE)
+	return 1;
+
+    memset (&stroke, 0, sizeof (stroke));
+
+    style = _svg_element_inherited_style (element, SVG_STYLE_FLAG_STROKE_WIDTH);
+    if (style)
+	width = style->stroke_width;
+    else
+	_svg_length_init (&width, 1.0);
+    if (! _svg_element_absolute_lengths (element, lengths, 1, &stroke.width))
+	return 0;
+
+    style = _svg_element_inherited_style (element, SVG_STYLE_FLAG_STROKE_LINE_CAP);
+    stroke.line_cap = style ? style->stroke_line_cap : SVG_STROKE_LINE_CAP_BUTT;
+    style = _svg_element_inherited_style (element, SVG_STYLE_FLAG_STROKE_LINE_JOIN);
+    stroke.line_join = style ? style->stroke_line_join : SVG_STROKE_LINE_JOIN_MITER;
+    style = _svg_element_inherited_style (element, SVG_STYLE_FLAG_STROKE_MITER_LIMIT);
+    stroke.miter_limit = style ? style->stroke_miter_limit : 4.0;
+
+    *reach = svg_stroke_reach (&stroke);
+
+    return 1;
+}
+
+static void
+_svg_element_extents_add (double *extents, double x, double y)
+{
+    if (x < extents[0])
+	extents[0] = x;
+    if (y < extents[1])
+	extents[1] = y;
+    if (x > extents[2])
+	extents[2] = x;
+    if (y > extents[3])
+	extents[3] = y;
+}
+
+/* Grow extents = { x1, y1, x2, y2 } by what the element can draw, in the
+   user space of its parent. This is a bound, not the exact area: the
+   control points of curves count and the stroke takes its widest
+   reach. Returns 0 when the engine would have to be asked, e.g. for
+   text, images, filters or lengths relative to the viewport. */
+static int
+_svg_element_extents (svg_element_t *element, double *extents)
+{
+    svg_transform_t transform = element->transform;
+    double e[4] = { HUGE_VAL, HUGE_VAL, -HUGE_VAL, -HUGE_VAL };
+    double v[4], reach;
+    svg_length_t *lengths[4];
+    int i;
+
+    /* nothing drawn, see _svg_element_render */
+    if (_svg_style_get_display (&element->style))
+	return 1;
+
+    if ((element->style.flags & SVG_STYLE_FLAG_FILTER) && element->style.filter_element)
+	return 0;
+
+    switch (element->type) {
+    case SVG_ELEMENT_TYPE_SVG_GROUP:
+    case SVG_ELEMENT_TYPE_GROUP:
+    case SVG_ELEMENT_TYPE_USE:
+	if (element->e.group.view_box.aspect_ratio != SVG_PRESERVE_ASPECT_RATIO_UNKNOWN)
+	    return 0;
+	for (i = 0; i < element->e.group.num_elements; i++) {
+	    if (! _svg_element_extents (element->e.group.element[i], e))
+		return 0;
+	}
+	break;
+    case SVG_ELEMENT_TYPE_PATH:
+	_svg_path_extents (&element->e.path, e);
+	break;
+    case SVG_ELEMENT_TYPE_CIRCLE:
+    case SVG_ELEMENT_TYPE_ELLIPSE:
+	lengths[0] = &element->e.ellipse.cx;
+	lengths[1] = &element->e.ellipse.cy;
+	lengths[2] = &element->e.ellipse.rx;
+	lengths[3] = element->type == SVG_ELEMENT_TYPE_CIRCLE ?
+	    &element->e.ellipse.rx : &element->e.ellipse.ry;
+	if (! _svg_element_absolute_lengths (element, lengths, 4, v))
+	    return 0;
+	_svg_element_extents_add (e, v[0] - v[2], v[1] - v[3]);
+	_svg_element_extents_add (e, v[0] + v[2], v[1] + v[3]);
+	break;
+    case SVG_ELEMENT_TYPE_LINE:
+	lengths[0] = &element->e.line.x1;
+	lengths[1] = &element->e.line.y1;
+	lengths[2] = &element->e.line.x2;
+	lengths[3] = &element->e.line.y2;
+	if (! _svg_element_absolute_lengths (element, lengths, 4, v))
+	    return 0;
+	_svg_element_extents_add (e, v[0], v[1]);
+	_svg_element_extents_add (e, v[2], v[3]);
+	break;
+    case SVG_ELEMENT_TYPE_RECT:
+	lengths[0] = &element->e.rect.x;
+	lengths[1] = &element->e.rect.y;
+	lengths[2] = &element->e.rect.width;
+	lengths[3] = &element->e.rect.height;
+	if (! _svg_element_absolute_lengths (element, lengths, 4, v))
+	    return 0;
+	_svg_element_extents_add (e, v[0], v[1]);
+	_svg_element_extents_add (e, v[0] + v[2], v[1] + v[3]);
+	break;
+    case SVG_ELEMENT_TYPE_DEFS:
+    case SVG_ELEMENT_TYPE_SYMBOL:
+    case SVG_ELEMENT_TYPE_GRADIENT:
+    case SVG_ELEMENT_TYPE_GRADIENT_STOP:
+    case SVG_ELEMENT_TYPE_PATTERN:
+    case SVG_ELEMENT_TYPE_FILTER:
+	return 1; /* not rendered directly */
+    default:
+	return 0;
+    }
+
+    if (e[0] > e[2])
+	return 1;
+
+    switch (element->type) {
+    case SVG_ELEMENT_TYPE_PATH:
+    case SVG_ELEMENT_TYPE_CIRCLE:
+    case SVG_ELEMENT_TYPE_ELLIPSE:
+    case SVG_ELEMENT_TYPE_LINE:
+    case SVG_ELEMENT_TYPE_RECT:
+	if (! _svg_element_stroke_reach (element, &reach))
+	    return 0;
+	e[0] -= reach; e[1] -= reach;
+	e[2] += reach; e[3] += reach;
+	break;
+    default:
+	break;
+    }
+
+    /* into the parent's user space, the same way it is rendered */
+    if (element->type == SVG_ELEMENT_TYPE_SVG_GROUP ||
+	element->type == SVG_ELEMENT_TYPE_USE)
+	_svg_transform_add_translate (&transform, element->e.group.x.value, element->e.group.y.value);
+
+    for (i = 0; i < 4; i++) {
+	double x = e[(i & 1) ? 2 : 0], y = e[(i & 2) ? 3 : 1];
+
+	_svg_element_extents_add (extents,
+				  transform.m[0][0] * x + transform.m[1][0] * y + transform.m[2][0],
+				  transform.m[0][1] * x + transform.m[1][1] * y + transform.m[2][1]);
+    }
+
+    return 1;
+}
+
+/* Entry point for rendering from outside the tree walk, e.g. an
+   engine rendering a pattern into its own fresh state. Nothing is
+   known about the engine state here, so the style diffing starts
+   over. */
 svg_status_t
 svg_element_render (svg_element_t		*element,
 		    svg_render_engine_t		*engine,
 		    void			*closure)
+{
+    svg_style_t *render_style = element->doc->render_style;
+    double fold_opacity = element->doc->fold_opacity;
+    svg_status_t status;
+
+    element->doc->render_style = NULL;
+    element->doc->fold_opacity = 1.0;
+    status = _svg_element_render (element, engine, closure);
+    element->doc->render_style = render_style;
+    element->doc->fold_opacity = fold_opacity;
+
+    return status;
+}
+
+svg_status_t
+_svg_element_render (svg_element_t		*element,
+		     svg_render_engine_t	*engine,
+		     void			*closure)
 {
 	svg_status_t status, fail_status = SVG_STATUS_SUCCESS, return_status = SVG_STATUS_SUCCESS;
     svg_transform_t transform = element->transform;
+    /* style values the engine holds while this element is rendered */
+    svg_style_t *parent_style = element->doc->render_style;
+    svg_style_t render_style;
+    uint64_t style_changes;
+    unsigned int changes = 0;
+    svg_style_t *style = &element->style;
+    svg_style_t folded_style;
+    double group_opacity = 1.0;
+
+    /* opacity folded in from the parent group, see below */
+    if (element->doc->fold_opacity != 1.0) {
+	folded_style = element->style;
+	folded_style.opacity *= element->doc->fold_opacity;
+	style = &folded_style;
+	element->doc->fold_opacity = 1.0;
+    }
 
     /* if the display property is not activated, we dont have to
        draw this element nor its children, so we can safely return here. */
@@ -261,13 +559,49 @@ svg_element_render (svg_element_t		*element,
 	    element->doc->event_stack = element;
     }
 
+    /* TODO : this is probably not the right place to change transform, but
+     atm we dont store svg_length_t in group, so... */
+    if (element->type == SVG_ELEMENT_TYPE_SVG_GROUP ||
+        element->type == SVG_ELEMENT_TYPE_USE)
+	_svg_transform_add_translate (&transform, element->e.group.x.value, element->e.group.y.value);
+
+    if (! _svg_transform_is_identity (&transform))
+	changes |= SVG_RENDER_ELEMENT_TRANSFORM;
+
+    style_changes = _svg_style_render_changes (style, parent_style, engine);
+    if (style_changes)
+	changes |= SVG_RENDER_ELEMENT_STYLE;
+
     if (element->type == SVG_ELEMENT_TYPE_SVG_GROUP
 	|| element->type == SVG_ELEMENT_TYPE_GROUP) {
 
-	status = (engine->begin_group) (closure, _svg_style_get_opacity(&element->style));
+	double fold_opacity = 1.0;
+	double extents_buf[4] = { HUGE_VAL, HUGE_VAL, -HUGE_VAL, -HUGE_VAL };
+	svg_rect_t extents, *group_extents = NULL;
+
+	group_opacity = _svg_element_group_opacity (element, engine);
+	if (group_opacity != 1.0 && _svg_element_can_fold_opacity (element)) {
+	    fold_opacity = group_opacity;
+	    group_opacity = 1.0;
+	}
+
+	/* a layer need not be any larger than what the group draws */
+	if (group_opacity != 1.0 &&
+	    _svg_element_extents (element, extents_buf)) {
+	    extents.x = extents_buf[0];
+	    extents.y = extents_buf[1];
+	    extents.width = extents_buf[2] - extents_buf[0];
+	    extents.height = extents_buf[3] - extents_buf[1];
+	    group_extents = &extents;
+	}
+
+	status = (engine->begin_group) (closure, group_opacity, group_extents);
 	if (status)
 	    return status;
 
+	/* picked up by the single child */
+	element->doc->fold_opacity = fold_opacity;
+
 	/* if element->type == SVG_ELEMENT_TYPE_SVG_GROUP and
 	 * the overflow attribute is set to hide or scroll
 	 * we must apply a clip box too.
@@ -292,9 +626,11 @@ svg_element_render (svg_element_t		*element,
 
     } else {
 	    if(element->type == SVG_ELEMENT_TYPE_PATH)
-		    status = (engine->begin_element) (closure, element->e.path.cache);
+		    status = (engine->begin_element) (closure,
+						      _svg_path_cache (element->doc, &element->e.path),
+						      changes);
 	    else
-		    status = (engine->begin_element) (closure, NULL);
+		    status = (engine->begin_element) (closure, NULL, changes);
 	if (status)
 	    return status;
     }
@@ -316,23 +652,25 @@ svg_element_render (svg_element_t		*element,
 	status = (engine->apply_view_box) (closure, element->e.group.view_box,
 					   &element->e.group.width, &element->e.group.height);
     }
-    /* TODO : this is probably not the right place to change transform, but
-     atm we dont store svg_length_t in group, so... */
-    if (element->type == SVG_ELEMENT_TYPE_SVG_GROUP ||
-        element->type == SVG_ELEMENT_TYPE_USE)
-	_svg_transform_add_translate (&transform, element->e.group.x.value, element->e.group.y.value);
-
-    status = _svg_transform_render (&transform, engine, closure);
-    if (status) {
-	    fail_status = status;
-	    goto fail;
+    if (changes & SVG_RENDER_ELEMENT_TRANSFORM) {
+	status = _svg_transform_render (&transform, engine, closure);
+	if (status) {
+		fail_status = status;
+		goto fail;
+	}
     }
 
-    status = _svg_style_render (&element->style, engine, closure);
+    status = _svg_style_render (style, style_changes, parent_style, &render_style,
+				engine, closure);
     if (status) {
 	    fail_status = status;
 	    goto fail;
     }
+    /* the opacity of a layered group went to begin_group, the engine
+       leaves it out of the state its children start from */
+    if (group_opacity != 1.0)
+	render_style.opacity = 1.0;
+    element->doc->render_style = &render_style;
 
     /* If the element doesnt have children, we can check visibility property, otherwise
        the children will have to be processed. */
@@ -387,13 +725,17 @@ svg_element_render (svg_element_t		*element,
 	    fail_status = status;
 
 
-    (void) engine->get_last_bounding_box(closure, &(element->bounding_box));
+    if (engine->capabilities & SVG_RENDER_ENGINE_NEEDS_BOUNDING_BOX)
+	(void) engine->get_last_bounding_box(closure, &(element->bounding_box));
 
 fail:
+    element->doc->render_style = parent_style;
+    element->doc->fold_opacity = 1.0;
+
     if (element->type == SVG_ELEMENT_TYPE_SVG_GROUP
 	|| element->type == SVG_ELEMENT_TYPE_GROUP) {
 
-	status = (engine->end_group) (closure, _svg_style_get_opacity(&element->style));
+	status = (engine->end_group) (closure, group_opacity);
 	if (status && !return_status)
 	    return_status = status;
     } else {
@@ -697,7 +1039,7 @@ _svg_element_apply_attributes (svg_element_t	*element,
 	status = _svg_text_apply_attributes (&element->e.text, attributes);
 	break;
     case SVG_ELEMENT_TYPE_IMAGE:
-	status = _svg_image_apply_attributes (&element->e.image, attributes);
+	status = _svg_image_apply_attributes (element->doc, &element->e.image, attributes);
 	break;
     case SVG_ELEMENT_TYPE_GRADIENT:
 	status = _svg_gradient_apply_attributes (&element->e.gradient,
@@ -741,6 +1083,15 @@ svg_element_pattern (svg_element_t *element)
     return &element->e.pattern;
 }
 
+svg_status_t
+svg_element_flatten (svg_element_t *element, svg_polyline_t *polyline)
+{
+    if (element->type != SVG_ELEMENT_TYPE_PATH)
+	return SVG_STATUS_INVALID_CALL;
+
+    return _svg_path_flatten (&element->e.path, polyline);
+}
+
 svg_status_t _svg_element_init_copy (
 	const char *new_id,
 	svg_element_t   *element,
@@ -234,6 +234,7 @@ _svg_parser_parse_filter (svg_parser_t *parser,
 	/* The only thing that distinguishes a group from a leaf is that
 	   the group becomes the new parent for future elements. */
 	parser->state->filter_element = *filter_element;
+	parser->svg->uses_filters = 1;
 	(*filter_element)->e.filter.element = (*filter_element);
 
 	SVG_DEBUG("_svg_parser_parse_filter() created new Filter element (%p, %s, %d).\n",
@@ -165,8 +165,8 @@ _svg_group_render (svg_group_t		*group,
        doesn't include images with null data in the tree for
        example. */
     for (i=0; i < group->num_elements; i++) {
-	status = svg_element_render (group->element[i],
-				     engine, closure);
+	status = _svg_element_render (group->element[i],
+				      engine, closure);
 	if (status && !return_status)
 		return_status = status;
     }
@@ -21,6 +21,7 @@
 */
 
 #include <string.h>
+#include <stdint.h>
 #include <png.h>
 #include <jpeglib.h>
 #include <jerror.h>
@@ -54,6 +55,7 @@ _svg_image_init (svg_image_t *image)
     _svg_length_init_unit (&image->y, 0, SVG_LENGTH_UNIT_PX, SVG_LENGTH_ORIENTATION_VERTICAL);
     _svg_length_init_unit (&image->width, 0, SVG_LENGTH_UNIT_PX, SVG_LENGTH_ORIENTATION_HORIZONTAL);
     _svg_length_init_unit (&image->height, 0, SVG_LENGTH_UNIT_PX, SVG_LENGTH_ORIENTATION_VERTICAL);
+    _svg_length_cache_init (&image->lengths);
 
     image->url = NULL;
 
@@ -82,7 +84,7 @@ _svg_image_deinit (svg_t *doc, svg_image_t *image)
     }
 
     if (image->data) {
-	    if (doc->engine)
+	    if (doc->engine && doc->engine->free_image_cache)
 		    doc->engine->free_image_cache(doc->closure, (unsigned char *)image->data);
 	    free (image->data);
 	    image->data = NULL;
@@ -92,10 +94,12 @@ _svg_image_deinit (svg_t *doc, svg_image_t *image)
 }
 
 svg_status_t
-_svg_image_apply_attributes (svg_image_t	*image,
+_svg_image_apply_attributes (svg_t		*doc,
+			     svg_image_t	*image,
 			     const char		**attributes)
 {
     const char *aspect, *href;
+    char *url;
 
     _svg_attribute_get_length (attributes, "x", &image->x, "0");
     _svg_attribute_get_length (attributes, "y", &image->y, "0");
@@ -112,19 +116,24 @@ _svg_image_apply_attributes (svg_image_t	*image,
     if (image->width.value < 0 || image->height.value < 0)
 	return SVG_STATUS_PARSE_ERROR;
 
-    /* XXX: We really need to do something like this to resolve
-       relative URLs. It involves linking the tree up in the other
-       direction. Or, another approach would be to simply throw out
-       the SAX parser and use the tree interface of libxml2 which
-       takes care of things like xml:base for us.
-
-    image->url = _svg_element_resolve_uri_alloc (image->element, href);
-
-       For now, the bogus code below will let me test the rest of the
-       image support:
-    */
+    /* XXX: xml:base is not taken into account, only the base URI of
+       the document. */
+    url = _svg_resolve_uri_alloc (doc, href);
+    if (url == NULL)
+	return SVG_STATUS_NO_MEMORY;
+
+    if (image->url && strcmp (image->url, url) != 0) {
+	/* the decoded data (and whatever the engine made of it) is stale */
+	if (image->data) {
+	    if (doc->engine && doc->engine->free_image_cache)
+		doc->engine->free_image_cache(doc->closure, (unsigned char *)image->data);
+	    free (image->data);
+	    image->data = NULL;
+	}
+    }
+    free (image->url);
 
-    image->url = strdup ((char*)href);
+    image->url = url;
 
     return SVG_STATUS_SUCCESS;
 }
@@ -150,7 +159,8 @@ _svg_image_render (svg_image_t		*image,
 				     &image->x,
 				     &image->y,
 				     &image->width,
-				     &image->height);
+				     &image->height,
+				     &image->lengths);
     if (status)
 	return status;
 
@@ -200,12 +210,12 @@ premultiply_data (png_structp png, png_row_infop row_info, png_bytep data)
     for (i = 0; i < row_info->rowbytes; i += 4) {
 	unsigned char *b = &data[i];
 	unsigned char alpha = b[3];
-	unsigned long pixel = ((((b[0] * alpha) / 255) << 0) |
-			       (((b[1] * alpha) / 255) << 8) |
-			       (((b[2] * alpha) / 255) << 16) |
-			       (alpha << 24));
-	unsigned long *p = (unsigned long *) b;
-	*p = pixel;
+	/* one 32 bit pixel, whatever the size of a long */
+	uint32_t pixel = ((((b[0] * alpha) / 255) << 0) |
+			  (((b[1] * alpha) / 255) << 8) |
+			  (((b[2] * alpha) / 255) << 16) |
+			  ((uint32_t) alpha << 24));
+	memcpy (b, &pixel, sizeof (pixel));
     }
 }
 
@@ -21,6 +21,7 @@
 */
 
 #include <string.h>
+#include <math.h>
 
 #include "svgint.h"
 
@@ -93,3 +94,79 @@ _svg_length_deinit (svg_length_t *length)
     return SVG_STATUS_SUCCESS;
 }
 
+void
+_svg_length_cache_init (svg_length_cache_t *cache)
+{
+    cache->count = 0;
+}
+
+double
+svg_length_resolve (const svg_length_t		*length,
+		    const svg_length_context_t	*context)
+{
+    double width = context->viewport_width;
+    double height = context->viewport_height;
+
+    switch (length->unit) {
+    case SVG_LENGTH_UNIT_PX:
+	return length->value;
+    case SVG_LENGTH_UNIT_CM:
+	return (length->value / 2.54) * context->dpi;
+    case SVG_LENGTH_UNIT_MM:
+	return (length->value / 25.4) * context->dpi;
+    case SVG_LENGTH_UNIT_IN:
+	return length->value * context->dpi;
+    case SVG_LENGTH_UNIT_PT:
+	return (length->value / 72.0) * context->dpi;
+    case SVG_LENGTH_UNIT_PC:
+	return (length->value / 6.0) * context->dpi;
+    case SVG_LENGTH_UNIT_EM:
+	return length->value * context->font_size;
+    case SVG_LENGTH_UNIT_EX:
+	return length->value * context->font_size / 2.0;
+    case SVG_LENGTH_UNIT_PCT:
+	if (length->orientation == SVG_LENGTH_ORIENTATION_HORIZONTAL)
+	    return (length->value / 100.0) * width;
+	else if (length->orientation == SVG_LENGTH_ORIENTATION_VERTICAL)
+	    return (length->value / 100.0) * height;
+	else
+	    return (length->value / 100.0) * sqrt (width * width + height * height) * sqrt (2);
+    default:
+	return length->value;
+    }
+}
+
+static int
+_svg_length_context_equal (const svg_length_context_t *a,
+			   const svg_length_context_t *b)
+{
+    return a->viewport_width == b->viewport_width
+	&& a->viewport_height == b->viewport_height
+	&& a->font_size == b->font_size
+	&& a->dpi == b->dpi;
+}
+
+void
+svg_length_cache_resolve (svg_length_cache_t		*cache,
+			  const svg_length_context_t	*context,
+			  svg_length_t			**lengths,
+			  int				count,
+			  double			*values)
+{
+    int i;
+
+    if (cache == NULL || count > SVG_LENGTH_CACHE_SIZE) {
+	for (i = 0; i < count; i++)
+	    values[i] = svg_length_resolve (lengths[i], context);
+	return;
+    }
+
+    if (cache->count != count || !_svg_length_context_equal (&cache->context, context)) {
+	for (i = 0; i < count; i++)
+	    cache->value[i] = svg_length_resolve (lengths[i], context);
+	cache->context = *context;
+	cache->count = count;
+    }
+
+    memcpy (values, cache->value, count * sizeof (double));
+}
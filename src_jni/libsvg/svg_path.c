@@ -22,6 +22,7 @@
 
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
 #include <math.h>
 
 #include "svgint.h"
@@ -118,8 +119,13 @@ svg_status_t
 _svg_path_init (svg_path_t *path)
 {
 	path->cache = NULL;
+	path->generation = 0;
+	path->cache_generation = 0;
+	path->extents_valid = 0;
+	path->extents_generation = 0;
 
     path->last_path_op = SVG_PATH_OP_MOVE_TO;
+    path->keep_arcs = 0;
 
     path->last_move_pt.x = 0;
     path->last_move_pt.y = 0;
@@ -148,6 +154,7 @@ _svg_ellipse_init (svg_ellipse_t *ellipse)
     _svg_length_init_unit (&ellipse->cy, 0, SVG_LENGTH_UNIT_PX, SVG_LENGTH_ORIENTATION_VERTICAL);
     _svg_length_init_unit (&ellipse->rx, 0, SVG_LENGTH_UNIT_PX, SVG_LENGTH_ORIENTATION_HORIZONTAL);
     _svg_length_init_unit (&ellipse->ry, 0, SVG_LENGTH_UNIT_PX, SVG_LENGTH_ORIENTATION_VERTICAL);
+    _svg_length_cache_init (&ellipse->lengths);
 
     return SVG_STATUS_SUCCESS;
 }
@@ -164,6 +171,7 @@ _svg_line_init (svg_line_t *line)
 	_svg_length_init_unit (&line->y1, 0, SVG_LENGTH_UNIT_PX, SVG_LENGTH_ORIENTATION_VERTICAL);
 	_svg_length_init_unit (&line->x2, 0, SVG_LENGTH_UNIT_PX, SVG_LENGTH_ORIENTATION_HORIZONTAL);
 	_svg_length_init_unit (&line->y2, 0, SVG_LENGTH_UNIT_PX, SVG_LENGTH_ORIENTATION_VERTICAL);
+	_svg_length_cache_init (&line->lengths);
 
     return SVG_STATUS_SUCCESS;
 }
@@ -182,6 +190,7 @@ _svg_rect_init (svg_rect_element_t *rect)
 	_svg_length_init_unit (&rect->height, 0, SVG_LENGTH_UNIT_PX, SVG_LENGTH_ORIENTATION_VERTICAL);
 	_svg_length_init_unit (&rect->rx, 0, SVG_LENGTH_UNIT_PX, SVG_LENGTH_ORIENTATION_HORIZONTAL);
 	_svg_length_init_unit (&rect->ry, 0, SVG_LENGTH_UNIT_PX, SVG_LENGTH_ORIENTATION_VERTICAL);
+	_svg_length_cache_init (&rect->lengths);
 
     return SVG_STATUS_SUCCESS;
 }
@@ -196,34 +205,182 @@ static svg_status_t _svg_path_do_nothing (void *closure, void **path_cache) {
     return SVG_STATUS_SUCCESS;
 }
 
+/* An ugly little hack. Cleaner would be to fix up the
+   render_engine so that the 4 relevant fields here made part of a
+   new path_interpreter struct */
+static svg_render_engine_t svg_path_copy_engine = {
+	.move_to = (svg_status_t (*) (void *, double, double)) _svg_path_move_to,
+	.line_to = (svg_status_t (*) (void *, double, double)) _svg_path_line_to,
+	.curve_to = (svg_status_t (*) (void *,
+				       double, double,
+				       double, double,
+				       double, double)) _svg_path_curve_to,
+	.quadratic_curve_to = (svg_status_t (*) (void *,
+						 double, double,
+						 double, double)) _svg_path_quadratic_curve_to,
+	.arc_to = (svg_status_t (*) (void *,
+				     double, double, double,
+				     int, int,
+				     double, double)) _svg_path_arc_to,
+	.close_path = (svg_status_t (*) (void *)) _svg_path_close_path,
+	.render_path = _svg_path_do_nothing, // <-- the render_path() function should point to "do_nothing" since we don't WANT to render anything here..
+	.capabilities = SVG_RENDER_ENGINE_NATIVE_ARCS, // keep arcs and quads as they are in the copy
+};
+
 svg_status_t _svg_path_init_copy (svg_path_t *path,
 				  svg_path_t *other) {
-	/* An ugly little hack. Cleaner would be to fix up the
-	   render_engine so that the 4 relevant fields here made part of a
-	   new path_interpreter struct */
-	static svg_render_engine_t svg_path_copy_engine = {
-		.move_to = (svg_status_t (*) (void *, double, double)) _svg_path_move_to,
-		.line_to = (svg_status_t (*) (void *, double, double)) _svg_path_line_to,
-		.curve_to = (svg_status_t (*) (void *,
-					       double, double,
-					       double, double,
-					       double, double)) _svg_path_curve_to,
-		.quadratic_curve_to = (svg_status_t (*) (void *,
-							 double, double,
-							 double, double)) _svg_path_quadratic_curve_to,
-		.arc_to = (svg_status_t (*) (void *,
-					     double, double, double,
-					     int, int,
-					     double, double)) _svg_path_arc_to,
-		.close_path = (svg_status_t (*) (void *)) _svg_path_close_path,
-		.render_path = _svg_path_do_nothing, // <-- the render_path() function should point to "do_nothing" since we don't WANT to render anything here..
-	};
-
 	_svg_path_init (path);
+	path->keep_arcs = other->keep_arcs;
 
 	return _svg_path_render (other, &svg_path_copy_engine, path, 0);
 }
 
+/* The same trick once more, this time feeding a polyline. Asking for
+   cubics only leaves us with lines and cubic curves to handle. */
+static svg_status_t
+_svg_path_flatten_move_to (void *closure, double x, double y)
+{
+    svg_polyline_t *polyline = closure;
+
+    svg_polyline_move_to (polyline, x, y);
+    return polyline->error ? SVG_STATUS_NO_MEMORY : SVG_STATUS_SUCCESS;
+}
+
+static svg_status_t
+_svg_path_flatten_line_to (void *closure, double x, double y)
+{
+    svg_polyline_t *polyline = closure;
+
+    svg_polyline_line_to (polyline, x, y);
+    return polyline->error ? SVG_STATUS_NO_MEMORY : SVG_STATUS_SUCCESS;
+}
+
+static svg_status_t
+_svg_path_flatten_curve_to (void *closure,
+			    double x1, double y1,
+			    double x2, double y2,
+			    double x3, double y3)
+{
+    svg_polyline_t *polyline = closure;
+    svg_polyline_subpath_t *subpath;
+    svg_polyline_point_t *current;
+
+    if (polyline->num_subpaths == 0)
+	svg_polyline_move_to (polyline, x1, y1);
+    if (polyline->error)
+	return SVG_STATUS_NO_MEMORY;
+
+    /* after a close_path the current point is back at the start */
+    subpath = &polyline->subpaths[polyline->num_subpaths - 1];
+    current = &polyline->points[subpath->closed ?
+				subpath->first : subpath->first + subpath->count - 1];
+
+    svg_polyline_curve_to (polyline,
+			   SVG_COORD_TO_DOUBLE (current->x), SVG_COORD_TO_DOUBLE (current->y),
+			   x1, y1, x2, y2, x3, y3);
+    return polyline->error ? SVG_STATUS_NO_MEMORY : SVG_STATUS_SUCCESS;
+}
+
+static svg_status_t
+_svg_path_flatten_close_path (void *closure)
+{
+    svg_polyline_close_path (closure);
+    return SVG_STATUS_SUCCESS;
+}
+
+svg_status_t
+_svg_path_flatten (svg_path_t *path, svg_polyline_t *polyline)
+{
+	static svg_render_engine_t svg_path_flatten_engine = {
+		.move_to = _svg_path_flatten_move_to,
+		.line_to = _svg_path_flatten_line_to,
+		.curve_to = _svg_path_flatten_curve_to,
+		.close_path = _svg_path_flatten_close_path,
+		.render_path = _svg_path_do_nothing,
+		.capabilities = SVG_RENDER_ENGINE_CUBICS_ONLY,
+	};
+
+	return _svg_path_render (path, &svg_path_flatten_engine, polyline, 0);
+}
+
+/* And to take the extents, where the control points of the curves
+   will do in place of the curves themselves. */
+static svg_status_t
+_svg_path_extents_point (void *closure, double x, double y)
+{
+    double *extents = closure;
+
+    if (x < extents[0])
+	extents[0] = x;
+    if (y < extents[1])
+	extents[1] = y;
+    if (x > extents[2])
+	extents[2] = x;
+    if (y > extents[3])
+	extents[3] = y;
+
+    return SVG_STATUS_SUCCESS;
+}
+
+static svg_status_t
+_svg_path_extents_curve_to (void *closure,
+			    double x1, double y1,
+			    double x2, double y2,
+			    double x3, double y3)
+{
+    _svg_path_extents_point (closure, x1, y1);
+    _svg_path_extents_point (closure, x2, y2);
+    return _svg_path_extents_point (closure, x3, y3);
+}
+
+static svg_status_t
+_svg_path_extents_close_path (void *closure)
+{
+    return SVG_STATUS_SUCCESS;
+}
+
+/* The extents of the path as { x1, y1, x2, y2 }, with x1 > x2 for a
+   path without points. They are kept until the geometry changes. */
+void
+_svg_path_extents (svg_path_t *path, double *extents)
+{
+	static svg_render_engine_t svg_path_extents_engine = {
+		.move_to = _svg_path_extents_point,
+		.line_to = _svg_path_extents_point,
+		.curve_to = _svg_path_extents_curve_to,
+		.close_path = _svg_path_extents_close_path,
+		.render_path = _svg_path_do_nothing,
+		.capabilities = SVG_RENDER_ENGINE_CUBICS_ONLY,
+	};
+
+	if (! path->extents_valid || path->extents_generation != path->generation) {
+		path->extents[0] = path->extents[1] = HUGE_VAL;
+		path->extents[2] = path->extents[3] = -HUGE_VAL;
+		_svg_path_render (path, &svg_path_extents_engine, path->extents, 0);
+		path->extents_valid = 1;
+		path->extents_generation = path->generation;
+	}
+
+	memcpy (extents, path->extents, sizeof (path->extents));
+}
+
+/* The engine's cached copy of the path, or NULL if there is none or the
+   geometry changed since it was made (a stale copy is released here). */
+void *
+_svg_path_cache (svg_t *doc, svg_path_t *path)
+{
+    if (! doc->do_path_cache)
+	return NULL;
+
+    if (path->cache && path->cache_generation != path->generation) {
+	if (doc->engine && doc->engine->free_path_cache)
+	    doc->engine->free_path_cache (doc->closure, &(path->cache));
+	path->cache = NULL;
+    }
+
+    return path->cache;
+}
+
 static int _svg_path_is_empty (svg_path_t *path) {
     return path->op_head == NULL;
 }
@@ -256,6 +413,146 @@ _svg_path_deinit (svg_t *doc, svg_path_t *path)
     return SVG_STATUS_SUCCESS;
 }
 
+/* The arc conversion functions below are:
+
+   Copyright (C) 2000 Eazel, Inc.
+
+   Author: Raph Levien <raph@artofcode.com>
+
+   This is adapted from svg-path in Gill.
+*/
+static svg_status_t
+_svg_path_arc_segment (svg_render_engine_t	*engine,
+		       void			*closure,
+		       double xc, double yc,
+		       double th0, double th1,
+		       double rx, double ry, double x_axis_rotation)
+{
+    double sin_th, cos_th;
+    double a00, a01, a10, a11;
+    double x1, y1, x2, y2, x3, y3;
+    double t;
+    double th_half;
+
+    sin_th = sin (x_axis_rotation * (M_PI / 180.0));
+    cos_th = cos (x_axis_rotation * (M_PI / 180.0));
+    /* inverse transform compared with rsvg_path_arc */
+    a00 = cos_th * rx;
+    a01 = -sin_th * ry;
+    a10 = sin_th * rx;
+    a11 = cos_th * ry;
+
+    th_half = 0.5 * (th1 - th0);
+    t = (8.0 / 3.0) * sin (th_half * 0.5) * sin (th_half * 0.5) / sin (th_half);
+    x1 = xc + cos (th0) - t * sin (th0);
+    y1 = yc + sin (th0) + t * cos (th0);
+    x3 = xc + cos (th1);
+    y3 = yc + sin (th1);
+    x2 = x3 + t * sin (th1);
+    y2 = y3 - t * cos (th1);
+
+    return (engine->curve_to) (closure,
+			       a00 * x1 + a01 * y1, a10 * x1 + a11 * y1,
+			       a00 * x2 + a01 * y2, a10 * x2 + a11 * y2,
+			       a00 * x3 + a01 * y3, a10 * x3 + a11 * y3);
+}
+
+/* Emit an elliptical arc from (curx, cury) as a series of curve_to
+   calls, for engines that do not implement arc_to themselves. */
+static svg_status_t
+_svg_path_arc_to_curves (svg_render_engine_t	*engine,
+			 void			*closure,
+			 double			curx,
+			 double			cury,
+			 double			rx,
+			 double			ry,
+			 double			x_axis_rotation,
+			 int			large_arc_flag,
+			 int			sweep_flag,
+			 double			x,
+			 double			y)
+{
+    svg_status_t status;
+    double sin_th, cos_th;
+    double a00, a01, a10, a11;
+    double x0, y0, x1, y1, xc, yc;
+    double d, sfactor, sfactor_sq;
+    double th0, th1, th_arc;
+    int i, n_segs;
+    double dx, dy, dx1, dy1, Pr1, Pr2, Px, Py, check;
+
+    rx = fabs (rx);
+    ry = fabs (ry);
+
+    /* Spec : a zero radius degenerates to a straight line */
+    if (rx == 0 || ry == 0)
+	return (engine->line_to) (closure, x, y);
+
+    sin_th = sin (x_axis_rotation * (M_PI / 180.0));
+    cos_th = cos (x_axis_rotation * (M_PI / 180.0));
+
+    dx = (curx - x) / 2.0;
+    dy = (cury - y) / 2.0;
+    dx1 =  cos_th * dx + sin_th * dy;
+    dy1 = -sin_th * dx + cos_th * dy;
+    Pr1 = rx * rx;
+    Pr2 = ry * ry;
+    Px = dx1 * dx1;
+    Py = dy1 * dy1;
+    /* Spec : check if radii are large enough */
+    check = Px / Pr1 + Py / Pr2;
+    if (check > 1) {
+	rx = rx * sqrt (check);
+	ry = ry * sqrt (check);
+    }
+
+    a00 = cos_th / rx;
+    a01 = sin_th / rx;
+    a10 = -sin_th / ry;
+    a11 = cos_th / ry;
+    x0 = a00 * curx + a01 * cury;
+    y0 = a10 * curx + a11 * cury;
+    x1 = a00 * x + a01 * y;
+    y1 = a10 * x + a11 * y;
+    /* (x0, y0) is current point in transformed coordinate space.
+       (x1, y1) is new point in transformed coordinate space.
+
+       The arc fits a unit-radius circle in this space.
+    */
+    d = (x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0);
+    if (d == 0)
+	return SVG_STATUS_SUCCESS;
+    sfactor_sq = 1.0 / d - 0.25;
+    if (sfactor_sq < 0) sfactor_sq = 0;
+    sfactor = sqrt (sfactor_sq);
+    if (sweep_flag == large_arc_flag) sfactor = -sfactor;
+    xc = 0.5 * (x0 + x1) - sfactor * (y1 - y0);
+    yc = 0.5 * (y0 + y1) + sfactor * (x1 - x0);
+    /* (xc, yc) is center of the circle. */
+
+    th0 = atan2 (y0 - yc, x0 - xc);
+    th1 = atan2 (y1 - yc, x1 - xc);
+
+    th_arc = th1 - th0;
+    if (th_arc < 0 && sweep_flag)
+	th_arc += 2 * M_PI;
+    else if (th_arc > 0 && !sweep_flag)
+	th_arc -= 2 * M_PI;
+
+    n_segs = ceil (fabs (th_arc / (M_PI * 0.5 + 0.001)));
+
+    for (i = 0; i < n_segs; i++) {
+	status = _svg_path_arc_segment (engine, closure, xc, yc,
+					th0 + i * th_arc / n_segs,
+					th0 + (i + 1) * th_arc / n_segs,
+					rx, ry, x_axis_rotation);
+	if (status)
+	    return status;
+    }
+
+    return SVG_STATUS_SUCCESS;
+}
+
 svg_status_t
 _svg_path_render (svg_path_t		*path,
 		  svg_render_engine_t	*engine,
@@ -269,6 +566,11 @@ _svg_path_render (svg_path_t		*path,
     svg_path_op_t op;
     svg_path_arg_buf_t *arg_buf = path->arg_head;
     int buf_i = 0;
+    /* current point and start of the current subpath, only needed
+       when we convert quads or arcs on behalf of the engine */
+    double cur_x = 0, cur_y = 0, move_x = 0, move_y = 0;
+    int cubics_only = engine->capabilities & SVG_RENDER_ENGINE_CUBICS_ONLY;
+    int native_arcs = (engine->capabilities & SVG_RENDER_ENGINE_NATIVE_ARCS) && !cubics_only;
 
     if(! (do_cache && (path->cache != NULL))) {
 	    for (op_buf = path->op_head; op_buf; op_buf = op_buf->next) {
@@ -287,29 +589,59 @@ _svg_path_render (svg_path_t		*path,
 			    switch (op) {
 			    case SVG_PATH_OP_MOVE_TO:
 				    status = (engine->move_to) (closure, arg[0], arg[1]);
+				    move_x = cur_x = arg[0];
+				    move_y = cur_y = arg[1];
 				    break;
 			    case SVG_PATH_OP_LINE_TO:
 				    status = (engine->line_to) (closure, arg[0], arg[1]);
+				    cur_x = arg[0];
+				    cur_y = arg[1];
 				    break;
 			    case SVG_PATH_OP_CURVE_TO:
 				    status = (engine->curve_to) (closure,
 								 arg[0], arg[1],
 								 arg[2], arg[3],
 								 arg[4], arg[5]);
+				    cur_x = arg[4];
+				    cur_y = arg[5];
 				    break;
 			    case SVG_PATH_OP_QUAD_TO:
-				    status = (engine->quadratic_curve_to) (closure,
-									   arg[0], arg[1],
-									   arg[2], arg[3]);
+				    if (cubics_only) {
+					    /* degree elevation of the quadratic */
+					    status = (engine->curve_to) (closure,
+									 cur_x + 2.0 / 3.0 * (arg[0] - cur_x),
+									 cur_y + 2.0 / 3.0 * (arg[1] - cur_y),
+									 arg[2] + 2.0 / 3.0 * (arg[0] - arg[2]),
+									 arg[3] + 2.0 / 3.0 * (arg[1] - arg[3]),
+									 arg[2], arg[3]);
+				    } else {
+					    status = (engine->quadratic_curve_to) (closure,
+										   arg[0], arg[1],
+										   arg[2], arg[3]);
+				    }
+				    cur_x = arg[2];
+				    cur_y = arg[3];
 				    break;
 			    case SVG_PATH_OP_ARC_TO:
-				    status = (engine->arc_to) (closure,
-							       arg[0], arg[1],
-							       arg[2], arg[3], arg[4],
-							       arg[5], arg[6]);
+				    if (native_arcs) {
+					    status = (engine->arc_to) (closure,
+								       arg[0], arg[1],
+								       arg[2], arg[3], arg[4],
+								       arg[5], arg[6]);
+				    } else {
+					    status = _svg_path_arc_to_curves (engine, closure,
+									      cur_x, cur_y,
+									      arg[0], arg[1],
+									      arg[2], arg[3], arg[4],
+									      arg[5], arg[6]);
+				    }
+				    cur_x = arg[5];
+				    cur_y = arg[6];
 				    break;
 			    case SVG_PATH_OP_CLOSE_PATH:
 				    status = (engine->close_path) (closure);
+				    cur_x = move_x;
+				    cur_y = move_y;
 				    break;
 			    }
 			    if (status)
@@ -322,6 +654,9 @@ _svg_path_render (svg_path_t		*path,
     if (status)
 	return status;
 
+    if (do_cache && path->cache)
+	path->cache_generation = path->generation;
+
     return SVG_STATUS_SUCCESS;
 }
 
@@ -516,6 +851,9 @@ _svg_path_add_va (svg_path_t *path, svg_path_op_t op, va_list va)
     cmd_info = &SVG_PATH_CMD_INFO[op];
     num_args = cmd_info->num_args;
 
+    /* whatever the engine cached is stale from now on */
+    path->generation++;
+
     if (path->op_tail == NULL || path->op_tail->num_ops + 1 > SVG_PATH_BUF_SZ) {
         status = _svg_path_new_op_buf (path);
         if (status)
@@ -755,7 +1093,8 @@ _svg_line_render (svg_line_t	*line,
 {
     return (engine->render_line) (closure,
 				  &line->x1, &line->y1,
-				  &line->x2, &line->y2);
+				  &line->x2, &line->y2,
+				  &line->lengths);
 }
 
 svg_status_t
@@ -766,7 +1105,8 @@ _svg_rect_render (svg_rect_element_t	*rect,
     return (engine->render_rect) (closure,
 				  &rect->x, &rect->y,
 				  &rect->width, &rect->height,
-				  &rect->rx, &rect->ry);
+				  &rect->rx, &rect->ry,
+				  &rect->lengths);
 }
 
 svg_status_t
@@ -779,7 +1119,8 @@ _svg_circle_render (svg_ellipse_t	*circle,
 
     return (engine->render_ellipse) (closure,
 				     &circle->cx, &circle->cy,
-				     &circle->rx, &circle->rx);
+				     &circle->rx, &circle->rx,
+				     &circle->lengths);
 }
 
 svg_status_t
@@ -792,7 +1133,8 @@ _svg_ellipse_render (svg_ellipse_t	*ellipse,
 
     return (engine->render_ellipse) (closure,
 				     &ellipse->cx, &ellipse->cy,
-				     &ellipse->rx, &ellipse->ry);
+				     &ellipse->rx, &ellipse->ry,
+				     &ellipse->lengths);
 }
 
 /**
@@ -819,10 +1161,22 @@ _svg_path_arc_to (svg_path_t	*path,
 {
     svg_status_t status;
 
-    status = _svg_path_add (path, SVG_PATH_OP_ARC_TO,
-			    rx, ry, x_axis_rotation,
-			    (double) large_arc_flag, (double) sweep_flag,
-			    x, y);
+    if (path->keep_arcs) {
+	status = _svg_path_add (path, SVG_PATH_OP_ARC_TO,
+				rx, ry, x_axis_rotation,
+				(double) large_arc_flag, (double) sweep_flag,
+				x, y);
+    } else {
+	/* Do the trigonometry once, here, rather than on every render.
+	   The curves are added through the copy engine, which leaves
+	   the last op and the current point to be set right below. */
+	status = _svg_path_arc_to_curves (&svg_path_copy_engine, path,
+					  path->current_pt.x, path->current_pt.y,
+					  rx, ry, x_axis_rotation,
+					  large_arc_flag, sweep_flag,
+					  x, y);
+	path->last_path_op = SVG_PATH_OP_ARC_TO;
+    }
 
     path->current_pt.x = x;
     path->current_pt.y = y;
@@ -0,0 +1,466 @@
+/*
+ * svg_polyline.c
+ *
+ * part of libsvgandroid
+ *
+ * Copyright 2016 by Anton Persson ( https://github.com/pltxtra/libsvgandroid )
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ *  Boston, MA 02111-1307, USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "svgint.h"
+
+/* Paths are flattened as they are built, so whoever consumes a
+   polyline only ever sees straight lines. The buffers only grow, keep
+   a polyline around and clear it between paths.
+
+   Curves are split into as few lines as keep within the tolerance of
+   the polyline. The count comes straight from the control points
+   (Wang's formula), so there is no recursion and no flatness test per
+   piece. Set the tolerance to the allowed error in device pixels
+   divided by the scale of the transformation, the default is meant
+   for a polyline drawn at scale 1.
+
+   With LIBSVG_FIXED_POINT the points are kept in 16.16 fixed point,
+   and curves are flattened in integer arithmetic as well. Only the
+   coordinates passed in are converted, once each. */
+
+#define SVG_POLYLINE_DEFAULT_TOLERANCE 0.25
+
+/* keeps huge or broken coordinates from eating all memory */
+#define SVG_POLYLINE_MAX_SEGMENTS 1024
+
+/* 4 * (sqrt(2) - 1) / 3, the control point distance of a quarter circle */
+#define SVG_POLYLINE_KAPPA 0.5522847498307936
+
+void
+svg_polyline_init (svg_polyline_t *polyline)
+{
+    memset (polyline, 0, sizeof (svg_polyline_t));
+    polyline->tolerance = SVG_POLYLINE_DEFAULT_TOLERANCE;
+}
+
+void
+svg_polyline_deinit (svg_polyline_t *polyline)
+{
+    free (polyline->points);
+    free (polyline->subpaths);
+    svg_polyline_init (polyline);
+}
+
+void
+svg_polyline_clear (svg_polyline_t *polyline)
+{
+    polyline->num_points = 0;
+    polyline->num_subpaths = 0;
+    polyline->has_extents = 0;
+    polyline->error = 0;
+}
+
+svg_coord_t
+svg_coord_from_double (double value)
+{
+#ifdef LIBSVG_FIXED_POINT
+    /* NaN ends up at the lower limit too */
+    if (! (value > -32767.0))
+	return -32767 * SVG_COORD_ONE;
+    if (value >= 32767.0)
+	return 32767 * SVG_COORD_ONE;
+
+    return (svg_coord_t) (value * SVG_COORD_ONE + (value < 0.0 ? -0.5 : 0.5));
+#else
+    return value;
+#endif
+}
+
+static void
+_svg_polyline_extend (svg_polyline_t *polyline, svg_coord_t x, svg_coord_t y)
+{
+    if (! polyline->has_extents) {
+	polyline->x1 = polyline->x2 = x;
+	polyline->y1 = polyline->y2 = y;
+	polyline->has_extents = 1;
+	return;
+    }
+
+    if (x < polyline->x1) polyline->x1 = x;
+    if (y < polyline->y1) polyline->y1 = y;
+    if (x > polyline->x2) polyline->x2 = x;
+    if (y > polyline->y2) polyline->y2 = y;
+}
+
+static void
+_svg_polyline_add_point (svg_polyline_t *polyline, svg_coord_t x, svg_coord_t y)
+{
+    if (polyline->num_points == polyline->points_size) {
+	int new_size = polyline->points_size ? 2 * polyline->points_size : 64;
+	svg_polyline_point_t *new_points =
+	    realloc (polyline->points, new_size * sizeof (svg_polyline_point_t));
+
+	if (new_points == NULL) {
+	    polyline->error = 1;
+	    return;
+	}
+
+	polyline->points = new_points;
+	polyline->points_size = new_size;
+    }
+
+    polyline->points[polyline->num_points].x = x;
+    polyline->points[polyline->num_points].y = y;
+    polyline->num_points++;
+
+    if (polyline->num_subpaths)
+	polyline->subpaths[polyline->num_subpaths - 1].count++;
+}
+
+static void
+_svg_polyline_move_to (svg_polyline_t *polyline, svg_coord_t x, svg_coord_t y)
+{
+    svg_polyline_subpath_t *subpath;
+
+    /* a lonely move_to is replaced by the next one */
+    if (polyline->num_subpaths &&
+	polyline->subpaths[polyline->num_subpaths - 1].count == 1 &&
+	! polyline->subpaths[polyline->num_subpaths - 1].closed) {
+	polyline->num_subpaths--;
+	polyline->num_points--;
+    }
+
+    if (polyline->num_subpaths == polyline->subpaths_size) {
+	int new_size = polyline->subpaths_size ? 2 * polyline->subpaths_size : 8;
+	svg_polyline_subpath_t *new_subpaths =
+	    realloc (polyline->subpaths, new_size * sizeof (svg_polyline_subpath_t));
+
+	if (new_subpaths == NULL) {
+	    polyline->error = 1;
+	    return;
+	}
+
+	polyline->subpaths = new_subpaths;
+	polyline->subpaths_size = new_size;
+    }
+
+    subpath = &polyline->subpaths[polyline->num_subpaths++];
+    subpath->first = polyline->num_points;
+    subpath->count = 0;
+    subpath->closed = 0;
+
+    _svg_polyline_add_point (polyline, x, y);
+    _svg_polyline_extend (polyline, x, y);
+}
+
+static void
+_svg_polyline_line_to (svg_polyline_t *polyline, svg_coord_t x, svg_coord_t y)
+{
+    if (polyline->num_subpaths == 0) {
+	_svg_polyline_move_to (polyline, x, y);
+	return;
+    }
+
+    /* drawing on after a close_path starts over where the subpath started */
+    if (polyline->subpaths[polyline->num_subpaths - 1].closed) {
+	svg_polyline_point_t *start =
+	    &polyline->points[polyline->subpaths[polyline->num_subpaths - 1].first];
+	_svg_polyline_move_to (polyline, start->x, start->y);
+    }
+
+    _svg_polyline_add_point (polyline, x, y);
+    _svg_polyline_extend (polyline, x, y);
+}
+
+void
+svg_polyline_move_to (svg_polyline_t *polyline, double x, double y)
+{
+    _svg_polyline_move_to (polyline, svg_coord_from_double (x), svg_coord_from_double (y));
+}
+
+void
+svg_polyline_line_to (svg_polyline_t *polyline, double x, double y)
+{
+    _svg_polyline_line_to (polyline, svg_coord_from_double (x), svg_coord_from_double (y));
+}
+
+void
+svg_polyline_close_path (svg_polyline_t *polyline)
+{
+    if (polyline->num_subpaths)
+	polyline->subpaths[polyline->num_subpaths - 1].closed = 1;
+}
+
+#ifdef LIBSVG_FIXED_POINT
+
+/* the smallest n with n * n >= value */
+static int64_t
+_svg_polyline_isqrt_ceil (int64_t value)
+{
+    int64_t n = 0, bit = (int64_t) 1 << 30;
+
+    while (bit) {
+	if ((n + bit) * (n + bit) <= value)
+	    n += bit;
+	bit >>= 1;
+    }
+
+    return n * n < value ? n + 1 : n;
+}
+
+/* Wang's formula as below, on the largest component of the second
+   differences instead of their length. That over-estimates by up
+   to sqrt(2), which is paid for with the 181 / 128. */
+static int
+_svg_polyline_curve_segments (svg_coord_t tolerance, const int64_t *x, const int64_t *y)
+{
+    int64_t m = 0, d, n;
+    int k;
+
+    for (k = 0; k < 2; k++) {
+	d = x[k] - 2 * x[k + 1] + x[k + 2];
+	if (d < 0) d = -d;
+	if (d > m) m = d;
+	d = y[k] - 2 * y[k + 1] + y[k + 2];
+	if (d < 0) d = -d;
+	if (d > m) m = d;
+    }
+
+    if (tolerance < 1)
+	tolerance = 1;
+
+    n = _svg_polyline_isqrt_ceil ((3 * m * 181 / 128 + 4 * tolerance - 1) / (4 * tolerance));
+
+    if (n < 1)
+	return 1;
+    if (n > SVG_POLYLINE_MAX_SEGMENTS)
+	return SVG_POLYLINE_MAX_SEGMENTS;
+
+    return (int) n;
+}
+
+void
+svg_polyline_curve_to (svg_polyline_t *polyline,
+		       double x0, double y0,
+		       double x1, double y1,
+		       double x2, double y2,
+		       double x3, double y3)
+{
+    double tolerance = polyline->tolerance > 0.0 ?
+	polyline->tolerance : SVG_POLYLINE_DEFAULT_TOLERANCE;
+    int64_t x[4], y[4], ax, bx, cx, ay, by, cy, t;
+    int k, n;
+
+    x[0] = svg_coord_from_double (x0); y[0] = svg_coord_from_double (y0);
+    x[1] = svg_coord_from_double (x1); y[1] = svg_coord_from_double (y1);
+    x[2] = svg_coord_from_double (x2); y[2] = svg_coord_from_double (y2);
+    x[3] = svg_coord_from_double (x3); y[3] = svg_coord_from_double (y3);
+
+    _svg_polyline_extend (polyline, x[1], y[1]);
+    _svg_polyline_extend (polyline, x[2], y[2]);
+
+    n = _svg_polyline_curve_segments (svg_coord_from_double (tolerance), x, y);
+
+    /* the polynomial coefficients, evaluated with Horner's rule for
+       every point - no error builds up the way forward differences
+       would let it in fixed point */
+    ax = x[3] - x[0] + 3 * (x[1] - x[2]);
+    bx = 3 * (x[0] - 2 * x[1] + x[2]);
+    cx = 3 * (x[1] - x[0]);
+    ay = y[3] - y[0] + 3 * (y[1] - y[2]);
+    by = 3 * (y[0] - 2 * y[1] + y[2]);
+    cy = 3 * (y[1] - y[0]);
+
+    for (k = 1; k < n; k++) {
+	t = ((int64_t) k << 16) / n;
+
+	_svg_polyline_line_to (polyline,
+			       (svg_coord_t) (((((ax * t >> 16) + bx) * t >> 16) + cx) * t >> 16) + x[0],
+			       (svg_coord_t) (((((ay * t >> 16) + by) * t >> 16) + cy) * t >> 16) + y[0]);
+    }
+
+    _svg_polyline_line_to (polyline, (svg_coord_t) x[3], (svg_coord_t) y[3]);
+}
+
+#else /* LIBSVG_FIXED_POINT */
+
+/* Number of lines needed to keep within tolerance of a cubic. The
+   second differences of the control points bound the second
+   derivative, which bounds how far a chord strays from the curve.
+   A quadratic raised to a cubic gives the same count it would get on
+   its own. */
+static int
+_svg_polyline_curve_segments (double tolerance,
+			      double x0, double y0,
+			      double x1, double y1,
+			      double x2, double y2,
+			      double x3, double y3)
+{
+    double ax = x0 - 2.0 * x1 + x2, ay = y0 - 2.0 * y1 + y2;
+    double bx = x1 - 2.0 * x2 + x3, by = y1 - 2.0 * y2 + y3;
+    double m = sqrt (ax * ax + ay * ay), mb = sqrt (bx * bx + by * by);
+    double n;
+
+    if (mb > m)
+	m = mb;
+
+    n = ceil (sqrt (0.75 * m / tolerance));
+
+    if (! (n >= 1.0)) /* NaN as well */
+	return 1;
+    if (n > SVG_POLYLINE_MAX_SEGMENTS)
+	return SVG_POLYLINE_MAX_SEGMENTS;
+
+    return (int) n;
+}
+
+void
+svg_polyline_curve_to (svg_polyline_t *polyline,
+		       double x0, double y0,
+		       double x1, double y1,
+		       double x2, double y2,
+		       double x3, double y3)
+{
+    double tolerance = polyline->tolerance > 0.0 ?
+	polyline->tolerance : SVG_POLYLINE_DEFAULT_TOLERANCE;
+    double h, h2, h3, x, y, dx, dy, ddx, ddy, dddx, dddy;
+    int k, n;
+
+    _svg_polyline_extend (polyline, x1, y1);
+    _svg_polyline_extend (polyline, x2, y2);
+
+    n = _svg_polyline_curve_segments (tolerance, x0, y0, x1, y1, x2, y2, x3, y3);
+
+    /* forward differences, step h = 1 / n */
+    h = 1.0 / n; h2 = h * h; h3 = h2 * h;
+
+    x = x0; y = y0;
+    dx = 3.0 * (x1 - x0) * h + 3.0 * (x0 - 2.0 * x1 + x2) * h2 +
+	(x3 - x0 + 3.0 * (x1 - x2)) * h3;
+    dy = 3.0 * (y1 - y0) * h + 3.0 * (y0 - 2.0 * y1 + y2) * h2 +
+	(y3 - y0 + 3.0 * (y1 - y2)) * h3;
+    ddx = 6.0 * (x0 - 2.0 * x1 + x2) * h2 + 6.0 * (x3 - x0 + 3.0 * (x1 - x2)) * h3;
+    ddy = 6.0 * (y0 - 2.0 * y1 + y2) * h2 + 6.0 * (y3 - y0 + 3.0 * (y1 - y2)) * h3;
+    dddx = 6.0 * (x3 - x0 + 3.0 * (x1 - x2)) * h3;
+    dddy = 6.0 * (y3 - y0 + 3.0 * (y1 - y2)) * h3;
+
+    for (k = 1; k < n; k++) {
+	x += dx; y += dy;
+	dx += ddx; dy += ddy;
+	ddx += dddx; ddy += dddy;
+
+	_svg_polyline_line_to (polyline, x, y);
+    }
+
+    /* the end point exactly, whatever rounding did to the last step */
+    _svg_polyline_line_to (polyline, x3, y3);
+}
+
+#endif /* LIBSVG_FIXED_POINT */
+
+void
+svg_polyline_ellipse (svg_polyline_t *polyline,
+		      double cx, double cy, double rx, double ry)
+{
+    double kx = rx * SVG_POLYLINE_KAPPA, ky = ry * SVG_POLYLINE_KAPPA;
+
+    svg_polyline_move_to (polyline, cx + rx, cy);
+    svg_polyline_curve_to (polyline, cx + rx, cy, cx + rx, cy + ky, cx + kx, cy + ry, cx, cy + ry);
+    svg_polyline_curve_to (polyline, cx, cy + ry, cx - kx, cy + ry, cx - rx, cy + ky, cx - rx, cy);
+    svg_polyline_curve_to (polyline, cx - rx, cy, cx - rx, cy - ky, cx - kx, cy - ry, cx, cy - ry);
+    svg_polyline_curve_to (polyline, cx, cy - ry, cx + kx, cy - ry, cx + rx, cy - ky, cx + rx, cy);
+    svg_polyline_close_path (polyline);
+}
+
+void
+svg_polyline_rect (svg_polyline_t *polyline,
+		   double x, double y, double width, double height,
+		   double rx, double ry)
+{
+    double kx = rx * SVG_POLYLINE_KAPPA, ky = ry * SVG_POLYLINE_KAPPA;
+    double x2 = x + width, y2 = y + height;
+
+    if (rx <= 0.0 || ry <= 0.0) {
+	svg_polyline_move_to (polyline, x, y);
+	svg_polyline_line_to (polyline, x2, y);
+	svg_polyline_line_to (polyline, x2, y2);
+	svg_polyline_line_to (polyline, x, y2);
+	svg_polyline_close_path (polyline);
+	return;
+    }
+
+    svg_polyline_move_to (polyline, x + rx, y);
+    svg_polyline_line_to (polyline, x2 - rx, y);
+    svg_polyline_curve_to (polyline, x2 - rx, y, x2 - rx + kx, y, x2, y + ry - ky, x2, y + ry);
+    svg_polyline_line_to (polyline, x2, y2 - ry);
+    svg_polyline_curve_to (polyline, x2, y2 - ry, x2, y2 - ry + ky, x2 - rx + kx, y2, x2 - rx, y2);
+    svg_polyline_line_to (polyline, x + rx, y2);
+    svg_polyline_curve_to (polyline, x + rx, y2, x + rx - kx, y2, x, y2 - ry + ky, x, y2 - ry);
+    svg_polyline_line_to (polyline, x, y + ry);
+    svg_polyline_curve_to (polyline, x, y + ry, x, y + ry - ky, x + rx - kx, y, x + rx, y);
+    svg_polyline_close_path (polyline);
+}
+
+/* Differences of coordinates for cross products. In fixed point the
+   sign of a cross product only needs 24.8, which keeps it in 64 bits. */
+#ifdef LIBSVG_FIXED_POINT
+typedef int64_t svg_polyline_diff_t;
+#define SVG_POLYLINE_DIFF(a, b) (((int64_t) (a) - (b)) >> 8)
+#else
+typedef double svg_polyline_diff_t;
+#define SVG_POLYLINE_DIFF(a, b) ((a) - (b))
+#endif
+
+/* Every subpath is taken as closed, like a fill does. Returns non-zero
+   if (x, y) is inside according to fill_rule. */
+int
+svg_polyline_contains (const svg_polyline_t *polyline, svg_fill_rule_t fill_rule,
+		       double px, double py)
+{
+    svg_coord_t x = svg_coord_from_double (px), y = svg_coord_from_double (py);
+    int s, k, winding = 0;
+
+    if (! polyline->has_extents ||
+	x < polyline->x1 || x > polyline->x2 || y < polyline->y1 || y > polyline->y2)
+	return 0;
+
+    for (s = 0; s < polyline->num_subpaths; s++) {
+	const svg_polyline_subpath_t *subpath = &polyline->subpaths[s];
+	const svg_polyline_point_t *pts = &polyline->points[subpath->first];
+
+	for (k = 0; k < subpath->count; k++) {
+	    const svg_polyline_point_t *a = &pts[k];
+	    const svg_polyline_point_t *b = &pts[(k + 1) % subpath->count];
+	    svg_polyline_diff_t side =
+		SVG_POLYLINE_DIFF (b->x, a->x) * SVG_POLYLINE_DIFF (y, a->y) -
+		SVG_POLYLINE_DIFF (x, a->x) * SVG_POLYLINE_DIFF (b->y, a->y);
+
+	    if (a->y <= y) {
+		if (b->y > y && side > 0)
+		    winding++;
+	    } else {
+		if (b->y <= y && side < 0)
+		    winding--;
+	    }
+	}
+    }
+
+    if (fill_rule == SVG_FILL_RULE_EVEN_ODD)
+	return winding & 1;
+
+    return winding != 0;
+}
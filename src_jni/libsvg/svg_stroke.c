@@ -0,0 +1,511 @@
+/*
+ * svg_stroke.c
+ *
+ * part of libsvgandroid
+ *
+ * Copyright 2016 by Anton Persson ( https://github.com/pltxtra/libsvgandroid )
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ *  Boston, MA 02111-1307, USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "svgint.h"
+
+/* The stroker turns a polyline into polygons that are filled with the
+   nonzero rule. An open subpath becomes one polygon, its left side
+   walked forward, the end cap, the left side of the reversed subpath
+   and the start cap. A closed one becomes two polygons, one per side,
+   running in opposite directions so the inside stays empty.
+
+   Joins are only made on the outer side of a corner. The inner side
+   goes through the corner point itself, the small loop this leaves
+   behind is filled by the nonzero rule anyway.
+
+   Everything happens in the space of the polyline, usually user
+   space, which is why the tolerance comes with the style. The math
+   is done in double even when the polyline is fixed point, joins and
+   caps need the trigonometry anyway. */
+
+typedef struct svg_stroke_context {
+    svg_polyline_t *outline;
+    double half_width;
+    double tolerance;
+    svg_stroke_line_cap_t line_cap;
+    svg_stroke_line_join_t line_join;
+    double miter_limit;
+} svg_stroke_context_t;
+
+void
+svg_stroker_init (svg_stroker_t *stroker)
+{
+    svg_polyline_init (&stroker->dashed);
+    svg_polyline_init (&stroker->outline);
+    stroker->scratch = NULL;
+    stroker->scratch_size = 0;
+}
+
+void
+svg_stroker_deinit (svg_stroker_t *stroker)
+{
+    svg_polyline_deinit (&stroker->dashed);
+    svg_polyline_deinit (&stroker->outline);
+    free (stroker->scratch);
+    stroker->scratch = NULL;
+    stroker->scratch_size = 0;
+}
+
+/* points of an arc around (cx, cy), not including the one at angle a0 */
+static void
+_svg_stroke_arc (svg_stroke_context_t *context, double cx, double cy,
+		 double a0, double sweep)
+{
+    double r = context->half_width, step;
+    int k, n;
+
+    if (r > context->tolerance)
+	step = 2.0 * acos (1.0 - context->tolerance / r);
+    else
+	step = M_PI / 2.0;
+
+    n = (int) ceil (fabs (sweep) / step);
+    if (n < 1)
+	n = 1;
+
+    for (k = 1; k <= n; k++) {
+	double a = a0 + sweep * k / n;
+	svg_polyline_line_to (context->outline, cx + r * cos (a), cy + r * sin (a));
+    }
+}
+
+/* Sweep from offset vector (ax, ay) to (bx, by) on the side that
+   bulges towards (dx, dy), half a turn when they point apart. */
+static void
+_svg_stroke_round (svg_stroke_context_t *context, double px, double py,
+		   double ax, double ay, double bx, double by,
+		   double dx, double dy)
+{
+    double cross = ax * by - ay * bx;
+    double dot = ax * bx + ay * by;
+    double sweep = atan2 (cross, dot);
+
+    if (fabs (cross) < 1e-12 * context->half_width * context->half_width) {
+	/* rotating a by +90 degrees has to end up in front of us */
+	sweep = (-ay * dx + ax * dy) > 0.0 ? M_PI : -M_PI;
+    }
+
+    _svg_stroke_arc (context, px, py, atan2 (ay, ax), sweep);
+}
+
+/* we are at p + n0, leave us at p + n1 */
+static void
+_svg_stroke_join (svg_stroke_context_t *context, const svg_stroke_point_t *p,
+		  double d0x, double d0y, double d1x, double d1y)
+{
+    double hw = context->half_width;
+    double n0x = -d0y * hw, n0y = d0x * hw;
+    double n1x = -d1y * hw, n1y = d1x * hw;
+    double cross = d0x * d1y - d0y * d1x;
+    double dot = d0x * d1x + d0y * d1y;
+
+    if (fabs (cross) < 1e-12 && dot > 0.0) {
+	/* straight on */
+	svg_polyline_line_to (context->outline, p->x + n1x, p->y + n1y);
+	return;
+    }
+
+    if (cross > 0.0) {
+	/* inner side */
+	svg_polyline_line_to (context->outline, p->x, p->y);
+	svg_polyline_line_to (context->outline, p->x + n1x, p->y + n1y);
+	return;
+    }
+
+    switch (context->line_join) {
+    case SVG_STROKE_LINE_JOIN_MITER:
+	/* the miter is 1 / sin(theta / 2) long, theta the angle between the segments */
+	if (1.0 + dot > 1e-12 &&
+	    2.0 / (1.0 + dot) <= context->miter_limit * context->miter_limit) {
+	    svg_polyline_line_to (context->outline,
+				  p->x + (n0x + n1x) / (1.0 + dot),
+				  p->y + (n0y + n1y) / (1.0 + dot));
+	}
+	svg_polyline_line_to (context->outline, p->x + n1x, p->y + n1y);
+	break;
+    case SVG_STROKE_LINE_JOIN_ROUND:
+	_svg_stroke_round (context, p->x, p->y, n0x, n0y, n1x, n1y, d0x, d0y);
+	break;
+    case SVG_STROKE_LINE_JOIN_BEVEL:
+    default:
+	svg_polyline_line_to (context->outline, p->x + n1x, p->y + n1y);
+	break;
+    }
+}
+
+/* we are at p + n, leave us at p - n */
+static void
+_svg_stroke_cap (svg_stroke_context_t *context, const svg_stroke_point_t *p,
+		 double dx, double dy)
+{
+    double hw = context->half_width;
+    double nx = -dy * hw, ny = dx * hw;
+
+    switch (context->line_cap) {
+    case SVG_STROKE_LINE_CAP_ROUND:
+	_svg_stroke_round (context, p->x, p->y, nx, ny, -nx, -ny, dx, dy);
+	break;
+    case SVG_STROKE_LINE_CAP_SQUARE:
+	svg_polyline_line_to (context->outline, p->x + nx + dx * hw, p->y + ny + dy * hw);
+	svg_polyline_line_to (context->outline, p->x - nx + dx * hw, p->y - ny + dy * hw);
+	svg_polyline_line_to (context->outline, p->x - nx, p->y - ny);
+	break;
+    case SVG_STROKE_LINE_CAP_BUTT:
+    default:
+	svg_polyline_line_to (context->outline, p->x - nx, p->y - ny);
+	break;
+    }
+}
+
+static void
+_svg_stroke_direction (const svg_stroke_point_t *a, const svg_stroke_point_t *b,
+		       double *dx, double *dy)
+{
+    double x = b->x - a->x, y = b->y - a->y;
+    double length = sqrt (x * x + y * y);
+
+    *dx = x / length;
+    *dy = y / length;
+}
+
+/* The left side of pts, walked forward or backward. A closed side
+   ends with the join at its first point, an open one at its last
+   point, ready for the cap. */
+static void
+_svg_stroke_side (svg_stroke_context_t *context, const svg_stroke_point_t *pts, int n,
+		  int reverse, int closed, int start)
+{
+    const svg_stroke_point_t *p, *q;
+    double d0x, d0y, d1x, d1y, hw = context->half_width;
+    int k, segments = closed ? n : n - 1;
+
+#define POINT(i) (reverse ? &pts[n - 1 - ((i) % n)] : &pts[(i) % n])
+
+    _svg_stroke_direction (POINT(0), POINT(1), &d0x, &d0y);
+    p = POINT(0);
+    if (start)
+	svg_polyline_move_to (context->outline, p->x - d0y * hw, p->y + d0x * hw);
+    else
+	svg_polyline_line_to (context->outline, p->x - d0y * hw, p->y + d0x * hw);
+
+    for (k = 1; k < segments; k++) {
+	p = POINT(k);
+	q = POINT(k + 1);
+
+	svg_polyline_line_to (context->outline, p->x - d0y * hw, p->y + d0x * hw);
+	_svg_stroke_direction (p, q, &d1x, &d1y);
+	_svg_stroke_join (context, p, d0x, d0y, d1x, d1y);
+	d0x = d1x; d0y = d1y;
+    }
+
+    p = POINT(segments);
+    svg_polyline_line_to (context->outline, p->x - d0y * hw, p->y + d0x * hw);
+
+    if (closed) {
+	_svg_stroke_direction (POINT(0), POINT(1), &d1x, &d1y);
+	_svg_stroke_join (context, p, d0x, d0y, d1x, d1y);
+	svg_polyline_close_path (context->outline);
+    }
+
+#undef POINT
+}
+
+/* a subpath of zero length only shows its caps */
+static void
+_svg_stroke_dot (svg_stroke_context_t *context, const svg_stroke_point_t *p)
+{
+    double hw = context->half_width;
+
+    switch (context->line_cap) {
+    case SVG_STROKE_LINE_CAP_ROUND:
+	svg_polyline_move_to (context->outline, p->x + hw, p->y);
+	_svg_stroke_arc (context, p->x, p->y, 0.0, 2.0 * M_PI);
+	svg_polyline_close_path (context->outline);
+	break;
+    case SVG_STROKE_LINE_CAP_SQUARE:
+	svg_polyline_move_to (context->outline, p->x - hw, p->y - hw);
+	svg_polyline_line_to (context->outline, p->x + hw, p->y - hw);
+	svg_polyline_line_to (context->outline, p->x + hw, p->y + hw);
+	svg_polyline_line_to (context->outline, p->x - hw, p->y + hw);
+	svg_polyline_close_path (context->outline);
+	break;
+    case SVG_STROKE_LINE_CAP_BUTT:
+    default:
+	break;
+    }
+}
+
+static void
+_svg_stroke_subpath (svg_stroke_context_t *context, const svg_stroke_point_t *pts,
+		     int n, int closed)
+{
+    double dx, dy;
+
+    if (n == 1) {
+	_svg_stroke_dot (context, &pts[0]);
+	return;
+    }
+
+    if (closed && n > 2) {
+	_svg_stroke_side (context, pts, n, 0, 1, 1);
+	_svg_stroke_side (context, pts, n, 1, 1, 1);
+	return;
+    }
+
+    _svg_stroke_side (context, pts, n, 0, 0, 1);
+    _svg_stroke_direction (&pts[n - 2], &pts[n - 1], &dx, &dy);
+    _svg_stroke_cap (context, &pts[n - 1], dx, dy);
+
+    _svg_stroke_side (context, pts, n, 1, 0, 0);
+    _svg_stroke_direction (&pts[1], &pts[0], &dx, &dy);
+    _svg_stroke_cap (context, &pts[0], dx, dy);
+
+    svg_polyline_close_path (context->outline);
+}
+
+/* Split path into its dashes. The pattern starts over at each subpath,
+   an odd number of dashes is repeated to make it even. */
+static void
+_svg_stroke_dash (const svg_polyline_t *path, const svg_stroke_style_t *style,
+		  double period, svg_polyline_t *dashed)
+{
+    const double *dash = style->dash;
+    int num_dashes = style->num_dashes;
+    double offset;
+    int s, k;
+
+    svg_polyline_clear (dashed);
+
+    if (num_dashes & 1)
+	period *= 2.0;
+
+    for (s = 0; s < path->num_subpaths; s++) {
+	const svg_polyline_subpath_t *subpath = &path->subpaths[s];
+	const svg_polyline_point_t *pts = &path->points[subpath->first];
+	int segments = subpath->closed ? subpath->count : subpath->count - 1;
+	double remaining;
+	int index = 0, on = 1;
+
+	offset = fmod (style->dash_offset, period);
+	if (offset < 0.0)
+	    offset += period;
+
+	remaining = dash[0];
+	while (offset > 0.0) {
+	    if (offset >= remaining) {
+		offset -= remaining;
+		index = (index + 1) % num_dashes;
+		on = !on;
+		remaining = dash[index];
+	    } else {
+		remaining -= offset;
+		offset = 0.0;
+	    }
+	}
+
+	if (on)
+	    svg_polyline_move_to (dashed, SVG_COORD_TO_DOUBLE (pts[0].x),
+				  SVG_COORD_TO_DOUBLE (pts[0].y));
+
+	for (k = 0; k < segments; k++) {
+	    const svg_polyline_point_t *a = &pts[k];
+	    const svg_polyline_point_t *b = &pts[(k + 1) % subpath->count];
+	    double ax = SVG_COORD_TO_DOUBLE (a->x), ay = SVG_COORD_TO_DOUBLE (a->y);
+	    double bx = SVG_COORD_TO_DOUBLE (b->x), by = SVG_COORD_TO_DOUBLE (b->y);
+	    double dx = bx - ax, dy = by - ay;
+	    double length = sqrt (dx * dx + dy * dy), pos = 0.0;
+
+	    while (length - pos > remaining) {
+		double x, y;
+
+		pos += remaining;
+		x = ax + dx * pos / length;
+		y = ay + dy * pos / length;
+
+		if (on)
+		    svg_polyline_line_to (dashed, x, y);
+		else
+		    svg_polyline_move_to (dashed, x, y);
+
+		on = !on;
+		index = (index + 1) % num_dashes;
+		remaining = dash[index];
+	    }
+
+	    remaining -= length - pos;
+	    if (on)
+		svg_polyline_line_to (dashed, bx, by);
+	}
+    }
+}
+
+/* copy a subpath, leaving out points that repeat the previous one */
+static int
+_svg_stroke_unique_points (svg_stroker_t *stroker, const svg_polyline_point_t *pts,
+			   int count, int closed)
+{
+    int k, last = 0, n = 0;
+
+    if (stroker->scratch_size < count) {
+	svg_stroke_point_t *scratch =
+	    realloc (stroker->scratch, count * sizeof (svg_stroke_point_t));
+
+	if (scratch == NULL)
+	    return -1;
+
+	stroker->scratch = scratch;
+	stroker->scratch_size = count;
+    }
+
+    /* compared as stored, so fixed point compares exactly as well */
+    for (k = 0; k < count; k++) {
+	if (n && pts[k].x == pts[last].x && pts[k].y == pts[last].y)
+	    continue;
+	stroker->scratch[n].x = SVG_COORD_TO_DOUBLE (pts[k].x);
+	stroker->scratch[n].y = SVG_COORD_TO_DOUBLE (pts[k].y);
+	last = k;
+	n++;
+    }
+
+    /* the closing segment would repeat the first point as well */
+    if (closed && n > 1 &&
+	stroker->scratch[n - 1].x == stroker->scratch[0].x &&
+	stroker->scratch[n - 1].y == stroker->scratch[0].y)
+	n--;
+
+    return n;
+}
+
+/* Replace outline with the polygons covered by stroking path. Fill
+   them with the nonzero rule. */
+svg_status_t
+svg_stroker_stroke (svg_stroker_t		*stroker,
+		    const svg_polyline_t	*path,
+		    const svg_stroke_style_t	*style,
+		    svg_polyline_t		*outline)
+{
+    svg_stroke_context_t context;
+    double period = 0.0;
+    int s, k, n;
+
+    svg_polyline_clear (outline);
+
+    if (path->error)
+	return SVG_STATUS_NO_MEMORY;
+
+    if (style->width <= 0.0 || style->tolerance <= 0.0)
+	return SVG_STATUS_SUCCESS;
+
+    context.outline = outline;
+    context.half_width = style->width / 2.0;
+    context.tolerance = style->tolerance;
+    context.line_cap = style->line_cap;
+    context.line_join = style->line_join;
+    context.miter_limit = style->miter_limit;
+
+    for (k = 0; k < style->num_dashes; k++) {
+	if (style->dash[k] < 0.0) {
+	    period = 0.0; /* an invalid pattern turns dashing off */
+	    break;
+	}
+	period += style->dash[k];
+    }
+
+    if (period > 0.0) {
+	_svg_stroke_dash (path, style, period, &stroker->dashed);
+	if (stroker->dashed.error)
+	    return SVG_STATUS_NO_MEMORY;
+	path = &stroker->dashed;
+    }
+
+    for (s = 0; s < path->num_subpaths; s++) {
+	const svg_polyline_subpath_t *subpath = &path->subpaths[s];
+
+	/* a lonely move_to draws nothing, not even caps */
+	if (subpath->count < 2 && ! subpath->closed)
+	    continue;
+
+	n = _svg_stroke_unique_points (stroker, &path->points[subpath->first],
+				       subpath->count, subpath->closed);
+	if (n < 0)
+	    return SVG_STATUS_NO_MEMORY;
+
+	_svg_stroke_subpath (&context, stroker->scratch, n, subpath->closed);
+    }
+
+    return outline->error ? SVG_STATUS_NO_MEMORY : SVG_STATUS_SUCCESS;
+}
+
+/* The extents of what stroking path covers. Returns 0 if it covers
+   nothing, the extents are left alone then. */
+int
+svg_stroker_extents (svg_stroker_t		*stroker,
+		     const svg_polyline_t	*path,
+		     const svg_stroke_style_t	*style,
+		     double *x1, double *y1, double *x2, double *y2)
+{
+    svg_polyline_t *outline = &stroker->outline;
+
+    if (svg_stroker_stroke (stroker, path, style, outline) || ! outline->has_extents)
+	return 0;
+
+    *x1 = SVG_COORD_TO_DOUBLE (outline->x1); *y1 = SVG_COORD_TO_DOUBLE (outline->y1);
+    *x2 = SVG_COORD_TO_DOUBLE (outline->x2); *y2 = SVG_COORD_TO_DOUBLE (outline->y2);
+
+    return 1;
+}
+
+/* non-zero if (x, y) is on the stroke of path */
+int
+svg_stroker_contains (svg_stroker_t		*stroker,
+		      const svg_polyline_t	*path,
+		      const svg_stroke_style_t	*style,
+		      double x, double y)
+{
+    svg_polyline_t *outline = &stroker->outline;
+
+    if (svg_stroker_stroke (stroker, path, style, outline))
+	return 0;
+
+    return svg_polyline_contains (outline, SVG_FILL_RULE_NONZERO, x, y);
+}
+
+/* How far the stroke can reach beyond the points of the path, for when
+   the geometry itself is not at hand. */
+double
+svg_stroke_reach (const svg_stroke_style_t *style)
+{
+    double reach = style->width / 2.0;
+    double scale = 1.0;
+
+    if (style->line_join == SVG_STROKE_LINE_JOIN_MITER && style->miter_limit > 1.0)
+	scale = style->miter_limit;
+    if (style->line_cap == SVG_STROKE_LINE_CAP_SQUARE && scale < M_SQRT2)
+	scale = M_SQRT2;
+
+    return reach * scale;
+}
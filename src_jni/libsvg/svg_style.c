@@ -863,69 +863,334 @@ _svg_style_apply_attributes (svg_style_t	*style,
     return SVG_STATUS_SUCCESS;
 }
 
+/* Style diffing: render_style mirrors the values the engine holds
+   for the element being rendered. The engine copies its state on
+   begin_element/begin_group, so a child only needs to push the
+   properties that differ from what its parent left there. */
+
+#define SVG_STYLE_RENDER_FLAGS (SVG_STYLE_FLAG_COLOR |			\
+				SVG_STYLE_FLAG_FILL_OPACITY |		\
+				SVG_STYLE_FLAG_FILL_PAINT |		\
+				SVG_STYLE_FLAG_FILL_RULE |		\
+				SVG_STYLE_FLAG_FONT_FAMILY |		\
+				SVG_STYLE_FLAG_FONT_SIZE |		\
+				SVG_STYLE_FLAG_FONT_STYLE |		\
+				SVG_STYLE_FLAG_FONT_WEIGHT |		\
+				SVG_STYLE_FLAG_OPACITY |		\
+				SVG_STYLE_FLAG_STROKE_DASH_ARRAY |	\
+				SVG_STYLE_FLAG_STROKE_DASH_OFFSET |	\
+				SVG_STYLE_FLAG_STROKE_LINE_CAP |	\
+				SVG_STYLE_FLAG_STROKE_LINE_JOIN |	\
+				SVG_STYLE_FLAG_STROKE_MITER_LIMIT |	\
+				SVG_STYLE_FLAG_STROKE_OPACITY |		\
+				SVG_STYLE_FLAG_STROKE_PAINT |		\
+				SVG_STYLE_FLAG_STROKE_WIDTH |		\
+				SVG_STYLE_FLAG_TEXT_ANCHOR)
+
+/* nothing is known about the engine state */
+static const svg_style_t SVG_STYLE_RENDER_UNKNOWN;
+
+/* the engine already holds this value, no need to push it again */
+#define SVG_STYLE_UNCHANGED(flag, same) ((render_style->flags & (flag)) && (same))
+
+static int
+_svg_style_color_equal (const svg_color_t *a, const svg_color_t *b)
+{
+    return a->is_current_color == b->is_current_color && a->rgb == b->rgb;
+}
+
+static int
+_svg_style_paint_equal (const svg_paint_t *a, const svg_paint_t *b)
+{
+    if (a->type != b->type)
+	return 0;
+
+    switch (a->type) {
+    case SVG_PAINT_TYPE_NONE:
+	return 1;
+    case SVG_PAINT_TYPE_COLOR:
+	return _svg_style_color_equal (&a->p.color, &b->p.color);
+    case SVG_PAINT_TYPE_GRADIENT:
+	return a->p.gradient == b->p.gradient;
+    case SVG_PAINT_TYPE_PATTERN:
+	return a->p.pattern_element == b->p.pattern_element;
+    }
+
+    return 0;
+}
+
+/* relative lengths are resolved by the engine against the current
+   viewport or font, so they are always pushed */
+static int
+_svg_style_length_equal (const svg_length_t *a, const svg_length_t *b)
+{
+    switch (a->unit) {
+    case SVG_LENGTH_UNIT_PCT:
+    case SVG_LENGTH_UNIT_EM:
+    case SVG_LENGTH_UNIT_EX:
+	return 0;
+    default:
+	break;
+    }
+
+    return a->unit == b->unit && a->value == b->value;
+}
+
+static int
+_svg_style_string_equal (const char *a, const char *b)
+{
+    if (a == b)
+	return 1;
+    if (a == NULL || b == NULL)
+	return 0;
+
+    return strcmp (a, b) == 0;
+}
+
+static int
+_svg_style_dash_equal (const svg_style_t *a, const svg_style_t *b)
+{
+    if (a->num_dashes != b->num_dashes)
+	return 0;
+    if (a->num_dashes == 0 || a->stroke_dash_array == b->stroke_dash_array)
+	return 1;
+
+    return memcmp (a->stroke_dash_array, b->stroke_dash_array,
+		   a->num_dashes * sizeof (double)) == 0;
+}
+
+/* Record the values pushed for this element. The pointers (font
+   family, dash array, paint servers) are borrowed from the element
+   style, which outlives the render pass. */
+static void
+_svg_style_merge_render_style (svg_style_t *render_style, const svg_style_t *style)
+{
+    uint64_t flags = style->flags & SVG_STYLE_RENDER_FLAGS;
+
+    if (flags & SVG_STYLE_FLAG_COLOR)
+	render_style->color = style->color;
+    if (flags & SVG_STYLE_FLAG_FILL_OPACITY)
+	render_style->fill_opacity = style->fill_opacity;
+    if (flags & SVG_STYLE_FLAG_FILL_PAINT)
+	render_style->fill_paint = style->fill_paint;
+    if (flags & SVG_STYLE_FLAG_FILL_RULE)
+	render_style->fill_rule = style->fill_rule;
+    if (flags & SVG_STYLE_FLAG_FONT_FAMILY)
+	render_style->font_family = style->font_family;
+    if (flags & SVG_STYLE_FLAG_FONT_SIZE)
+	render_style->font_size = style->font_size;
+    if (flags & SVG_STYLE_FLAG_FONT_STYLE)
+	render_style->font_style = style->font_style;
+    if (flags & SVG_STYLE_FLAG_FONT_WEIGHT)
+	render_style->font_weight = style->font_weight;
+    if (flags & SVG_STYLE_FLAG_OPACITY)
+	render_style->opacity = style->opacity;
+    if (flags & SVG_STYLE_FLAG_STROKE_DASH_ARRAY) {
+	render_style->stroke_dash_array = style->stroke_dash_array;
+	render_style->num_dashes = style->num_dashes;
+    }
+    if (flags & SVG_STYLE_FLAG_STROKE_DASH_OFFSET)
+	render_style->stroke_dash_offset = style->stroke_dash_offset;
+    if (flags & SVG_STYLE_FLAG_STROKE_LINE_CAP)
+	render_style->stroke_line_cap = style->stroke_line_cap;
+    if (flags & SVG_STYLE_FLAG_STROKE_LINE_JOIN)
+	render_style->stroke_line_join = style->stroke_line_join;
+    if (flags & SVG_STYLE_FLAG_STROKE_MITER_LIMIT)
+	render_style->stroke_miter_limit = style->stroke_miter_limit;
+    if (flags & SVG_STYLE_FLAG_STROKE_OPACITY)
+	render_style->stroke_opacity = style->stroke_opacity;
+    if (flags & SVG_STYLE_FLAG_STROKE_PAINT)
+	render_style->stroke_paint = style->stroke_paint;
+    if (flags & SVG_STYLE_FLAG_STROKE_WIDTH)
+	render_style->stroke_width = style->stroke_width;
+    if (flags & SVG_STYLE_FLAG_TEXT_ANCHOR)
+	render_style->text_anchor = style->text_anchor;
+
+    render_style->flags |= flags;
+}
+
+/* Which of the properties set on style actually have to be pushed
+   to the engine, given what the enclosing element left there. */
+uint64_t
+_svg_style_render_changes (svg_style_t		*style,
+			   const svg_style_t	*render_style,
+			   svg_render_engine_t	*engine)
+{
+    uint64_t changes = 0;
+
+    if (render_style == NULL)
+	render_style = &SVG_STYLE_RENDER_UNKNOWN;
+
+    if ((style->flags & SVG_STYLE_FLAG_COLOR) && engine->set_color &&
+	! SVG_STYLE_UNCHANGED (SVG_STYLE_FLAG_COLOR,
+				_svg_style_color_equal (&style->color, &render_style->color)))
+	changes |= SVG_STYLE_FLAG_COLOR;
+
+    if ((style->flags & SVG_STYLE_FLAG_FILL_OPACITY) && engine->set_fill_opacity &&
+	! SVG_STYLE_UNCHANGED (SVG_STYLE_FLAG_FILL_OPACITY,
+				style->fill_opacity == render_style->fill_opacity))
+	changes |= SVG_STYLE_FLAG_FILL_OPACITY;
+
+    if ((style->flags & SVG_STYLE_FLAG_FILL_PAINT) && engine->set_fill_paint &&
+	! SVG_STYLE_UNCHANGED (SVG_STYLE_FLAG_FILL_PAINT,
+				_svg_style_paint_equal (&style->fill_paint, &render_style->fill_paint)))
+	changes |= SVG_STYLE_FLAG_FILL_PAINT;
+
+    if ((style->flags & SVG_STYLE_FLAG_FILL_RULE) && engine->set_fill_rule &&
+	! SVG_STYLE_UNCHANGED (SVG_STYLE_FLAG_FILL_RULE,
+				style->fill_rule == render_style->fill_rule))
+	changes |= SVG_STYLE_FLAG_FILL_RULE;
+
+    if ((style->flags & SVG_STYLE_FLAG_FONT_FAMILY) && engine->set_font_family &&
+	! SVG_STYLE_UNCHANGED (SVG_STYLE_FLAG_FONT_FAMILY,
+				_svg_style_string_equal (style->font_family, render_style->font_family)))
+	changes |= SVG_STYLE_FLAG_FONT_FAMILY;
+
+    if ((style->flags & SVG_STYLE_FLAG_FONT_SIZE) && engine->set_font_size &&
+	! SVG_STYLE_UNCHANGED (SVG_STYLE_FLAG_FONT_SIZE,
+				style->font_size.value == render_style->font_size.value))
+	changes |= SVG_STYLE_FLAG_FONT_SIZE;
+
+    if ((style->flags & SVG_STYLE_FLAG_FONT_STYLE) && engine->set_font_style &&
+	! SVG_STYLE_UNCHANGED (SVG_STYLE_FLAG_FONT_STYLE,
+				style->font_style == render_style->font_style))
+	changes |= SVG_STYLE_FLAG_FONT_STYLE;
+
+    if ((style->flags & SVG_STYLE_FLAG_FONT_WEIGHT) && engine->set_font_weight &&
+	! SVG_STYLE_UNCHANGED (SVG_STYLE_FLAG_FONT_WEIGHT,
+				style->font_weight == render_style->font_weight))
+	changes |= SVG_STYLE_FLAG_FONT_WEIGHT;
+
+    if ((style->flags & SVG_STYLE_FLAG_OPACITY) && engine->set_opacity &&
+	! SVG_STYLE_UNCHANGED (SVG_STYLE_FLAG_OPACITY,
+				style->opacity == render_style->opacity))
+	changes |= SVG_STYLE_FLAG_OPACITY;
+
+    if ((style->flags & SVG_STYLE_FLAG_STROKE_DASH_ARRAY) && engine->set_stroke_dash_array &&
+	! SVG_STYLE_UNCHANGED (SVG_STYLE_FLAG_STROKE_DASH_ARRAY,
+				_svg_style_dash_equal (style, render_style)))
+	changes |= SVG_STYLE_FLAG_STROKE_DASH_ARRAY;
+
+    if ((style->flags & SVG_STYLE_FLAG_STROKE_DASH_OFFSET) && engine->set_stroke_dash_offset &&
+	! SVG_STYLE_UNCHANGED (SVG_STYLE_FLAG_STROKE_DASH_OFFSET,
+				_svg_style_length_equal (&style->stroke_dash_offset, &render_style->stroke_dash_offset)))
+	changes |= SVG_STYLE_FLAG_STROKE_DASH_OFFSET;
+
+    if ((style->flags & SVG_STYLE_FLAG_STROKE_LINE_CAP) && engine->set_stroke_line_cap &&
+	! SVG_STYLE_UNCHANGED (SVG_STYLE_FLAG_STROKE_LINE_CAP,
+				style->stroke_line_cap == render_style->stroke_line_cap))
+	changes |= SVG_STYLE_FLAG_STROKE_LINE_CAP;
+
+    if ((style->flags & SVG_STYLE_FLAG_STROKE_LINE_JOIN) && engine->set_stroke_line_join &&
+	! SVG_STYLE_UNCHANGED (SVG_STYLE_FLAG_STROKE_LINE_JOIN,
+				style->stroke_line_join == render_style->stroke_line_join))
+	changes |= SVG_STYLE_FLAG_STROKE_LINE_JOIN;
+
+    if ((style->flags & SVG_STYLE_FLAG_STROKE_MITER_LIMIT) && engine->set_stroke_miter_limit &&
+	! SVG_STYLE_UNCHANGED (SVG_STYLE_FLAG_STROKE_MITER_LIMIT,
+				style->stroke_miter_limit == render_style->stroke_miter_limit))
+	changes |= SVG_STYLE_FLAG_STROKE_MITER_LIMIT;
+
+    if ((style->flags & SVG_STYLE_FLAG_STROKE_OPACITY) && engine->set_stroke_opacity &&
+	! SVG_STYLE_UNCHANGED (SVG_STYLE_FLAG_STROKE_OPACITY,
+				style->stroke_opacity == render_style->stroke_opacity))
+	changes |= SVG_STYLE_FLAG_STROKE_OPACITY;
+
+    if ((style->flags & SVG_STYLE_FLAG_STROKE_PAINT) && engine->set_stroke_paint &&
+	! SVG_STYLE_UNCHANGED (SVG_STYLE_FLAG_STROKE_PAINT,
+				_svg_style_paint_equal (&style->stroke_paint, &render_style->stroke_paint)))
+	changes |= SVG_STYLE_FLAG_STROKE_PAINT;
+
+    if ((style->flags & SVG_STYLE_FLAG_STROKE_WIDTH) && engine->set_stroke_width &&
+	! SVG_STYLE_UNCHANGED (SVG_STYLE_FLAG_STROKE_WIDTH,
+				_svg_style_length_equal (&style->stroke_width, &render_style->stroke_width)))
+	changes |= SVG_STYLE_FLAG_STROKE_WIDTH;
+
+    if ((style->flags & SVG_STYLE_FLAG_TEXT_ANCHOR) && engine->set_text_anchor &&
+	! SVG_STYLE_UNCHANGED (SVG_STYLE_FLAG_TEXT_ANCHOR,
+				style->text_anchor == render_style->text_anchor))
+	changes |= SVG_STYLE_FLAG_TEXT_ANCHOR;
+
+    /* filters are not inherited, they apply to this element only */
+    if ((style->flags & SVG_STYLE_FLAG_FILTER) &&
+	(engine->capabilities & SVG_RENDER_ENGINE_FILTERS))
+	changes |= SVG_STYLE_FLAG_FILTER;
+
+    return changes;
+}
+
 svg_status_t
 _svg_style_render (svg_style_t		*style,
+		   uint64_t		changes,
+		   const svg_style_t	*parent_render_style,
+		   svg_style_t		*render_style,
 		   svg_render_engine_t	*engine,
 		   void			*closure)
 {
     svg_status_t status;
 
-    if (style->flags & SVG_STYLE_FLAG_COLOR) {
+    if (parent_render_style) {
+	*render_style = *parent_render_style;
+    } else {
+	render_style->flags = 0;
+    }
+
+    if (changes & SVG_STYLE_FLAG_COLOR) {
 	status = (engine->set_color) (closure, &style->color);
 	if (status)
 	    return status;
     }
 
-    if (style->flags & SVG_STYLE_FLAG_FILL_OPACITY) {
+    if (changes & SVG_STYLE_FLAG_FILL_OPACITY) {
 	status = (engine->set_fill_opacity) (closure, style->fill_opacity);
 	if (status)
 	    return status;
     }
 
-    if (style->flags & SVG_STYLE_FLAG_FILL_PAINT) {
-			status = (engine->set_fill_paint) (closure, &style->fill_paint);
+    if (changes & SVG_STYLE_FLAG_FILL_PAINT) {
+	status = (engine->set_fill_paint) (closure, &style->fill_paint);
 	if (status)
 	    return status;
     }
 
-    if (style->flags & SVG_STYLE_FLAG_FILL_RULE) {
+    if (changes & SVG_STYLE_FLAG_FILL_RULE) {
 	status = (engine->set_fill_rule) (closure, style->fill_rule);
 	if (status)
 	    return status;
     }
 
-    if (style->flags & SVG_STYLE_FLAG_FONT_FAMILY) {
+    if (changes & SVG_STYLE_FLAG_FONT_FAMILY) {
 	status = (engine->set_font_family) (closure, style->font_family);
 	if (status)
 	    return status;
     }
 
-    if (style->flags & SVG_STYLE_FLAG_FONT_SIZE) {
+    if (changes & SVG_STYLE_FLAG_FONT_SIZE) {
 	/* XXX: How to deal with units of svg_length_t ? */
 	status = (engine->set_font_size) (closure, style->font_size.value);
 	if (status)
 	    return status;
     }
 
-    if (style->flags & SVG_STYLE_FLAG_FONT_STYLE) {
+    if (changes & SVG_STYLE_FLAG_FONT_STYLE) {
 	status = (engine->set_font_style) (closure, style->font_style);
 	if (status)
 	    return status;
     }
 
-    if (style->flags & SVG_STYLE_FLAG_FONT_WEIGHT) {
+    if (changes & SVG_STYLE_FLAG_FONT_WEIGHT) {
 	status = (engine->set_font_weight) (closure, style->font_weight);
 	if (status)
 	    return status;
     }
 
-    if (style->flags & SVG_STYLE_FLAG_OPACITY) {
+    if (changes & SVG_STYLE_FLAG_OPACITY) {
 	status = (engine->set_opacity) (closure, style->opacity);
 	if (status)
 	    return status;
     }
 
-    if (style->flags & SVG_STYLE_FLAG_FILTER) {
+    if (changes & SVG_STYLE_FLAG_FILTER) {
 	const char* flt = "inherit";
 
 	SVG_DEBUG("_svg_style_render(FILTER) - %p\n", style->filter_element);
@@ -945,61 +1210,63 @@ _svg_style_render (svg_style_t		*style,
 	    return status;
     }
 
-    if (style->flags & SVG_STYLE_FLAG_STROKE_DASH_ARRAY) {
+    if (changes & SVG_STYLE_FLAG_STROKE_DASH_ARRAY) {
 	/* XXX: How to deal with units of svg_length_t ? */
 	status = (engine->set_stroke_dash_array) (closure, style->stroke_dash_array, style->num_dashes);
 	if (status)
 	    return status;
     }
 
-    if (style->flags & SVG_STYLE_FLAG_STROKE_DASH_OFFSET) {
+    if (changes & SVG_STYLE_FLAG_STROKE_DASH_OFFSET) {
 	status = (engine->set_stroke_dash_offset) (closure, &style->stroke_dash_offset);
 	if (status)
 	    return status;
     }
 
-    if (style->flags & SVG_STYLE_FLAG_STROKE_LINE_CAP) {
+    if (changes & SVG_STYLE_FLAG_STROKE_LINE_CAP) {
 	status = (engine->set_stroke_line_cap) (closure, style->stroke_line_cap);
 	if (status)
 	    return status;
     }
 
-    if (style->flags & SVG_STYLE_FLAG_STROKE_LINE_JOIN) {
+    if (changes & SVG_STYLE_FLAG_STROKE_LINE_JOIN) {
 	status = (engine->set_stroke_line_join) (closure, style->stroke_line_join);
 	if (status)
 	    return status;
     }
 
-    if (style->flags & SVG_STYLE_FLAG_STROKE_MITER_LIMIT) {
+    if (changes & SVG_STYLE_FLAG_STROKE_MITER_LIMIT) {
 	status = (engine->set_stroke_miter_limit) (closure, style->stroke_miter_limit);
 	if (status)
 	    return status;
     }
 
-    if (style->flags & SVG_STYLE_FLAG_STROKE_OPACITY) {
+    if (changes & SVG_STYLE_FLAG_STROKE_OPACITY) {
 	status = (engine->set_stroke_opacity) (closure, style->stroke_opacity);
 	if (status)
 	    return status;
     }
 
-    if (style->flags & SVG_STYLE_FLAG_STROKE_PAINT) {
+    if (changes & SVG_STYLE_FLAG_STROKE_PAINT) {
 	status = (engine->set_stroke_paint) (closure, &style->stroke_paint);
 	if (status)
 	    return status;
     }
 
-    if (style->flags & SVG_STYLE_FLAG_STROKE_WIDTH) {
+    if (changes & SVG_STYLE_FLAG_STROKE_WIDTH) {
 	status = (engine->set_stroke_width) (closure, &style->stroke_width);
 	if (status)
 	    return status;
     }
 
-    if (style->flags & SVG_STYLE_FLAG_TEXT_ANCHOR) {
+    if (changes & SVG_STYLE_FLAG_TEXT_ANCHOR) {
 	status = (engine->set_text_anchor) (closure, style->text_anchor);
 	if (status)
 	    return status;
     }
 
+    _svg_style_merge_render_style (render_style, style);
+
     return SVG_STATUS_SUCCESS;
 }
 
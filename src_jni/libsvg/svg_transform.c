@@ -232,6 +232,12 @@ _svg_transform_multiply (svg_transform_t	*result,
     return SVG_STATUS_SUCCESS;
 }
 
+int
+_svg_transform_is_identity (const svg_transform_t *transform)
+{
+    return memcmp (transform, &SVG_TRANSFORM_IDENTITY, sizeof (svg_transform_t)) == 0;
+}
+
 svg_status_t
 _svg_transform_render (svg_transform_t		*transform,
 		       svg_render_engine_t	*engine,
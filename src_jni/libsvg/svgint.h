@@ -27,6 +27,7 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
 #include <expat.h>
 #include "strhmap_cc.h"
 
@@ -139,7 +140,18 @@ typedef struct svg_path {
     svg_path_arg_buf_t *arg_head;
     svg_path_arg_buf_t *arg_tail;
 
+    /* store arcs as arc ops, otherwise they are turned into curves
+       when they are added */
+    int keep_arcs;
+
 	void *cache; // pointer to a cached version of the path, in an engine specific format
+	unsigned int generation; // bumped on every change to the geometry
+	unsigned int cache_generation; // generation the cache was made from
+
+	/* see _svg_path_extents */
+	double extents[4];
+	int extents_valid;
+	unsigned int extents_generation;
 } svg_path_t;
 
 #define SVG_STYLE_FLAG_NONE				0x00000000000ULL
@@ -254,6 +266,8 @@ typedef struct svg_ellipse {
     svg_length_t cy;
     svg_length_t rx;
     svg_length_t ry;
+
+    svg_length_cache_t lengths;
 } svg_ellipse_t;
 
 typedef struct svg_line {
@@ -261,6 +275,8 @@ typedef struct svg_line {
     svg_length_t y1;
     svg_length_t x2;
     svg_length_t y2;
+
+    svg_length_cache_t lengths;
 } svg_line_t;
 
 typedef struct svg_rect_element {
@@ -270,6 +286,8 @@ typedef struct svg_rect_element {
     svg_length_t height;
     svg_length_t rx;
     svg_length_t ry;
+
+    svg_length_cache_t lengths;
 } svg_rect_element_t;
 
 typedef struct svg_image {
@@ -284,6 +302,8 @@ typedef struct svg_image {
     svg_length_t y;
     svg_length_t width;
     svg_length_t height;
+
+    svg_length_cache_t lengths;
 } svg_image_t;
 
 typedef enum svg_element_type {
@@ -386,7 +406,7 @@ struct svg_parser {
 struct svg {
     double dpi;
 
-    char *dir_name;
+    char *base_uri; /* relative hrefs are resolved against this */
 
     svg_element_t *group_element;
 	svg_element_t *event_stack;
@@ -399,6 +419,21 @@ struct svg {
 	void *closure;
 
 	int do_path_cache;
+
+	/* set by the parser when the document contains a filter */
+	int uses_filters;
+
+	/* bumped whenever elements are added to or dropped from the
+	   document, see svg_content_generation() */
+	unsigned int generation;
+
+	/* style values the engine currently holds during svg_render,
+	   NULL when they are unknown */
+	svg_style_t *render_style;
+
+	/* opacity of a translucent parent group that was folded into
+	   its only child instead of getting a layer */
+	double fold_opacity;
 };
 
 /* svg.c */
@@ -406,6 +441,9 @@ struct svg {
 svg_status_t
 _svg_store_element_by_id (svg_t *svg, svg_element_t *element);
 
+char *
+_svg_resolve_uri_alloc (svg_t *svg, const char *uri);
+
 svg_status_t
 _svg_fetch_element_by_id (svg_t *svg, const char *id, svg_element_t **element_ret);
 
@@ -468,6 +506,11 @@ _svg_element_init (svg_element_t	*element,
 		   svg_element_t	*parent,
 		   svg_t		*doc);
 
+svg_status_t
+_svg_element_render (svg_element_t		*element,
+		     svg_render_engine_t	*engine,
+		     void			*closure);
+
 void _svg_element_reference(svg_element_t *element);
 
 void _svg_element_dereference(svg_element_t *element);
@@ -584,7 +627,8 @@ svg_status_t
 _svg_image_deinit (svg_t *doc, svg_image_t *image);
 
 svg_status_t
-_svg_image_apply_attributes (svg_image_t	*image,
+_svg_image_apply_attributes (svg_t		*doc,
+			     svg_image_t	*image,
 			     const char		**attributes);
 
 svg_status_t
@@ -609,6 +653,9 @@ _svg_length_init_from_str (svg_length_t *length, const char *str);
 svg_status_t
 _svg_length_deinit (svg_length_t *length);
 
+void
+_svg_length_cache_init (svg_length_cache_t *cache);
+
 /* svg_paint.c */
 
 svg_status_t
@@ -684,12 +731,21 @@ svg_status_t _svg_rect_init_copy (svg_rect_element_t *path,
 svg_status_t
 _svg_path_deinit (svg_t *doc, svg_path_t *path);
 
+void *
+_svg_path_cache (svg_t *doc, svg_path_t *path);
+
 svg_status_t
 _svg_path_render (svg_path_t		*path,
 		  svg_render_engine_t	*engine,
 		  void			*closure,
 		  int                    do_cache);
 
+svg_status_t
+_svg_path_flatten (svg_path_t *path, svg_polyline_t *polyline);
+
+void
+_svg_path_extents (svg_path_t *path, double *extents);
+
 svg_status_t
 _svg_circle_render (svg_ellipse_t	*circle,
 		    svg_render_engine_t	*engine,
@@ -862,8 +918,16 @@ _svg_style_parse_style_str (svg_style_t	*style, const char *str);
 svg_status_t
 _svg_style_deinit (svg_style_t *style);
 
+uint64_t
+_svg_style_render_changes (svg_style_t		*style,
+			   const svg_style_t	*parent_render_style,
+			   svg_render_engine_t	*engine);
+
 svg_status_t
 _svg_style_render (svg_style_t		*style,
+		   uint64_t		changes,
+		   const svg_style_t	*parent_render_style,
+		   svg_style_t		*render_style,
 		   svg_render_engine_t	*engine,
 		   void			*closure);
 
@@ -981,6 +1045,9 @@ _svg_transform_multiply_into_left (svg_transform_t *t1, const svg_transform_t *t
 svg_status_t
 _svg_transform_multiply_into_right (const svg_transform_t *t1, svg_transform_t *t2);
 
+int
+_svg_transform_is_identity (const svg_transform_t *transform);
+
 svg_status_t
 _svg_transform_render (svg_transform_t		*transform,
 		       svg_render_engine_t	*engine,
@@ -0,0 +1,255 @@
+/* libsvg-android host tests
+ *
+ * Copyright © 2016 Anton Persson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy (COPYING.LESSER) of the
+ * GNU Lesser General Public License along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Adaptive flattening as svg_polyline does it, against the fixed 16
+ * lines per cubic it replaced: lines made, the furthest any of them
+ * strays from the true curve, and the time it takes. Then the same
+ * adaptive flattening in double and in the 16.16 of LIBSVG_FIXED_POINT,
+ * through the copies of svg_polyline.c in polyline_copy.h. Run it with
+ * "make bench".
+ *
+ * The times are the host's, which has a floating point unit. What
+ * fixed point saves on a soft-float core is not measured here.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+#include <svg.h>
+
+#include "polyline_copy.h"
+
+#define BENCH_FIXED_STEPS 16
+#define BENCH_SAMPLES 2000
+#define BENCH_ROUNDS 200000
+
+typedef struct bench_curve {
+	const char *name;
+	double c[8]; // control points of a cubic spanning 1 x 1
+} bench_curve_t;
+
+static const bench_curve_t bench_curves[] = {
+	{ "s-curve", { 0.0, 0.0, 0.3, 1.0, 0.7, -0.5, 1.0, 0.2 } },
+	// a quarter circle, as ellipses and arcs are flattened
+	{ "quarter circle", { 1.0, 0.0, 1.0, 0.5522847498307936, 0.5522847498307936, 1.0, 0.0, 1.0 } },
+};
+
+static const double bench_sizes[] = { 4.0, 40.0, 400.0, 4000.0 };
+
+static void
+bench_point (const double *c, double t, double *x, double *y)
+{
+	double m = 1.0 - t;
+
+	*x = m * m * m * c[0] + 3.0 * m * m * t * c[2] + 3.0 * m * t * t * c[4] + t * t * t * c[6];
+	*y = m * m * m * c[1] + 3.0 * m * m * t * c[3] + 3.0 * m * t * t * c[5] + t * t * t * c[7];
+}
+
+static double
+bench_segment_distance (double px, double py, double ax, double ay, double bx, double by)
+{
+	double dx = bx - ax, dy = by - ay, l = dx * dx + dy * dy;
+	double t = l > 0.0 ? ((px - ax) * dx + (py - ay) * dy) / l : 0.0;
+
+	if(t < 0.0) t = 0.0;
+	if(t > 1.0) t = 1.0;
+	dx = ax + t * dx - px;
+	dy = ay + t * dy - py;
+
+	return sqrt(dx * dx + dy * dy);
+}
+
+/* the furthest a point of the curve is from the polyline */
+static double
+bench_error (const double *c, const svg_polyline_t *polyline)
+{
+	const svg_polyline_point_t *p = polyline->points;
+	double worst = 0.0, x, y, d, e;
+	int k, j;
+
+	for(k = 0; k <= BENCH_SAMPLES; k++) {
+		bench_point (c, (double)k / BENCH_SAMPLES, &x, &y);
+		d = HUGE_VAL;
+		for(j = 0; j + 1 < polyline->num_points; j++) {
+			e = bench_segment_distance (x, y,
+						    SVG_COORD_TO_DOUBLE (p[j].x), SVG_COORD_TO_DOUBLE (p[j].y),
+						    SVG_COORD_TO_DOUBLE (p[j + 1].x), SVG_COORD_TO_DOUBLE (p[j + 1].y));
+			if(e < d)
+				d = e;
+		}
+		if(d > worst)
+			worst = d;
+	}
+
+	return worst;
+}
+
+static double
+bench_copy_error (const double *c, const polyline_copy_backend_t *backend,
+		  const polyline_copy_t *copy)
+{
+	double worst = 0.0, x, y, ax, ay, bx, by, d, e;
+	int k, j, n = backend->num_points(copy);
+
+	for(k = 0; k <= BENCH_SAMPLES; k++) {
+		bench_point (c, (double)k / BENCH_SAMPLES, &x, &y);
+		d = HUGE_VAL;
+		for(j = 0; j + 1 < n; j++) {
+			backend->point(copy, j, &ax, &ay);
+			backend->point(copy, j + 1, &bx, &by);
+			e = bench_segment_distance (x, y, ax, ay, bx, by);
+			if(e < d)
+				d = e;
+		}
+		if(d > worst)
+			worst = d;
+	}
+
+	return worst;
+}
+
+/* both write into a polyline, the way the old flattening did too */
+static void
+bench_fixed (svg_polyline_t *polyline, const double *c)
+{
+	double x, y;
+	int k;
+
+	svg_polyline_clear (polyline);
+	svg_polyline_move_to (polyline, c[0], c[1]);
+	for(k = 1; k <= BENCH_FIXED_STEPS; k++) {
+		bench_point (c, (double)k / BENCH_FIXED_STEPS, &x, &y);
+		svg_polyline_line_to (polyline, x, y);
+	}
+}
+
+static void
+bench_adaptive (svg_polyline_t *polyline, const double *c)
+{
+	svg_polyline_clear (polyline);
+	svg_polyline_move_to (polyline, c[0], c[1]);
+	svg_polyline_curve_to (polyline, c[0], c[1], c[2], c[3], c[4], c[5], c[6], c[7]);
+}
+
+static void
+bench_copy (const polyline_copy_backend_t *backend, polyline_copy_t *copy, const double *c)
+{
+	backend->clear(copy);
+	backend->move_to(copy, c[0], c[1]);
+	backend->curve_to(copy, c[0], c[1], c[2], c[3], c[4], c[5], c[6], c[7]);
+}
+
+static double
+bench_seconds (void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+int
+main (int argc, char **argv)
+{
+	svg_polyline_t polyline;
+	double c[8], start, adaptive_ns, fixed_ns, adaptive_error, fixed_error;
+	volatile double sink = 0.0;
+	int i, s, k, lines;
+
+	svg_polyline_init (&polyline);
+
+	printf("%-15s %6s | %8s %8s %8s | %8s %8s %8s\n", "curve", "size",
+	       "adaptive", "error", "ns", "fixed", "error", "ns");
+
+	for(i = 0; i < sizeof(bench_curves) / sizeof(bench_curves[0]); i++) {
+		for(s = 0; s < sizeof(bench_sizes) / sizeof(bench_sizes[0]); s++) {
+			for(k = 0; k < 8; k++)
+				c[k] = bench_curves[i].c[k] * bench_sizes[s];
+
+			bench_adaptive (&polyline, c);
+			lines = polyline.num_points - 1;
+			adaptive_error = bench_error (c, &polyline);
+
+			bench_fixed (&polyline, c);
+			fixed_error = bench_error (c, &polyline);
+
+			start = bench_seconds ();
+			for(k = 0; k < BENCH_ROUNDS; k++) {
+				bench_adaptive (&polyline, c);
+				sink += SVG_COORD_TO_DOUBLE (polyline.points[1].x);
+			}
+			adaptive_ns = (bench_seconds () - start) * 1e9 / BENCH_ROUNDS;
+
+			start = bench_seconds ();
+			for(k = 0; k < BENCH_ROUNDS; k++) {
+				bench_fixed (&polyline, c);
+				sink += SVG_COORD_TO_DOUBLE (polyline.points[1].x);
+			}
+			fixed_ns = (bench_seconds () - start) * 1e9 / BENCH_ROUNDS;
+
+			printf("%-15s %6g | %8d %8.3f %8.0f | %8d %8.3f %8.0f\n",
+			       bench_curves[i].name, bench_sizes[s],
+			       lines, adaptive_error, adaptive_ns,
+			       BENCH_FIXED_STEPS, fixed_error, fixed_ns);
+		}
+	}
+
+	svg_polyline_deinit (&polyline);
+
+	printf("\n%-15s %6s | %8s %8s %8s | %8s %8s %8s\n", "curve", "size",
+	       double_polyline.name, "error", "ns", fixed_polyline.name, "error", "ns");
+
+	for(i = 0; i < sizeof(bench_curves) / sizeof(bench_curves[0]); i++) {
+		for(s = 0; s < sizeof(bench_sizes) / sizeof(bench_sizes[0]); s++) {
+			const polyline_copy_backend_t *backends[2] = { &double_polyline, &fixed_polyline };
+			double error[2], ns[2];
+			int count[2], b;
+
+			for(k = 0; k < 8; k++)
+				c[k] = bench_curves[i].c[k] * bench_sizes[s];
+
+			for(b = 0; b < 2; b++) {
+				polyline_copy_t *copy = backends[b]->create (0.25);
+				double x, y;
+
+				bench_copy (backends[b], copy, c);
+				count[b] = backends[b]->num_points (copy) - 1;
+				error[b] = bench_copy_error (c, backends[b], copy);
+
+				start = bench_seconds ();
+				for(k = 0; k < BENCH_ROUNDS; k++) {
+					bench_copy (backends[b], copy, c);
+					backends[b]->point (copy, 1, &x, &y);
+					sink += x;
+				}
+				ns[b] = (bench_seconds () - start) * 1e9 / BENCH_ROUNDS;
+
+				backends[b]->destroy (copy);
+			}
+
+			printf("%-15s %6g | %8d %8.3f %8.0f | %8d %8.3f %8.0f\n",
+			       bench_curves[i].name, bench_sizes[s],
+			       count[0], error[0], ns[0], count[1], error[1], ns[1]);
+		}
+	}
+
+	return 0;
+}
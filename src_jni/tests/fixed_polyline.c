@@ -0,0 +1,29 @@
+/* libsvg-android host tests
+ *
+ * Copyright © 2016 Anton Persson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy (COPYING.LESSER) of the
+ * GNU Lesser General Public License along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* svg_polyline.c with 16.16 points, see polyline_copy.h */
+
+#ifndef LIBSVG_FIXED_POINT
+#define LIBSVG_FIXED_POINT
+#endif
+
+#define POLYLINE_COPY(name) fixed_##name
+#define POLYLINE_COPY_NAME "16.16"
+
+#include "polyline_copy.c"
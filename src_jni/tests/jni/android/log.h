@@ -0,0 +1,23 @@
+/* Host stand-in for <android/log.h>, see jni_stub.c */
+
+#ifndef JNI_STUB_ANDROID_LOG_H
+#define JNI_STUB_ANDROID_LOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+	ANDROID_LOG_DEBUG = 3,
+	ANDROID_LOG_INFO = 4,
+	ANDROID_LOG_WARN = 5,
+	ANDROID_LOG_ERROR = 6,
+};
+
+int __android_log_print(int prio, const char *tag, const char *fmt, ...);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
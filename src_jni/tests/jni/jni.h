@@ -0,0 +1,101 @@
+/* Host stand-in for <jni.h>, only what libsvg-android uses.
+ *
+ * The function table is not laid out like the one of a real VM, it
+ * only has to agree with the fake JNIEnv in jni_stub.c. Add a member
+ * here and an implementation there when the engine starts using
+ * another JNI function.
+ */
+
+#ifndef JNI_STUB_JNI_H
+#define JNI_STUB_JNI_H
+
+#include <stdint.h>
+#include <stdarg.h>
+
+typedef uint8_t jboolean;
+typedef int8_t jbyte;
+typedef uint16_t jchar;
+typedef int16_t jshort;
+typedef int32_t jint;
+typedef int64_t jlong;
+typedef float jfloat;
+typedef double jdouble;
+typedef jint jsize;
+
+typedef void *jobject;
+typedef jobject jclass;
+typedef jobject jstring;
+typedef jobject jarray;
+typedef jobject jthrowable;
+typedef jarray jfloatArray;
+typedef jarray jintArray;
+typedef jarray jbyteArray;
+
+typedef struct _jmethodID *jmethodID;
+
+#define JNI_FALSE 0
+#define JNI_TRUE 1
+
+#define JNI_OK 0
+#define JNI_ERR (-1)
+#define JNI_EDETACHED (-2)
+
+#define JNI_VERSION_1_6 0x00010006
+
+#define JNIEXPORT
+#define JNICALL
+
+typedef struct {
+	const char *name;
+	const char *signature;
+	void *fnPtr;
+} JNINativeMethod;
+
+struct JNINativeInterface;
+struct JNIInvokeInterface;
+
+typedef const struct JNINativeInterface *JNIEnv;
+typedef const struct JNIInvokeInterface *JavaVM;
+
+struct JNIInvokeInterface {
+	jint (*GetEnv)(JavaVM *, void **, jint);
+};
+
+struct JNINativeInterface {
+	jclass (*FindClass)(JNIEnv *, const char *);
+	jmethodID (*GetMethodID)(JNIEnv *, jclass, const char *, const char *);
+	jmethodID (*GetStaticMethodID)(JNIEnv *, jclass, const char *, const char *);
+	jint (*RegisterNatives)(JNIEnv *, jclass, const JNINativeMethod *, jint);
+
+	jobject (*NewObject)(JNIEnv *, jclass, jmethodID, ...);
+	void (*CallVoidMethod)(JNIEnv *, jobject, jmethodID, ...);
+	jint (*CallIntMethod)(JNIEnv *, jobject, jmethodID, ...);
+	jboolean (*CallBooleanMethod)(JNIEnv *, jobject, jmethodID, ...);
+	jobject (*CallObjectMethod)(JNIEnv *, jobject, jmethodID, ...);
+	void (*CallStaticVoidMethod)(JNIEnv *, jclass, jmethodID, ...);
+	jobject (*CallStaticObjectMethod)(JNIEnv *, jclass, jmethodID, ...);
+
+	jobject (*NewGlobalRef)(JNIEnv *, jobject);
+	void (*DeleteGlobalRef)(JNIEnv *, jobject);
+	void (*DeleteLocalRef)(JNIEnv *, jobject);
+	jint (*PushLocalFrame)(JNIEnv *, jint);
+	jobject (*PopLocalFrame)(JNIEnv *, jobject);
+
+	jfloatArray (*NewFloatArray)(JNIEnv *, jsize);
+	jintArray (*NewIntArray)(JNIEnv *, jsize);
+	jbyteArray (*NewByteArray)(JNIEnv *, jsize);
+	void (*GetFloatArrayRegion)(JNIEnv *, jfloatArray, jsize, jsize, jfloat *);
+	void (*SetFloatArrayRegion)(JNIEnv *, jfloatArray, jsize, jsize, const jfloat *);
+	void (*SetIntArrayRegion)(JNIEnv *, jintArray, jsize, jsize, const jint *);
+	void (*SetByteArrayRegion)(JNIEnv *, jbyteArray, jsize, jsize, const jbyte *);
+
+	jstring (*NewStringUTF)(JNIEnv *, const char *);
+	const char *(*GetStringUTFChars)(JNIEnv *, jstring, jboolean *);
+	void (*ReleaseStringUTFChars)(JNIEnv *, jstring, const char *);
+
+	jthrowable (*ExceptionOccurred)(JNIEnv *);
+	void (*ExceptionDescribe)(JNIEnv *);
+	void (*ExceptionClear)(JNIEnv *);
+};
+
+#endif
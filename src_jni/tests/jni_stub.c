@@ -0,0 +1,1049 @@
+/* jni_stub - a fake JNIEnv/JavaVM for driving libsvg-android on a host
+ *
+ * Copyright © 2016 Anton Persson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy (COPYING.LESSER) of the
+ * GNU Lesser General Public License along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <pthread.h>
+
+#include <android/log.h>
+#include <android/bitmap.h>
+
+#include "jni_stub.h"
+
+#define STUB_MAGIC 0x4a4e4953
+#define STUB_MAX_CLASSES 32
+#define STUB_MAX_METHODS 256
+#define STUB_MAX_NATIVES 64
+#define STUB_MAX_FRAMES 64
+#define STUB_MAX_ARGS 16
+
+typedef struct stub_class stub_class_t;
+
+typedef struct stub_object {
+	unsigned int magic;
+	const char *class_name;
+	struct stub_object *next; // all objects of the env that made it
+
+	int locals, globals, pinned;
+
+	int width, height; // canvas, bitmap
+	void *data; // array elements, string, bitmap pixels
+	size_t length;
+
+	unsigned int calls; // canvas calls
+} stub_object_t;
+
+struct stub_class {
+	stub_object_t object;
+	char name[128];
+};
+
+typedef struct stub_method {
+	const char *class_name;
+	char name[64];
+	char signature[128];
+	int is_static;
+} stub_method_t;
+
+typedef union stub_value {
+	jint i;
+	jlong j;
+	double d;
+	jobject l;
+} stub_value_t;
+
+struct stub_env {
+	const struct JNINativeInterface *functions; // must come first, see stub_env_of()
+
+	stub_object_t *objects;
+
+	stub_object_t **locals;
+	int num_locals, locals_size, locals_peak;
+	int frames[STUB_MAX_FRAMES];
+	int num_frames;
+
+	unsigned int method_calls[STUB_MAX_METHODS];
+	unsigned int function_calls[STUB_JNI_FUNCTIONS];
+	unsigned int allocations;
+	unsigned int stale_refs;
+};
+
+static pthread_mutex_t stub_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static stub_class_t stub_classes[STUB_MAX_CLASSES];
+static int stub_num_classes;
+
+static stub_method_t stub_methods[STUB_MAX_METHODS];
+static int stub_num_methods;
+
+static JNINativeMethod stub_natives[STUB_MAX_NATIVES];
+static int stub_num_natives;
+
+static int stub_globals;
+
+static __thread stub_env_t *stub_current;
+
+static stub_env_t *
+stub_env_of (JNIEnv *env)
+{
+	return (stub_env_t *)env;
+}
+
+static stub_object_t *
+stub_object (stub_env_t *stub, jobject ref)
+{
+	stub_object_t *object = ref;
+
+	if(object == NULL)
+		return NULL;
+	if(object->magic != STUB_MAGIC) {
+		fprintf(stderr, "jni_stub: %p is not a reference\n", ref);
+		abort();
+	}
+	if(stub && object->locals <= 0 && object->globals <= 0 && !object->pinned)
+		stub->stale_refs++;
+
+	return object;
+}
+
+/*
+ * local references
+ */
+
+static void
+stub_add_local (stub_env_t *stub, stub_object_t *object)
+{
+	if(stub->num_locals == stub->locals_size) {
+		stub->locals_size = stub->locals_size ? 2 * stub->locals_size : 64;
+		stub->locals = realloc(stub->locals, stub->locals_size * sizeof(stub_object_t *));
+		if(stub->locals == NULL)
+			abort();
+	}
+	stub->locals[stub->num_locals++] = object;
+	object->locals++;
+
+	if(stub_env_local_refs (stub) > stub->locals_peak)
+		stub->locals_peak = stub_env_local_refs (stub);
+}
+
+static stub_object_t *
+stub_new_object (stub_env_t *stub, const char *class_name)
+{
+	stub_object_t *object = calloc(1, sizeof(stub_object_t));
+
+	if(object == NULL)
+		abort();
+	object->magic = STUB_MAGIC;
+	object->class_name = class_name;
+	object->next = stub->objects;
+	stub->objects = object;
+	stub->allocations++;
+
+	stub_add_local (stub, object);
+
+	return object;
+}
+
+static void
+stub_delete_local (stub_env_t *stub, jobject ref)
+{
+	int k;
+
+	for(k = stub->num_locals - 1; k >= 0; k--) {
+		if(stub->locals[k] != NULL && stub->locals[k] == ref) {
+			stub->locals[k]->locals--;
+			stub->locals[k] = NULL;
+			return;
+		}
+	}
+	if(ref)
+		stub->stale_refs++;
+}
+
+/*
+ * classes and methods, shared by every env like in a VM
+ */
+
+static stub_class_t *
+stub_find_class (const char *name)
+{
+	stub_class_t *clazz = NULL;
+	int k;
+
+	pthread_mutex_lock(&stub_lock);
+	for(k = 0; k < stub_num_classes; k++)
+		if(strcmp(stub_classes[k].name, name) == 0)
+			clazz = &stub_classes[k];
+	if(clazz == NULL && stub_num_classes < STUB_MAX_CLASSES) {
+		clazz = &stub_classes[stub_num_classes++];
+		snprintf(clazz->name, sizeof(clazz->name), "%s", name);
+		clazz->object.magic = STUB_MAGIC;
+		clazz->object.class_name = "java/lang/Class";
+		clazz->object.pinned = 1;
+	}
+	pthread_mutex_unlock(&stub_lock);
+
+	return clazz;
+}
+
+static stub_method_t *
+stub_find_method (jclass clazz, const char *name, const char *signature, int is_static)
+{
+	stub_class_t *c = clazz;
+	stub_method_t *method = NULL;
+	int k;
+
+	pthread_mutex_lock(&stub_lock);
+	for(k = 0; k < stub_num_methods; k++) {
+		if(stub_methods[k].class_name == c->name &&
+		   strcmp(stub_methods[k].name, name) == 0 &&
+		   strcmp(stub_methods[k].signature, signature) == 0)
+			method = &stub_methods[k];
+	}
+	if(method == NULL && stub_num_methods < STUB_MAX_METHODS) {
+		method = &stub_methods[stub_num_methods++];
+		method->class_name = c->name;
+		snprintf(method->name, sizeof(method->name), "%s", name);
+		snprintf(method->signature, sizeof(method->signature), "%s", signature);
+		method->is_static = is_static;
+	}
+	pthread_mutex_unlock(&stub_lock);
+
+	return method;
+}
+
+/*
+ * the java side
+ */
+
+static int
+stub_parse_args (const char *signature, va_list *ap, stub_value_t *args)
+{
+	const char *p = signature + 1;
+	int n = 0;
+
+	while(*p && *p != ')' && n < STUB_MAX_ARGS) {
+		switch(*p) {
+		case 'Z': case 'B': case 'C': case 'S': case 'I':
+			args[n].i = va_arg(*ap, jint);
+			break;
+		case 'J':
+			args[n].j = va_arg(*ap, jlong);
+			break;
+		case 'F': case 'D':
+			args[n].d = va_arg(*ap, double);
+			break;
+		case '[':
+			while(*p == '[')
+				p++;
+			/* fall through */
+		case 'L':
+			if(*p == 'L')
+				p = strchr(p, ';');
+			args[n].l = va_arg(*ap, jobject);
+			break;
+		}
+		p++;
+		n++;
+	}
+
+	return n;
+}
+
+static int
+stub_is (stub_object_t *object, const char *class_name)
+{
+	return object && strcmp(object->class_name, class_name) == 0;
+}
+
+static void
+stub_fill_floats (stub_env_t *stub, jobject array, const float *values, int count)
+{
+	stub_object_t *object = stub_object (stub, array);
+
+	if(object && object->length >= (size_t)count)
+		memcpy(object->data, values, count * sizeof(float));
+}
+
+static stub_object_t *
+stub_new_bitmap_object (stub_env_t *stub, int width, int height)
+{
+	stub_object_t *bitmap = stub_new_object (stub, "android/graphics/Bitmap");
+
+	bitmap->width = width;
+	bitmap->height = height;
+
+	return bitmap;
+}
+
+/* What the java side does for a call, only the parts the engine reads
+ * back are simulated. The return type decides the rest: methods
+ * returning an object make a new one, except for the setters of Paint
+ * which hand back the previous value. */
+static stub_value_t
+stub_invoke (stub_env_t *stub, stub_object_t *self, stub_method_t *method, va_list *ap)
+{
+	stub_value_t args[STUB_MAX_ARGS], result;
+	stub_object_t *canvas = NULL;
+	const char *returns;
+	int num_args;
+
+	memset(&result, 0, sizeof(result));
+	num_args = stub_parse_args (method->signature, ap, args);
+
+	if(stub_is (self, "android/graphics/Canvas"))
+		canvas = self;
+	else if(num_args > 0 && strncmp(method->signature, "(Landroid/graphics/Canvas;", 26) == 0)
+		canvas = stub_object (stub, args[0].l);
+	if(canvas)
+		canvas->calls++;
+
+	if(strcmp(method->name, "getWidth") == 0) {
+		result.i = self->width;
+	} else if(strcmp(method->name, "getHeight") == 0) {
+		result.i = self->height;
+	} else if(strcmp(method->name, "clipRect") == 0) {
+		result.i = JNI_TRUE;
+	} else if(strcmp(method->name, "getCanvasState") == 0) {
+		float state[10] = { 1, 0, 0, 1, 0, 0, 0, 0, canvas->width, canvas->height };
+
+		stub_fill_floats (stub, args[1].l, state, 10);
+	} else if(strcmp(method->name, "getBoundingBox") == 0) {
+		stub_object_t *target = stub_object (stub, args[1].l);
+		float box[5] = { 1, 0, 0, target->width, target->height };
+
+		stub_fill_floats (stub, args[2].l, box, 5);
+	} else if(strcmp(method->name, "getBounds") == 0) {
+		float bounds[4] = { 0, 0, 1, 1 };
+
+		stub_fill_floats (stub, args[1].l, bounds, 4);
+	}
+
+	returns = strchr(method->signature, ')') + 1;
+	if(*returns == 'L' &&
+	   strcmp(method->name, "setShader") != 0 &&
+	   strcmp(method->name, "setPathEffect") != 0) {
+		if(strcmp(returns, "Landroid/graphics/Bitmap;") == 0 &&
+		   strcmp(method->name, "createBitmap") == 0)
+			result.l = stub_new_bitmap_object (stub, args[0].i, args[1].i);
+		else if(strcmp(returns, "Landroid/graphics/Bitmap;") == 0 &&
+			strcmp(method->name, "data2bitmap") == 0)
+			result.l = stub_new_bitmap_object (stub, args[0].i, args[1].i);
+		else {
+			stub_class_t *clazz;
+			char name[128];
+
+			snprintf(name, sizeof(name), "%.*s", (int)strlen(returns) - 2, returns + 1);
+			clazz = stub_find_class (name);
+			result.l = stub_new_object (stub, clazz->name);
+		}
+	}
+
+	return result;
+}
+
+static stub_value_t
+stub_call (JNIEnv *env, jobject ref, jmethodID id, va_list *ap)
+{
+	stub_env_t *stub = stub_env_of (env);
+	stub_method_t *method = (stub_method_t *)id;
+	stub_object_t *self = NULL;
+
+	if(method->is_static)
+		stub_object (stub, ref); // the class
+	else
+		self = stub_object (stub, ref);
+
+	stub->function_calls[STUB_CALL_METHOD]++;
+	stub->method_calls[method - stub_methods]++;
+
+	return stub_invoke (stub, self, method, ap);
+}
+
+/*
+ * the JNIEnv functions
+ */
+
+static jclass
+stub_FindClass (JNIEnv *env, const char *name)
+{
+	stub_class_t *clazz = stub_find_class (name);
+	stub_env_t *stub = stub_env_of (env);
+
+	stub->function_calls[STUB_OTHER]++;
+	if(clazz == NULL)
+		return NULL;
+
+	/* a local ref like any other, the caller deletes it */
+	stub_add_local (stub, &clazz->object);
+
+	return &clazz->object;
+}
+
+static jmethodID
+stub_GetMethodID (JNIEnv *env, jclass clazz, const char *name, const char *signature)
+{
+	stub_env_of (env)->function_calls[STUB_OTHER]++;
+	return (jmethodID)stub_find_method (clazz, name, signature, 0);
+}
+
+static jmethodID
+stub_GetStaticMethodID (JNIEnv *env, jclass clazz, const char *name, const char *signature)
+{
+	stub_env_of (env)->function_calls[STUB_OTHER]++;
+	return (jmethodID)stub_find_method (clazz, name, signature, 1);
+}
+
+static jint
+stub_RegisterNatives (JNIEnv *env, jclass clazz, const JNINativeMethod *methods, jint count)
+{
+	int k;
+
+	stub_env_of (env)->function_calls[STUB_OTHER]++;
+
+	pthread_mutex_lock(&stub_lock);
+	for(k = 0; k < count && stub_num_natives < STUB_MAX_NATIVES; k++)
+		stub_natives[stub_num_natives++] = methods[k];
+	pthread_mutex_unlock(&stub_lock);
+
+	return k == count ? JNI_OK : JNI_ERR;
+}
+
+static jobject
+stub_NewObject (JNIEnv *env, jclass clazz, jmethodID id, ...)
+{
+	stub_env_t *stub = stub_env_of (env);
+	stub_method_t *method = (stub_method_t *)id;
+	stub_value_t args[STUB_MAX_ARGS];
+	stub_object_t *object;
+	va_list ap;
+	int num_args;
+
+	stub->function_calls[STUB_NEW_OBJECT]++;
+	stub->method_calls[method - stub_methods]++;
+
+	va_start(ap, id);
+	num_args = stub_parse_args (method->signature, &ap, args);
+	va_end(ap);
+
+	object = stub_new_object (stub, ((stub_class_t *)stub_object (stub, clazz))->name);
+
+	// new Canvas(bitmap) draws to the bitmap
+	if(num_args == 1 && stub_is (object, "android/graphics/Canvas")) {
+		stub_object_t *bitmap = stub_object (stub, args[0].l);
+
+		object->width = bitmap->width;
+		object->height = bitmap->height;
+	}
+
+	return object;
+}
+
+#define STUB_CALL(name, type, field)					\
+static type								\
+stub_##name (JNIEnv *env, jobject ref, jmethodID id, ...)		\
+{									\
+	stub_value_t result;						\
+	va_list ap;							\
+									\
+	va_start(ap, id);						\
+	result = stub_call (env, ref, id, &ap);				\
+	va_end(ap);							\
+									\
+	return (type)result.field;					\
+}
+
+STUB_CALL(CallIntMethod, jint, i)
+STUB_CALL(CallBooleanMethod, jboolean, i)
+STUB_CALL(CallObjectMethod, jobject, l)
+STUB_CALL(CallStaticObjectMethod, jobject, l)
+
+static void
+stub_CallVoidMethod (JNIEnv *env, jobject ref, jmethodID id, ...)
+{
+	va_list ap;
+
+	va_start(ap, id);
+	stub_call (env, ref, id, &ap);
+	va_end(ap);
+}
+
+static void
+stub_CallStaticVoidMethod (JNIEnv *env, jclass clazz, jmethodID id, ...)
+{
+	va_list ap;
+
+	va_start(ap, id);
+	stub_call (env, clazz, id, &ap);
+	va_end(ap);
+}
+
+static jobject
+stub_NewGlobalRef (JNIEnv *env, jobject ref)
+{
+	stub_object_t *object = stub_object (stub_env_of (env), ref);
+
+	stub_env_of (env)->function_calls[STUB_NEW_GLOBAL_REF]++;
+	if(object == NULL)
+		return NULL;
+
+	pthread_mutex_lock(&stub_lock);
+	object->globals++;
+	stub_globals++;
+	pthread_mutex_unlock(&stub_lock);
+
+	return object;
+}
+
+static void
+stub_DeleteGlobalRef (JNIEnv *env, jobject ref)
+{
+	stub_object_t *object = stub_object (NULL, ref);
+
+	stub_env_of (env)->function_calls[STUB_DELETE_GLOBAL_REF]++;
+	if(object == NULL)
+		return;
+
+	pthread_mutex_lock(&stub_lock);
+	if(object->globals > 0) {
+		object->globals--;
+		stub_globals--;
+	} else {
+		stub_env_of (env)->stale_refs++;
+	}
+	pthread_mutex_unlock(&stub_lock);
+}
+
+static void
+stub_DeleteLocalRef (JNIEnv *env, jobject ref)
+{
+	stub_env_of (env)->function_calls[STUB_DELETE_LOCAL_REF]++;
+	stub_delete_local (stub_env_of (env), ref);
+}
+
+static jint
+stub_PushLocalFrame (JNIEnv *env, jint capacity)
+{
+	stub_env_t *stub = stub_env_of (env);
+
+	stub->function_calls[STUB_PUSH_LOCAL_FRAME]++;
+	if(stub->num_frames == STUB_MAX_FRAMES)
+		return JNI_ERR;
+	stub->frames[stub->num_frames++] = stub->num_locals;
+
+	return JNI_OK;
+}
+
+static jobject
+stub_PopLocalFrame (JNIEnv *env, jobject ref)
+{
+	stub_env_t *stub = stub_env_of (env);
+	stub_object_t *result = stub_object (stub, ref);
+	int top;
+
+	stub->function_calls[STUB_POP_LOCAL_FRAME]++;
+	if(stub->num_frames == 0) {
+		fprintf(stderr, "jni_stub: PopLocalFrame without a frame\n");
+		abort();
+	}
+
+	top = stub->frames[--stub->num_frames];
+	while(stub->num_locals > top) {
+		stub_object_t *object = stub->locals[--stub->num_locals];
+
+		if(object)
+			object->locals--;
+	}
+
+	if(result)
+		stub_add_local (stub, result);
+
+	return result;
+}
+
+static jarray
+stub_new_array (JNIEnv *env, const char *class_name, jsize length, size_t size)
+{
+	stub_env_t *stub = stub_env_of (env);
+	stub_object_t *array;
+
+	stub->function_calls[STUB_NEW_ARRAY]++;
+
+	array = stub_new_object (stub, class_name);
+	array->length = length;
+	array->data = calloc(length ? length : 1, size);
+	if(array->data == NULL)
+		abort();
+
+	return array;
+}
+
+static jfloatArray
+stub_NewFloatArray (JNIEnv *env, jsize length)
+{
+	return stub_new_array (env, "[F", length, sizeof(jfloat));
+}
+
+static jintArray
+stub_NewIntArray (JNIEnv *env, jsize length)
+{
+	return stub_new_array (env, "[I", length, sizeof(jint));
+}
+
+static jbyteArray
+stub_NewByteArray (JNIEnv *env, jsize length)
+{
+	return stub_new_array (env, "[B", length, sizeof(jbyte));
+}
+
+static void
+stub_array_region (JNIEnv *env, jarray ref, jsize start, jsize length,
+		   void *buffer, size_t size, int set)
+{
+	stub_env_t *stub = stub_env_of (env);
+	stub_object_t *array = stub_object (stub, ref);
+
+	stub->function_calls[STUB_ARRAY_REGION]++;
+	if(start < 0 || length < 0 || (size_t)(start + length) > array->length) {
+		fprintf(stderr, "jni_stub: array region %d+%d out of %d\n",
+			(int)start, (int)length, (int)array->length);
+		abort();
+	}
+
+	if(set)
+		memcpy((char *)array->data + start * size, buffer, length * size);
+	else
+		memcpy(buffer, (char *)array->data + start * size, length * size);
+}
+
+static void
+stub_GetFloatArrayRegion (JNIEnv *env, jfloatArray ref, jsize start, jsize length, jfloat *buffer)
+{
+	stub_array_region (env, ref, start, length, buffer, sizeof(jfloat), 0);
+}
+
+static void
+stub_SetFloatArrayRegion (JNIEnv *env, jfloatArray ref, jsize start, jsize length, const jfloat *buffer)
+{
+	stub_array_region (env, ref, start, length, (void *)buffer, sizeof(jfloat), 1);
+}
+
+static void
+stub_SetIntArrayRegion (JNIEnv *env, jintArray ref, jsize start, jsize length, const jint *buffer)
+{
+	stub_array_region (env, ref, start, length, (void *)buffer, sizeof(jint), 1);
+}
+
+static void
+stub_SetByteArrayRegion (JNIEnv *env, jbyteArray ref, jsize start, jsize length, const jbyte *buffer)
+{
+	stub_array_region (env, ref, start, length, (void *)buffer, sizeof(jbyte), 1);
+}
+
+static jstring
+stub_NewStringUTF (JNIEnv *env, const char *string)
+{
+	stub_env_t *stub = stub_env_of (env);
+	stub_object_t *object;
+
+	stub->function_calls[STUB_NEW_STRING]++;
+
+	object = stub_new_object (stub, "java/lang/String");
+	object->data = strdup(string);
+	object->length = strlen(string);
+
+	return object;
+}
+
+static const char *
+stub_GetStringUTFChars (JNIEnv *env, jstring ref, jboolean *is_copy)
+{
+	stub_env_of (env)->function_calls[STUB_OTHER]++;
+	if(is_copy)
+		*is_copy = JNI_FALSE;
+	return stub_object (stub_env_of (env), ref)->data;
+}
+
+static void
+stub_ReleaseStringUTFChars (JNIEnv *env, jstring ref, const char *chars)
+{
+	stub_env_of (env)->function_calls[STUB_OTHER]++;
+}
+
+static jthrowable
+stub_ExceptionOccurred (JNIEnv *env)
+{
+	// the fake java side never throws
+	stub_env_of (env)->function_calls[STUB_OTHER]++;
+	return NULL;
+}
+
+static void
+stub_ExceptionDescribe (JNIEnv *env)
+{
+	stub_env_of (env)->function_calls[STUB_OTHER]++;
+}
+
+static void
+stub_ExceptionClear (JNIEnv *env)
+{
+	stub_env_of (env)->function_calls[STUB_OTHER]++;
+}
+
+static const struct JNINativeInterface stub_functions = {
+	.FindClass = stub_FindClass,
+	.GetMethodID = stub_GetMethodID,
+	.GetStaticMethodID = stub_GetStaticMethodID,
+	.RegisterNatives = stub_RegisterNatives,
+	.NewObject = stub_NewObject,
+	.CallVoidMethod = stub_CallVoidMethod,
+	.CallIntMethod = stub_CallIntMethod,
+	.CallBooleanMethod = stub_CallBooleanMethod,
+	.CallObjectMethod = stub_CallObjectMethod,
+	.CallStaticVoidMethod = stub_CallStaticVoidMethod,
+	.CallStaticObjectMethod = stub_CallStaticObjectMethod,
+	.NewGlobalRef = stub_NewGlobalRef,
+	.DeleteGlobalRef = stub_DeleteGlobalRef,
+	.DeleteLocalRef = stub_DeleteLocalRef,
+	.PushLocalFrame = stub_PushLocalFrame,
+	.PopLocalFrame = stub_PopLocalFrame,
+	.NewFloatArray = stub_NewFloatArray,
+	.NewIntArray = stub_NewIntArray,
+	.NewByteArray = stub_NewByteArray,
+	.GetFloatArrayRegion = stub_GetFloatArrayRegion,
+	.SetFloatArrayRegion = stub_SetFloatArrayRegion,
+	.SetIntArrayRegion = stub_SetIntArrayRegion,
+	.SetByteArrayRegion = stub_SetByteArrayRegion,
+	.NewStringUTF = stub_NewStringUTF,
+	.GetStringUTFChars = stub_GetStringUTFChars,
+	.ReleaseStringUTFChars = stub_ReleaseStringUTFChars,
+	.ExceptionOccurred = stub_ExceptionOccurred,
+	.ExceptionDescribe = stub_ExceptionDescribe,
+	.ExceptionClear = stub_ExceptionClear,
+};
+
+/*
+ * the VM
+ */
+
+static jint
+stub_GetEnv (JavaVM *vm, void **env, jint version)
+{
+	if(stub_current == NULL) {
+		*env = NULL;
+		return JNI_EDETACHED;
+	}
+
+	*env = stub_env_jni (stub_current);
+	return JNI_OK;
+}
+
+static const struct JNIInvokeInterface stub_invoke_functions = {
+	.GetEnv = stub_GetEnv,
+};
+
+static JavaVM stub_java_vm = &stub_invoke_functions;
+
+JavaVM *
+stub_vm (void)
+{
+	return &stub_java_vm;
+}
+
+/*
+ * the test side
+ */
+
+stub_env_t *
+stub_env_create (void)
+{
+	stub_env_t *stub = calloc(1, sizeof(stub_env_t));
+
+	if(stub == NULL)
+		abort();
+	stub->functions = &stub_functions;
+	stub_current = stub;
+
+	return stub;
+}
+
+void
+stub_env_destroy (stub_env_t *stub)
+{
+	stub_object_t *object;
+
+	while(stub->objects) {
+		object = stub->objects;
+		stub->objects = object->next;
+		if(object->globals)
+			fprintf(stderr, "jni_stub: %s still has %d global refs\n",
+				object->class_name, object->globals);
+		free(object->data);
+		free(object);
+	}
+
+	if(stub_current == stub)
+		stub_current = NULL;
+	free(stub->locals);
+	free(stub);
+}
+
+JNIEnv *
+stub_env_jni (stub_env_t *stub)
+{
+	return (JNIEnv *)stub;
+}
+
+void
+stub_env_reset (stub_env_t *stub)
+{
+	memset(stub->method_calls, 0, sizeof(stub->method_calls));
+	memset(stub->function_calls, 0, sizeof(stub->function_calls));
+	stub->allocations = 0;
+	stub->stale_refs = 0;
+	stub->locals_peak = stub_env_local_refs (stub);
+}
+
+unsigned int
+stub_env_transitions (stub_env_t *stub)
+{
+	return stub->function_calls[STUB_CALL_METHOD] + stub->function_calls[STUB_NEW_OBJECT];
+}
+
+unsigned int
+stub_env_allocations (stub_env_t *stub)
+{
+	return stub->allocations;
+}
+
+unsigned int
+stub_env_function_calls (stub_env_t *stub, stub_jni_function_t function)
+{
+	return stub->function_calls[function];
+}
+
+unsigned int
+stub_env_method_calls (stub_env_t *stub, const char *method)
+{
+	const char *dot = strrchr(method, '.');
+	unsigned int count = 0;
+	int k;
+
+	if(dot == NULL)
+		return 0;
+
+	pthread_mutex_lock(&stub_lock);
+	for(k = 0; k < stub_num_methods; k++) {
+		if(strlen(stub_methods[k].class_name) == (size_t)(dot - method) &&
+		   strncmp(stub_methods[k].class_name, method, dot - method) == 0 &&
+		   strcmp(stub_methods[k].name, dot + 1) == 0)
+			count += stub->method_calls[k];
+	}
+	pthread_mutex_unlock(&stub_lock);
+
+	return count;
+}
+
+int
+stub_env_local_refs (stub_env_t *stub)
+{
+	int k, count = 0;
+
+	for(k = 0; k < stub->num_locals; k++)
+		if(stub->locals[k])
+			count++;
+
+	return count;
+}
+
+int
+stub_env_local_refs_peak (stub_env_t *stub)
+{
+	return stub->locals_peak;
+}
+
+unsigned int
+stub_env_stale_refs (stub_env_t *stub)
+{
+	return stub->stale_refs;
+}
+
+void
+stub_env_report (stub_env_t *stub, FILE *out, const char *title)
+{
+	static const char *functions[STUB_JNI_FUNCTIONS] = {
+		"NewObject", "Call*Method", "New*Array", "NewStringUTF",
+		"NewGlobalRef", "DeleteGlobalRef", "DeleteLocalRef",
+		"PushLocalFrame", "PopLocalFrame", "*ArrayRegion", "other",
+	};
+	int k;
+
+	fprintf(out, "%s: %u calls into java, %u allocations, %d local refs at most\n",
+		title, stub_env_transitions (stub), stub->allocations, stub->locals_peak);
+
+	pthread_mutex_lock(&stub_lock);
+	for(k = 0; k < stub_num_methods; k++) {
+		if(stub->method_calls[k])
+			fprintf(out, "  %8u %s.%s%s\n", stub->method_calls[k],
+				stub_methods[k].class_name, stub_methods[k].name,
+				stub_methods[k].signature);
+	}
+	pthread_mutex_unlock(&stub_lock);
+
+	for(k = 0; k < STUB_JNI_FUNCTIONS; k++) {
+		if(stub->function_calls[k])
+			fprintf(out, "  %8u %s\n", stub->function_calls[k], functions[k]);
+	}
+}
+
+int
+stub_global_refs (void)
+{
+	int count;
+
+	pthread_mutex_lock(&stub_lock);
+	count = stub_globals;
+	pthread_mutex_unlock(&stub_lock);
+
+	return count;
+}
+
+jobject
+stub_new_canvas (stub_env_t *stub, int width, int height)
+{
+	stub_object_t *canvas = stub_new_object (stub, "android/graphics/Canvas");
+
+	canvas->width = width;
+	canvas->height = height;
+	canvas->pinned = 1;
+	stub->allocations--; // made by the test, not the engine
+
+	return canvas;
+}
+
+jobject
+stub_new_bitmap (stub_env_t *stub, int width, int height)
+{
+	stub_object_t *bitmap = stub_new_bitmap_object (stub, width, height);
+
+	bitmap->data = calloc((size_t)width * height, 4);
+	if(bitmap->data == NULL)
+		abort();
+	bitmap->length = (size_t)width * height * 4;
+	bitmap->pinned = 1;
+	stub->allocations--;
+
+	return bitmap;
+}
+
+jstring
+stub_new_string (stub_env_t *stub, const char *string)
+{
+	stub_object_t *object = stub_new_object (stub, "java/lang/String");
+
+	object->data = strdup(string);
+	object->length = strlen(string);
+	object->pinned = 1;
+	stub->allocations--;
+
+	return object;
+}
+
+unsigned int
+stub_canvas_calls (jobject canvas)
+{
+	return stub_object (NULL, canvas)->calls;
+}
+
+const unsigned char *
+stub_bitmap_pixels (jobject bitmap)
+{
+	return stub_object (NULL, bitmap)->data;
+}
+
+void *
+stub_native (const char *name)
+{
+	void *native = NULL;
+	int k;
+
+	pthread_mutex_lock(&stub_lock);
+	for(k = 0; k < stub_num_natives; k++)
+		if(strcmp(stub_natives[k].name, name) == 0)
+			native = stub_natives[k].fnPtr;
+	pthread_mutex_unlock(&stub_lock);
+
+	return native;
+}
+
+/*
+ * what the NDK libraries provide on a device
+ */
+
+int
+__android_log_print (int prio, const char *tag, const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	if(prio < ANDROID_LOG_ERROR && getenv("JNI_STUB_LOG") == NULL)
+		return 0;
+
+	va_start(ap, fmt);
+	n = vfprintf(stderr, fmt, ap);
+	va_end(ap);
+
+	return n;
+}
+
+int
+AndroidBitmap_getInfo (JNIEnv *env, jobject ref, AndroidBitmapInfo *info)
+{
+	stub_object_t *bitmap = stub_object (stub_env_of (env), ref);
+
+	if(!stub_is (bitmap, "android/graphics/Bitmap"))
+		return ANDROID_BITMAP_RESULT_BAD_PARAMETER;
+
+	info->width = bitmap->width;
+	info->height = bitmap->height;
+	info->stride = 4 * bitmap->width;
+	info->format = ANDROID_BITMAP_FORMAT_RGBA_8888;
+	info->flags = 0;
+
+	return ANDROID_BITMAP_RESULT_SUCCESS;
+}
+
+int
+AndroidBitmap_lockPixels (JNIEnv *env, jobject ref, void **pixels)
+{
+	stub_object_t *bitmap = stub_object (stub_env_of (env), ref);
+
+	if(bitmap->data == NULL)
+		return ANDROID_BITMAP_RESULT_BAD_PARAMETER;
+	*pixels = bitmap->data;
+
+	return ANDROID_BITMAP_RESULT_SUCCESS;
+}
+
+int
+AndroidBitmap_unlockPixels (JNIEnv *env, jobject ref)
+{
+	return ANDROID_BITMAP_RESULT_SUCCESS;
+}
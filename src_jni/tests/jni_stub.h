@@ -0,0 +1,125 @@
+/* jni_stub - a fake JNIEnv/JavaVM for driving libsvg-android on a host
+ *
+ * Copyright © 2016 Anton Persson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy (COPYING.LESSER) of the
+ * GNU Lesser General Public License along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JNI_STUB_H
+#define JNI_STUB_H
+
+#include <stdio.h>
+#include <jni.h>
+
+/* Every env counts what was called through it, so a document rendered
+ * through an env of its own gets a report of its own. An env belongs to
+ * the thread that created it, like a real one.
+ *
+ * The Java side is simulated just far enough for the engine to run:
+ * objects are allocated and reference counted, canvases have a size and
+ * an identity clip, bitmaps made by the test have pixels, and anything
+ * returning geometry returns the canvas bounds.
+ */
+typedef struct stub_env stub_env_t;
+
+/* the JNI functions the counters below are kept for */
+typedef enum stub_jni_function {
+	STUB_NEW_OBJECT,
+	STUB_CALL_METHOD,		/* all Call*Method variants */
+	STUB_NEW_ARRAY,			/* all New*Array variants */
+	STUB_NEW_STRING,
+	STUB_NEW_GLOBAL_REF,
+	STUB_DELETE_GLOBAL_REF,
+	STUB_DELETE_LOCAL_REF,
+	STUB_PUSH_LOCAL_FRAME,
+	STUB_POP_LOCAL_FRAME,
+	STUB_ARRAY_REGION,		/* Get/Set*ArrayRegion */
+	STUB_OTHER,
+	STUB_JNI_FUNCTIONS
+} stub_jni_function_t;
+
+JavaVM *
+stub_vm (void);
+
+stub_env_t *
+stub_env_create (void);
+
+void
+stub_env_destroy (stub_env_t *stub);
+
+JNIEnv *
+stub_env_jni (stub_env_t *stub);
+
+/* forget the counts, typically between two renders */
+void
+stub_env_reset (stub_env_t *stub);
+
+/* calls made into java: Call*Method and NewObject (a constructor) */
+unsigned int
+stub_env_transitions (stub_env_t *stub);
+
+/* java objects created: NewObject, New*Array, NewStringUTF and every
+ * method returning a new object */
+unsigned int
+stub_env_allocations (stub_env_t *stub);
+
+unsigned int
+stub_env_function_calls (stub_env_t *stub, stub_jni_function_t function);
+
+/* calls of one method, by "Class.name", e.g. "android/graphics/Path.lineTo" */
+unsigned int
+stub_env_method_calls (stub_env_t *stub, const char *method);
+
+/* local refs alive now, and the most that were alive at any point */
+int
+stub_env_local_refs (stub_env_t *stub);
+
+int
+stub_env_local_refs_peak (stub_env_t *stub);
+
+/* uses of a reference after it was deleted */
+unsigned int
+stub_env_stale_refs (stub_env_t *stub);
+
+/* one line per method called since the last reset */
+void
+stub_env_report (stub_env_t *stub, FILE *out, const char *title);
+
+/* global refs alive in the process */
+int
+stub_global_refs (void);
+
+/* objects the java side of a test hands in */
+jobject
+stub_new_canvas (stub_env_t *stub, int width, int height);
+
+jobject
+stub_new_bitmap (stub_env_t *stub, int width, int height);
+
+jstring
+stub_new_string (stub_env_t *stub, const char *string);
+
+/* calls made on a canvas, or with it, since it was created */
+unsigned int
+stub_canvas_calls (jobject canvas);
+
+const unsigned char *
+stub_bitmap_pixels (jobject bitmap);
+
+/* a native registered through RegisterNatives, NULL if there is none */
+void *
+stub_native (const char *name);
+
+#endif
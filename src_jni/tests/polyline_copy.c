@@ -0,0 +1,180 @@
+/* libsvg-android host tests
+ *
+ * Copyright © 2016 Anton Persson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy (COPYING.LESSER) of the
+ * GNU Lesser General Public License along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Not built on its own: fixed_polyline.c and double_polyline.c choose
+ * LIBSVG_FIXED_POINT and a POLYLINE_COPY() prefix, then include this.
+ * The svg_polyline functions are renamed with the prefix so both copies
+ * link next to the one in the library.
+ */
+
+#define svg_polyline_init		POLYLINE_COPY (svg_polyline_init)
+#define svg_polyline_deinit		POLYLINE_COPY (svg_polyline_deinit)
+#define svg_polyline_clear		POLYLINE_COPY (svg_polyline_clear)
+#define svg_coord_from_double		POLYLINE_COPY (svg_coord_from_double)
+#define svg_polyline_move_to		POLYLINE_COPY (svg_polyline_move_to)
+#define svg_polyline_line_to		POLYLINE_COPY (svg_polyline_line_to)
+#define svg_polyline_close_path		POLYLINE_COPY (svg_polyline_close_path)
+#define svg_polyline_curve_to		POLYLINE_COPY (svg_polyline_curve_to)
+#define svg_polyline_ellipse		POLYLINE_COPY (svg_polyline_ellipse)
+#define svg_polyline_rect		POLYLINE_COPY (svg_polyline_rect)
+#define svg_polyline_contains		POLYLINE_COPY (svg_polyline_contains)
+
+#include "svg_polyline.c"
+
+#include "polyline_copy.h"
+
+struct polyline_copy {
+	svg_polyline_t polyline;
+};
+
+static polyline_copy_t *
+copy_create (double tolerance)
+{
+	polyline_copy_t *copy = malloc(sizeof(polyline_copy_t));
+
+	if(copy == NULL)
+		return NULL;
+
+	svg_polyline_init(&copy->polyline);
+	copy->polyline.tolerance = tolerance;
+
+	return copy;
+}
+
+static void
+copy_destroy (polyline_copy_t *copy)
+{
+	svg_polyline_deinit(&copy->polyline);
+	free(copy);
+}
+
+static void
+copy_clear (polyline_copy_t *copy)
+{
+	svg_polyline_clear(&copy->polyline);
+}
+
+static void
+copy_move_to (polyline_copy_t *copy, double x, double y)
+{
+	svg_polyline_move_to(&copy->polyline, x, y);
+}
+
+static void
+copy_line_to (polyline_copy_t *copy, double x, double y)
+{
+	svg_polyline_line_to(&copy->polyline, x, y);
+}
+
+static void
+copy_curve_to (polyline_copy_t *copy,
+	       double x0, double y0, double x1, double y1,
+	       double x2, double y2, double x3, double y3)
+{
+	svg_polyline_curve_to(&copy->polyline, x0, y0, x1, y1, x2, y2, x3, y3);
+}
+
+static void
+copy_close_path (polyline_copy_t *copy)
+{
+	svg_polyline_close_path(&copy->polyline);
+}
+
+static void
+copy_ellipse (polyline_copy_t *copy, double cx, double cy, double rx, double ry)
+{
+	svg_polyline_ellipse(&copy->polyline, cx, cy, rx, ry);
+}
+
+static void
+copy_rect (polyline_copy_t *copy, double x, double y,
+	   double width, double height, double rx, double ry)
+{
+	svg_polyline_rect(&copy->polyline, x, y, width, height, rx, ry);
+}
+
+static int
+copy_contains (const polyline_copy_t *copy, svg_fill_rule_t fill_rule, double x, double y)
+{
+	return svg_polyline_contains(&copy->polyline, fill_rule, x, y);
+}
+
+static int
+copy_error (const polyline_copy_t *copy)
+{
+	return copy->polyline.error;
+}
+
+static int
+copy_num_points (const polyline_copy_t *copy)
+{
+	return copy->polyline.num_points;
+}
+
+static void
+copy_point (const polyline_copy_t *copy, int k, double *x, double *y)
+{
+	*x = SVG_COORD_TO_DOUBLE(copy->polyline.points[k].x);
+	*y = SVG_COORD_TO_DOUBLE(copy->polyline.points[k].y);
+}
+
+static int
+copy_num_subpaths (const polyline_copy_t *copy)
+{
+	return copy->polyline.num_subpaths;
+}
+
+static void
+copy_subpath (const polyline_copy_t *copy, int s, int *first, int *count, int *closed)
+{
+	*first = copy->polyline.subpaths[s].first;
+	*count = copy->polyline.subpaths[s].count;
+	*closed = copy->polyline.subpaths[s].closed;
+}
+
+static int
+copy_extents (const polyline_copy_t *copy, double *x1, double *y1, double *x2, double *y2)
+{
+	*x1 = SVG_COORD_TO_DOUBLE(copy->polyline.x1);
+	*y1 = SVG_COORD_TO_DOUBLE(copy->polyline.y1);
+	*x2 = SVG_COORD_TO_DOUBLE(copy->polyline.x2);
+	*y2 = SVG_COORD_TO_DOUBLE(copy->polyline.y2);
+
+	return copy->polyline.has_extents;
+}
+
+const polyline_copy_backend_t POLYLINE_COPY (polyline) = {
+	POLYLINE_COPY_NAME,
+	copy_create,
+	copy_destroy,
+	copy_clear,
+	copy_move_to,
+	copy_line_to,
+	copy_curve_to,
+	copy_close_path,
+	copy_ellipse,
+	copy_rect,
+	copy_contains,
+	copy_error,
+	copy_num_points,
+	copy_point,
+	copy_num_subpaths,
+	copy_subpath,
+	copy_extents,
+};
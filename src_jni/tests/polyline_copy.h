@@ -0,0 +1,66 @@
+/* libsvg-android host tests
+ *
+ * Copyright © 2016 Anton Persson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy (COPYING.LESSER) of the
+ * GNU Lesser General Public License along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef POLYLINE_COPY_H
+#define POLYLINE_COPY_H
+
+#include <svg.h>
+
+/* svg_polyline.c is built into the tests twice more, with and without
+ * LIBSVG_FIXED_POINT, whichever way the library is built. Coordinates
+ * go in and come out as doubles, svg_polyline_t itself stays inside
+ * fixed_polyline.c and double_polyline.c, see polyline_copy.c.
+ */
+typedef struct polyline_copy polyline_copy_t;
+
+typedef struct polyline_copy_backend {
+	const char *name;
+
+	polyline_copy_t *(*create) (double tolerance);
+	void (*destroy) (polyline_copy_t *copy);
+	void (*clear) (polyline_copy_t *copy);
+
+	void (*move_to) (polyline_copy_t *copy, double x, double y);
+	void (*line_to) (polyline_copy_t *copy, double x, double y);
+	void (*curve_to) (polyline_copy_t *copy,
+			  double x0, double y0, double x1, double y1,
+			  double x2, double y2, double x3, double y3);
+	void (*close_path) (polyline_copy_t *copy);
+	void (*ellipse) (polyline_copy_t *copy, double cx, double cy, double rx, double ry);
+	void (*rect) (polyline_copy_t *copy, double x, double y,
+		      double width, double height, double rx, double ry);
+
+	int (*contains) (const polyline_copy_t *copy, svg_fill_rule_t fill_rule,
+			 double x, double y);
+	int (*error) (const polyline_copy_t *copy);
+
+	int (*num_points) (const polyline_copy_t *copy);
+	void (*point) (const polyline_copy_t *copy, int k, double *x, double *y);
+	int (*num_subpaths) (const polyline_copy_t *copy);
+	void (*subpath) (const polyline_copy_t *copy, int s, int *first, int *count, int *closed);
+	// 0 when there are none
+	int (*extents) (const polyline_copy_t *copy,
+			double *x1, double *y1, double *x2, double *y2);
+} polyline_copy_backend_t;
+
+extern const polyline_copy_backend_t fixed_polyline;
+
+extern const polyline_copy_backend_t double_polyline;
+
+#endif
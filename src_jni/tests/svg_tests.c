@@ -0,0 +1,66 @@
+/* libsvg-android host tests
+ *
+ * Copyright © 2016 Anton Persson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy (COPYING.LESSER) of the
+ * GNU Lesser General Public License along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "svg_tests.h"
+
+static const struct {
+	const char *name;
+	int (*run)(void);
+} svg_tests[] = {
+	{ "jni_render", test_jni_render },
+	{ "jni_path_transitions", test_jni_path_transitions },
+	{ "jni_global_refs", test_jni_global_refs },
+	{ "jni_steady_state", test_jni_steady_state },
+	{ "threads", test_threads },
+	{ "golden", test_golden },
+	{ "fixed_point", test_fixed_point },
+};
+
+/* svg-tests [name...] runs the tests named, or all of them */
+int
+main (int argc, char **argv)
+{
+	int k, i, run, failed = 0, count = 0;
+
+	for(k = 0; k < sizeof(svg_tests) / sizeof(svg_tests[0]); k++) {
+		run = argc < 2;
+		for(i = 1; i < argc; i++)
+			if(strcmp(argv[i], svg_tests[k].name) == 0)
+				run = 1;
+		if(!run)
+			continue;
+
+		printf("%-24s ", svg_tests[k].name);
+		fflush(stdout);
+		if(svg_tests[k].run()) {
+			printf("FAIL\n");
+			failed++;
+		} else {
+			printf("ok\n");
+		}
+		count++;
+	}
+
+	printf("%d of %d tests failed\n", failed, count);
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,69 @@
+/* libsvg-android host tests
+ *
+ * Copyright © 2016 Anton Persson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy (COPYING.LESSER) of the
+ * GNU Lesser General Public License along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SVG_TESTS_H
+#define SVG_TESTS_H
+
+#include <stdio.h>
+
+/* A test returns 0 when it passed. CHECK() fails the test it is used
+ * in, with the condition and where it is in the output. */
+#define CHECK(c) do {							\
+		if(!(c)) {						\
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n",	\
+				__FILE__, __LINE__, #c);		\
+			return 1;					\
+		}							\
+	} while(0)
+
+/* test_jni.c - libsvg-android driven through its natives, the way
+ * SvgRaster.java drives it, with every call counted by jni_stub */
+#include "jni_stub.h"
+
+/* runs JNI_OnLoad once, in an env that is kept for the whole run since
+ * the refs resolved in it are global ones */
+int test_jni_load (void);
+
+/* a document parsed from svg, 0 if that failed */
+jlong test_document_create (stub_env_t *stub, const char *svg);
+
+int test_document_render (stub_env_t *stub, jlong document, jobject canvas);
+
+int test_document_render_to_bitmap (stub_env_t *stub, jlong document, jobject bitmap);
+
+void test_document_destroy (stub_env_t *stub, jlong document);
+
+int test_jni_render (void);
+
+int test_jni_path_transitions (void);
+
+int test_jni_global_refs (void);
+
+int test_jni_steady_state (void);
+
+/* test_threads.c */
+int test_threads (void);
+
+/* test_golden.c */
+int test_golden (void);
+
+/* test_fixed_point.c */
+int test_fixed_point (void);
+
+#endif
@@ -0,0 +1,280 @@
+/* libsvg-android host tests
+ *
+ * Copyright © 2016 Anton Persson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy (COPYING.LESSER) of the
+ * GNU Lesser General Public License along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <math.h>
+
+#include <svg.h>
+
+#include "svg_tests.h"
+#include "polyline_copy.h"
+
+/* The same shapes flattened by svg_polyline in double and in the 16.16
+ * fixed point of LIBSVG_FIXED_POINT, both built into the tests whichever
+ * way the library is (see polyline_copy.h). Both keep within the
+ * tolerance of the true curve, a quarter of a device pixel, so neither
+ * may be further than half a pixel from the other. Every point of one
+ * is held to that against the lines of the other, in both directions,
+ * and so are the extents, the subpaths and what is inside.
+ *
+ * Fixed point estimates the number of lines a curve needs from the
+ * largest component instead of the length, which may cost up to
+ * sqrt(2) times the lines, never fewer.
+ */
+
+#define TEST_FIXED_POINT_TOLERANCE 0.25	// device pixels
+#define TEST_FIXED_POINT_BOUND 0.5	// device pixels
+#define TEST_FIXED_POINT_GRID 64
+
+typedef struct test_fixed_point_op {
+	char op; // M, L, C, Z, E (ellipse) and R (rect), 0 ends the shape
+	double a[8];
+} test_fixed_point_op_t;
+
+typedef struct test_fixed_point_shape {
+	const char *name;
+	double scale; // device pixels per user unit
+	test_fixed_point_op_t ops[12];
+} test_fixed_point_shape_t;
+
+static const test_fixed_point_shape_t test_fixed_point_shapes[] = {
+	{ "lines", 1.0, {
+			{ 'M', { 10.0, 10.0 } }, { 'L', { 90.0, 15.0 } }, { 'L', { 50.0, 80.0 } }, { 'Z', { 0 } },
+			// drawing on after a close starts over at 10, 10
+			{ 'L', { 30.0, 95.0 } },
+			{ 'M', { 20.5, 20.25 } }, { 'L', { 30.125, 20.0 } },
+		} },
+	{ "s-curve", 1.0, {
+			{ 'M', { 0.0, 0.0 } },
+			{ 'C', { 0.0, 0.0, 120.0, 400.0, 280.0, -200.0, 400.0, 80.0 } },
+		} },
+	{ "s-curve scaled", 16.0, {
+			{ 'M', { 0.0, 0.0 } },
+			{ 'C', { 0.0, 0.0, 3.0, 10.0, 7.0, -5.0, 10.0, 2.0 } },
+			{ 'C', { 10.0, 2.0, 11.0, 3.0, 9.0, 6.0, 0.0, 0.0 } }, { 'Z', { 0 } },
+		} },
+	{ "negative", 1.0, {
+			{ 'M', { -300.0, -20.0 } },
+			{ 'C', { -300.0, -20.0, -20.0, -300.0, -250.0, -250.0, -20.0, -120.0 } },
+			{ 'L', { -300.0, -20.0 } },
+		} },
+	{ "ellipse", 1.0, {
+			{ 'E', { 50.0, 50.0, 40.0, 25.0 } },
+		} },
+	{ "ellipse huge", 1.0, {
+			{ 'E', { 0.0, 0.0, 30000.0, 20000.0 } },
+		} },
+	{ "rects", 4.0, {
+			{ 'R', { 5.0, 5.0, 90.0, 60.0, 12.0, 8.0 } },
+			{ 'R', { 20.0, 20.0, 30.0, 20.0, 0.0, 0.0 } },
+		} },
+};
+
+static void
+test_fixed_point_build (const test_fixed_point_shape_t *shape,
+			const polyline_copy_backend_t *backend, polyline_copy_t *copy)
+{
+	const test_fixed_point_op_t *op;
+
+	for(op = shape->ops; op->op; op++) {
+		const double *a = op->a;
+
+		switch(op->op) {
+		case 'M': backend->move_to(copy, a[0], a[1]); break;
+		case 'L': backend->line_to(copy, a[0], a[1]); break;
+		case 'C': backend->curve_to(copy, a[0], a[1], a[2], a[3],
+					    a[4], a[5], a[6], a[7]); break;
+		case 'Z': backend->close_path(copy); break;
+		case 'E': backend->ellipse(copy, a[0], a[1], a[2], a[3]); break;
+		case 'R': backend->rect(copy, a[0], a[1], a[2], a[3], a[4], a[5]); break;
+		}
+	}
+}
+
+static double
+test_fixed_point_segment_distance (double px, double py, double ax, double ay, double bx, double by)
+{
+	double dx = bx - ax, dy = by - ay, l = dx * dx + dy * dy;
+	double t = l > 0.0 ? ((px - ax) * dx + (py - ay) * dy) / l : 0.0;
+
+	if(t < 0.0) t = 0.0;
+	if(t > 1.0) t = 1.0;
+	dx = ax + t * dx - px;
+	dy = ay + t * dy - py;
+
+	return sqrt(dx * dx + dy * dy);
+}
+
+/* how far (px, py) is from the lines of a subpath, the closing one
+ * included when it is closed */
+static double
+test_fixed_point_subpath_distance (const polyline_copy_backend_t *backend,
+				   const polyline_copy_t *copy, int s, double px, double py)
+{
+	double ax, ay, bx, by, d, nearest = HUGE_VAL;
+	int first, count, closed, k, n;
+
+	backend->subpath(copy, s, &first, &count, &closed);
+	n = closed || count == 1 ? count : count - 1;
+	for(k = 0; k < n; k++) {
+		backend->point(copy, first + k, &ax, &ay);
+		backend->point(copy, first + (k + 1) % count, &bx, &by);
+		d = test_fixed_point_segment_distance(px, py, ax, ay, bx, by);
+		if(d < nearest)
+			nearest = d;
+	}
+
+	return nearest;
+}
+
+/* the furthest a point of a subpath of one is from the other, in user units */
+static double
+test_fixed_point_distance (const polyline_copy_t *from, const polyline_copy_backend_t *from_backend,
+			   const polyline_copy_t *to, const polyline_copy_backend_t *to_backend,
+			   int s)
+{
+	double x, y, d, worst = 0.0;
+	int first, count, closed, k;
+
+	from_backend->subpath(from, s, &first, &count, &closed);
+	for(k = first; k < first + count; k++) {
+		from_backend->point(from, k, &x, &y);
+		d = test_fixed_point_subpath_distance(to_backend, to, s, x, y);
+		if(d > worst)
+			worst = d;
+	}
+
+	return worst;
+}
+
+/* how far (px, py) is from any line */
+static double
+test_fixed_point_edge_distance (const polyline_copy_backend_t *backend,
+				const polyline_copy_t *copy, double px, double py)
+{
+	double d, nearest = HUGE_VAL;
+	int s;
+
+	for(s = 0; s < backend->num_subpaths(copy); s++) {
+		d = test_fixed_point_subpath_distance(backend, copy, s, px, py);
+		if(d < nearest)
+			nearest = d;
+	}
+
+	return nearest;
+}
+
+static int
+test_fixed_point_compare (const test_fixed_point_shape_t *shape,
+			  const polyline_copy_t *ref, const polyline_copy_t *fixed)
+{
+	const polyline_copy_backend_t *r = &double_polyline, *f = &fixed_polyline;
+	double bound = TEST_FIXED_POINT_BOUND / shape->scale;
+	double x1, y1, x2, y2, rx1, ry1, rx2, ry2, x, y, d, rd;
+	int s, i, j, first, count, closed, rfirst, rcount, rclosed, curves = 0;
+	const test_fixed_point_op_t *op;
+
+	for(op = shape->ops; op->op; op++)
+		curves += op->op == 'C' ? 1 : op->op == 'E' || op->op == 'R' ? 4 : 0;
+
+	CHECK(!r->error(ref) && !f->error(fixed));
+
+	// the same subpaths, each with at least the lines of the double one
+	// and at most sqrt(2) times those of its curves more, plus rounding
+	CHECK(f->num_subpaths(fixed) == r->num_subpaths(ref));
+	CHECK(f->num_points(fixed) >= r->num_points(ref));
+	CHECK(f->num_points(fixed) <= r->num_points(ref) * 3 / 2 + curves);
+	for(s = 0; s < r->num_subpaths(ref); s++) {
+		f->subpath(fixed, s, &first, &count, &closed);
+		r->subpath(ref, s, &rfirst, &rcount, &rclosed);
+		CHECK(closed == rclosed);
+		CHECK(count >= rcount);
+
+		d = test_fixed_point_distance(fixed, f, ref, r, s);
+		rd = test_fixed_point_distance(ref, r, fixed, f, s);
+		d = (d > rd ? d : rd) * shape->scale;
+		if(d > TEST_FIXED_POINT_BOUND)
+			fprintf(stderr, "%s: subpath %d strays %g pixels\n", shape->name, s, d);
+		CHECK(d <= TEST_FIXED_POINT_BOUND);
+	}
+
+	// the extents are the same points, only rounded to 16.16
+	CHECK(f->extents(fixed, &x1, &y1, &x2, &y2) == r->extents(ref, &rx1, &ry1, &rx2, &ry2));
+	CHECK(fabs(x1 - rx1) <= 1.0 / 65536);
+	CHECK(fabs(y1 - ry1) <= 1.0 / 65536);
+	CHECK(fabs(x2 - rx2) <= 1.0 / 65536);
+	CHECK(fabs(y2 - ry2) <= 1.0 / 65536);
+
+	// inside is inside for both, away from the lines where they differ
+	for(i = 0; i <= TEST_FIXED_POINT_GRID; i++) {
+		for(j = 0; j <= TEST_FIXED_POINT_GRID; j++) {
+			x = rx1 - bound + (rx2 - rx1 + 2.0 * bound) * i / TEST_FIXED_POINT_GRID;
+			y = ry1 - bound + (ry2 - ry1 + 2.0 * bound) * j / TEST_FIXED_POINT_GRID;
+			if(test_fixed_point_edge_distance(r, ref, x, y) <= bound)
+				continue;
+
+			CHECK(f->contains(fixed, SVG_FILL_RULE_NONZERO, x, y) ==
+			      r->contains(ref, SVG_FILL_RULE_NONZERO, x, y));
+			CHECK(f->contains(fixed, SVG_FILL_RULE_EVEN_ODD, x, y) ==
+			      r->contains(ref, SVG_FILL_RULE_EVEN_ODD, x, y));
+		}
+	}
+
+	return 0;
+}
+
+static int
+test_fixed_point_shape (const test_fixed_point_shape_t *shape)
+{
+	double tolerance = TEST_FIXED_POINT_TOLERANCE / shape->scale;
+	polyline_copy_t *ref, *fixed;
+	int failed;
+
+	ref = double_polyline.create(tolerance);
+	CHECK(ref != NULL);
+	fixed = fixed_polyline.create(tolerance);
+	if(fixed == NULL) {
+		double_polyline.destroy(ref);
+		CHECK(fixed != NULL);
+	}
+
+	test_fixed_point_build(shape, &double_polyline, ref);
+	test_fixed_point_build(shape, &fixed_polyline, fixed);
+
+	failed = test_fixed_point_compare(shape, ref, fixed);
+
+	fixed_polyline.destroy(fixed);
+	double_polyline.destroy(ref);
+
+	return failed;
+}
+
+int
+test_fixed_point (void)
+{
+	size_t k;
+
+	for(k = 0; k < sizeof(test_fixed_point_shapes) / sizeof(test_fixed_point_shapes[0]); k++)
+		if(test_fixed_point_shape(&test_fixed_point_shapes[k])) {
+			fprintf(stderr, "shape %s\n", test_fixed_point_shapes[k].name);
+			return 1;
+		}
+
+	return 0;
+}
@@ -0,0 +1,235 @@
+/* libsvg-android host tests
+ *
+ * Copyright © 2016 Anton Persson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy (COPYING.LESSER) of the
+ * GNU Lesser General Public License along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <png.h>
+
+#include <svg.h>
+#include <svg-soft.h>
+
+#include "svg_tests.h"
+
+/* Every fixture in data/ is rendered with the software engine on a
+ * white background and compared with the PNG next to it. A channel
+ * may be off by the tolerance, to allow for a different compiler or
+ * libm rounding a coverage value the other way.
+ *
+ * SVG_TESTS_UPDATE_GOLDEN=1 ./svg-tests golden rewrites the PNGs,
+ * look at them before committing them. A failing render is written
+ * to obj/<fixture>.png.
+ *
+ * Built with LIBSVG_FIXED_POINT the geometry may be up to half a pixel
+ * off the double geometry the PNGs were made with (test_fixed_point.c
+ * holds it to that), which moves the coverage of edge pixels by any
+ * amount - a sliver may come or go. Away from edges, where the golden
+ * 3 x 3 neighbourhood is flat, pixels must still match. Along edges
+ * the area that moved, every difference over the contrast at that
+ * pixel, may not exceed half a pixel times the length of the edges.
+ * The neighbourhood marks a band three pixels wide along every edge,
+ * so the length is taken as a third of the pixels in it - short where
+ * bands overlap, along thin strokes, which errs on the strict side.
+ */
+
+#define TEST_GOLDEN_SIZE 100
+#define TEST_GOLDEN_TOLERANCE 2
+#define TEST_GOLDEN_SHIFT 0.5	// pixels, fixed point only
+
+static const char *test_golden_fixtures[] = {
+	"fill",
+	"stroke",
+	"gradient",
+	"pattern_image",
+	"pattern_deep",
+	"opacity",
+	"arcs_units",
+};
+
+static int
+test_golden_render (const char *file, unsigned char *pixels)
+{
+	svg_t *svg;
+	svg_soft_t *soft;
+	svg_status_t status;
+
+	memset(pixels, 255, TEST_GOLDEN_SIZE * TEST_GOLDEN_SIZE * 4);
+
+	CHECK(svg_create (&svg, &SVG_SOFT_RENDER_ENGINE, NULL) == SVG_STATUS_SUCCESS);
+	soft = svgSoftCreate (svg);
+	CHECK(soft != NULL);
+
+	status = svg_parse (svg, file);
+	if(status == SVG_STATUS_SUCCESS)
+		status = svgSoftRender (soft, pixels, TEST_GOLDEN_SIZE, TEST_GOLDEN_SIZE,
+					TEST_GOLDEN_SIZE * 4);
+
+	svgSoftDestroy (soft);
+	svg_destroy (svg);
+	CHECK(status == SVG_STATUS_SUCCESS);
+
+	return 0;
+}
+
+/* the pixels are opaque, so premultiplied and straight RGBA agree */
+static int
+test_golden_write_png (const char *file, const unsigned char *pixels)
+{
+	png_image image;
+
+	memset(&image, 0, sizeof(image));
+	image.version = PNG_IMAGE_VERSION;
+	image.width = TEST_GOLDEN_SIZE;
+	image.height = TEST_GOLDEN_SIZE;
+	image.format = PNG_FORMAT_RGB;
+
+	/* png_image drops the alpha channel given the stride of RGBA */
+	{
+		unsigned char rgb[TEST_GOLDEN_SIZE * TEST_GOLDEN_SIZE * 3];
+		int k;
+
+		for(k = 0; k < TEST_GOLDEN_SIZE * TEST_GOLDEN_SIZE; k++)
+			memcpy(rgb + 3 * k, pixels + 4 * k, 3);
+		CHECK(png_image_write_to_file(&image, file, 0, rgb, 0, NULL));
+	}
+
+	return 0;
+}
+
+static int
+test_golden_read_png (const char *file, unsigned char *rgb)
+{
+	png_image image;
+
+	memset(&image, 0, sizeof(image));
+	image.version = PNG_IMAGE_VERSION;
+	if(!png_image_begin_read_from_file(&image, file)) {
+		fprintf(stderr, "%s: %s\n", file, image.message);
+		return 1;
+	}
+	image.format = PNG_FORMAT_RGB;
+	CHECK(image.width == TEST_GOLDEN_SIZE && image.height == TEST_GOLDEN_SIZE);
+	CHECK(png_image_finish_read(&image, NULL, rgb, 0, NULL));
+
+	return 0;
+}
+
+#ifdef LIBSVG_FIXED_POINT
+/* the range of the golden values around pixel k, in every channel */
+static int
+test_golden_contrast (const unsigned char *golden, int k, int *lo, int *hi)
+{
+	int x = k % TEST_GOLDEN_SIZE, y = k / TEST_GOLDEN_SIZE;
+	int dx, dy, c, g, contrast = 0;
+
+	for(c = 0; c < 3; c++) {
+		lo[c] = hi[c] = golden[3 * k + c];
+		for(dy = -1; dy <= 1; dy++) {
+			for(dx = -1; dx <= 1; dx++) {
+				if(x + dx < 0 || x + dx >= TEST_GOLDEN_SIZE ||
+				   y + dy < 0 || y + dy >= TEST_GOLDEN_SIZE)
+					continue;
+				g = golden[3 * (k + dy * TEST_GOLDEN_SIZE + dx) + c];
+				if(g < lo[c]) lo[c] = g;
+				if(g > hi[c]) hi[c] = g;
+			}
+		}
+		if(hi[c] - lo[c] > contrast)
+			contrast = hi[c] - lo[c];
+	}
+
+	return contrast;
+}
+#endif
+
+static int
+test_golden_fixture (const char *name)
+{
+	static unsigned char pixels[TEST_GOLDEN_SIZE * TEST_GOLDEN_SIZE * 4];
+	static unsigned char golden[TEST_GOLDEN_SIZE * TEST_GOLDEN_SIZE * 3];
+	char svg_file[256], png_file[256];
+	int k, c, worst = 0, wrong = 0, edge_pixels = 0;
+	double moved = 0.0;
+
+	snprintf(svg_file, sizeof(svg_file), "data/%s.svg", name);
+	snprintf(png_file, sizeof(png_file), "data/%s.png", name);
+	CHECK(test_golden_render (svg_file, pixels) == 0);
+
+	if(getenv("SVG_TESTS_UPDATE_GOLDEN"))
+		return test_golden_write_png (png_file, pixels);
+
+	CHECK(test_golden_read_png (png_file, golden) == 0);
+	for(k = 0; k < TEST_GOLDEN_SIZE * TEST_GOLDEN_SIZE; k++) {
+#ifdef LIBSVG_FIXED_POINT
+		int lo[3], hi[3];
+
+		if(test_golden_contrast (golden, k, lo, hi) > TEST_GOLDEN_TOLERANCE) {
+			double area = 0.0;
+
+			for(c = 0; c < 3; c++) {
+				double a = (double)abs(pixels[4 * k + c] - golden[3 * k + c]) /
+					(hi[c] - lo[c] > TEST_GOLDEN_TOLERANCE ? hi[c] - lo[c] : 255);
+
+				if(a > area)
+					area = a;
+			}
+			moved += area < 1.0 ? area : 1.0;
+			edge_pixels++;
+			continue;
+		}
+#endif
+		for(c = 0; c < 3; c++) {
+			int d = abs(pixels[4 * k + c] - golden[3 * k + c]);
+
+			if(d > worst)
+				worst = d;
+			if(d > TEST_GOLDEN_TOLERANCE) {
+				wrong++;
+				break;
+			}
+		}
+	}
+
+	if(moved > TEST_GOLDEN_SHIFT * edge_pixels / 3.0) {
+		fprintf(stderr, "%s: %.1f pixels of area moved along edges %.0f pixels long\n",
+			name, moved, edge_pixels / 3.0);
+		wrong++;
+	}
+
+	if(wrong) {
+		snprintf(png_file, sizeof(png_file), "obj/%s.png", name);
+		fprintf(stderr, "%s: %d pixels differ, by up to %d, see %s\n",
+			name, wrong, worst, png_file);
+		test_golden_write_png (png_file, pixels);
+		return 1;
+	}
+
+	return 0;
+}
+
+int
+test_golden (void)
+{
+	int k, failed = 0;
+
+	for(k = 0; k < sizeof(test_golden_fixtures) / sizeof(test_golden_fixtures[0]); k++)
+		failed |= test_golden_fixture (test_golden_fixtures[k]);
+
+	return failed;
+}
@@ -0,0 +1,344 @@
+/* libsvg-android host tests
+ *
+ * Copyright © 2016 Anton Persson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy (COPYING.LESSER) of the
+ * GNU Lesser General Public License along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include <svg-android.h>
+
+#include "svg_tests.h"
+
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved);
+
+typedef jlong (*create_native_t)(JNIEnv *env, jclass jc);
+typedef jint (*destroy_native_t)(JNIEnv *env, jclass jc, jlong document);
+typedef jint (*parse_native_t)(JNIEnv *env, jclass jc, jlong document, jstring buffer);
+typedef jint (*render_native_t)(JNIEnv *env, jclass jc, jlong document, jobject target);
+typedef jint (*render_area_native_t)(JNIEnv *env, jclass jc, jlong document, jobject canvas,
+				     jint x, jint y, jint w, jint h);
+
+static pthread_once_t test_jni_once = PTHREAD_ONCE_INIT;
+stub_env_t *test_jni_env;
+static jint test_jni_version;
+
+static void
+test_jni_do_load (void)
+{
+	test_jni_env = stub_env_create ();
+	test_jni_version = JNI_OnLoad(stub_vm (), NULL);
+}
+
+int
+test_jni_load (void)
+{
+	pthread_once(&test_jni_once, test_jni_do_load);
+
+	return test_jni_version == JNI_VERSION_1_6 ? 0 : 1;
+}
+
+jlong
+test_document_create (stub_env_t *stub, const char *svg)
+{
+	create_native_t create = stub_native ("svgAndroidCreate");
+	parse_native_t parse = stub_native ("svgAndroidParseBuffer");
+	destroy_native_t destroy = stub_native ("svgAndroidDestroy");
+	JNIEnv *env = stub_env_jni (stub);
+	jlong document;
+
+	document = create(env, NULL);
+	if(document == 0)
+		return 0;
+
+	if(parse(env, NULL, document, stub_new_string (stub, svg))) {
+		destroy(env, NULL, document);
+		return 0;
+	}
+
+	return document;
+}
+
+int
+test_document_render (stub_env_t *stub, jlong document, jobject canvas)
+{
+	render_native_t render = stub_native ("svgAndroidRender");
+
+	return render(stub_env_jni (stub), NULL, document, canvas);
+}
+
+int
+test_document_render_to_bitmap (stub_env_t *stub, jlong document, jobject bitmap)
+{
+	render_native_t render = stub_native ("svgAndroidRenderToBitmap");
+
+	return render(stub_env_jni (stub), NULL, document, bitmap);
+}
+
+void
+test_document_destroy (stub_env_t *stub, jlong document)
+{
+	destroy_native_t destroy = stub_native ("svgAndroidDestroy");
+
+	destroy(stub_env_jni (stub), NULL, document);
+}
+
+static const char *test_jni_svg =
+	"<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"200\" height=\"200\">"
+	"<rect x=\"10\" y=\"10\" width=\"80\" height=\"60\" fill=\"red\" stroke=\"black\"/>"
+	"<circle cx=\"140\" cy=\"60\" r=\"40\" fill=\"blue\"/>"
+	"<g opacity=\"0.5\">"
+	"<path d=\"M10 120 L190 120 L100 190 Z\" fill=\"green\" stroke=\"navy\" stroke-width=\"4\"/>"
+	"<ellipse cx=\"100\" cy=\"150\" rx=\"50\" ry=\"20\" fill=\"none\" stroke=\"orange\"/>"
+	"</g>"
+	"</svg>";
+
+/* A document goes through create, parse, render and destroy on one env,
+ * which must then be left without stale or dangling refs. */
+int
+test_jni_render (void)
+{
+	stub_env_t *stub;
+	jobject canvas;
+	jlong document;
+	int globals, locals;
+
+	CHECK(test_jni_load () == 0);
+	CHECK(stub_native ("svgAndroidRender") != NULL);
+
+	stub = stub_env_create ();
+	globals = stub_global_refs ();
+	canvas = stub_new_canvas (stub, 200, 200);
+	locals = stub_env_local_refs (stub);
+
+	document = test_document_create (stub, test_jni_svg);
+	CHECK(document != 0);
+
+	stub_env_reset (stub);
+	CHECK(test_document_render (stub, document, canvas) == 0);
+	if(getenv("JNI_STUB_REPORT"))
+		stub_env_report (stub, stdout, "render");
+
+	CHECK(stub_env_stale_refs (stub) == 0);
+	CHECK(stub_env_local_refs (stub) == locals + 1); // the svg string
+	CHECK(stub_canvas_calls (canvas) > 0);
+	CHECK(stub_env_method_calls (stub, "android/graphics/Canvas.drawPath") > 0);
+
+	test_document_destroy (stub, document);
+	CHECK(stub_env_stale_refs (stub) == 0);
+	CHECK(stub_global_refs () == globals);
+
+	stub_env_destroy (stub);
+
+	return 0;
+}
+
+/* a document holding a single path of segments line segments */
+static char *
+test_jni_path_svg (int segments)
+{
+	char *svg = malloc(200 + 24 * segments), *p;
+	int k;
+
+	if(svg == NULL)
+		return NULL;
+
+	p = svg + sprintf(svg, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"200\" height=\"200\">"
+			  "<path fill=\"black\" d=\"M0 0");
+	for(k = 0; k < segments; k++)
+		p += sprintf(p, " L%d %d", k % 200, (k * 7) % 200);
+	sprintf(p, " Z\"/></svg>");
+
+	return svg;
+}
+
+static int
+test_jni_path_render (stub_env_t *stub, int segments, unsigned int *transitions)
+{
+	char *svg = test_jni_path_svg (segments);
+	jobject canvas = stub_new_canvas (stub, 200, 200);
+	jlong document;
+
+	CHECK(svg != NULL);
+	document = test_document_create (stub, svg);
+	free(svg);
+	CHECK(document != 0);
+
+	stub_env_reset (stub);
+	CHECK(test_document_render (stub, document, canvas) == 0);
+	*transitions = stub_env_transitions (stub);
+	if(getenv("JNI_STUB_REPORT"))
+		stub_env_report (stub, stdout, segments > 10 ? "long path" : "short path");
+
+	/* the segments reach java in one replayPath() call, never one
+	 * Path method call each as they did before the command buffer */
+	CHECK(stub_env_method_calls (stub, "com/toolkits/libsvgandroid/SvgRaster.replayPath") == 1);
+	CHECK(stub_env_method_calls (stub, "android/graphics/Path.moveTo") == 0);
+	CHECK(stub_env_method_calls (stub, "android/graphics/Path.lineTo") == 0);
+	CHECK(stub_env_method_calls (stub, "android/graphics/Path.close") == 0);
+
+	test_document_destroy (stub, document);
+	CHECK(stub_env_stale_refs (stub) == 0);
+
+	return 0;
+}
+
+/* The calls into java a path costs do not grow with its length: a 10
+ * and a 10000 segment path cost the same. With one Path call per
+ * segment the long one would have cost at least 10000 more. */
+int
+test_jni_path_transitions (void)
+{
+	stub_env_t *stub;
+	unsigned int short_path, long_path;
+
+	CHECK(test_jni_load () == 0);
+	stub = stub_env_create ();
+
+	CHECK(test_jni_path_render (stub, 10, &short_path) == 0);
+	CHECK(test_jni_path_render (stub, 10000, &long_path) == 0);
+	CHECK(long_path == short_path);
+
+	/* moveTo, 10000 lineTo and close instead of the one replayPath */
+	printf("%u calls into java, %u with a Path call per segment  ",
+	       long_path, long_path - 1 + 10002);
+
+	stub_env_destroy (stub);
+
+	return 0;
+}
+
+/* more paths than SVG_ANDROID_PATH_CACHE_MAX_ENTRIES, so the cache
+ * evicts on every render */
+static char *
+test_jni_many_paths_svg (int paths)
+{
+	char *svg = malloc(200 + 80 * paths), *p;
+	int k;
+
+	if(svg == NULL)
+		return NULL;
+
+	p = svg + sprintf(svg, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"200\" height=\"200\">");
+	for(k = 0; k < paths; k++)
+		p += sprintf(p, "<path stroke=\"black\" d=\"M%d %d l10 0 l0 10 z\"/>",
+			     k % 190, (k * 7) % 190);
+	sprintf(p, "</svg>");
+
+	return svg;
+}
+
+/* Documents with the path cache on go through create, two renders and
+ * destroy again and again. The cache stays within its budget while a
+ * document lives, and every global ref is gone once it is destroyed. */
+int
+test_jni_global_refs (void)
+{
+	stub_env_t *stub;
+	jobject canvas;
+	jlong document;
+	char *svg;
+	int baseline, k;
+
+	CHECK(test_jni_load () == 0);
+	stub = stub_env_create ();
+	canvas = stub_new_canvas (stub, 200, 200);
+	svg = test_jni_many_paths_svg (300);
+	CHECK(svg != NULL);
+
+	baseline = stub_global_refs ();
+	for(k = 0; k < 20; k++) {
+		document = test_document_create (stub, svg);
+		CHECK(document != 0);
+		svgAndroidEnablePathCache ((svg_android_t *)(intptr_t)document);
+
+		CHECK(test_document_render (stub, document, canvas) == 0);
+		CHECK(test_document_render (stub, document, canvas) == 0);
+		CHECK(stub_global_refs () - baseline >= 256); // the cache is full
+		CHECK(stub_global_refs () - baseline <= 256 + 64);
+
+		test_document_destroy (stub, document);
+		CHECK(stub_global_refs () == baseline);
+	}
+	CHECK(stub_env_stale_refs (stub) == 0);
+
+	free(svg);
+	stub_env_destroy (stub);
+
+	return 0;
+}
+
+static const char *test_jni_steady_svg =
+	"<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"200\" height=\"200\">"
+	"<defs>"
+	"<linearGradient id=\"lg\"><stop offset=\"0\" stop-color=\"red\"/>"
+	"<stop offset=\"1\" stop-color=\"blue\"/></linearGradient>"
+	"<radialGradient id=\"rg\"><stop offset=\"0\" stop-color=\"white\"/>"
+	"<stop offset=\"1\" stop-color=\"black\"/></radialGradient>"
+	"</defs>"
+	"<rect x=\"10\" y=\"10\" width=\"80\" height=\"60\" fill=\"url(#lg)\"/>"
+	"<circle cx=\"140\" cy=\"60\" r=\"40\" fill=\"url(#rg)\" stroke=\"black\""
+	" stroke-dasharray=\"5 3\"/>"
+	"<g opacity=\"0.5\">"
+	"<path d=\"M10 120 C60 100 140 180 190 120 Z\" fill=\"green\" stroke=\"navy\""
+	" stroke-width=\"4\" stroke-dasharray=\"8 4\"/>"
+	"</g>"
+	"<text x=\"20\" y=\"190\" font-family=\"sans-serif\" font-size=\"16\">libsvg</text>"
+	"</svg>";
+
+/* Rendering a document that has not changed since the last render
+ * creates no java objects, whether to a canvas or to an area of one. */
+int
+test_jni_steady_state (void)
+{
+	render_area_native_t render_area;
+	stub_env_t *stub;
+	jobject canvas;
+	jlong document;
+
+	CHECK(test_jni_load () == 0);
+	render_area = stub_native ("svgAndroidRenderToArea");
+	stub = stub_env_create ();
+	canvas = stub_new_canvas (stub, 200, 200);
+	document = test_document_create (stub, test_jni_steady_svg);
+	CHECK(document != 0);
+
+	CHECK(test_document_render (stub, document, canvas) == 0);
+	stub_env_reset (stub);
+	CHECK(test_document_render (stub, document, canvas) == 0);
+	if(getenv("JNI_STUB_REPORT"))
+		stub_env_report (stub, stdout, "second render");
+	CHECK(stub_env_allocations (stub) == 0);
+	CHECK(stub_env_function_calls (stub, STUB_NEW_OBJECT) == 0);
+	CHECK(stub_env_function_calls (stub, STUB_NEW_ARRAY) == 0);
+	CHECK(stub_env_function_calls (stub, STUB_NEW_STRING) == 0);
+
+	CHECK(render_area(stub_env_jni (stub), NULL, document, canvas, 10, 10, 100, 100) == 0);
+	stub_env_reset (stub);
+	CHECK(render_area(stub_env_jni (stub), NULL, document, canvas, 10, 10, 100, 100) == 0);
+	if(getenv("JNI_STUB_REPORT"))
+		stub_env_report (stub, stdout, "second render to area");
+	CHECK(stub_env_allocations (stub) == 0);
+
+	test_document_destroy (stub, document);
+	CHECK(stub_env_stale_refs (stub) == 0);
+	stub_env_destroy (stub);
+
+	return 0;
+}
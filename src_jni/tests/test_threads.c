@@ -0,0 +1,140 @@
+/* libsvg-android host tests
+ *
+ * Copyright © 2016 Anton Persson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy (COPYING.LESSER) of the
+ * GNU Lesser General Public License along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "svg_tests.h"
+
+#define TEST_THREADS 4
+#define TEST_THREAD_ROUNDS 25
+#define TEST_SIZE 120
+
+static const char *test_threads_svg =
+	"<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"120\" height=\"120\">"
+	"<defs><linearGradient id=\"lg\"><stop offset=\"0\" stop-color=\"red\"/>"
+	"<stop offset=\"1\" stop-color=\"blue\"/></linearGradient></defs>"
+	"<rect x=\"5\" y=\"5\" width=\"60\" height=\"40\" fill=\"url(#lg)\" stroke=\"black\"/>"
+	"<g opacity=\"0.5\" transform=\"rotate(10 60 60)\">"
+	"<circle cx=\"70\" cy=\"70\" r=\"30\" fill=\"green\" stroke=\"navy\" stroke-width=\"3\"/>"
+	"<path d=\"M10 110 C40 60 80 120 110 70\" fill=\"none\" stroke=\"orange\""
+	" stroke-width=\"5\" stroke-dasharray=\"6 2\"/>"
+	"</g>"
+	"<ellipse cx=\"90\" cy=\"25\" rx=\"20\" ry=\"10\" fill=\"purple\" fill-opacity=\"0.7\"/>"
+	"</svg>";
+
+/* what one render of test_threads_svg produced */
+typedef struct test_render {
+	unsigned int canvas_calls;
+	unsigned int transitions;
+	unsigned char pixels[TEST_SIZE * TEST_SIZE * 4];
+} test_render_t;
+
+static test_render_t test_threads_reference;
+
+/* A document kept for all rounds, and one created and destroyed in
+ * each, are rendered to a canvas and with the software engine. The
+ * first round is recorded in result if record is set, every round is
+ * compared with result. */
+static int
+test_threads_render (test_render_t *result, int rounds, int record)
+{
+	stub_env_t *stub = stub_env_create ();
+	jlong kept, document;
+	int k;
+
+	kept = test_document_create (stub, test_threads_svg);
+	CHECK(kept != 0);
+
+	for(k = 0; k < rounds; k++) {
+		jobject canvas = stub_new_canvas (stub, TEST_SIZE, TEST_SIZE);
+		jobject bitmap = stub_new_bitmap (stub, TEST_SIZE, TEST_SIZE);
+		unsigned int canvas_calls, transitions;
+
+		document = test_document_create (stub, test_threads_svg);
+		CHECK(document != 0);
+
+		stub_env_reset (stub);
+		CHECK(test_document_render (stub, document, canvas) == 0);
+		canvas_calls = stub_canvas_calls (canvas);
+		transitions = stub_env_transitions (stub);
+		CHECK(test_document_render_to_bitmap (stub, document, bitmap) == 0);
+		test_document_destroy (stub, document);
+
+		if(record && k == 0) {
+			result->canvas_calls = canvas_calls;
+			result->transitions = transitions;
+			memcpy(result->pixels, stub_bitmap_pixels (bitmap), sizeof(result->pixels));
+		}
+		CHECK(canvas_calls == result->canvas_calls);
+		CHECK(transitions == result->transitions);
+		CHECK(memcmp(stub_bitmap_pixels (bitmap), result->pixels, sizeof(result->pixels)) == 0);
+
+		canvas = stub_new_canvas (stub, TEST_SIZE, TEST_SIZE);
+		bitmap = stub_new_bitmap (stub, TEST_SIZE, TEST_SIZE);
+		CHECK(test_document_render (stub, kept, canvas) == 0);
+		CHECK(stub_canvas_calls (canvas) == result->canvas_calls);
+		CHECK(test_document_render_to_bitmap (stub, kept, bitmap) == 0);
+		CHECK(memcmp(stub_bitmap_pixels (bitmap), result->pixels, sizeof(result->pixels)) == 0);
+	}
+
+	test_document_destroy (stub, kept);
+	CHECK(stub_env_stale_refs (stub) == 0);
+	stub_env_destroy (stub);
+
+	return 0;
+}
+
+static void *
+test_threads_run (void *data)
+{
+	test_render_t *result = data;
+
+	return test_threads_render (result, TEST_THREAD_ROUNDS, 0) ? result : NULL;
+}
+
+/* Documents rendered on several threads at once, one document per
+ * thread at a time, come out exactly as they do rendered one by one. */
+int
+test_threads (void)
+{
+	static test_render_t results[TEST_THREADS];
+	pthread_t threads[TEST_THREADS];
+	void *failed;
+	int k;
+
+	CHECK(test_jni_load () == 0);
+	CHECK(test_threads_render (&test_threads_reference, 1, 1) == 0);
+	CHECK(test_threads_reference.canvas_calls > 0);
+	CHECK(test_threads_reference.pixels[4 * (25 * TEST_SIZE + 35) + 3] != 0); // in the rect
+
+	for(k = 0; k < TEST_THREADS; k++) {
+		results[k] = test_threads_reference;
+		CHECK(pthread_create(&threads[k], NULL, test_threads_run, &results[k]) == 0);
+	}
+
+	for(k = 0; k < TEST_THREADS; k++) {
+		CHECK(pthread_join(threads[k], &failed) == 0);
+		CHECK(failed == NULL);
+	}
+
+	return 0;
+}